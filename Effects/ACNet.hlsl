@@ -6,6 +6,8 @@
 //!VERSION 1
 //!OUTPUT_WIDTH INPUT_WIDTH * 2
 //!OUTPUT_HEIGHT INPUT_HEIGHT * 2
+//!HALF_PRECISION
+//!HALO 10
 
 
 //!CONSTANT
@@ -20,10 +22,11 @@ float inputPtY;
 //!TEXTURE
 Texture2D INPUT;
 
-//!TEXTURE
+//!TENSOR
 //!WIDTH INPUT_WIDTH
 //!HEIGHT INPUT_HEIGHT
-//!FORMAT B8G8R8A8_UNORM
+//!CHANNELS 3
+//!FORMAT R8G8B8A8_UNORM
 Texture2D yuvTex;
 
 //!TEXTURE
@@ -121,15 +124,21 @@ void Pass2(float2 pos, out float4 target1, out float4 target2) {
 	// [tl, tc, tr]
 	// [ml, mc, mr]
 	// [bl, bc, br]
-	float tl = yuvTex.Sample(sam, pos + float2(-inputPtX, -inputPtY)).x;
-	float ml = yuvTex.Sample(sam, pos + float2(-inputPtX, 0)).x;
-	float bl = yuvTex.Sample(sam, pos + float2(-inputPtX, inputPtY)).x;
-	float tc = yuvTex.Sample(sam, pos + float2(0, -inputPtY)).x;
-	float mc = yuvTex.Sample(sam, pos).x;
-	float bc = yuvTex.Sample(sam, pos + float2(0, inputPtY)).x;
-	float tr = yuvTex.Sample(sam, pos + float2(inputPtX, -inputPtY)).x;
-	float mr = yuvTex.Sample(sam, pos + float2(inputPtX, 0)).x;
-	float br = yuvTex.Sample(sam, pos + float2(inputPtX, inputPtY)).x;
+	// 4 次 Gather 覆盖 3x3 邻域的亮度
+	float4 g1 = yuvTex_Gather(0, pos + float2(-0.5 * inputPtX, -0.5 * inputPtY));
+	float4 g2 = yuvTex_Gather(0, pos + float2(1.5 * inputPtX, -0.5 * inputPtY));
+	float4 g3 = yuvTex_Gather(0, pos + float2(-0.5 * inputPtX, 1.5 * inputPtY));
+	float4 g4 = yuvTex_Gather(0, pos + float2(1.5 * inputPtX, 1.5 * inputPtY));
+
+	float tl = g1.w;
+	float ml = g1.x;
+	float bl = g3.w;
+	float tc = g1.z;
+	float mc = g1.y;
+	float bc = g3.z;
+	float tr = g2.w;
+	float mr = g2.x;
+	float br = g4.w;
 
 	target1 = RELU(float4(
 		tl * kernelsL1A[0 * 9 + 0] + tc * kernelsL1A[0 * 9 + 1] + tr * kernelsL1A[0 * 9 + 2] +
@@ -4170,6 +4179,6 @@ float4 Pass11(float2 pos) {
 		mc2.z * kernelsL10[24 + index] +
 		mc2.w * kernelsL10[28 + index], 0.0f, 1.0f);
 
-	float3 yuv = yuvTex.Sample(sam, pos).xyz;
+	float3 yuv = yuvTex_Sample(0, pos).xyz;
 	return float4(mul(_yuv2rgb, float3(luma, yuv.yz) - float3(0, 0.5, 0.5)), 1);
 }
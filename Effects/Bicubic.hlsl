@@ -3,6 +3,7 @@
 
 //!MAGPIE EFFECT
 //!VERSION 1
+//!HALO 3
 
 
 //!CONSTANT
@@ -28,16 +29,31 @@ float paramB;
 
 float paramC;
 
+//!CONSTANT
+//!DEFAULT 0
+//!MIN 0
+//!MAX 1
+
+// 0：在一个 Pass 中计算 4x4 的二维卷积
+// 1：先水平后垂直分两个 Pass 计算，每个像素只需 4+4 次采样
+int separable;
+
 //!TEXTURE
 Texture2D INPUT;
 
+// 水平方向缩放后的中间结果，负瓣会产生超出 [0, 1] 的值。只在 separable 为 1 时创建
+//!TEXTURE
+//!WIDTH OUTPUT_WIDTH
+//!HEIGHT INPUT_HEIGHT
+//!FORMAT R16G16B16A16_FLOAT
+Texture2D tmpTex;
+
 //!SAMPLER
 //!FILTER POINT
 SamplerState sam;
 
 
-//!PASS 1
-//!BIND INPUT
+//!COMMON
 
 
 float weight(float x, float B, float C) {
@@ -52,17 +68,21 @@ float weight(float x, float B, float C) {
 	}
 }
 
+// 一个方向上的 4 个权重，已归一化
 float4 weight4(float x) {
 	float B = paramB;
 	float C = paramC;
 
 
-	return float4(
+	float4 taps = float4(
 		weight(x - 2.0, B, C),
 		weight(x - 1.0, B, C),
 		weight(x, B, C),
 		weight(x + 1.0, B, C)
 	);
+
+	// make sure all taps added together is exactly 1.0, otherwise some (very small) distortion can occur
+	return taps / (taps.r + taps.g + taps.b + taps.a);
 }
 
 float3 line_run(float ypos, float4 xpos, float4 linetaps) {
@@ -73,15 +93,41 @@ float3 line_run(float ypos, float4 xpos, float4 linetaps) {
 }
 
 
+//!PASS 1
+//!BIND INPUT
+//!SAVE tmpTex
+//!CONDITION separable
+
 float4 Pass1(float2 pos) {
-	float2 f = frac(pos / float2(inputPtX, inputPtY) + 0.5);
+	// 水平方向
+	float f = frac(pos.x / inputPtX + 0.5);
+	float4 linetaps = weight4(1.0 - f);
 
-	float4 linetaps = weight4(1.0 - f.x);
+	float x = pos.x - (f + 1) * inputPtX;
+	float4 xpos = float4(x, x + inputPtX, x + 2 * inputPtX, x + 3 * inputPtX);
+
+	return float4(line_run(pos.y, xpos, linetaps), 1);
+}
+
+
+//!PASS 2
+//!BIND INPUT, tmpTex
+
+float4 Pass2(float2 pos) {
+	float2 f = frac(pos / float2(inputPtX, inputPtY) + 0.5);
 	float4 columntaps = weight4(1.0 - f.y);
 
-	// make sure all taps added together is exactly 1.0, otherwise some (very small) distortion can occur
-	linetaps /= linetaps.r + linetaps.g + linetaps.b + linetaps.a;
-	columntaps /= columntaps.r + columntaps.g + columntaps.b + columntaps.a;
+	if (separable) {
+		// 垂直方向，tmpTex 的行和 INPUT 对应，列和输出对应
+		float y = pos.y - (f.y + 1) * inputPtY;
+		return float4(tmpTex.Sample(sam, float2(pos.x, y)).rgb * columntaps.r
+			+ tmpTex.Sample(sam, float2(pos.x, y + inputPtY)).rgb * columntaps.g
+			+ tmpTex.Sample(sam, float2(pos.x, y + 2 * inputPtY)).rgb * columntaps.b
+			+ tmpTex.Sample(sam, float2(pos.x, y + 3 * inputPtY)).rgb * columntaps.a,
+			1);
+	}
+
+	float4 linetaps = weight4(1.0 - f.x);
 
 	// !!!改变当前坐标
 	pos -= (f + 1) * float2(inputPtX, inputPtY);
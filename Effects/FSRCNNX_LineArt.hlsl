@@ -5,6 +5,7 @@
 //!VERSION 1
 //!OUTPUT_WIDTH INPUT_WIDTH * 2
 //!OUTPUT_HEIGHT INPUT_HEIGHT * 2
+//!HALO 7
 
 
 //!CONSTANT
@@ -19,10 +20,11 @@ float inputPtY;
 //!TEXTURE
 Texture2D INPUT;
 
-//!TEXTURE
+//!TENSOR
 //!WIDTH INPUT_WIDTH
 //!HEIGHT INPUT_HEIGHT
-//!FORMAT B8G8R8A8_UNORM
+//!CHANNELS 3
+//!FORMAT R8G8B8A8_UNORM
 Texture2D yuvTex;
 
 //!TEXTURE
@@ -88,109 +90,123 @@ float4 Pass1(float2 pos) {
 //!SAVE featureMap1, featureMap2
 
 void Pass2(float2 pos, out float4 target1, out float4 target2) {
+	// 5x5 邻域的亮度，luma[i][j] 位于 (i - 2, j - 2)，9 次 Gather 覆盖 6x6 的区域
+	float luma[6][6];
+	[unroll]
+	for (int i = 0; i < 3; ++i) {
+		[unroll]
+		for (int j = 0; j < 3; ++j) {
+			float4 g = yuvTex_Gather(0, pos + float2((2 * i - 1.5) * inputPtX, (2 * j - 1.5) * inputPtY));
+			luma[2 * i][2 * j + 1] = g.x;
+			luma[2 * i + 1][2 * j + 1] = g.y;
+			luma[2 * i + 1][2 * j] = g.z;
+			luma[2 * i][2 * j] = g.w;
+		}
+	}
+
 	target1 = float4(-0.3117050230503082, 0.1817725896835327, 0.0011673698900267, -0.0044658286496997);
 	target1 += float4(-0.0187959559261799, -0.0206312909722328, 0.0226501729339361, 0.0111862262710929)
-		* yuvTex.Sample(sam, pos + float2(-2 * inputPtX, -2 * inputPtY)).x;
+		* luma[0][0];
 	target1 += float4(0.0469042696058750, 0.0428658165037632, -0.0208927169442177, -0.0053485808894038)
-		* yuvTex.Sample(sam, pos + float2(-2 * inputPtX, -inputPtY)).x;
+		* luma[0][1];
 	target1 += float4(0.0486242026090622, 0.0268428903073072, -0.1095351055264473, -0.0197027549147606)
-		* yuvTex.Sample(sam, pos + float2(-2 * inputPtX, 0)).x;
+		* luma[0][2];
 	target1 += float4(-0.0301427692174911, -0.0444439016282558, 0.0803908482193947, -0.0072240661829710)
-		* yuvTex.Sample(sam, pos + float2(-2 * inputPtX, inputPtY)).x;
+		* luma[0][3];
 	target1 += float4(0.0097448397427797, 0.0132117131724954, -0.0087575586512685, 0.0003270092420280)
-		* yuvTex.Sample(sam, pos + float2(-2 * inputPtX, 2 * inputPtY)).x;
+		* luma[0][4];
 	target1 += float4(0.0227436870336533, 0.0284603293985128, -0.0899902656674385, 0.0174379274249077)
-		* yuvTex.Sample(sam, pos + float2(-inputPtX, -2 * inputPtY)).x;
+		* luma[1][0];
 	target1 += float4(-0.0880827009677887, -0.0890802741050720, 0.3386772871017456, -0.0749290063977242)
-		* yuvTex.Sample(sam, pos + float2(-inputPtX, -inputPtY)).x;
+		* luma[1][1];
 	target1 += float4(-0.0832799598574638, -0.1518420130014420, 0.1693033277988434, 0.1514045447111130)
-		* yuvTex.Sample(sam, pos + float2(-inputPtX, 0)).x;
+		* luma[1][2];
 	target1 += float4(0.0490957386791706, 0.0839962288737297, 0.0323486365377903, -0.0491475425660610)
-		* yuvTex.Sample(sam, pos + float2(-inputPtX, inputPtY)).x;
+		* luma[1][3];
 	target1 += float4(0.0281097982078791, 0.0267692077904940, -0.0460123419761658, 0.0137899341061711)
-		* yuvTex.Sample(sam, pos + float2(-inputPtX, 2 * inputPtY)).x;
+		* luma[1][4];
 	target1 += float4(0.0592067055404186, -0.0008030450553633, 0.1280025541782379, -0.0270480886101723)
-		* yuvTex.Sample(sam, pos + float2(0, -2 * inputPtY)).x;
+		* luma[2][0];
 	target1 += float4(-0.0784756019711494, -0.0078630214557052, -0.1963789612054825, 0.2132134586572647)
-		* yuvTex.Sample(sam, pos + float2(0, -inputPtY)).x;
+		* luma[2][1];
 	target1 += float4(0.9478371739387512, -0.7432878613471985, -0.4691794812679291, -0.4196422100067139)
-		* yuvTex.Sample(sam, pos).x;
+		* luma[2][2];
 	target1 += float4(0.1578149050474167, -0.0874812081456184, 0.1223142221570015, 0.2514914274215698)
-		* yuvTex.Sample(sam, pos + float2(0, inputPtY)).x;
+		* luma[2][3];
 	target1 += float4(0.0576529577374458, 0.0775778889656067, 0.0526014007627964, -0.1151828765869141)
-		* yuvTex.Sample(sam, pos + float2(0, 2 * inputPtY)).x;
+		* luma[2][4];
 	target1 += float4(-0.0459806136786938, -0.0550342053174973, -0.0553226508200169, -0.0042642662301660)
-		* yuvTex.Sample(sam, pos + float2(inputPtX, -2 * inputPtY)).x;
+		* luma[3][0];
 	target1 += float4(0.1346504986286163, 0.1795998811721802, -0.0741422399878502, -0.0004661275597755)
-		* yuvTex.Sample(sam, pos + float2(inputPtX, -inputPtY)).x;
+		* luma[3][1];
 	target1 += float4(-0.0344312079250813, -0.0998986735939980, 0.2834288179874420, 0.1789152175188065)
-		* yuvTex.Sample(sam, pos + float2(inputPtX, 0)).x;
+		* luma[3][2];
 	target1 += float4(-0.0376542955636978, -0.0137260686606169, -0.2183600962162018, -0.0829529240727425)
-		* yuvTex.Sample(sam, pos + float2(inputPtX, inputPtY)).x;
+		* luma[3][3];
 	target1 += float4(0.0143303163349628, 0.0085790483281016, 0.0312815308570862, 0.0557830408215523)
-		* yuvTex.Sample(sam, pos + float2(inputPtX, 2 * inputPtY)).x;
+		* luma[3][4];
 	target1 += float4(0.0196402054280043, 0.0245775021612644, 0.0333996489644051, 0.0064323167316616)
-		* yuvTex.Sample(sam, pos + float2(2 * inputPtX, -2 * inputPtY)).x;
+		* luma[4][0];
 	target1 += float4(-0.0247105974704027, -0.0139399459585547, 0.0039188005030155, 0.0138866743072867)
-		* yuvTex.Sample(sam, pos + float2(2 * inputPtX, -inputPtY)).x;
+		* luma[4][1];
 	target1 += float4(0.0688862130045891, 0.0629303157329559, -0.0323157459497452, -0.1300792843103409)
-		* yuvTex.Sample(sam, pos + float2(2 * inputPtX, 0)).x;
+		* luma[4][2];
 	target1 += float4(0.0111092608422041, 0.0116711426526308, 0.0460555553436279, 0.0563828162848949)
-		* yuvTex.Sample(sam, pos + float2(2 * inputPtX, inputPtY)).x;
+		* luma[4][3];
 	target1 += float4(-0.0043270774185658, -0.0096766958013177, -0.0235258601605892, -0.0409700050950050)
-		* yuvTex.Sample(sam, pos + float2(2 * inputPtX, 2 * inputPtY)).x;
+		* luma[4][4];
 
 	target2 = float4(0.0165165197104216, 0.0061719734221697, -0.0008248710073531, -0.0774794667959213);
 	target2 += float4(-0.0127812735736370, -0.0146999256685376, 0.0025963818188757, 0.0008133125957102)
-		* yuvTex.Sample(sam, pos + float2(-2 * inputPtX, -2 * inputPtY)).x;
+		* luma[0][0];
 	target2 += float4(0.0192508958280087, 0.0089628640562296, 0.0046624913811684, -0.0005601323791780)
-		* yuvTex.Sample(sam, pos + float2(-2 * inputPtX, -inputPtY)).x;
+		* luma[0][1];
 	target2 += float4(-0.1021092385053635, -0.0491660982370377, -0.0818324312567711, -0.0719010531902313)
-		* yuvTex.Sample(sam, pos + float2(-2 * inputPtX, 0)).x;
+		* luma[0][2];
 	target2 += float4(0.0166876111179590, -0.0046075899153948, 0.0258100070059299, -0.0235325042158365)
-		* yuvTex.Sample(sam, pos + float2(-2 * inputPtX, inputPtY)).x;
+		* luma[0][3];
 	target2 += float4(-0.0028500237967819, -0.0020616643596441, -0.0073093594983220, -0.0034190006554127)
-		* yuvTex.Sample(sam, pos + float2(-2 * inputPtX, 2 * inputPtY)).x;
+		* luma[0][4];
 	target2 += float4(0.0024815262295306, 0.0222324915230274, -0.0080765523016453, 0.0105959763750434)
-		* yuvTex.Sample(sam, pos + float2(-inputPtX, -2 * inputPtY)).x;
+		* luma[1][0];
 	target2 += float4(0.1017390340566635, 0.0138921840116382, 0.0559288635849953, -0.0168517548590899)
-		* yuvTex.Sample(sam, pos + float2(-inputPtX, -inputPtY)).x;
+		* luma[1][1];
 	target2 += float4(0.1267367750406265, -0.2365809977054596, 0.4724994897842407, -0.0154752098023891)
-		* yuvTex.Sample(sam, pos + float2(-inputPtX, 0)).x;
+		* luma[1][2];
 	target2 += float4(0.0847241580486298, 0.1127829849720001, -0.0643212646245956, 0.0177757386118174)
-		* yuvTex.Sample(sam, pos + float2(-inputPtX, inputPtY)).x;
+		* luma[1][3];
 	target2 += float4(-0.0354492329061031, -0.0234994646161795, 0.0336676724255085, 0.0153558924794197)
-		* yuvTex.Sample(sam, pos + float2(-inputPtX, 2 * inputPtY)).x;
+		* luma[1][4];
 	target2 += float4(-0.1001686528325081, 0.0175829399377108, -0.0146998856216669, -0.0897502079606056)
-		* yuvTex.Sample(sam, pos + float2(0, -2 * inputPtY)).x;
+		* luma[2][0];
 	target2 += float4(0.0973328053951263, -0.5987607836723328, -0.0770601108670235, 0.2343221157789230)
-		* yuvTex.Sample(sam, pos + float2(0, -inputPtY)).x;
+		* luma[2][1];
 	target2 += float4(-1.0639246702194214, 0.5335622429847717, -0.2365868240594864, 0.6484431028366089)
-		* yuvTex.Sample(sam, pos).x;
+		* luma[2][2];
 	target2 += float4(-0.0258918590843678, 0.1439655423164368, 0.2597847878932953, -0.5380389094352722)
-		* yuvTex.Sample(sam, pos + float2(0, inputPtY)).x;
+		* luma[2][3];
 	target2 += float4(0.0333042629063129, -0.0408495217561722, 0.0026879014912993, 0.0496195442974567)
-		* yuvTex.Sample(sam, pos + float2(0, 2 * inputPtY)).x;
+		* luma[2][4];
 	target2 += float4(0.0017764334334061, 0.0032939016819000, -0.0121603077277541, -0.0066827093251050)
-		* yuvTex.Sample(sam, pos + float2(inputPtX, -2 * inputPtY)).x;
+		* luma[3][0];
 	target2 += float4(0.0497846752405167, 0.0766935721039772, 0.0505562871694565, 0.0058483541943133)
-		* yuvTex.Sample(sam, pos + float2(inputPtX, -inputPtY)).x;
+		* luma[3][1];
 	target2 += float4(0.6903248429298401, 0.0658241882920265, -0.4562527537345886, -0.0117225451394916)
-		* yuvTex.Sample(sam, pos + float2(inputPtX, 0)).x;
+		* luma[3][2];
 	target2 += float4(0.1896255612373352, -0.0459045991301537, -0.0380226671695709, -0.0333303771913052)
-		* yuvTex.Sample(sam, pos + float2(inputPtX, inputPtY)).x;
+		* luma[3][3];
 	target2 += float4(-0.0868696048855782, 0.0157926902174950, 0.0011628456413746, 0.0207170285284519)
-		* yuvTex.Sample(sam, pos + float2(inputPtX, 2 * inputPtY)).x;
+		* luma[3][4];
 	target2 += float4(0.0130701754242182, -0.0067251212894917, -0.0007082104566507, -0.0017002354143187)
-		* yuvTex.Sample(sam, pos + float2(2 * inputPtX, -2 * inputPtY)).x;
+		* luma[4][0];
 	target2 += float4(0.0029672298114747, -0.0060487915761769, 0.0191176552325487, 0.0520425662398338)
-		* yuvTex.Sample(sam, pos + float2(2 * inputPtX, -inputPtY)).x;
+		* luma[4][1];
 	target2 += float4(-0.0253955777734518, -0.0159530192613602, 0.0304108783602715, -0.0263646803796291)
-		* yuvTex.Sample(sam, pos + float2(2 * inputPtX, 0)).x;
+		* luma[4][2];
 	target2 += float4(-0.0708072409033775, 0.0109798992052674, 0.0285820439457893, 0.0188453849405050)
-		* yuvTex.Sample(sam, pos + float2(2 * inputPtX, inputPtY)).x;
+		* luma[4][3];
 	target2 += float4(0.0698847994208336, -0.0164128411561251, 0.0043246182613075, -0.0244176983833313)
-		* yuvTex.Sample(sam, pos + float2(2 * inputPtX, 2 * inputPtY)).x;
+		* luma[4][4];
 }
 
 
@@ -536,7 +552,7 @@ float4 Pass8(float2 pos) {
 	float2 pos1 = pos + (float2(0.5, 0.5) - f) * float2(inputPtX, inputPtY);
 
 	float luma = tex1.Sample(sam, pos1)[index];
-	float3 yuv = yuvTex.Sample(sam, pos).xyz;
+	float3 yuv = yuvTex_Sample(0, pos).xyz;
 
 	return float4(mul(_yuv2rgb, float3(luma, yuv.yz) - float3(0, 0.5, 0.5)), 1);
 }
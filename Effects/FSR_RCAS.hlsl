@@ -2,6 +2,7 @@
 //!VERSION 1
 //!OUTPUT_WIDTH INPUT_WIDTH
 //!OUTPUT_HEIGHT INPUT_HEIGHT
+//!HALO 1
 
 
 //!CONSTANT
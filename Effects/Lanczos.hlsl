@@ -3,6 +3,7 @@
 
 //!MAGPIE EFFECT
 //!VERSION 1
+//!HALO 4
 
 
 //!CONSTANT
@@ -19,16 +20,31 @@ float inputPtY;
 //!MAX 1
 float ARStrength;
 
+//!CONSTANT
+//!DEFAULT 0
+//!MIN 0
+//!MAX 1
+
+// 0：在一个 Pass 中计算 6x6 的二维卷积
+// 1：先水平后垂直分两个 Pass 计算，每个像素只需 6+6 次采样
+int separable;
+
 //!TEXTURE
 Texture2D INPUT;
 
+// 水平方向缩放后的中间结果，Lanczos 的负瓣会产生超出 [0, 1] 的值。只在 separable 为 1 时创建
+//!TEXTURE
+//!WIDTH OUTPUT_WIDTH
+//!HEIGHT INPUT_HEIGHT
+//!FORMAT R16G16B16A16_FLOAT
+Texture2D tmpTex;
+
 //!SAMPLER
 //!FILTER POINT
 SamplerState sam;
 
 
-//!PASS 1
-//!BIND INPUT
+//!COMMON
 
 #define FIX(c) max(abs(c), 1e-5)
 #define PI 3.14159265359
@@ -42,6 +58,18 @@ float3 weight3(float x) {
 	return /*radius **/ sin(s) * sin(s / radius) / (s * s);
 }
 
+// 一个方向上的 6 个权重，已归一化
+void GetTaps(float f, out float3 taps1, out float3 taps2) {
+	taps1 = weight3(0.5 - f * 0.5);
+	taps2 = weight3(1.0 - f * 0.5);
+
+	// make sure all taps added together is exactly 1.0, otherwise some
+	// (very small) distortion can occur
+	float sum = dot(taps1, float3(1, 1, 1)) + dot(taps2, float3(1, 1, 1));
+	taps1 /= sum;
+	taps2 /= sum;
+}
+
 float3 line_run(float ypos, float3 xpos1, float3 xpos2, float3 linetaps1, float3 linetaps2) {
 	return INPUT.Sample(sam, float2(xpos1.r, ypos)).rgb * linetaps1.r
 		+ INPUT.Sample(sam, float2(xpos1.g, ypos)).rgb * linetaps2.r
@@ -51,7 +79,30 @@ float3 line_run(float ypos, float3 xpos1, float3 xpos2, float3 linetaps1, float3
 		+ INPUT.Sample(sam, float2(xpos2.b, ypos)).rgb * linetaps2.b;
 }
 
+
+//!PASS 1
+//!BIND INPUT
+//!SAVE tmpTex
+//!CONDITION separable
+
 float4 Pass1(float2 pos) {
+	// 水平方向
+	float f = frac(pos.x / inputPtX + 0.5);
+	float3 linetaps1, linetaps2;
+	GetTaps(f, linetaps1, linetaps2);
+
+	float x = pos.x - (f + 2) * inputPtX;
+	float3 xpos1 = float3(x, x + inputPtX, x + 2 * inputPtX);
+	float3 xpos2 = float3(x + 3 * inputPtX, x + 4 * inputPtX, x + 5 * inputPtX);
+
+	return float4(line_run(pos.y, xpos1, xpos2, linetaps1, linetaps2), 1);
+}
+
+
+//!PASS 2
+//!BIND INPUT, tmpTex
+
+float4 Pass2(float2 pos) {
 	// 用于抗振铃
 	float3 neighbors[4] = {
 		INPUT.Sample(sam, float2(pos.x - inputPtX, pos.y)).rgb,
@@ -61,32 +112,36 @@ float4 Pass1(float2 pos) {
 	};
 
 	float2 f = frac(pos.xy / float2(inputPtX, inputPtY) + 0.5);
-	float3 linetaps1 = weight3(0.5 - f.x * 0.5);
-	float3 linetaps2 = weight3(1.0 - f.x * 0.5);
-	float3 columntaps1 = weight3(0.5 - f.y * 0.5);
-	float3 columntaps2 = weight3(1.0 - f.y * 0.5);
-
-	// make sure all taps added together is exactly 1.0, otherwise some
-	// (very small) distortion can occur
-	float suml = dot(linetaps1, float3(1, 1, 1)) + dot(linetaps2, float3(1, 1, 1));
-	float sumc = dot(columntaps1, float3(1, 1, 1)) + dot(columntaps2, float3(1, 1, 1));
-	linetaps1 /= suml;
-	linetaps2 /= suml;
-	columntaps1 /= sumc;
-	columntaps2 /= sumc;
-
-	// !!!改变当前坐标
-	pos -= (f + 2) * float2(inputPtX, inputPtY);
-	float3 xpos1 = float3(pos.x, pos.x + inputPtX, pos.x + 2 * inputPtX);
-	float3 xpos2 = float3(pos.x + 3 * inputPtX, pos.x + 4 * inputPtX, pos.x + 5 * inputPtX);
-
-	// final sum and weight normalization
-	float3 color = line_run(pos.y, xpos1, xpos2, linetaps1, linetaps2) * columntaps1.r
-		+ line_run(pos.y + inputPtY, xpos1, xpos2, linetaps1, linetaps2) * columntaps2.r
-		+ line_run(pos.y + 2 * inputPtY, xpos1, xpos2, linetaps1, linetaps2) * columntaps1.g
-		+ line_run(pos.y + 3 * inputPtY, xpos1, xpos2, linetaps1, linetaps2) * columntaps2.g
-		+ line_run(pos.y + 4 * inputPtY, xpos1, xpos2, linetaps1, linetaps2) * columntaps1.b
-		+ line_run(pos.y + 5 * inputPtY, xpos1, xpos2, linetaps1, linetaps2) * columntaps2.b;
+	float3 columntaps1, columntaps2;
+	GetTaps(f.y, columntaps1, columntaps2);
+
+	float3 color;
+	if (separable) {
+		// 垂直方向，tmpTex 的行和 INPUT 对应，列和输出对应
+		float y = pos.y - (f.y + 2) * inputPtY;
+		color = tmpTex.Sample(sam, float2(pos.x, y)).rgb * columntaps1.r
+			+ tmpTex.Sample(sam, float2(pos.x, y + inputPtY)).rgb * columntaps2.r
+			+ tmpTex.Sample(sam, float2(pos.x, y + 2 * inputPtY)).rgb * columntaps1.g
+			+ tmpTex.Sample(sam, float2(pos.x, y + 3 * inputPtY)).rgb * columntaps2.g
+			+ tmpTex.Sample(sam, float2(pos.x, y + 4 * inputPtY)).rgb * columntaps1.b
+			+ tmpTex.Sample(sam, float2(pos.x, y + 5 * inputPtY)).rgb * columntaps2.b;
+	} else {
+		float3 linetaps1, linetaps2;
+		GetTaps(f.x, linetaps1, linetaps2);
+
+		// !!!改变当前坐标
+		pos -= (f + 2) * float2(inputPtX, inputPtY);
+		float3 xpos1 = float3(pos.x, pos.x + inputPtX, pos.x + 2 * inputPtX);
+		float3 xpos2 = float3(pos.x + 3 * inputPtX, pos.x + 4 * inputPtX, pos.x + 5 * inputPtX);
+
+		// final sum and weight normalization
+		color = line_run(pos.y, xpos1, xpos2, linetaps1, linetaps2) * columntaps1.r
+			+ line_run(pos.y + inputPtY, xpos1, xpos2, linetaps1, linetaps2) * columntaps2.r
+			+ line_run(pos.y + 2 * inputPtY, xpos1, xpos2, linetaps1, linetaps2) * columntaps1.g
+			+ line_run(pos.y + 3 * inputPtY, xpos1, xpos2, linetaps1, linetaps2) * columntaps2.g
+			+ line_run(pos.y + 4 * inputPtY, xpos1, xpos2, linetaps1, linetaps2) * columntaps1.b
+			+ line_run(pos.y + 5 * inputPtY, xpos1, xpos2, linetaps1, linetaps2) * columntaps2.b;
+	}
 
 	// 抗振铃
 	float3 min_sample = min4(neighbors[0], neighbors[1], neighbors[2], neighbors[3]);
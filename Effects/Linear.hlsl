@@ -1,5 +1,6 @@
 //!MAGPIE EFFECT
 //!VERSION 1
+//!HALO 1
 
 
 //!TEXTURE
@@ -32,9 +32,25 @@ float outputPtY;
 // 2：Sharper
 int variant;
 
+//!CONSTANT
+//!DEFAULT 0
+//!MIN 0
+//!MAX 1
+
+// 0：在一个 Pass 中计算 4x4 的二维卷积
+// 1：先水平后垂直分两个 Pass 计算，每个像素只需 4+4 次采样
+int separable;
+
 //!TEXTURE
 Texture2D INPUT;
 
+// 水平方向缩放后的中间结果，负瓣会产生超出 [0, 1] 的值。只在 separable 为 1 时创建
+//!TEXTURE
+//!WIDTH OUTPUT_WIDTH
+//!HEIGHT INPUT_HEIGHT
+//!FORMAT R16G16B16A16_FLOAT
+Texture2D scaleTexH;
+
 //!TEXTURE
 //!WIDTH INPUT_WIDTH
 //!HEIGHT OUTPUT_HEIGHT
@@ -64,9 +80,7 @@ Texture2D scaleTex;
 SamplerState sam;
 
 
-//!PASS 1
-//!BIND INPUT
-//!SAVE scaleTex
+//!COMMON
 
 float weight(float x, float B, float C) {
 	float ax = abs(x);
@@ -80,6 +94,7 @@ float weight(float x, float B, float C) {
 	}
 }
 
+// 一个方向上的 4 个权重，已归一化
 float4 weight4(float x) {
 	float B = 0.0;
 	float C = 0.0;
@@ -104,12 +119,15 @@ float4 weight4(float x) {
 	// Robidoux Sharp: B = 0.2620; C = 0.3690;
 	// Robidoux Soft: B = 0.6796; C = 0.1602;
 
-	return float4(
+	float4 taps = float4(
 		weight(x - 2.0, B, C),
 		weight(x - 1.0, B, C),
 		weight(x, B, C),
 		weight(x + 1.0, B, C)
 		);
+
+	// make sure all taps added together is exactly 1.0, otherwise some (very small) distortion can occur
+	return taps / (taps.r + taps.g + taps.b + taps.a);
 }
 
 float3 line_run(float ypos, float4 xpos, float4 linetaps) {
@@ -120,15 +138,42 @@ float3 line_run(float ypos, float4 xpos, float4 linetaps) {
 }
 
 
+//!PASS 1
+//!BIND INPUT
+//!SAVE scaleTexH
+//!CONDITION separable
+
 float4 Pass1(float2 pos) {
-	float2 f = frac(pos / float2(inputPtX, inputPtY) + 0.5);
+	// 水平方向
+	float f = frac(pos.x / inputPtX + 0.5);
+	float4 linetaps = weight4(1.0 - f);
 
-	float4 linetaps = weight4(1.0 - f.x);
+	float x = pos.x - (f + 1) * inputPtX;
+	float4 xpos = float4(x, x + inputPtX, x + 2 * inputPtX, x + 3 * inputPtX);
+
+	return float4(line_run(pos.y, xpos, linetaps), 1);
+}
+
+
+//!PASS 2
+//!BIND INPUT, scaleTexH
+//!SAVE scaleTex
+
+float4 Pass2(float2 pos) {
+	float2 f = frac(pos / float2(inputPtX, inputPtY) + 0.5);
 	float4 columntaps = weight4(1.0 - f.y);
 
-	// make sure all taps added together is exactly 1.0, otherwise some (very small) distortion can occur
-	linetaps /= linetaps.r + linetaps.g + linetaps.b + linetaps.a;
-	columntaps /= columntaps.r + columntaps.g + columntaps.b + columntaps.a;
+	if (separable) {
+		// 垂直方向，scaleTexH 的行和 INPUT 对应，列和输出对应
+		float y = pos.y - (f.y + 1) * inputPtY;
+		return float4(scaleTexH.Sample(sam, float2(pos.x, y)).rgb * columntaps.r
+			+ scaleTexH.Sample(sam, float2(pos.x, y + inputPtY)).rgb * columntaps.g
+			+ scaleTexH.Sample(sam, float2(pos.x, y + 2 * inputPtY)).rgb * columntaps.b
+			+ scaleTexH.Sample(sam, float2(pos.x, y + 3 * inputPtY)).rgb * columntaps.a,
+			1);
+	}
+
+	float4 linetaps = weight4(1.0 - f.x);
 
 	// !!!改变当前坐标
 	pos -= (f + 1) * float2(inputPtX, inputPtY);
@@ -143,7 +188,7 @@ float4 Pass1(float2 pos) {
 		1);
 }
 
-//!PASS 2
+//!PASS 3
 //!BIND INPUT
 //!SAVE L2
 
@@ -152,7 +197,7 @@ float4 Pass1(float2 pos) {
 #define taps        2.0
 
 
-float4 Pass2(float2 pos) {
+float4 Pass3(float2 pos) {
 	float baseY = pos.y;
 
 	float low = ceil((pos.y - taps * outputPtY) / inputPtY - 0.5);
@@ -176,7 +221,7 @@ float4 Pass2(float2 pos) {
 }
 
 
-//!PASS 3
+//!PASS 4
 //!BIND L2
 //!SAVE L2_2
 
@@ -185,7 +230,7 @@ float4 Pass2(float2 pos) {
 #define taps        2.0
 
 
-float4 Pass3(float2 pos) {
+float4 Pass4(float2 pos) {
 	float baseX = pos.x;
 
 	float low = ceil((pos.x - taps * outputPtX) / inputPtX - 0.5);
@@ -208,7 +253,7 @@ float4 Pass3(float2 pos) {
 }
 
 
-//!PASS 4
+//!PASS 5
 //!BIND L2_2, scaleTex
 //!SAVE MR
 
@@ -243,7 +288,7 @@ float3x3 ScaleH(float2 pos) {
 	return avg;
 }
 
-float4 Pass4(float2 pos) {
+float4 Pass5(float2 pos) {
 	float low = ceil(-0.5 * taps);
 	float high = floor(0.5 * taps);
 
@@ -267,7 +312,7 @@ float4 Pass4(float2 pos) {
 }
 
 
-//!PASS 5
+//!PASS 6
 //!BIND MR, scaleTex
 
 #define locality    2.0
@@ -301,7 +346,7 @@ float3x3 ScaleH(float2 pos) {
 	return avg;
 }
 
-float4 Pass5(float2 pos) {
+float4 Pass6(float2 pos) {
 	float low = ceil(-0.5 * taps);
 	float high = floor(0.5 * taps);
 
@@ -47,7 +47,11 @@ namespace Magpie {
 			DisableDirectFlip = 0x80,
 			ConfineCursorIn3DGames = 0x100,
 			CropTitleBarOfUWP = 0x200,
-			DisableEffectCache = 0x400
+			DisableEffectCache = 0x400,
+			SpecializeEffectConstants = 0x800,
+			HalfPrecisionEffects = 0x1000,
+			RecordEffectCommandList = 0x2000,
+			AdaptiveQuality = 0x4000
 		}
 
 		private readonly MagWindowParams magWindowParams = new();
@@ -162,7 +166,11 @@ namespace Magpie {
 							(Settings.Default.ConfineCursorIn3DGames ? (uint)FlagMasks.ConfineCursorIn3DGames : 0) |
 							(Settings.Default.CropTitleBarOfUWP ? (uint)FlagMasks.CropTitleBarOfUWP : 0) |
 							(Settings.Default.DebugDisableEffectCache ? (uint)FlagMasks.DisableEffectCache : 0) |
-							(Settings.Default.SimulateExclusiveFullscreen ? (uint)FlagMasks.SimulateExclusiveFullscreen : 0);
+							(Settings.Default.SimulateExclusiveFullscreen ? (uint)FlagMasks.SimulateExclusiveFullscreen : 0) |
+							(Settings.Default.SpecializeEffectConstants ? (uint)FlagMasks.SpecializeEffectConstants : 0) |
+							(Settings.Default.HalfPrecisionEffects ? (uint)FlagMasks.HalfPrecisionEffects : 0) |
+							(Settings.Default.RecordEffectCommandList ? (uint)FlagMasks.RecordEffectCommandList : 0) |
+							(Settings.Default.AdaptiveQuality ? (uint)FlagMasks.AdaptiveQuality : 0);
 
 						bool customCropping = Settings.Default.CustomCropping;
 
@@ -245,6 +253,15 @@ namespace Magpie {
 			_ = runEvent.Set();
 		}
 
+		// 全屏期间更换效果，无需退出全屏
+		public void SetEffects(string effectsJson) {
+			if (!Running) {
+				return;
+			}
+
+			NativeMethods.SetSessionEffects(SrcWindow, effectsJson);
+		}
+
 		public void Destory() {
 			if (!Running) {
 				return;
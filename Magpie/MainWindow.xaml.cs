@@ -329,6 +329,12 @@ namespace Magpie {
 		
 		private void CbbScaleMode_SelectionChanged(object sender, SelectionChangedEventArgs e) {
 			Settings.Default.ScaleMode = (uint)cbbScaleMode.SelectedIndex;
+
+			// 全屏期间切换缩放模式或修改了缩放模式的配置时立即应用
+			if (cbbScaleMode.SelectedIndex >= 0 && magWindow != null && magWindow.Running && scaleModelManager.IsValid()) {
+				Logger.Info("全屏期间更换缩放模式");
+				magWindow.SetEffects(scaleModelManager.GetScaleModels()![cbbScaleMode.SelectedIndex].Effects);
+			}
 		}
 		
 		private void StartScaleTimer() {
@@ -152,6 +152,12 @@ namespace Magpie {
 		[DllImport("MagpieRT", CallingConvention = CallingConvention.StdCall)]
 		public static extern void SetLogLevel(uint logLevel);
 
+		[DllImport("MagpieRT", CallingConvention = CallingConvention.StdCall)]
+		public static extern void SetEffects([MarshalAs(UnmanagedType.LPUTF8Str)] string effectsJson);
+
+		[DllImport("MagpieRT", CallingConvention = CallingConvention.StdCall)]
+		public static extern void SetSessionEffects(IntPtr hwndSrc, [MarshalAs(UnmanagedType.LPUTF8Str)] string effectsJson);
+
 		[DllImport("MagpieRT", EntryPoint = "Run", CallingConvention = CallingConvention.StdCall)]
 		private static extern IntPtr RunNative(
 			IntPtr hwndSrc,
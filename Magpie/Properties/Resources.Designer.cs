@@ -375,6 +375,15 @@ namespace Magpie.Properties {
             }
         }
         
+        /// <summary>
+        ///   查找类似 Adapt effect quality to the GPU load (uses the fallbacks of the scale mode) 的本地化字符串。
+        /// </summary>
+        public static string UI_Options_Advanced_Adaptive_Quality {
+            get {
+                return ResourceManager.GetString("UI_Options_Advanced_Adaptive_Quality", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   查找类似 Breakpoint Mode 的本地化字符串。
         /// </summary>
@@ -411,6 +420,15 @@ namespace Magpie.Properties {
             }
         }
         
+        /// <summary>
+        ///   查找类似 Use half precision in supported effects (faster on some GPUs, validated before use) 的本地化字符串。
+        /// </summary>
+        public static string UI_Options_Advanced_Half_Precision_Effects {
+            get {
+                return ResourceManager.GetString("UI_Options_Advanced_Half_Precision_Effects", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   查找类似 Logging 的本地化字符串。
         /// </summary>
@@ -474,6 +492,15 @@ namespace Magpie.Properties {
             }
         }
         
+        /// <summary>
+        ///   查找类似 Record effects into a command list (lowers CPU usage on drivers that support it) 的本地化字符串。
+        /// </summary>
+        public static string UI_Options_Advanced_Record_Effect_Command_List {
+            get {
+                return ResourceManager.GetString("UI_Options_Advanced_Record_Effect_Command_List", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   查找类似 Show All Capture Methods 的本地化字符串。
         /// </summary>
@@ -501,6 +528,15 @@ namespace Magpie.Properties {
             }
         }
         
+        /// <summary>
+        ///   查找类似 Specialize effect constants (faster rendering, slower first start) 的本地化字符串。
+        /// </summary>
+        public static string UI_Options_Advanced_Specialize_Effect_Constants {
+            get {
+                return ResourceManager.GetString("UI_Options_Advanced_Specialize_Effect_Constants", resourceCulture);
+            }
+        }
+        
         /// <summary>
         ///   查找类似 Application 的本地化字符串。
         /// </summary>
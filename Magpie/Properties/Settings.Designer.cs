@@ -418,5 +418,53 @@ namespace Magpie.Properties {
                 this["CustomCropping"] = value;
             }
         }
+        
+        [global::System.Configuration.UserScopedSettingAttribute()]
+        [global::System.Diagnostics.DebuggerNonUserCodeAttribute()]
+        [global::System.Configuration.DefaultSettingValueAttribute("False")]
+        public bool SpecializeEffectConstants {
+            get {
+                return ((bool)(this["SpecializeEffectConstants"]));
+            }
+            set {
+                this["SpecializeEffectConstants"] = value;
+            }
+        }
+        
+        [global::System.Configuration.UserScopedSettingAttribute()]
+        [global::System.Diagnostics.DebuggerNonUserCodeAttribute()]
+        [global::System.Configuration.DefaultSettingValueAttribute("False")]
+        public bool HalfPrecisionEffects {
+            get {
+                return ((bool)(this["HalfPrecisionEffects"]));
+            }
+            set {
+                this["HalfPrecisionEffects"] = value;
+            }
+        }
+        
+        [global::System.Configuration.UserScopedSettingAttribute()]
+        [global::System.Diagnostics.DebuggerNonUserCodeAttribute()]
+        [global::System.Configuration.DefaultSettingValueAttribute("False")]
+        public bool RecordEffectCommandList {
+            get {
+                return ((bool)(this["RecordEffectCommandList"]));
+            }
+            set {
+                this["RecordEffectCommandList"] = value;
+            }
+        }
+        
+        [global::System.Configuration.UserScopedSettingAttribute()]
+        [global::System.Diagnostics.DebuggerNonUserCodeAttribute()]
+        [global::System.Configuration.DefaultSettingValueAttribute("False")]
+        public bool AdaptiveQuality {
+            get {
+                return ((bool)(this["AdaptiveQuality"]));
+            }
+            set {
+                this["AdaptiveQuality"] = value;
+            }
+        }
     }
 }
@@ -82,10 +82,14 @@ namespace Magpie {
 
 					JsonNode name = model["name"] ?? throw new Exception("未找到 name 字段");
 					JsonNode effects = model["effects"] ?? throw new Exception("未找到 effects 字段");
+					JsonNode? fallbacks = model["fallbacks"];
 
 					return new ScaleModel {
 						Name = name.GetValue<string>(),
-						Effects = effects.ToJsonString()
+						// 有 fallbacks 字段时传给运行时的是由所有变体组成的数组，质量由高到低
+						Effects = fallbacks == null ? effects.ToJsonString() : "[" + string.Join(",",
+							fallbacks.AsArray().Select(f => (f ?? throw new Exception("fallbacks 字段非法")).ToJsonString())
+								.Prepend(effects.ToJsonString())) + "]"
 					};
 				}).ToArray();
 
@@ -0,0 +1,265 @@
+// Copyright (c) 2021 - present, Liu Xu
+//
+//  This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// 命令行批处理工具，使用 MagpieRT 中效果的 CPU 实现离线处理图像
+// 不需要源窗口和显卡，可以在无界面的环境中运行。指定 --gpu 时改为在显卡上执行 MagpieFX 效果
+// 指定 --bench 时只运行 CPU 锐化效果的基准测试，同时指定 --gpu 时改为比较内置缩放效果的单 Pass 和可分离实现
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <sstream>
+
+
+typedef BOOL(WINAPI* InitializeFunc)(UINT logLevel, const char* logFileName, int logArchiveAboveSize, int logMaxArchiveFiles);
+typedef void(WINAPI* BatchProgressCallback)(UINT processed, UINT total);
+typedef BOOL(WINAPI* RunBatchFunc)(
+	const char* effectsJson,
+	const wchar_t* input,
+	const wchar_t* outputDir,
+	const wchar_t* outputFormat,
+	UINT decodeThreads,
+	UINT processThreads,
+	UINT encodeThreads,
+	UINT queueCapacity,
+	UINT memoryBudgetMB,
+	UINT tileSize,
+	int gpuAdapter,
+	BatchProgressCallback progressCallback
+);
+typedef void(WINAPI* RunCpuBenchmarkFunc)(UINT width, UINT height, UINT iterations);
+typedef void(WINAPI* RunGpuBenchmarkFunc)(
+	UINT adapterIdx,
+	const char* baselineJson,
+	const char* effectsJson,
+	UINT width,
+	UINT height,
+	UINT iterations
+);
+
+// --bench --gpu 比较的效果：以可分离的两个 Pass 为基准，测量默认的单 Pass 实现
+static const char* GPU_BENCHMARK_EFFECTS[][2] = {
+	{ R"([{"effect":"Lanczos","scale":[2,2],"separable":1}])", R"([{"effect":"Lanczos","scale":[2,2]}])" },
+	{ R"([{"effect":"Lanczos","scale":[1.5,1.5],"separable":1}])", R"([{"effect":"Lanczos","scale":[1.5,1.5]}])" },
+	{ R"([{"effect":"Bicubic","scale":[2,2],"separable":1}])", R"([{"effect":"Bicubic","scale":[2,2]}])" },
+	{ R"([{"effect":"SSimDownscaler","scale":[0.5,0.5],"separable":1}])", R"([{"effect":"SSimDownscaler","scale":[0.5,0.5]}])" }
+};
+
+static void PrintUsage() {
+	fwprintf(stderr,
+		L"用法：MagpieBatch -e <效果 json 文件> -i <输入> -o <输出文件夹> [选项]\n"
+		L"      MagpieBatch --bench [--gpu <n>] [--bench-size <宽>x<高>] [--bench-iterations <n>]\n"
+		L"\n"
+		L"  -i <输入>            文件夹、单个文件或带通配符的路径，如 frames\\*.png\n"
+		L"  -f <格式>            输出格式：png、jpg、bmp 或 tif，默认和输入相同\n"
+		L"  --decode-threads <n> 解码线程数，默认自动选择\n"
+		L"  --process-threads <n> 处理线程数，默认自动选择\n"
+		L"  --encode-threads <n> 编码线程数，默认自动选择\n"
+		L"  --queue <n>          阶段间队列的容量\n"
+		L"  --memory <MB>        在途图像占用内存的上限，超出上限的图像分块处理\n"
+		L"  --tile <n>           分块处理时块的边长，默认根据内存上限选择\n"
+		L"  --gpu <n>            在第 n 个显卡上执行 MagpieFX 效果，超出纹理尺寸限制的图像分块处理\n"
+		L"  --log-level <n>      日志级别，0：TRACE ... 6：OFF，默认为 2\n"
+		L"  --bench              测量 CPU 锐化效果的吞吐量，默认在 3840x2160 的合成图像上迭代 5 次\n"
+		L"                       指定 --gpu 时比较 Lanczos、Bicubic 和 SSimDownscaler 的单 Pass 和可分离实现的\n"
+		L"                       吞吐量和输出的 PSNR，默认在 1920x1080 的参考图像上迭代 20 次\n"
+	);
+}
+
+static bool ReadFile(const std::wstring& fileName, std::string& result) {
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	std::stringstream ss;
+	ss << file.rdbuf();
+	result = ss.str();
+	return true;
+}
+
+static std::wstring GetFullPath(const std::wstring& path) {
+	DWORD len = GetFullPathName(path.c_str(), 0, nullptr, nullptr);
+	if (len == 0) {
+		return path;
+	}
+
+	std::wstring result(len, 0);
+	len = GetFullPathName(path.c_str(), len, result.data(), nullptr);
+	result.resize(len);
+	return result;
+}
+
+static bool ParseUInt(const wchar_t* str, UINT& value) {
+	wchar_t* end = nullptr;
+	unsigned long result = wcstoul(str, &end, 10);
+	if (end == str || *end != L'\0') {
+		return false;
+	}
+
+	value = (UINT)result;
+	return true;
+}
+
+static void WINAPI OnProgress(UINT processed, UINT total) {
+	// 可能在多个线程上同时调用，fwprintf 会锁定流
+	fwprintf(stdout, L"\r%u/%u", processed, total);
+	fflush(stdout);
+}
+
+int wmain(int argc, wchar_t* argv[]) {
+	std::wstring effectsFile;
+	std::wstring input;
+	std::wstring outputDir;
+	std::wstring outputFormat;
+	UINT decodeThreads = 0;
+	UINT processThreads = 0;
+	UINT encodeThreads = 0;
+	UINT queueCapacity = 0;
+	UINT memoryBudgetMB = 0;
+	UINT tileSize = 0;
+	int gpuAdapter = -1;
+	UINT logLevel = 2;
+	bool bench = false;
+	UINT benchWidth = 0;
+	UINT benchHeight = 0;
+	UINT benchIterations = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		std::wstring_view arg = argv[i];
+		// 唯一不带值的选项
+		if (arg == L"--bench") {
+			bench = true;
+			continue;
+		}
+
+		if (i + 1 >= argc) {
+			PrintUsage();
+			return 1;
+		}
+
+		const wchar_t* value = argv[++i];
+		bool success = true;
+		if (arg == L"-e") {
+			effectsFile = value;
+		} else if (arg == L"-i") {
+			input = value;
+		} else if (arg == L"-o") {
+			outputDir = value;
+		} else if (arg == L"-f") {
+			outputFormat = value;
+		} else if (arg == L"--decode-threads") {
+			success = ParseUInt(value, decodeThreads);
+		} else if (arg == L"--process-threads") {
+			success = ParseUInt(value, processThreads);
+		} else if (arg == L"--encode-threads") {
+			success = ParseUInt(value, encodeThreads);
+		} else if (arg == L"--queue") {
+			success = ParseUInt(value, queueCapacity);
+		} else if (arg == L"--memory") {
+			success = ParseUInt(value, memoryBudgetMB);
+		} else if (arg == L"--tile") {
+			success = ParseUInt(value, tileSize);
+		} else if (arg == L"--gpu") {
+			UINT adapter;
+			success = ParseUInt(value, adapter);
+			gpuAdapter = (int)adapter;
+		} else if (arg == L"--bench-size") {
+			success = swscanf_s(value, L"%ux%u", &benchWidth, &benchHeight) == 2 && benchWidth > 0 && benchHeight > 0;
+		} else if (arg == L"--bench-iterations") {
+			success = ParseUInt(value, benchIterations) && benchIterations > 0;
+		} else if (arg == L"--log-level") {
+			success = ParseUInt(value, logLevel) && logLevel <= 6;
+		} else {
+			success = false;
+		}
+
+		if (!success) {
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (!bench && (effectsFile.empty() || input.empty() || outputDir.empty())) {
+		PrintUsage();
+		return 1;
+	}
+
+	std::string effectsJson;
+	if (!bench && !ReadFile(effectsFile, effectsJson)) {
+		fwprintf(stderr, L"读取 %s 失败\n", effectsFile.c_str());
+		return 1;
+	}
+
+	// MagpieRT 从工作目录加载 effects 文件夹中的文件，因此先转换为绝对路径再切换工作目录
+	input = GetFullPath(input);
+	outputDir = GetFullPath(outputDir);
+
+	std::wstring exePath(MAX_PATH, 0);
+	exePath.resize(GetModuleFileName(NULL, exePath.data(), (DWORD)exePath.size()));
+	exePath.resize(exePath.find_last_of(L'\\'));
+	SetCurrentDirectory(exePath.c_str());
+
+	HMODULE hRuntime = LoadLibrary(L"MagpieRT.dll");
+	if (!hRuntime) {
+		fwprintf(stderr, L"加载 MagpieRT.dll 失败\n");
+		return 1;
+	}
+
+	auto initialize = (InitializeFunc)GetProcAddress(hRuntime, "Initialize");
+	auto runBatch = (RunBatchFunc)GetProcAddress(hRuntime, "RunBatch");
+	auto runCpuBenchmark = (RunCpuBenchmarkFunc)GetProcAddress(hRuntime, "RunCpuBenchmark");
+	auto runGpuBenchmark = (RunGpuBenchmarkFunc)GetProcAddress(hRuntime, "RunGpuBenchmark");
+	if (!initialize || !runBatch || !runCpuBenchmark || !runGpuBenchmark) {
+		fwprintf(stderr, L"MagpieRT.dll 的版本不匹配\n");
+		return 1;
+	}
+
+	CreateDirectory(L"logs", nullptr);
+	if (!initialize(logLevel, "logs\\MagpieBatch.log", 100000, 1)) {
+		fwprintf(stderr, L"初始化失败\n");
+		return 1;
+	}
+
+	if (bench) {
+		// 基准测试的结果为 UTF-8
+		SetConsoleOutputCP(CP_UTF8);
+		if (gpuAdapter < 0) {
+			runCpuBenchmark(benchWidth, benchHeight, benchIterations);
+		} else {
+			for (const auto& effects : GPU_BENCHMARK_EFFECTS) {
+				runGpuBenchmark((UINT)gpuAdapter, effects[0], effects[1], benchWidth, benchHeight, benchIterations);
+			}
+		}
+		return 0;
+	}
+
+	BOOL success = runBatch(effectsJson.c_str(), input.c_str(), outputDir.c_str(),
+		outputFormat.c_str(), decodeThreads, processThreads, encodeThreads,
+		queueCapacity, memoryBudgetMB, tileSize, gpuAdapter, OnProgress);
+
+	fwprintf(stdout, L"\n");
+	if (!success) {
+		fwprintf(stderr, L"部分图像处理失败，详情见 logs\\MagpieBatch.log\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -17,7 +17,9 @@ static constexpr const wchar_t* DDF_WINDOW_CLASS_NAME = L"Window_Magpie_C322D752
 static constexpr const wchar_t* HOST_WINDOW_TITLE = L"Magpie_Host";
 
 
-App::~App() {
+void App::Uninitialize() {
+	_wicImgFactory = nullptr;
+
 	MagUninitialize();
 	winrt::uninit_apartment();
 }
@@ -53,6 +55,16 @@ bool App::Run(
 	const RECT& cropBorders,
 	UINT flags
 ) {
+	// 帧源使用 WinRT 对象，调用 Run 的线程必须处于 MTA
+	HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_CRITICAL(logger, MakeComErrorMsg("CoInitializeEx 失败", hr));
+		return false;
+	}
+	Utils::ScopeExit se([]() {
+		CoUninitialize();
+	});
+
 	_hwndSrc = hwndSrc;
 	_captureMode = captureMode;
 	_frameRate = frameRate;
@@ -63,6 +75,11 @@ bool App::Run(
 	_cropBorders = cropBorders;
 	_flags = flags;
 
+	AcquireSRWLockExclusive(&_pendingEffectsJsonLock);
+	_pendingEffectsJson.reset();
+	ReleaseSRWLockExclusive(&_pendingEffectsJsonLock);
+	_effectsLoadFailed = false;
+
 	SPDLOG_LOGGER_INFO(logger, fmt::format("运行时参数：\n\thwndSrc：{}\n\tcaptureMode：{}\n\tadjustCursorSpeed：{}\n\tshowFPS：{}\n\tframeRate：{}\n\tdisableLowLatency：{}\n\tbreakpointMode：{}\n\tdisableWindowResizing：{}\n\tdisableDirectFlip：{}\n\tconfineCursorIn3DGames：{}\n\tadapterIdx：{}\n\tcropTitleBarOfUWP：{}\n\tmultiMonitorUsage: {}\n\tnoCursor: {}\n\tdisableEffectCache: {}\n\tsimulateExclusiveFullscreen: {}\n\tcursorInterpolationMode: {}\n\tcropLeft: {}\n\tcropTop: {}\n\tcropRight: {}\n\tcropBottom: {}", (void*)hwndSrc, captureMode, IsAdjustCursorSpeed(), IsShowFPS(), frameRate, IsDisableLowLatency(), IsBreakpointMode(), IsDisableWindowResizing(), IsDisableDirectFlip(), IsConfineCursorIn3DGames(), adapterIdx, IsCropTitleBarOfUWP(), multiMonitorUsage, IsNoCursor(), IsDisableEffectCache(), IsSimulateExclusiveFullscreen(), cursorInterpolationMode, cropBorders.left, cropBorders.top, cropBorders.right, cropBorders.bottom));
 	
 	SetErrorMsg(ErrorMessages::GENERIC);
@@ -104,45 +121,12 @@ bool App::Run(
 		return false;
 	}
 
-	_srcFrameRect = {};
-	
-	switch (captureMode) {
-	case 0:
-		_frameSource.reset(new GraphicsCaptureFrameSource());
-		break;
-	case 1:
-		_frameSource.reset(new DesktopDuplicationFrameSource());
-		break;
-	case 2:
-		_frameSource.reset(new GDIFrameSource());
-		break;
-	case 3:
-		_frameSource.reset(new DwmSharedSurfaceFrameSource());
-		break;
-	default:
-		SPDLOG_LOGGER_CRITICAL(logger, "未知的捕获模式，即将退出");
+	if (!_CreateFrameSource()) {
+		SPDLOG_LOGGER_CRITICAL(logger, "创建 FrameSource 失败，即将退出");
 		Close();
 		_Run();
 		return false;
 	}
-	
-	if (!_frameSource->Initialize()) {
-		SPDLOG_LOGGER_CRITICAL(logger, "初始化 FrameSource 失败，即将退出");
-		Close();
-		_Run();
-		return false;
-	}
-
-	if (_srcFrameRect == RECT{}) {
-		// FrameSource 初始化完成后计算窗口边框，因为初始化过程中可能改变窗口位置
-		if (!UpdateSrcFrameRect()) {
-			SPDLOG_LOGGER_ERROR(logger, "UpdateSrcFrameRect 失败");
-			return false;
-		}
-	}
-
-	SPDLOG_LOGGER_INFO(logger, fmt::format("源窗口尺寸：{}x{}",
-		_srcFrameRect.right - _srcFrameRect.left, _srcFrameRect.bottom - _srcFrameRect.top));
 
 	if (!_renderer->InitializeEffectsAndCursor(effectsJson)) {
 		SPDLOG_LOGGER_CRITICAL(logger, "初始化效果失败，即将退出");
@@ -170,40 +154,131 @@ bool App::Run(
 		}
 	}
 
+	// 源窗口的状态不需要每帧检查
+	if (!RegisterTimer(_CHECK_TIMER_INTERVAL, std::bind(&App::_OnCheckTimer, this))) {
+		SPDLOG_LOGGER_ERROR(logger, "RegisterTimer 失败");
+	}
+
+	if (!_renderer->StartRenderThread()) {
+		SPDLOG_LOGGER_CRITICAL(logger, "启动渲染线程失败，即将退出");
+		Close();
+		_Run();
+		return false;
+	}
+
 	_Run();
 
-	return true;
+	// 效果在后台加载，失败时全屏已经开始
+	return !_effectsLoadFailed;
 }
 
 void App::_Run() {
 	SPDLOG_LOGGER_INFO(logger, "开始接收窗口消息");
 
-	while (true) {
-		MSG msg;
-		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
-			if (msg.message == WM_QUIT) {
-				_OnQuit();
-				return;
-			}
+	// 渲染在独立的线程上进行，这里只处理窗口消息
+	MSG msg;
+	while (GetMessage(&msg, nullptr, 0, 0) > 0) {
+		TranslateMessage(&msg);
+		DispatchMessage(&msg);
+	}
+
+	if (_renderer) {
+		_renderer->StopRenderThread();
+		// 后台加载效果时会访问 Renderer，必须在销毁前结束
+		_renderer->StopReloadThread();
+	}
+	_OnQuit();
+}
+
+bool App::_CreateFrameSource() {
+	// 先销毁旧的帧源，它可能修改过源窗口的状态
+	_frameSource.reset();
+	_srcFrameRect = {};
+
+	switch (_captureMode) {
+	case 0:
+		_frameSource.reset(new GraphicsCaptureFrameSource());
+		break;
+	case 1:
+		_frameSource.reset(new DesktopDuplicationFrameSource());
+		break;
+	case 2:
+		_frameSource.reset(new GDIFrameSource());
+		break;
+	case 3:
+		_frameSource.reset(new DwmSharedSurfaceFrameSource());
+		break;
+	default:
+		SPDLOG_LOGGER_ERROR(logger, "未知的捕获模式");
+		return false;
+	}
+
+	if (!_frameSource->Initialize()) {
+		SPDLOG_LOGGER_ERROR(logger, "初始化 FrameSource 失败");
+		return false;
+	}
 
-			TranslateMessage(&msg);
-			DispatchMessage(&msg);
+	if (_srcFrameRect == RECT{}) {
+		// FrameSource 初始化完成后计算窗口边框，因为初始化过程中可能改变窗口位置
+		if (!UpdateSrcFrameRect()) {
+			SPDLOG_LOGGER_ERROR(logger, "UpdateSrcFrameRect 失败");
+			return false;
 		}
+	}
 
-		_renderer->Render();
+	SPDLOG_LOGGER_INFO(logger, fmt::format("源窗口尺寸：{}x{}",
+		_srcFrameRect.right - _srcFrameRect.left, _srcFrameRect.bottom - _srcFrameRect.top));
 
-		// 第二帧（等待时或完成后）创建 DDF 窗口
-		// 如果在 Run 中创建会有短暂的灰屏
-		// 选择第二帧的原因：当 GetFrameCount() 返回 1 时第一帧可能处于等待状态而没有渲染，见 Renderer::Render()
-		if (_renderer->GetTimer().GetFrameCount() == 2 && !_hwndDDF && IsDisableDirectFlip() && !IsBreakpointMode()) {
-			if (!_DisableDirectFlip()) {
-				SPDLOG_LOGGER_ERROR(logger, "_DisableDirectFlip 失败");
-			}
+	return true;
+}
+
+void App::_OnCheckTimer() {
+	if (_renderer->IsEffectsLoadFailed()) {
+		SPDLOG_LOGGER_CRITICAL(logger, "初始化效果失败，即将退出");
+		_effectsLoadFailed = true;
+		Close();
+		return;
+	}
+
+	if (!_renderer->CheckSrcState()) {
+		SPDLOG_LOGGER_INFO(logger, "源窗口状态改变，退出全屏");
+		Close();
+		return;
+	}
+
+	if (_renderer->IsSrcWndRectChanged()) {
+		SPDLOG_LOGGER_INFO(logger, "源窗口位置或大小改变，重新构建");
+		if (!_Rebuild()) {
+			SPDLOG_LOGGER_INFO(logger, "重新构建失败，退出全屏");
+			Close();
+			return;
+		}
+	}
+
+	AcquireSRWLockExclusive(&_pendingEffectsJsonLock);
+	std::optional<std::string> effectsJson = std::move(_pendingEffectsJson);
+	_pendingEffectsJson.reset();
+	ReleaseSRWLockExclusive(&_pendingEffectsJsonLock);
+
+	if (effectsJson) {
+		SPDLOG_LOGGER_INFO(logger, "效果已更换，重新加载效果");
+		_renderer->ReloadEffects(*effectsJson);
+	}
+	_renderer->CheckEffectFiles();
+	_renderer->CheckQualityLevel();
+
+	// 首帧呈现后创建 DDF 窗口
+	// 如果在 Run 中创建会有短暂的灰屏
+	if (!_hwndDDF && IsDisableDirectFlip() && !IsBreakpointMode() && _renderer->GetPresentedFrameCount() > 0) {
+		if (!_DisableDirectFlip()) {
+			SPDLOG_LOGGER_ERROR(logger, "_DisableDirectFlip 失败");
 		}
 	}
 }
 
 ComPtr<IWICImagingFactory2> App::GetWICImageFactory() {
+	AcquireSRWLockExclusive(&_wicImgFactoryLock);
+
 	if (_wicImgFactory == nullptr) {
 		HRESULT hr = CoCreateInstance(
 			CLSID_WICImagingFactory,
@@ -214,11 +289,12 @@ ComPtr<IWICImagingFactory2> App::GetWICImageFactory() {
 
 		if (FAILED(hr)) {
 			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 WICImagingFactory 失败", hr));
-			return nullptr;
 		}
 	}
 
-	return _wicImgFactory;
+	ComPtr<IWICImagingFactory2> result = _wicImgFactory;
+	ReleaseSRWLockExclusive(&_wicImgFactoryLock);
+	return result;
 }
 
 bool App::RegisterTimer(UINT uElapse, std::function<void()> cb) {
@@ -243,7 +319,7 @@ LRESULT DDFWndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
 }
 
 // 注册窗口类
-void App::_RegisterWndClasses() const {
+void App::_RegisterWndClasses() {
 	WNDCLASSEX wcex = {};
 	wcex.cbSize = sizeof(WNDCLASSEX);
 	wcex.lpfnWndProc = _HostWndProcStatic;
@@ -344,15 +420,28 @@ static bool CalcHostWndRect(HWND hWnd, UINT multiMonitorMode, RECT& result) {
 
 // 创建主窗口
 bool App::_CreateHostWnd() {
-	if (FindWindow(HOST_WINDOW_CLASS_NAME, nullptr)) {
-		SPDLOG_LOGGER_CRITICAL(logger, "已存在主窗口");
+	if (!CalcHostWndRect(_hwndSrc, GetMultiMonitorUsage(), _hostWndRect)) {
+		SPDLOG_LOGGER_ERROR(logger, "CalcHostWndRect 失败");
 		return false;
 	}
 
-	if (!CalcHostWndRect(_hwndSrc, GetMultiMonitorUsage(), _hostWndRect)) {
-		SPDLOG_LOGGER_ERROR(logger, "CalcHostWndRect 失败");
+	// 同一个窗口只能缩放一次，各会话的主窗口不能重叠
+	// 因此同一时间最多只有一个会话处于非多屏幕模式，限制光标不会冲突
+	AcquireSRWLockExclusive(&_sessionsLock);
+	const bool conflicted = std::any_of(_sessions.begin(), _sessions.end(), [this](const App* other) {
+		return other->_hwndSrc == _hwndSrc || Utils::CheckOverlap(other->_hostWndRect, _hostWndRect);
+	});
+	if (!conflicted) {
+		_sessions.push_back(this);
+	}
+	const size_t sessionCount = _sessions.size();
+	ReleaseSRWLockExclusive(&_sessionsLock);
+
+	if (conflicted) {
+		SPDLOG_LOGGER_CRITICAL(logger, "源窗口已在缩放或主窗口和其他会话重叠");
 		return false;
 	}
+	SPDLOG_LOGGER_INFO(logger, fmt::format("当前有 {} 个会话", sessionCount));
 
 	// 主窗口没有覆盖 Virtual Screen 则使用多屏幕模式
 	// 打开断点模式时不使用多屏幕模式
@@ -396,6 +485,54 @@ bool App::_CreateHostWnd() {
 	return true;
 }
 
+bool App::_Rebuild() {
+	// 主窗口覆盖的显示器改变时无法原地重新构建
+	RECT hostWndRect;
+	if (!CalcHostWndRect(_hwndSrc, _multiMonitorUsage, hostWndRect)) {
+		SPDLOG_LOGGER_ERROR(logger, "CalcHostWndRect 失败");
+		return false;
+	}
+
+	if (hostWndRect != _hostWndRect) {
+		SPDLOG_LOGGER_INFO(logger, "主窗口的位置或大小需要改变");
+		return false;
+	}
+
+	_renderer->StopRenderThread();
+
+	bool success = true;
+	int duration = Utils::Measure([&]() {
+		// 渲染器缓存了帧源纹理的视图，帧源销毁前释放
+		for (UINT i = 0, count = _frameSource->GetOutputCount(); i < count; ++i) {
+			_renderer->ReleaseViews(_frameSource->GetOutputAt(i).Get());
+		}
+
+		if (!_CreateFrameSource()) {
+			SPDLOG_LOGGER_ERROR(logger, "_CreateFrameSource 失败");
+			success = false;
+			return;
+		}
+
+		if (!_renderer->Rebuild()) {
+			SPDLOG_LOGGER_ERROR(logger, "Renderer::Rebuild 失败");
+			success = false;
+		}
+	});
+
+	if (!success) {
+		return false;
+	}
+
+	SPDLOG_LOGGER_INFO(logger, fmt::format("重新构建用时 {} 毫秒", duration / 1000.0f));
+
+	if (!_renderer->StartRenderThread()) {
+		SPDLOG_LOGGER_ERROR(logger, "启动渲染线程失败");
+		return false;
+	}
+
+	return true;
+}
+
 bool App::_DisableDirectFlip() {
 	// 没有显式关闭 DirectFlip 的方法
 	// 将全屏窗口设为稍微透明，以灰色全屏窗口为背景
@@ -447,12 +584,23 @@ bool App::_DisableDirectFlip() {
 }
 
 LRESULT App::_HostWndProcStatic(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-	return GetInstance()._HostWndProc(hWnd, msg, wParam, lParam);
+	// 主窗口的消息总是在创建它的线程上处理，即所属会话的主线程
+	App* app = GetCurrent();
+	if (!app) {
+		return DefWindowProc(hWnd, msg, wParam, lParam);
+	}
+
+	return app->_HostWndProc(hWnd, msg, wParam, lParam);
 }
 
 
 LRESULT App::_HostWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
 	if (message == WM_DESTORYHOST) {
+		// wParam 为源窗口句柄时只关闭缩放该窗口的会话，为 0 时关闭所有会话
+		if (wParam && (HWND)wParam != _hwndSrc) {
+			return 0;
+		}
+
 		SPDLOG_LOGGER_INFO(logger, "收到 MAGPIE_WM_DESTORYHOST 消息，即将销毁主窗口");
 		Close();
 		return 0;
@@ -488,6 +636,8 @@ void App::_OnQuit() {
 	_frameSource = nullptr;
 	_renderer = nullptr;
 
+	_RemoveFromSessions();
+
 	// 计时器资源在窗口销毁时自动释放
 	_nextTimerId = 1;
 	_timerCbs.clear();
@@ -527,7 +677,36 @@ void App::_OnQuit() {
 	SPDLOG_LOGGER_INFO(logger, "主窗口已销毁");
 }
 
+void App::_RemoveFromSessions() {
+	AcquireSRWLockExclusive(&_sessionsLock);
+	auto it = std::find(_sessions.begin(), _sessions.end(), this);
+	if (it != _sessions.end()) {
+		_sessions.erase(it);
+	}
+	ReleaseSRWLockExclusive(&_sessionsLock);
+}
+
+void App::SetEffectsJson(HWND hwndSrc, const std::string& effectsJson) {
+	// 会话从列表中移除前不会销毁
+	AcquireSRWLockShared(&_sessionsLock);
+	for (App* app : _sessions) {
+		if (hwndSrc && app->_hwndSrc != hwndSrc) {
+			continue;
+		}
+
+		AcquireSRWLockExclusive(&app->_pendingEffectsJsonLock);
+		app->_pendingEffectsJson = effectsJson;
+		ReleaseSRWLockExclusive(&app->_pendingEffectsJsonLock);
+	}
+	ReleaseSRWLockShared(&_sessionsLock);
+}
+
 void App::Close() {
+	// 先停止渲染，之后不会再呈现到即将销毁的窗口
+	if (_renderer) {
+		_renderer->StopRenderThread();
+	}
+
 	if (_hwndDDF) {
 		DestroyWindow(_hwndDDF);
 	}
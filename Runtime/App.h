@@ -4,17 +4,51 @@
 #include "FrameSourceBase.h"
 
 
+// 每个缩放会话一个实例，一个进程中可以同时存在多个会话
+// 会话的主线程（调用 Run 的线程）、渲染线程和加载效果的线程都绑定到该会话，
+// 这些线程上 GetInstance 返回所属的会话
 class App {
 public:
-	~App();
+	App() = default;
+	App(const App&) = delete;
+	App(App&&) = delete;
 
+	// 只能在绑定了会话的线程上调用
 	static App& GetInstance() {
-		static App instance;
-		return instance;
+		assert(_current);
+		return *_current;
 	}
 
-	bool Initialize(HINSTANCE hInst);
+	// 当前线程绑定的会话，没有时返回 nullptr
+	static App* GetCurrent() {
+		return _current;
+	}
+
+	// 将当前线程绑定到一个会话，离开作用域时还原
+	// 会话创建的线程和线程池回调中使用
+	class ThreadScope {
+	public:
+		ThreadScope(const ThreadScope&) = delete;
+		ThreadScope(ThreadScope&&) = delete;
+
+		explicit ThreadScope(App* app) : _prev(_current) {
+			_current = app;
+		}
+
+		~ThreadScope() {
+			_current = _prev;
+		}
+
+	private:
+		App* _prev;
+	};
+
+	// 初始化所有会话共用的状态，进程中只调用一次
+	static bool Initialize(HINSTANCE hInst);
 
+	static void Uninitialize();
+
+	// 阻塞直到全屏结束。每个会话在自己的线程上调用，该线程必须能够进入 MTA
 	bool Run(
 		HWND hwndSrc,
 		const std::string& effectsJson,
@@ -30,7 +64,11 @@ public:
 
 	void Close();
 
-	HINSTANCE GetHInstance() const {
+	// 全屏期间更换效果，在会话的主线程上应用。可以在任意线程调用
+	// hwndSrc 为 NULL 时更换所有会话的效果
+	static void SetEffectsJson(HWND hwndSrc, const std::string& effectsJson);
+
+	static HINSTANCE GetHInstance() {
 		return _hInst;
 	}
 
@@ -132,6 +170,22 @@ public:
 		return _flags & (UINT)_FlagMasks::SimulateExclusiveFullscreen;
 	}
 
+	bool IsSpecializeEffectConstants() const {
+		return _flags & (UINT)_FlagMasks::SpecializeEffectConstants;
+	}
+
+	bool IsHalfPrecisionEffects() const {
+		return _flags & (UINT)_FlagMasks::HalfPrecisionEffects;
+	}
+
+	bool IsRecordEffectCommandList() const {
+		return _flags & (UINT)_FlagMasks::RecordEffectCommandList;
+	}
+
+	bool IsAdaptiveQuality() const {
+		return _flags & (UINT)_FlagMasks::AdaptiveQuality;
+	}
+
 	const char* GetErrorMsg() const {
 		return _errorMsg;
 	}
@@ -140,20 +194,31 @@ public:
 		_errorMsg = errorMsg;
 	}
 
-	ComPtr<IWICImagingFactory2> GetWICImageFactory();
+	// 所有会话共享，可以在任意线程调用
+	static ComPtr<IWICImagingFactory2> GetWICImageFactory();
 
 	bool RegisterTimer(UINT uElapse, std::function<void()> cb);
 
 private:
-	App() {}
-
 	void _Run();
 
-	void _RegisterWndClasses() const;
+	// 在主线程上定期调用
+	void _OnCheckTimer();
+
+	// 根据 _captureMode 创建并初始化帧源，已有的帧源被销毁
+	bool _CreateFrameSource();
+
+	// 源窗口的位置或大小改变后重新创建帧源并重新构建效果，不重新创建设备和主窗口
+	// 返回 false 时应退出全屏
+	bool _Rebuild();
+
+	static void _RegisterWndClasses();
 
-	// 创建主窗口
+	// 创建主窗口并注册到会话列表，主窗口不能和其他会话的主窗口重叠
 	bool _CreateHostWnd();
 
+	void _RemoveFromSessions();
+
 	bool _DisableDirectFlip();
 
 	static LRESULT CALLBACK _HostWndProcStatic(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
@@ -162,9 +227,18 @@ private:
 
 	void _OnQuit();
 
+	static inline thread_local App* _current = nullptr;
+
+	static inline HINSTANCE _hInst = NULL;
+	static inline ComPtr<IWICImagingFactory2> _wicImgFactory;
+	static inline SRWLOCK _wicImgFactoryLock = SRWLOCK_INIT;
+
+	// 正在运行的所有会话
+	static inline std::vector<App*> _sessions;
+	static inline SRWLOCK _sessionsLock = SRWLOCK_INIT;
+
 	const char* _errorMsg = ErrorMessages::GENERIC;
 
-	HINSTANCE _hInst = NULL;
 	HWND _hwndSrc = NULL;
 	HWND _hwndHost = NULL;
 
@@ -194,18 +268,30 @@ private:
 		DisableDirectFlip = 0x80,
 		ConfineCursorIn3DGames = 0x100,
 		CropTitleBarOfUWP = 0x200,
-		DisableEffectCache = 0x400
+		DisableEffectCache = 0x400,
+		SpecializeEffectConstants = 0x800,
+		HalfPrecisionEffects = 0x1000,
+		RecordEffectCommandList = 0x2000,
+		AdaptiveQuality = 0x4000
 	};
 
 	// 多屏幕模式下光标可以在屏幕间自由移动
 	bool _isMultiMonitorMode = false;
 
 	bool _windowResizingDisabled = false;
+	// 一直没能加载效果，Run 返回 false
+	bool _effectsLoadFailed = false;
 	bool _roundCornerDisabled = false;
 
+	// 由 SetEffectsJson 设置，等待主线程取走
+	std::optional<std::string> _pendingEffectsJson;
+	SRWLOCK _pendingEffectsJsonLock = SRWLOCK_INIT;
+
 	std::unique_ptr<Renderer> _renderer;
 	std::unique_ptr<FrameSourceBase> _frameSource;
-	ComPtr<IWICImagingFactory2> _wicImgFactory;
+
+	// 检查源窗口状态的间隔（毫秒）
+	static constexpr UINT _CHECK_TIMER_INTERVAL = 50;
 
 	UINT _nextTimerId = 1;
 	// 存储所有计时器回调
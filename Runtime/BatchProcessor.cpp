@@ -0,0 +1,772 @@
+#include "pch.h"
+#include "BatchProcessor.h"
+#include "CpuEffectChain.h"
+#include "CpuTiledProcessor.h"
+#include "GpuEffectChain.h"
+#include "App.h"
+#include "Utils.h"
+#include "StrUtils.h"
+#include <thread>
+#include <atomic>
+#include <deque>
+#include <wincodec.h>
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+
+// 有界阻塞队列，队列已满时 Push 阻塞，为空时 Pop 阻塞
+// Close 之后 Pop 取完剩余的元素后返回 false
+template<typename T>
+class BatchQueue {
+public:
+	explicit BatchQueue(size_t capacity) : _capacity(std::max<size_t>(capacity, 1)) {}
+
+	void Push(T&& item) {
+		AcquireSRWLockExclusive(&_lock);
+		while (_items.size() >= _capacity) {
+			SleepConditionVariableSRW(&_notFull, &_lock, INFINITE, 0);
+		}
+
+		_items.push_back(std::move(item));
+		ReleaseSRWLockExclusive(&_lock);
+
+		WakeConditionVariable(&_notEmpty);
+	}
+
+	bool Pop(T& item) {
+		AcquireSRWLockExclusive(&_lock);
+		while (_items.empty() && !_closed) {
+			SleepConditionVariableSRW(&_notEmpty, &_lock, INFINITE, 0);
+		}
+
+		if (_items.empty()) {
+			ReleaseSRWLockExclusive(&_lock);
+			return false;
+		}
+
+		item = std::move(_items.front());
+		_items.pop_front();
+		ReleaseSRWLockExclusive(&_lock);
+
+		WakeConditionVariable(&_notFull);
+		return true;
+	}
+
+	// 所有生产者退出后调用
+	void Close() {
+		AcquireSRWLockExclusive(&_lock);
+		_closed = true;
+		ReleaseSRWLockExclusive(&_lock);
+
+		WakeAllConditionVariable(&_notEmpty);
+	}
+
+private:
+	std::deque<T> _items;
+	size_t _capacity;
+	bool _closed = false;
+
+	SRWLOCK _lock = SRWLOCK_INIT;
+	CONDITION_VARIABLE _notFull = CONDITION_VARIABLE_INIT;
+	CONDITION_VARIABLE _notEmpty = CONDITION_VARIABLE_INIT;
+};
+
+// 在途图像的内存预算
+class BatchMemoryBudget {
+public:
+	explicit BatchMemoryBudget(size_t budget) : _budget(budget) {}
+
+	// 预算不足时阻塞。没有其他在途图像时总是成功，否则超出预算的图像永远无法处理
+	void Acquire(size_t size) {
+		AcquireSRWLockExclusive(&_lock);
+		while (_used > 0 && _used + size > _budget) {
+			SleepConditionVariableSRW(&_released, &_lock, INFINITE, 0);
+		}
+
+		_used += size;
+		ReleaseSRWLockExclusive(&_lock);
+	}
+
+	void Release(size_t size) {
+		if (size == 0) {
+			return;
+		}
+
+		AcquireSRWLockExclusive(&_lock);
+		assert(_used >= size);
+		_used -= size;
+		ReleaseSRWLockExclusive(&_lock);
+
+		WakeAllConditionVariable(&_released);
+	}
+
+private:
+	size_t _budget;
+	size_t _used = 0;
+
+	SRWLOCK _lock = SRWLOCK_INIT;
+	CONDITION_VARIABLE _released = CONDITION_VARIABLE_INIT;
+};
+
+struct BatchItem {
+	size_t index = 0;
+	// 解码前预留的内存，编码完成后归还
+	size_t reservedMemory = 0;
+	CpuImage image;
+	// GPU 处理时图像保存为 B8G8R8A8，不转换为 CpuImage
+	std::vector<BYTE> pixels;
+	SIZE pixelsSize{};
+
+	// 分块处理的图像不预先解码，由处理线程边读边写
+	ComPtr<IWICBitmapFrameDecode> frame;
+	CpuTiledProcessor::Plan tilePlan;
+};
+
+
+static std::wstring GetExtension(std::wstring_view fileName) {
+	size_t pos = fileName.find_last_of(L".\\/");
+	if (pos == std::wstring_view::npos || fileName[pos] != L'.') {
+		return {};
+	}
+
+	std::wstring result(fileName.substr(pos + 1));
+	for (wchar_t& c : result) {
+		c = towlower(c);
+	}
+	return result;
+}
+
+static const GUID* GetContainerFormat(std::wstring_view extension) {
+	if (extension == L"png") {
+		return &GUID_ContainerFormatPng;
+	} else if (extension == L"jpg" || extension == L"jpeg") {
+		return &GUID_ContainerFormatJpeg;
+	} else if (extension == L"bmp") {
+		return &GUID_ContainerFormatBmp;
+	} else if (extension == L"tif" || extension == L"tiff") {
+		return &GUID_ContainerFormatTiff;
+	} else {
+		return nullptr;
+	}
+}
+
+bool BatchProcessor::IsSupportedInput(std::wstring_view extension) {
+	return GetContainerFormat(extension) != nullptr || extension == L"gif" || extension == L"webp";
+}
+
+bool BatchProcessor::IsSupportedOutput(std::wstring_view extension) {
+	return GetContainerFormat(extension) != nullptr;
+}
+
+// 只读取尺寸，解码推迟到预留内存之后
+static bool OpenImage(IWICImagingFactory2* factory, const wchar_t* fileName, ComPtr<IWICBitmapFrameDecode>& frame, SIZE& size) {
+	ComPtr<IWICBitmapDecoder> decoder;
+	HRESULT hr = factory->CreateDecoderFromFilename(fileName, nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateDecoderFromFilename 失败", hr));
+		return false;
+	}
+
+	hr = decoder->GetFrame(0, &frame);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("IWICBitmapFrameDecode::GetFrame 失败", hr));
+		return false;
+	}
+
+	UINT width, height;
+	hr = frame->GetSize(&width, &height);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("GetSize 失败", hr));
+		return false;
+	}
+
+	size = { (LONG)width, (LONG)height };
+	return true;
+}
+
+static bool CreateBGRAConverter(IWICImagingFactory2* factory, IWICBitmapFrameDecode* frame, ComPtr<IWICFormatConverter>& formatConverter) {
+	// 转换为 B8G8R8A8，和捕获的帧相同。浮点格式在 WIC 中为线性空间，不适合直接输入效果
+	HRESULT hr = factory->CreateFormatConverter(&formatConverter);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateFormatConverter 失败", hr));
+		return false;
+	}
+
+	hr = formatConverter->Initialize(frame, GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone, nullptr, 0, WICBitmapPaletteTypeCustom);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("IWICFormatConverter::Initialize 失败", hr));
+		return false;
+	}
+
+	return true;
+}
+
+// 解码为 B8G8R8A8，行距为宽度的 4 倍
+static bool DecodeBGRA(IWICImagingFactory2* factory, IWICBitmapFrameDecode* frame, std::vector<BYTE>& result, SIZE& size) {
+	ComPtr<IWICFormatConverter> formatConverter;
+	if (!CreateBGRAConverter(factory, frame, formatConverter)) {
+		return false;
+	}
+
+	UINT width, height;
+	HRESULT hr = formatConverter->GetSize(&width, &height);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("GetSize 失败", hr));
+		return false;
+	}
+
+	const UINT stride = width * 4;
+	result.resize(size_t(stride) * height);
+	hr = formatConverter->CopyPixels(nullptr, stride, (UINT)result.size(), result.data());
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CopyPixels 失败", hr));
+		return false;
+	}
+
+	size = { (LONG)width, (LONG)height };
+	return true;
+}
+
+static bool DecodeImage(IWICImagingFactory2* factory, IWICBitmapFrameDecode* frame, CpuImage& result) {
+	std::vector<BYTE> buf;
+	SIZE size;
+	if (!DecodeBGRA(factory, frame, buf, size)) {
+		return false;
+	}
+
+	return CpuImageUtils::FromBGRA8(buf.data(), size.cx, size.cy, size.cx * 4, result);
+}
+
+// 以 B8G8R8A8 格式逐段写入图像，每次追加若干行
+class BatchImageWriter {
+public:
+	bool Initialize(IWICImagingFactory2* factory, const std::wstring& fileName, UINT width, UINT height) {
+		const GUID* containerFormat = GetContainerFormat(GetExtension(fileName));
+		assert(containerFormat);
+
+		_factory = factory;
+		_width = width;
+
+		ComPtr<IWICStream> stream;
+		HRESULT hr = factory->CreateStream(&stream);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateStream 失败", hr));
+			return false;
+		}
+
+		hr = stream->InitializeFromFilename(fileName.c_str(), GENERIC_WRITE);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("InitializeFromFilename 失败", hr));
+			return false;
+		}
+
+		hr = factory->CreateEncoder(*containerFormat, nullptr, &_encoder);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateEncoder 失败", hr));
+			return false;
+		}
+
+		hr = _encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("IWICBitmapEncoder::Initialize 失败", hr));
+			return false;
+		}
+
+		ComPtr<IPropertyBag2> props;
+		hr = _encoder->CreateNewFrame(&_frame, &props);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateNewFrame 失败", hr));
+			return false;
+		}
+
+		hr = _frame->Initialize(props.Get());
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("IWICBitmapFrameEncode::Initialize 失败", hr));
+			return false;
+		}
+
+		hr = _frame->SetSize(width, height);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("SetSize 失败", hr));
+			return false;
+		}
+
+		// 编码器可能选择其他格式（如 JPEG 不支持 Alpha 通道），WriteSource 会自动转换
+		WICPixelFormatGUID pixelFormat = GUID_WICPixelFormat32bppBGRA;
+		hr = _frame->SetPixelFormat(&pixelFormat);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("SetPixelFormat 失败", hr));
+			return false;
+		}
+
+		return true;
+	}
+
+	bool WriteRows(const BYTE* data, UINT rowCount, UINT rowPitch) {
+		ComPtr<IWICBitmap> bitmap;
+		HRESULT hr = _factory->CreateBitmapFromMemory(_width, rowCount, GUID_WICPixelFormat32bppBGRA,
+			rowPitch, rowPitch * rowCount, (BYTE*)data, &bitmap);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateBitmapFromMemory 失败", hr));
+			return false;
+		}
+
+		// 多次调用 WriteSource 时依次追加
+		hr = _frame->WriteSource(bitmap.Get(), nullptr);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("WriteSource 失败", hr));
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Commit() {
+		HRESULT hr = _frame->Commit();
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("IWICBitmapFrameEncode::Commit 失败", hr));
+			return false;
+		}
+
+		hr = _encoder->Commit();
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("IWICBitmapEncoder::Commit 失败", hr));
+			return false;
+		}
+
+		return true;
+	}
+
+private:
+	IWICImagingFactory2* _factory = nullptr;
+	ComPtr<IWICBitmapEncoder> _encoder;
+	ComPtr<IWICBitmapFrameEncode> _frame;
+	UINT _width = 0;
+};
+
+static bool EncodeBGRA(IWICImagingFactory2* factory, const BYTE* data, SIZE size, const std::wstring& fileName) {
+	BatchImageWriter writer;
+	return writer.Initialize(factory, fileName, size.cx, size.cy)
+		&& writer.WriteRows(data, size.cy, size.cx * 4)
+		&& writer.Commit();
+}
+
+static bool EncodeImage(IWICImagingFactory2* factory, const CpuImage& img, const std::wstring& fileName) {
+	const UINT width = img.GetWidth();
+	const UINT height = img.GetHeight();
+	std::vector<BYTE> buf(size_t(width) * height * 4);
+	CpuImageUtils::ToBGRA8(img, buf.data(), width * 4);
+
+	return EncodeBGRA(factory, buf.data(), { (LONG)width, (LONG)height }, fileName);
+}
+
+// 分块处理超出内存预算或纹理尺寸限制的图像，边解码边编码
+// gpuChain 不为空时在显卡上处理，否则使用 chain
+static bool ProcessTiled(
+	IWICImagingFactory2* factory,
+	const CpuEffectChain& chain,
+	const GpuEffectChain* gpuChain,
+	IWICBitmapFrameDecode* frame,
+	const CpuTiledProcessor::Plan& plan,
+	size_t memoryBudget,
+	const std::wstring& outputFile
+) {
+	ComPtr<IWICFormatConverter> formatConverter;
+	if (!CreateBGRAConverter(factory, frame, formatConverter)) {
+		return false;
+	}
+
+	BatchImageWriter writer;
+	if (!writer.Initialize(factory, outputFile, plan.outputSize.cx, plan.outputSize.cy)) {
+		return false;
+	}
+
+	auto readRows = [&](UINT y, UINT rowCount, BYTE* data, UINT rowPitch) {
+		// 行号递增，解码器无需回退
+		const WICRect rect{ 0, (INT)y, (INT)plan.inputSize.cx, (INT)rowCount };
+		HRESULT hr = formatConverter->CopyPixels(&rect, rowPitch, rowPitch * rowCount, data);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CopyPixels 失败", hr));
+			return false;
+		}
+		return true;
+	};
+
+	auto writeRows = [&](UINT rowCount, const BYTE* data, UINT rowPitch) {
+		return writer.WriteRows(data, rowCount, rowPitch);
+	};
+
+	if (gpuChain) {
+		// 立即上下文同一时刻只能处理一块
+		SPDLOG_LOGGER_INFO(logger, fmt::format("在显卡上分块处理：{}x{} 块，边长 {}，halo {}",
+			plan.columns, plan.rows, plan.tileSize, plan.halo));
+
+		auto processTile = [gpuChain](const BYTE* input, UINT width, UINT height, UINT pitch, std::vector<BYTE>& output, SIZE& outputSize) {
+			return gpuChain->Process(input, width, height, pitch, output, outputSize);
+		};
+		return CpuTiledProcessor::Run(plan, 1, readRows, processTile, writeRows) && writer.Commit();
+	}
+
+	const UINT parallelTiles = CpuTiledProcessor::CalcParallelTiles(chain, plan, memoryBudget);
+	SPDLOG_LOGGER_INFO(logger, fmt::format("分块处理：{}x{} 块，边长 {}，halo {}，同时处理 {} 块",
+		plan.columns, plan.rows, plan.tileSize, plan.halo, parallelTiles));
+
+	return CpuTiledProcessor::Run(chain, plan, parallelTiles, readRows, writeRows) && writer.Commit();
+}
+
+bool BatchProcessor::_EnumerateInputs(const std::wstring& input, std::vector<std::wstring>& result) {
+	std::wstring dir;
+	std::wstring pattern;
+
+	if (Utils::DirExists(input.c_str())) {
+		dir = input;
+		pattern = input + L"\\*";
+	} else {
+		size_t pos = input.find_last_of(L"\\/");
+		dir = pos == std::wstring::npos ? L"." : input.substr(0, pos);
+		pattern = input;
+	}
+
+	WIN32_FIND_DATA findData{};
+	HANDLE hFind = FindFirstFileEx(pattern.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+	if (hFind == INVALID_HANDLE_VALUE) {
+		SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("FindFirstFileEx 失败"));
+		return false;
+	}
+
+	do {
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			continue;
+		}
+
+		if (IsSupportedInput(GetExtension(findData.cFileName))) {
+			result.push_back(dir + L"\\" + findData.cFileName);
+		}
+	} while (FindNextFile(hFind, &findData));
+
+	FindClose(hFind);
+
+	// 按文件名排序，使图像序列按顺序处理
+	std::sort(result.begin(), result.end());
+	return true;
+}
+
+bool BatchProcessor::Run(
+	const std::string& effectsJson,
+	const std::wstring& input,
+	const std::wstring& outputDir,
+	const Options& options,
+	const ProgressCallback& progressCallback,
+	Result& result
+) {
+	using namespace std::chrono;
+
+	result = {};
+	const auto startTime = steady_clock::now();
+
+	if (!options.outputFormat.empty() && !IsSupportedOutput(options.outputFormat)) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("不支持的输出格式：{}", StrUtils::UTF16ToUTF8(options.outputFormat)));
+		return false;
+	}
+
+	// 两者只使用一个
+	CpuEffectChain chain;
+	std::unique_ptr<GpuEffectChain> gpuChain;
+	if (options.gpuAdapter >= 0) {
+		gpuChain = std::make_unique<GpuEffectChain>();
+		if (!gpuChain->Initialize(effectsJson, (UINT)options.gpuAdapter)) {
+			SPDLOG_LOGGER_ERROR(logger, "初始化 GpuEffectChain 失败");
+			return false;
+		}
+	} else if (!chain.Initialize(effectsJson)) {
+		SPDLOG_LOGGER_ERROR(logger, "初始化 CpuEffectChain 失败");
+		return false;
+	}
+
+	std::vector<std::wstring> inputs;
+	if (!_EnumerateInputs(input, inputs)) {
+		SPDLOG_LOGGER_ERROR(logger, "枚举输入文件失败");
+		return false;
+	}
+
+	if (inputs.empty()) {
+		SPDLOG_LOGGER_ERROR(logger, "没有可以处理的图像");
+		return false;
+	}
+
+	if (!Utils::DirExists(outputDir.c_str()) && !CreateDirectory(outputDir.c_str(), nullptr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("创建输出文件夹失败"));
+		return false;
+	}
+
+	// 输出文件和输入同名，扩展名不支持编码时使用 png
+	std::vector<std::wstring> outputs;
+	outputs.reserve(inputs.size());
+	for (const std::wstring& inputFile : inputs) {
+		size_t namePos = inputFile.find_last_of(L"\\/") + 1;
+		std::wstring name = inputFile.substr(namePos);
+		std::wstring ext = GetExtension(name);
+		if (!ext.empty()) {
+			name.resize(name.size() - ext.size() - 1);
+		}
+
+		if (!options.outputFormat.empty()) {
+			ext = options.outputFormat;
+		} else if (!IsSupportedOutput(ext)) {
+			ext = L"png";
+		}
+
+		outputs.push_back(outputDir + L"\\" + name + L"." + ext);
+	}
+
+	ComPtr<IWICImagingFactory2> wicFactory = App::GetWICImageFactory();
+	if (!wicFactory) {
+		SPDLOG_LOGGER_ERROR(logger, "GetWICImageFactory 失败");
+		return false;
+	}
+
+	// 效果本身已按条带并行，处理阶段的第二个线程用于填补单线程部分（如分配内存）留下的空闲
+	// GPU 处理时立即上下文被锁定，多个处理线程无法并行
+	// PNG 编码是单线程的且通常最慢，因此编码线程最多
+	const UINT cpuCount = std::max(std::thread::hardware_concurrency(), 1u);
+	const UINT decodeThreads = options.decodeThreads ? options.decodeThreads : std::max(cpuCount / 4, 1u);
+	const UINT processThreads = options.processThreads ? options.processThreads : (gpuChain ? 1 : 2);
+	const UINT encodeThreads = options.encodeThreads ? options.encodeThreads : std::max(cpuCount / 2, 2u);
+
+	SPDLOG_LOGGER_INFO(logger, fmt::format("开始批处理：{} 张图像，线程数 {}/{}/{}，内存预算 {} MB",
+		inputs.size(), decodeThreads, processThreads, encodeThreads, options.memoryBudget >> 20));
+
+	using BatchItemPtr = std::unique_ptr<BatchItem>;
+	BatchQueue<BatchItemPtr> processQueue(options.queueCapacity);
+	BatchQueue<BatchItemPtr> encodeQueue(options.queueCapacity);
+	BatchMemoryBudget memoryBudget(options.memoryBudget);
+
+	std::atomic<size_t> nextInput = 0;
+	std::atomic<UINT> processedCount = 0;
+	std::atomic<UINT> failedCount = 0;
+	const UINT total = (UINT)inputs.size();
+
+	auto finishItem = [&](bool succeeded, size_t reservedMemory) {
+		memoryBudget.Release(reservedMemory);
+
+		if (!succeeded) {
+			++failedCount;
+		}
+
+		UINT processed = ++processedCount;
+		if (progressCallback) {
+			progressCallback(processed, total);
+		}
+	};
+
+	auto decodeProc = [&]() {
+		winrt::init_apartment(winrt::apartment_type::multi_threaded);
+
+		while (true) {
+			const size_t i = nextInput++;
+			if (i >= inputs.size()) {
+				break;
+			}
+
+			const std::string inputName = StrUtils::UTF16ToUTF8(inputs[i]);
+
+			ComPtr<IWICBitmapFrameDecode> frame;
+			SIZE inputSize{};
+			SIZE outputSize{};
+			if (!OpenImage(wicFactory.Get(), inputs[i].c_str(), frame, inputSize)
+				|| !(gpuChain ? gpuChain->CalcOutputSize(inputSize, outputSize) : chain.CalcOutputSize(inputSize, outputSize))
+			) {
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("打开 {} 失败", inputName));
+				finishItem(false, 0);
+				continue;
+			}
+
+			BatchItemPtr item = std::make_unique<BatchItem>();
+			item->index = i;
+
+			if (gpuChain) {
+				// 显存不计入预算，内存中只有 B8G8R8A8 的输入和输出
+				const size_t reservedMemory = (size_t(inputSize.cx) * inputSize.cy + size_t(outputSize.cx) * outputSize.cy) * 4;
+
+				SIZE maxTextureSize;
+				if (!gpuChain->CalcMaxTextureSize(inputSize, maxTextureSize)) {
+					SPDLOG_LOGGER_ERROR(logger, fmt::format("打开 {} 失败", inputName));
+					finishItem(false, 0);
+					continue;
+				}
+
+				// 任一纹理超出尺寸限制或整张处理超出预算时分块处理
+				if ((UINT)std::max(maxTextureSize.cx, maxTextureSize.cy) > GpuEffectChain::MAX_TEXTURE_SIZE
+					|| reservedMemory > options.memoryBudget
+				) {
+					if (!gpuChain->CreateTilePlan(inputSize, options.tileSize, options.memoryBudget, item->tilePlan)) {
+						SPDLOG_LOGGER_ERROR(logger, fmt::format("{} 需要分块处理，但效果链不支持", inputName));
+						finishItem(false, 0);
+						continue;
+					}
+
+					memoryBudget.Acquire(options.memoryBudget);
+					item->reservedMemory = options.memoryBudget;
+					item->frame = std::move(frame);
+					processQueue.Push(std::move(item));
+					continue;
+				}
+
+				memoryBudget.Acquire(reservedMemory);
+				item->reservedMemory = reservedMemory;
+
+				if (!DecodeBGRA(wicFactory.Get(), frame.Get(), item->pixels, item->pixelsSize)) {
+					SPDLOG_LOGGER_ERROR(logger, fmt::format("解码 {} 失败", inputName));
+					finishItem(false, reservedMemory);
+					continue;
+				}
+
+				processQueue.Push(std::move(item));
+				continue;
+			}
+
+			// 还需要一个 B8G8R8A8 格式的编码缓冲区
+			const size_t reservedMemory = chain.EstimateMemoryUsage(inputSize) + size_t(outputSize.cx) * outputSize.cy * 4;
+
+			// 整张处理超出预算时分块处理，此时独占全部预算
+			// 效果链不支持分块时仍整张处理
+			if (reservedMemory > options.memoryBudget && CpuTiledProcessor::CreatePlan(
+				chain, inputSize, options.tileSize, options.memoryBudget, item->tilePlan)
+			) {
+				memoryBudget.Acquire(options.memoryBudget);
+				item->reservedMemory = options.memoryBudget;
+				item->frame = std::move(frame);
+				processQueue.Push(std::move(item));
+				continue;
+			}
+
+			memoryBudget.Acquire(reservedMemory);
+			item->reservedMemory = reservedMemory;
+
+			if (!DecodeImage(wicFactory.Get(), frame.Get(), item->image)) {
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("解码 {} 失败", inputName));
+				finishItem(false, reservedMemory);
+				continue;
+			}
+
+			processQueue.Push(std::move(item));
+		}
+
+		winrt::uninit_apartment();
+	};
+
+	auto processProc = [&]() {
+		winrt::init_apartment(winrt::apartment_type::multi_threaded);
+
+		BatchItemPtr item;
+		while (processQueue.Pop(item)) {
+			if (item->frame) {
+				const size_t index = item->index;
+				const size_t reservedMemory = item->reservedMemory;
+
+				bool succeeded = ProcessTiled(wicFactory.Get(), chain, gpuChain.get(), item->frame.Get(),
+					item->tilePlan, options.memoryBudget, outputs[index]);
+				if (!succeeded) {
+					SPDLOG_LOGGER_ERROR(logger, fmt::format("分块处理 {} 失败", StrUtils::UTF16ToUTF8(inputs[index])));
+				}
+
+				item.reset();
+				finishItem(succeeded, reservedMemory);
+				continue;
+			}
+
+			if (gpuChain) {
+				std::vector<BYTE> output;
+				SIZE outputSize;
+				if (!gpuChain->Process(item->pixels.data(), item->pixelsSize.cx, item->pixelsSize.cy,
+					item->pixelsSize.cx * 4, output, outputSize)
+				) {
+					SPDLOG_LOGGER_ERROR(logger, fmt::format("处理 {} 失败", StrUtils::UTF16ToUTF8(inputs[item->index])));
+					finishItem(false, item->reservedMemory);
+					continue;
+				}
+
+				// 释放输入
+				item->pixels = std::move(output);
+				item->pixelsSize = outputSize;
+				encodeQueue.Push(std::move(item));
+				continue;
+			}
+
+			CpuImage output;
+			if (!chain.Process(item->image, output)) {
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("处理 {} 失败", StrUtils::UTF16ToUTF8(inputs[item->index])));
+				finishItem(false, item->reservedMemory);
+				continue;
+			}
+
+			// 释放输入
+			item->image = std::move(output);
+			encodeQueue.Push(std::move(item));
+		}
+
+		winrt::uninit_apartment();
+	};
+
+	auto encodeProc = [&]() {
+		winrt::init_apartment(winrt::apartment_type::multi_threaded);
+
+		BatchItemPtr item;
+		while (encodeQueue.Pop(item)) {
+			const size_t index = item->index;
+			const size_t reservedMemory = item->reservedMemory;
+
+			bool succeeded = item->pixels.empty()
+				? EncodeImage(wicFactory.Get(), item->image, outputs[index])
+				: EncodeBGRA(wicFactory.Get(), item->pixels.data(), item->pixelsSize, outputs[index]);
+			if (!succeeded) {
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("编码 {} 失败", StrUtils::UTF16ToUTF8(outputs[index])));
+			}
+
+			// 先释放图像再归还预算
+			item.reset();
+			finishItem(succeeded, reservedMemory);
+		}
+
+		winrt::uninit_apartment();
+	};
+
+	std::vector<std::thread> decodeWorkers;
+	std::vector<std::thread> processWorkers;
+	std::vector<std::thread> encodeWorkers;
+	for (UINT i = 0; i < decodeThreads; ++i) {
+		decodeWorkers.emplace_back(decodeProc);
+	}
+	for (UINT i = 0; i < processThreads; ++i) {
+		processWorkers.emplace_back(processProc);
+	}
+	for (UINT i = 0; i < encodeThreads; ++i) {
+		encodeWorkers.emplace_back(encodeProc);
+	}
+
+	// 上游的所有线程退出后关闭下游的队列
+	for (std::thread& t : decodeWorkers) {
+		t.join();
+	}
+	processQueue.Close();
+
+	for (std::thread& t : processWorkers) {
+		t.join();
+	}
+	encodeQueue.Close();
+
+	for (std::thread& t : encodeWorkers) {
+		t.join();
+	}
+
+	result.total = total;
+	result.failed = failedCount;
+	result.succeeded = total - result.failed;
+	result.seconds = duration<double>(steady_clock::now() - startTime).count();
+
+	SPDLOG_LOGGER_INFO(logger, fmt::format("批处理完成：成功 {} 张，失败 {} 张，用时 {:.2f} 秒",
+		result.succeeded, result.failed, result.seconds));
+
+	return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "pch.h"
+
+
+// 离线批量处理图像：解码 -> 执行效果链 -> 编码
+// 三个阶段各有若干工作线程，阶段之间用有界队列连接
+// 解码前按 CpuEffectChain::EstimateMemoryUsage 预留内存，超出预算时解码线程等待，从而对上游形成背压
+// 整张处理超出预算的图像由 CpuTiledProcessor 分块处理
+// 指定 gpuAdapter 时效果链由 GpuEffectChain 在显卡上执行，超出纹理尺寸限制的图像同样分块处理
+class BatchProcessor {
+public:
+	struct Options {
+		// 各阶段的线程数，为 0 时根据处理器数量选择
+		UINT decodeThreads = 0;
+		UINT processThreads = 0;
+		UINT encodeThreads = 0;
+		// 每个队列最多容纳的图像数
+		UINT queueCapacity = 4;
+		// 所有在途图像占用内存的上限（字节）
+		// 单张图像超出预算时仍会处理，但此时不和其他图像并行
+		size_t memoryBudget = size_t(2) << 30;
+		// 输出文件的扩展名，如 "png"，为空时和输入相同
+		std::wstring outputFormat;
+		// 整张处理超出内存预算的图像分块处理，此为块的边长（输入像素），为 0 时根据预算选择
+		UINT tileSize = 0;
+		// 大于等于 0 时在该显卡上执行 MagpieFX 效果，否则使用 CpuEffectChain
+		int gpuAdapter = -1;
+	};
+
+	struct Result {
+		UINT total = 0;
+		UINT succeeded = 0;
+		UINT failed = 0;
+		double seconds = 0;
+	};
+
+	// 每处理完一张图像（无论成功与否）调用一次，可能在任意工作线程上调用
+	using ProgressCallback = std::function<void(UINT processed, UINT total)>;
+
+	// input 可以是文件夹、单个文件或带通配符的路径（如 frames\*.png）
+	// 输出文件和输入同名，存放在 outputDir 中
+	bool Run(
+		const std::string& effectsJson,
+		const std::wstring& input,
+		const std::wstring& outputDir,
+		const Options& options,
+		const ProgressCallback& progressCallback,
+		Result& result
+	);
+
+	// 可以解码的文件扩展名，不带点，小写
+	static bool IsSupportedInput(std::wstring_view extension);
+
+	// 可以编码的文件扩展名，不带点，小写
+	static bool IsSupportedOutput(std::wstring_view extension);
+
+private:
+	static bool _EnumerateInputs(const std::wstring& input, std::vector<std::wstring>& result);
+};
@@ -0,0 +1,405 @@
+#include "pch.h"
+#include "CpuEffectChain.h"
+#include <rapidjson/document.h>
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+
+// 常量的地址和取值范围，和 HLSL 中的 MIN 和 MAX 相同
+struct CpuConstantInfo {
+	float* floatValue = nullptr;
+	int* intValue = nullptr;
+	float minValue = std::numeric_limits<float>::lowest();
+	float maxValue = std::numeric_limits<float>::max();
+};
+
+bool CpuEffectChain::_ParseEffectType(std::string_view name, _EffectType& type) {
+	// 键为 effects 文件夹中的文件名
+	static const std::pair<std::string_view, _EffectType> EFFECTS[] = {
+		{ "CAS", _EffectType::CAS },
+		{ "LumaSharpen", _EffectType::LumaSharpen },
+		{ "NVSharpen", _EffectType::NVSharpen },
+		{ "AdaptiveSharpen", _EffectType::AdaptiveSharpen },
+		{ "FineSharp", _EffectType::FineSharp },
+		{ "NIS", _EffectType::NIS },
+		{ "RAVU_Lite_R3", _EffectType::RAVULite },
+		{ "RAVU_Zoom_R3", _EffectType::RAVUZoom }
+	};
+
+	for (const auto& [n, t] : EFFECTS) {
+		if (n == name) {
+			type = t;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool CpuEffectChain::Initialize(const std::string& effectsJson) {
+	rapidjson::Document doc;
+	if (doc.Parse(effectsJson.c_str(), effectsJson.size()).HasParseError()) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 json 失败\n\t错误码：{}", doc.GetParseError()));
+		return false;
+	}
+
+	if (!doc.IsArray() || doc.GetArray().Empty()) {
+		SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：根元素不为数组或为空");
+		return false;
+	}
+
+	for (const auto& effectJson : doc.GetArray()) {
+		if (!effectJson.IsObject()) {
+			SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：根数组中存在非法成员");
+			return false;
+		}
+
+		auto effectName = effectJson.FindMember("effect");
+		if (effectName == effectJson.MemberEnd() || !effectName->value.IsString()) {
+			SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：未找到 effect 属性或该属性的值不合法");
+			return false;
+		}
+
+		_Step& step = _steps.emplace_back();
+		if (!_ParseEffectType(effectName->value.GetString(), step.type)) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("效果 {} 没有 CPU 实现", effectName->value.GetString()));
+			return false;
+		}
+
+		switch (step.type) {
+		case _EffectType::NIS:
+			if (!_nis) {
+				_nis = std::make_unique<CpuNIS>();
+				if (!_nis->Initialize()) {
+					SPDLOG_LOGGER_ERROR(logger, "初始化 CpuNIS 失败");
+					return false;
+				}
+			}
+			break;
+		case _EffectType::RAVULite:
+			if (!_ravuLite) {
+				_ravuLite = std::make_unique<CpuRAVULite>();
+				if (!_ravuLite->Initialize()) {
+					SPDLOG_LOGGER_ERROR(logger, "初始化 CpuRAVULite 失败");
+					return false;
+				}
+			}
+			// 固定放大两倍
+			step.scaleX = step.scaleY = 2.0f;
+			break;
+		case _EffectType::RAVUZoom:
+			if (!_ravuZoom) {
+				_ravuZoom = std::make_unique<CpuRAVUZoom>();
+				if (!_ravuZoom->Initialize()) {
+					SPDLOG_LOGGER_ERROR(logger, "初始化 CpuRAVUZoom 失败");
+					return false;
+				}
+			}
+			break;
+		default:
+			break;
+		}
+
+		// 和 EffectDrawer::CanSetOutputSize 一致：未指定输出尺寸的缩放效果可以使用 scale 属性
+		const bool canSetOutputSize = step.type == _EffectType::NIS || step.type == _EffectType::RAVUZoom;
+
+		for (const auto& prop : effectJson.GetObject()) {
+			std::string_view name = prop.name.GetString();
+
+			if (name == "effect") {
+				continue;
+			}
+
+			if (canSetOutputSize && name == "scale") {
+				if (!prop.value.IsArray()) {
+					SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：非法的 scale 属性");
+					return false;
+				}
+
+				const auto& scale = prop.value.GetArray();
+				if (scale.Size() != 2 || !scale[0].IsNumber() || !scale[1].IsNumber()) {
+					SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：非法的 scale 属性");
+					return false;
+				}
+
+				static float DELTA = 1e-5f;
+
+				step.scaleX = scale[0].GetFloat();
+				step.scaleY = scale[1].GetFloat();
+				if (step.scaleX < DELTA || step.scaleY < DELTA) {
+					SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：离线处理时 scale 属性只能为正数");
+					return false;
+				}
+
+				continue;
+			}
+
+			CpuConstantInfo info;
+			switch (step.type) {
+			case _EffectType::CAS:
+				if (name == "sharpness") {
+					info = { &step.cas.sharpness, nullptr, 0.0f, 1.0f };
+				}
+				break;
+			case _EffectType::LumaSharpen:
+				if (name == "sharpStrength") {
+					info = { &step.lumaSharpen.sharpStrength, nullptr, 1e-5f };
+				} else if (name == "sharpClamp") {
+					info = { &step.lumaSharpen.sharpClamp, nullptr, 0.0f, 1.0f };
+				} else if (name == "pattern") {
+					info = { nullptr, &step.lumaSharpen.pattern, 0.0f, 3.0f };
+				} else if (name == "offsetBias") {
+					info = { &step.lumaSharpen.offsetBias, nullptr, 0.0f };
+				}
+				break;
+			case _EffectType::NVSharpen:
+				if (name == "sharpness") {
+					info = { &step.nvSharpen.sharpness, nullptr, 0.0f, 1.0f };
+				}
+				break;
+			case _EffectType::AdaptiveSharpen:
+				if (name == "curveHeight") {
+					info = { &step.adaptiveSharpen.curveHeight, nullptr, 1e-5f };
+				}
+				break;
+			case _EffectType::FineSharp:
+				if (name == "sstr") {
+					info = { &step.fineSharp.sstr, nullptr, 0.0f };
+				} else if (name == "cstr") {
+					info = { &step.fineSharp.cstr, nullptr, 0.0f };
+				} else if (name == "xstr") {
+					info = { &step.fineSharp.xstr, nullptr, 0.0f, 1.0f };
+				} else if (name == "xrep") {
+					info = { &step.fineSharp.xrep, nullptr, 0.0f };
+				}
+				break;
+			case _EffectType::NIS:
+				if (name == "sharpness") {
+					info = { &step.nis.sharpness, nullptr, 0.0f, 1.0f };
+				}
+				break;
+			default:
+				break;
+			}
+
+			if (info.floatValue) {
+				if (!prop.value.IsNumber()) {
+					SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 json 失败：成员 {} 的类型非法", name));
+					return false;
+				}
+
+				float value = prop.value.GetFloat();
+				if (value < info.minValue || value > info.maxValue) {
+					SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 json 失败：成员 {} 的值非法", name));
+					return false;
+				}
+
+				*info.floatValue = value;
+			} else if (info.intValue) {
+				int value;
+				if (prop.value.IsInt()) {
+					value = prop.value.GetInt();
+				} else if (prop.value.IsBool()) {
+					// bool 值视为 int
+					value = (int)prop.value.GetBool();
+				} else {
+					SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 json 失败：成员 {} 的类型非法", name));
+					return false;
+				}
+
+				if (value < info.minValue || value > info.maxValue) {
+					SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 json 失败：成员 {} 的值非法", name));
+					return false;
+				}
+
+				*info.intValue = value;
+			} else {
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 json 失败：非法成员 {}", name));
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+SIZE CpuEffectChain::_CalcStepOutputSize(const _Step& step, SIZE inputSize) {
+	if (step.scaleX == 0) {
+		return inputSize;
+	}
+
+	return { std::lroundf(inputSize.cx * step.scaleX), std::lroundf(inputSize.cy * step.scaleY) };
+}
+
+bool CpuEffectChain::CalcOutputSize(SIZE inputSize, SIZE& outputSize) const {
+	outputSize = inputSize;
+	for (const _Step& step : _steps) {
+		outputSize = _CalcStepOutputSize(step, outputSize);
+		if (outputSize.cx <= 0 || outputSize.cy <= 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+size_t CpuEffectChain::EstimateMemoryUsage(SIZE inputSize) const {
+	// 边框和填充最多占用 DEFAULT_BORDER * 2 + PADDING 个像素
+	auto imageSize = [](SIZE size) {
+		constexpr size_t extra = CpuImage::DEFAULT_BORDER * 2 + CpuImage::PADDING;
+		return (size.cx + extra) * (size.cy + extra) * sizeof(XMFLOAT4);
+	};
+
+	// 每一步同时存在输入、输出和不超过两个输出大小的中间图像
+	// 链的输入在整个过程中都存在
+	size_t peak = 0;
+	SIZE cur = inputSize;
+	for (const _Step& step : _steps) {
+		SIZE next = _CalcStepOutputSize(step, cur);
+		peak = std::max(peak, imageSize(cur) + imageSize(next) * 3);
+		cur = next;
+	}
+
+	return imageSize(inputSize) + peak;
+}
+
+UINT CpuEffectChain::_GetSamplingRadius(const _Step& step) {
+	// 多通道的效果为各通道的半径之和。缩放效果多出的 1 是因为输出像素对应的输入位置有小数部分
+	switch (step.type) {
+	case _EffectType::CAS:
+		return 1;
+	case _EffectType::LumaSharpen:
+		return CpuSharpen::GetLumaSharpenRadius(step.lumaSharpen);
+	case _EffectType::NVSharpen:
+		return 2;
+	case _EffectType::AdaptiveSharpen:
+		// 边缘检测 2 + 锐化 3
+		return 5;
+	case _EffectType::FineSharp:
+		// 高斯模糊、中值滤波、均衡和 XSharpen 各 1
+		return 4;
+	case _EffectType::NIS:
+		// 6x6 采样范围 [-3, 2]，边缘图 +1
+		return 4;
+	case _EffectType::RAVULite:
+		// 整数倍放大，5x5 的核
+		return 2;
+	case _EffectType::RAVUZoom:
+		// 6x6 的核
+		return 4;
+	default:
+		assert(false);
+		return CpuImage::DEFAULT_BORDER;
+	}
+}
+
+bool CpuEffectChain::GetTilingInfo(UINT& halo, UINT& alignment) const {
+	// 找到最小的 n 使 n 乘以每一步的累积缩放比例都是整数
+	alignment = 0;
+	for (UINT n = 1; n <= MAX_TILE_ALIGNMENT && alignment == 0; ++n) {
+		bool isInteger = true;
+		double scaleX = 1;
+		double scaleY = 1;
+		for (const _Step& step : _steps) {
+			if (step.scaleX == 0) {
+				continue;
+			}
+
+			scaleX *= step.scaleX;
+			scaleY *= step.scaleY;
+			if (std::abs(n * scaleX - std::round(n * scaleX)) > 1e-3
+				|| std::abs(n * scaleY - std::round(n * scaleY)) > 1e-3
+			) {
+				isInteger = false;
+				break;
+			}
+		}
+
+		if (isInteger) {
+			alignment = n;
+		}
+	}
+
+	if (alignment == 0) {
+		return false;
+	}
+
+	// 后面的步骤在放大后的图像上采样，折算到输入空间的半径更小
+	// 两个方向分别计算，取较大者
+	double radiusX = 0;
+	double radiusY = 0;
+	double scaleX = 1;
+	double scaleY = 1;
+	for (const _Step& step : _steps) {
+		const UINT radius = _GetSamplingRadius(step);
+		radiusX += radius / scaleX;
+		radiusY += radius / scaleY;
+
+		if (step.scaleX != 0) {
+			scaleX *= step.scaleX;
+			scaleY *= step.scaleY;
+		}
+	}
+
+	halo = (UINT)std::ceil(std::max(radiusX, radiusY) - 1e-6);
+	halo = (halo + alignment - 1) / alignment * alignment;
+	return true;
+}
+
+bool CpuEffectChain::_ApplyStep(const _Step& step, const CpuImage& src, SIZE stepInputSize, CpuImage& dst) const {
+	const SIZE outputSize = _CalcStepOutputSize(step, { (LONG)src.GetWidth(), (LONG)src.GetHeight() });
+
+	// 分块处理时根据整张图像的尺寸选择系数
+	CpuSharpen::FineSharpParams fineSharp = step.fineSharp;
+	fineSharp.referenceHeight = stepInputSize.cy;
+
+	switch (step.type) {
+	case _EffectType::CAS:
+		return CpuSharpen::CAS(src, dst, step.cas);
+	case _EffectType::LumaSharpen:
+		return CpuSharpen::LumaSharpen(src, dst, step.lumaSharpen);
+	case _EffectType::NVSharpen:
+		return CpuSharpen::NVSharpen(src, dst, step.nvSharpen);
+	case _EffectType::AdaptiveSharpen:
+		return CpuSharpen::AdaptiveSharpen(src, dst, step.adaptiveSharpen);
+	case _EffectType::FineSharp:
+		return CpuSharpen::FineSharp(src, dst, fineSharp);
+	case _EffectType::NIS:
+		return _nis->Scale(src, outputSize.cx, outputSize.cy, dst, step.nis);
+	case _EffectType::RAVULite:
+		return _ravuLite->Scale(src, dst);
+	case _EffectType::RAVUZoom:
+		return _ravuZoom->Scale(src, outputSize.cx, outputSize.cy, dst);
+	default:
+		assert(false);
+		return false;
+	}
+}
+
+bool CpuEffectChain::Process(const CpuImage& input, CpuImage& output) const {
+	return ProcessTile(input, { (LONG)input.GetWidth(), (LONG)input.GetHeight() }, output);
+}
+
+bool CpuEffectChain::ProcessTile(const CpuImage& input, SIZE fullInputSize, CpuImage& output) const {
+	assert(!_steps.empty());
+
+	// 中间结果在两个图像间交替存放
+	CpuImage temps[2];
+	const CpuImage* cur = &input;
+	SIZE stepInputSize = fullInputSize;
+
+	for (size_t i = 0; i < _steps.size(); ++i) {
+		CpuImage& dst = i + 1 == _steps.size() ? output : temps[i % 2];
+
+		if (!_ApplyStep(_steps[i], *cur, stepInputSize, dst)) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("执行第 {} 个效果失败", i + 1));
+			return false;
+		}
+
+		cur = &dst;
+		stepInputSize = _CalcStepOutputSize(_steps[i], stepInputSize);
+	}
+
+	return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "pch.h"
+#include "CpuImage.h"
+#include "CpuSharpen.h"
+#include "CpuNIS.h"
+#include "CpuRAVU.h"
+
+
+// 在 CPU 上执行效果链，格式和 Renderer 使用的 json 相同
+// 只支持有 CPU 实现的效果，scale 属性只能为正数，因为离线处理时没有屏幕尺寸可以参照
+// 初始化后 Process 可以在多个线程上同时调用
+class CpuEffectChain {
+public:
+	bool Initialize(const std::string& effectsJson);
+
+	bool CalcOutputSize(SIZE inputSize, SIZE& outputSize) const;
+
+	// 处理一张图像所需内存的保守估计（字节），包括输入、输出和所有中间图像
+	size_t EstimateMemoryUsage(SIZE inputSize) const;
+
+	bool Process(const CpuImage& input, CpuImage& output) const;
+
+	// 分块处理时块的坐标和尺寸需对齐到 alignment 个输入像素，使每块在每一步的缩放比例都和整张图像相同
+	// halo 为每块四周需要额外读取的输入像素数，由每一步的采样半径折算到输入空间后累加而来，已对齐
+	// 缩放比例无法用分母不超过 MAX_TILE_ALIGNMENT 的分数表示时返回 false
+	bool GetTilingInfo(UINT& halo, UINT& alignment) const;
+
+	// 处理整张图像中的一块，fullInputSize 为整张图像的尺寸，某些效果的参数取决于它
+	bool ProcessTile(const CpuImage& input, SIZE fullInputSize, CpuImage& output) const;
+
+	static constexpr UINT MAX_TILE_ALIGNMENT = 64;
+
+private:
+	enum class _EffectType {
+		CAS,
+		LumaSharpen,
+		NVSharpen,
+		AdaptiveSharpen,
+		FineSharp,
+		NIS,
+		RAVULite,
+		RAVUZoom
+	};
+
+	struct _Step {
+		_EffectType type = _EffectType::CAS;
+		// 缩放比例，为 0 表示输出尺寸和输入相同
+		float scaleX = 0;
+		float scaleY = 0;
+
+		CpuSharpen::CASParams cas;
+		CpuSharpen::LumaSharpenParams lumaSharpen;
+		CpuSharpen::NVSharpenParams nvSharpen;
+		CpuSharpen::AdaptiveSharpenParams adaptiveSharpen;
+		CpuSharpen::FineSharpParams fineSharp;
+		CpuNIS::Params nis;
+	};
+
+	static bool _ParseEffectType(std::string_view name, _EffectType& type);
+
+	static SIZE _CalcStepOutputSize(const _Step& step, SIZE inputSize);
+
+	// 输出像素依赖的输入像素距离该像素在输入中对应位置的最大距离（该步的输入像素）
+	static UINT _GetSamplingRadius(const _Step& step);
+
+	// stepInputSize 为整张图像在这一步的输入尺寸
+	bool _ApplyStep(const _Step& step, const CpuImage& src, SIZE stepInputSize, CpuImage& dst) const;
+
+	std::vector<_Step> _steps;
+
+	// 需要加载查找表的效果在第一次使用时初始化，之后所有步骤共享
+	std::unique_ptr<CpuNIS> _nis;
+	std::unique_ptr<CpuRAVULite> _ravuLite;
+	std::unique_ptr<CpuRAVUZoom> _ravuZoom;
+};
@@ -0,0 +1,199 @@
+#include "pch.h"
+#include "CpuImage.h"
+#include <thread>
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+using namespace DirectX::PackedVector;
+
+
+bool CpuImageUtils::FromBGRA8(const BYTE* data, UINT width, UINT height, UINT rowPitch, CpuImage& result, UINT border) {
+	if (!result.Create(width, height, border)) {
+		SPDLOG_LOGGER_ERROR(logger, "图像尺寸非法");
+		return false;
+	}
+
+	ParallelForBands(height, CalcBandHeight(size_t(width) * (4 + sizeof(XMFLOAT4))), [&](UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const XMUBYTEN4* src = (const XMUBYTEN4*)(data + size_t(y) * rowPitch);
+			XMFLOAT4* dst = result.GetRow(y);
+
+			for (UINT x = 0; x < width; ++x) {
+				// BGRA -> RGBA
+				XMStoreFloat4(&dst[x], XMVectorSwizzle<2, 1, 0, 3>(XMLoadUByteN4(&src[x])));
+			}
+		}
+
+		result.ExtendRowBorder(yBegin, yEnd);
+	});
+
+	result.ExtendVerticalBorder();
+	return true;
+}
+
+void CpuImageUtils::ToBGRA8(const CpuImage& img, BYTE* data, UINT rowPitch) {
+	const UINT width = img.GetWidth();
+	const XMVECTOR scale = XMVectorReplicate(255.0f);
+	const XMVECTOR half = XMVectorReplicate(0.5f);
+
+	ParallelForBands(img.GetHeight(), CalcBandHeight(size_t(width) * (4 + sizeof(XMFLOAT4))), [&](UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const XMFLOAT4* src = img.GetRow(y);
+			XMUBYTE4* dst = (XMUBYTE4*)(data + size_t(y) * rowPitch);
+
+			for (UINT x = 0; x < width; ++x) {
+				// 和 GPU 写入 UNORM 纹理时一样四舍五入
+				XMVECTOR v = XMVectorSwizzle<2, 1, 0, 3>(XMVectorSaturate(XMLoadFloat4(&src[x])));
+				XMStoreUByte4(&dst[x], XMVectorMultiplyAdd(v, scale, half));
+			}
+		}
+	});
+}
+
+bool CpuImageUtils::ComputeLuma(const CpuImage& src, CpuPlane& dst, const XMFLOAT3& coef) {
+	const UINT width = src.GetWidth();
+	if (dst.GetWidth() != width || dst.GetHeight() != src.GetHeight() || dst.GetBorder() > src.GetBorder()) {
+		if (!dst.Create(width, src.GetHeight(), src.GetBorder())) {
+			return false;
+		}
+	}
+
+	const XMVECTOR c = XMVectorSet(coef.x, coef.y, coef.z, 0);
+
+	ParallelForBands(src.GetHeight(), CalcBandHeight(size_t(width) * (sizeof(XMFLOAT4) + sizeof(float))), [&](UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const XMFLOAT4* s = src.GetRow(y);
+			float* d = dst.GetRow(y);
+
+			// 一次处理 4 个像素：转置后三行相加即为 4 个像素的亮度
+			UINT x = 0;
+			for (; x + 4 <= width; x += 4) {
+				XMMATRIX m(
+					XMVectorMultiply(XMLoadFloat4(&s[x]), c),
+					XMVectorMultiply(XMLoadFloat4(&s[x + 1]), c),
+					XMVectorMultiply(XMLoadFloat4(&s[x + 2]), c),
+					XMVectorMultiply(XMLoadFloat4(&s[x + 3]), c)
+				);
+				m = XMMatrixTranspose(m);
+				XMStoreFloat4((XMFLOAT4*)&d[x], XMVectorAdd(XMVectorAdd(m.r[0], m.r[1]), m.r[2]));
+			}
+			for (; x < width; ++x) {
+				d[x] = coef.x * s[x].x + coef.y * s[x].y + coef.z * s[x].z;
+			}
+		}
+
+		dst.ExtendRowBorder(yBegin, yEnd);
+	});
+
+	dst.ExtendVerticalBorder();
+	return true;
+}
+
+const CpuImage& CpuImageUtils::EnsureBorder(const CpuImage& src, UINT border, CpuImage& temp) {
+	if (src.GetBorder() >= border) {
+		return src;
+	}
+
+	temp.Create(src.GetWidth(), src.GetHeight(), border);
+	for (UINT y = 0; y < src.GetHeight(); ++y) {
+		std::memcpy(temp.GetRow(y), src.GetRow(y), sizeof(XMFLOAT4) * src.GetWidth());
+	}
+	temp.ExtendBorder();
+
+	return temp;
+}
+
+size_t CpuImageUtils::GetL2CacheSize() {
+	static size_t result = []() -> size_t {
+		// 获取失败时假设为 256KB
+		constexpr size_t DEFAULT_SIZE = 256 * 1024;
+
+		DWORD len = 0;
+		GetLogicalProcessorInformation(nullptr, &len);
+		if (len == 0) {
+			return DEFAULT_SIZE;
+		}
+
+		std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(len / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+		if (!GetLogicalProcessorInformation(infos.data(), &len)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("GetLogicalProcessorInformation 失败"));
+			return DEFAULT_SIZE;
+		}
+
+		size_t size = 0;
+		for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION& info : infos) {
+			if (info.Relationship == RelationCache && info.Cache.Level == 2) {
+				size = std::max(size, (size_t)info.Cache.Size);
+			}
+		}
+
+		return size == 0 ? DEFAULT_SIZE : size;
+	}();
+
+	return result;
+}
+
+UINT CpuImageUtils::CalcBandHeight(size_t bytesPerRow) {
+	// 只使用一半的 L2 缓存，剩余部分留给卷积核读取的上下相邻行和权重表等
+	size_t rows = GetL2CacheSize() / 2 / std::max(bytesPerRow, (size_t)1);
+	return (UINT)std::clamp(rows, (size_t)4, (size_t)256);
+}
+
+struct BandContext {
+	ULONG index;
+	UINT height;
+	UINT bandHeight;
+	const std::function<void(UINT, UINT)>& func;
+};
+
+static void ProcessBands(BandContext& con) {
+	while (true) {
+		// 动态分配条带，使各线程的负载更均衡
+		UINT i = (UINT)InterlockedIncrement(&con.index) - 1;
+		UINT yBegin = i * con.bandHeight;
+		if (yBegin >= con.height) {
+			break;
+		}
+
+		con.func(yBegin, std::min(yBegin + con.bandHeight, con.height));
+	}
+}
+
+static void NTAPI BandWork(PTP_CALLBACK_INSTANCE, PVOID Context, PTP_WORK) {
+	ProcessBands(*(BandContext*)Context);
+}
+
+void CpuImageUtils::ParallelForBands(UINT height, UINT bandHeight, const std::function<void(UINT, UINT)>& func) {
+	if (height == 0) {
+		return;
+	}
+
+	bandHeight = std::clamp(bandHeight, 1u, height);
+	const UINT bandCount = (height + bandHeight - 1) / bandHeight;
+	const UINT threadCount = std::min(bandCount, std::max(std::thread::hardware_concurrency(), 1u));
+
+	BandContext context = { 0, height, bandHeight, func };
+
+	if (threadCount <= 1) {
+		ProcessBands(context);
+		return;
+	}
+
+	PTP_WORK work = CreateThreadpoolWork(BandWork, &context, nullptr);
+	if (!work) {
+		SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("CreateThreadpoolWork 失败，回退到单线程"));
+		ProcessBands(context);
+		return;
+	}
+
+	for (UINT i = 1; i < threadCount; ++i) {
+		SubmitThreadpoolWork(work);
+	}
+
+	// 当前线程也参与处理
+	ProcessBands(context);
+
+	WaitForThreadpoolWorkCallbacks(work, FALSE);
+	CloseThreadpoolWork(work);
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include "pch.h"
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+
+// CPU 端的二维图像
+// 四周有一圈由边缘像素复制而来的边框，邻域读取时无需检查越界，效果等同于 CLAMP 寻址
+// 每行右侧另有 PADDING 个元素的填充，使一次读取 4 个相邻元素的 SIMD 代码可以安全地越过行尾
+template<typename T>
+class CpuSurface {
+public:
+	static constexpr UINT DEFAULT_BORDER = 4;
+	static constexpr UINT PADDING = 4;
+
+	bool Create(UINT width, UINT height, UINT border = DEFAULT_BORDER) {
+		if (width == 0 || height == 0) {
+			return false;
+		}
+
+		_width = width;
+		_height = height;
+		_border = border;
+		_pitch = width + border * 2 + PADDING;
+		_data.assign(size_t(_pitch) * (height + border * 2), T{});
+		return true;
+	}
+
+	bool IsEmpty() const {
+		return _data.empty();
+	}
+
+	UINT GetWidth() const {
+		return _width;
+	}
+
+	UINT GetHeight() const {
+		return _height;
+	}
+
+	UINT GetBorder() const {
+		return _border;
+	}
+
+	// 单位为元素
+	UINT GetPitch() const {
+		return _pitch;
+	}
+
+	size_t GetMemorySize() const {
+		return _data.size() * sizeof(T);
+	}
+
+	// y 的有效范围为 [-border, height + border)，返回值指向该行 x = 0 处
+	T* GetRow(int y) {
+		assert(y >= -(int)_border && y < int(_height + _border));
+		return _data.data() + (size_t(y + (int)_border) * _pitch + _border);
+	}
+
+	const T* GetRow(int y) const {
+		assert(y >= -(int)_border && y < int(_height + _border));
+		return _data.data() + (size_t(y + (int)_border) * _pitch + _border);
+	}
+
+	T& At(int x, int y) {
+		return GetRow(y)[x];
+	}
+
+	const T& At(int x, int y) const {
+		return GetRow(y)[x];
+	}
+
+	// 用边缘像素填充 [yBegin, yEnd) 行的左右边框
+	void ExtendRowBorder(UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			T* row = GetRow(y);
+			for (int x = 1; x <= (int)_border; ++x) {
+				row[-x] = row[0];
+				row[_width - 1 + x] = row[_width - 1];
+			}
+		}
+	}
+
+	// 用边缘像素填充全部边框
+	void ExtendBorder() {
+		ExtendRowBorder(0, _height);
+		ExtendVerticalBorder();
+	}
+
+	// 用首行和末行填充上下边框，调用前左右边框应已填充
+	void ExtendVerticalBorder() {
+		const size_t rowSize = size_t(_width + _border * 2) * sizeof(T);
+		for (int y = 1; y <= (int)_border; ++y) {
+			std::memcpy(GetRow(-y) - _border, GetRow(0) - _border, rowSize);
+			std::memcpy(GetRow(_height - 1 + y) - _border, GetRow(_height - 1) - _border, rowSize);
+		}
+	}
+
+private:
+	std::vector<T> _data;
+	UINT _width = 0;
+	UINT _height = 0;
+	UINT _border = 0;
+	UINT _pitch = 0;
+};
+
+// RGBA 浮点图像
+using CpuImage = CpuSurface<XMFLOAT4>;
+// 单通道浮点图像，如亮度
+using CpuPlane = CpuSurface<float>;
+
+
+struct CpuImageUtils {
+	// BT.709 亮度系数，与 NVSharpen、LumaSharpen 等效果中的一致
+	static constexpr XMFLOAT3 LUMA_BT709 = { 0.2126f, 0.7152f, 0.0722f };
+
+	// 从 B8G8R8A8 格式的像素数据转换，结果的边框已填充
+	static bool FromBGRA8(const BYTE* data, UINT width, UINT height, UINT rowPitch, CpuImage& result, UINT border = CpuImage::DEFAULT_BORDER);
+
+	// 转换为 B8G8R8A8 格式，超出 [0, 1] 的值被截断
+	static void ToBGRA8(const CpuImage& img, BYTE* data, UINT rowPitch);
+
+	// 计算亮度，结果的边框也被计算，因此 dst 的边框不会大于 src
+	static bool ComputeLuma(const CpuImage& src, CpuPlane& dst, const XMFLOAT3& coef = LUMA_BT709);
+
+	// 如果 src 的边框不小于 border 则直接返回 src，否则复制到 temp 中并扩展边框
+	static const CpuImage& EnsureBorder(const CpuImage& src, UINT border, CpuImage& temp);
+
+	// 获取 L2 缓存大小，失败时返回一个保守的估计值
+	static size_t GetL2CacheSize();
+
+	// 根据每行的工作集大小计算条带高度，使一个条带的工作集能放入 L2 缓存
+	static UINT CalcBandHeight(size_t bytesPerRow);
+
+	// 将 [0, height) 按 bandHeight 切分为若干条带，在线程池中并行执行 func(yBegin, yEnd)
+	// 线程池不可用时回退到在当前线程执行
+	static void ParallelForBands(UINT height, UINT bandHeight, const std::function<void(UINT, UINT)>& func);
+
+	// 逐条带并行地计算 dst 的所有行，完成后填充 dst 的边框
+	// bandHeight 为 0 时根据 bytesPerPixel 计算能放入 L2 缓存的条带高度
+	template<typename T, typename Fn>
+	static void RunPass(CpuSurface<T>& dst, UINT bandHeight, size_t bytesPerPixel, const Fn& func) {
+		if (bandHeight == 0) {
+			bandHeight = CalcBandHeight(dst.GetWidth() * bytesPerPixel);
+		}
+
+		ParallelForBands(dst.GetHeight(), bandHeight, [&](UINT yBegin, UINT yEnd) {
+			func(yBegin, yEnd);
+			dst.ExtendRowBorder(yBegin, yEnd);
+		});
+
+		dst.ExtendVerticalBorder();
+	}
+};
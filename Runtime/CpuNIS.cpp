@@ -0,0 +1,369 @@
+#include "pch.h"
+#include "CpuNIS.h"
+#include "CpuNISCommon.h"
+#include "DDSReader.h"
+#include "StrUtils.h"
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+using namespace CpuNISCommon;
+using namespace DirectX::PackedVector;
+
+
+// 每个输出像素的工作集大小（字节），用于计算条带高度
+static constexpr size_t NIS_BYTES_PER_PIXEL = sizeof(XMFLOAT4) * 3 + sizeof(float);
+
+constexpr int kPhaseCount = CpuNIS::PHASE_COUNT;
+
+
+bool CpuNIS::_LoadCoef(const wchar_t* fileName, float(&result)[PHASE_COUNT][8]) {
+	CpuImage img;
+	if (!DDSReader::Load(fileName, img)) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("加载 {} 失败", StrUtils::UTF16ToUTF8(fileName)));
+		return false;
+	}
+
+	// 纹理的 x 轴为相位，y 轴为系数
+	if (img.GetWidth() != PHASE_COUNT || img.GetHeight() != FILTER_SIZE) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("{} 的尺寸非法", StrUtils::UTF16ToUTF8(fileName)));
+		return false;
+	}
+
+	for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+		for (int i = 0; i < 8; ++i) {
+			result[phase][i] = i < FILTER_SIZE ? img.At(phase, i).x : 0.0f;
+		}
+	}
+
+	return true;
+}
+
+bool CpuNIS::Initialize(const wchar_t* coefScaleFile, const wchar_t* coefUSMFile) {
+	if (!_LoadCoef(coefScaleFile, _coefScale) || !_LoadCoef(coefUSMFile, _coefUSM)) {
+		return false;
+	}
+
+	_initialized = true;
+	return true;
+}
+
+static float Lerp(float a, float b, float t) {
+	return a + (b - a) * t;
+}
+
+static float Saturate(float v) {
+	return std::clamp(v, 0.0f, 1.0f);
+}
+
+// 6 个元素与系数的点积，pxl 和 coef 都至少有 8 个元素，coef 末尾两个为 0
+static float XM_CALLCONV Dot6(const float* pxl, const float* coef) {
+	XMVECTOR r = XMVectorMultiply(XMLoadFloat4((const XMFLOAT4*)pxl), XMLoadFloat4A((const XMFLOAT4A*)coef));
+	r = XMVectorMultiplyAdd(XMLoadFloat4((const XMFLOAT4*)(pxl + 4)), XMLoadFloat4A((const XMFLOAT4A*)(coef + 4)), r);
+	return XMVectorGetX(XMVector4Dot(r, g_XMOne));
+}
+
+struct NISContext {
+	const float(*coefScale)[8];
+	const float(*coefUSM)[8];
+	SharpnessConsts consts;
+};
+
+static float CalcLTI(const float* p, int phase_index) {
+	const bool selector = (phase_index <= kPhaseCount / 2);
+	float sel = selector ? p[0] : p[3];
+	const float a_min = std::min(std::min(p[1], p[2]), sel);
+	const float a_max = std::max(std::max(p[1], p[2]), sel);
+	sel = selector ? p[2] : p[5];
+	const float b_min = std::min(std::min(p[3], p[4]), sel);
+	const float b_max = std::max(std::max(p[3], p[4]), sel);
+
+	const float a_cont = a_max - a_min;
+	const float b_cont = b_max - b_min;
+
+	const float cont_ratio = std::max(a_cont, b_cont) / (std::min(a_cont, b_cont) + kEps);
+	return (1.0f - Saturate((cont_ratio - kMinContrastRatio) * kRatioNorm)) * kContrastBoost;
+}
+
+// pxl 至少有 8 个元素，末尾两个不参与计算
+static float EvalPoly6(const NISContext& con, const float* pxl, int phase_int) {
+	float y = Dot6(pxl, con.coefScale[phase_int]);
+	float y_usm = Dot6(pxl, con.coefUSM[phase_int]);
+
+	// let's compute a piece-wise ramp based on luma
+	const float y_scale = 1.0f - Saturate((y * (1.0f / NIS_SCALE_FLOAT) - kSharpStartY) * kSharpScaleY);
+
+	// scale the ramp to sharpen as a function of luma
+	const float y_sharpness = y_scale * con.consts.sharpStrengthScale + con.consts.sharpStrengthMin;
+
+	y_usm *= y_sharpness;
+
+	// scale the ramp to limit USM as a function of luma
+	const float y_sharpness_limit = (y_scale * con.consts.sharpLimitScale + con.consts.sharpLimitMin) * y;
+
+	y_usm = std::min(y_sharpness_limit, std::max(-y_sharpness_limit, y_usm));
+	// reduce ringing
+	y_usm *= CalcLTI(pxl, phase_int);
+
+	return y + y_usm;
+}
+
+static XMVECTOR GetDirFilters(const NISContext& con, const float p[6][8], float phase_x_frac, float phase_y_frac, int phase_x_frac_int, int phase_y_frac_int) {
+	XMFLOAT4 f;
+
+	// 0 deg filter
+	float interp0Deg[8]{};
+	for (int i = 0; i < 6; ++i) {
+		interp0Deg[i] = Lerp(p[i][2], p[i][3], phase_x_frac);
+	}
+
+	f.x = EvalPoly6(con, interp0Deg, phase_y_frac_int);
+
+	// 90 deg filter
+	float interp90Deg[8]{};
+	for (int i = 0; i < 6; ++i) {
+		interp90Deg[i] = Lerp(p[2][i], p[3][i], phase_y_frac);
+	}
+
+	f.y = EvalPoly6(con, interp90Deg, phase_x_frac_int);
+
+	// 45 deg filter
+	float pphase_b45 = 0.5f + 0.5f * (phase_x_frac - phase_y_frac);
+
+	// 多出的两个元素使从第二个元素开始读取 8 个元素时不会越界
+	float temp_interp45Deg[9]{};
+	temp_interp45Deg[1] = Lerp(p[2][1], p[1][2], pphase_b45);
+	temp_interp45Deg[3] = Lerp(p[3][2], p[2][3], pphase_b45);
+	temp_interp45Deg[5] = Lerp(p[4][3], p[3][4], pphase_b45);
+	{
+		pphase_b45 = pphase_b45 - 0.5f;
+		float a = (pphase_b45 >= 0.f) ? p[0][2] : p[2][0];
+		float b = (pphase_b45 >= 0.f) ? p[1][3] : p[3][1];
+		float c = (pphase_b45 >= 0.f) ? p[2][4] : p[4][2];
+		float d = (pphase_b45 >= 0.f) ? p[3][5] : p[5][3];
+		temp_interp45Deg[0] = Lerp(p[1][1], a, std::abs(pphase_b45));
+		temp_interp45Deg[2] = Lerp(p[2][2], b, std::abs(pphase_b45));
+		temp_interp45Deg[4] = Lerp(p[3][3], c, std::abs(pphase_b45));
+		temp_interp45Deg[6] = Lerp(p[4][4], d, std::abs(pphase_b45));
+	}
+
+	const float* interp45Deg = temp_interp45Deg;
+	float pphase_p45 = phase_x_frac + phase_y_frac;
+	if (pphase_p45 >= 1) {
+		interp45Deg = temp_interp45Deg + 1;
+		pphase_p45 = pphase_p45 - 1;
+	}
+
+	f.z = EvalPoly6(con, interp45Deg, (int)(pphase_p45 * 64));
+
+	// 135 deg filter
+	float pphase_b135 = 0.5f * (phase_x_frac + phase_y_frac);
+
+	float temp_interp135Deg[9]{};
+	temp_interp135Deg[1] = Lerp(p[3][1], p[4][2], pphase_b135);
+	temp_interp135Deg[3] = Lerp(p[2][2], p[3][3], pphase_b135);
+	temp_interp135Deg[5] = Lerp(p[1][3], p[2][4], pphase_b135);
+	{
+		pphase_b135 = pphase_b135 - 0.5f;
+		float a = (pphase_b135 >= 0.f) ? p[5][2] : p[3][0];
+		float b = (pphase_b135 >= 0.f) ? p[4][3] : p[2][1];
+		float c = (pphase_b135 >= 0.f) ? p[3][4] : p[1][2];
+		float d = (pphase_b135 >= 0.f) ? p[2][5] : p[0][3];
+		temp_interp135Deg[0] = Lerp(p[4][1], a, std::abs(pphase_b135));
+		temp_interp135Deg[2] = Lerp(p[3][2], b, std::abs(pphase_b135));
+		temp_interp135Deg[4] = Lerp(p[2][3], c, std::abs(pphase_b135));
+		temp_interp135Deg[6] = Lerp(p[1][4], d, std::abs(pphase_b135));
+	}
+
+	const float* interp135Deg = temp_interp135Deg;
+	float pphase_p135 = 1 + (phase_x_frac - phase_y_frac);
+	if (pphase_p135 >= 1) {
+		interp135Deg = temp_interp135Deg + 1;
+		pphase_p135 = pphase_p135 - 1;
+	}
+
+	f.w = EvalPoly6(con, interp135Deg, (int)(pphase_p135 * 64));
+
+	return XMLoadFloat4(&f);
+}
+
+// 可分离的 6x6 滤波，rows 为 6 行像素，每行两个寄存器
+static float XM_CALLCONV FilterNormal(const NISContext& con, const XMVECTOR rows[6][2], int phase_x_frac_int, int phase_y_frac_int) {
+	// 先在垂直方向滤波，同时处理 8 列（后两列的水平系数为 0）
+	const float* coefY = con.coefScale[phase_y_frac_int];
+	XMVECTOR v0 = XMVectorScale(rows[0][0], coefY[0]);
+	XMVECTOR v1 = XMVectorScale(rows[0][1], coefY[0]);
+	for (int i = 1; i < 6; ++i) {
+		const XMVECTOR c = XMVectorReplicate(coefY[i]);
+		v0 = XMVectorMultiplyAdd(rows[i][0], c, v0);
+		v1 = XMVectorMultiplyAdd(rows[i][1], c, v1);
+	}
+
+	// 再在水平方向滤波
+	const float* coefX = con.coefScale[phase_x_frac_int];
+	XMVECTOR h = XMVectorMultiply(v0, XMLoadFloat4A((const XMFLOAT4A*)coefX));
+	h = XMVectorMultiplyAdd(v1, XMLoadFloat4A((const XMFLOAT4A*)(coefX + 4)), h);
+	return XMVectorGetX(XMVector4Dot(h, g_XMOne));
+}
+
+static float GetY(FXMVECTOR rgb) {
+	return XMVectorGetX(XMVector3Dot(rgb, XMVectorSet(0.2126f, 0.7152f, 0.0722f, 0)));
+}
+
+// 每个输出行或列的采样位置
+struct NISSamplePos {
+	int srcPosB;
+	float frac;
+	int fracInt;
+};
+
+static std::vector<NISSamplePos> CalcSamplePositions(UINT inputSize, UINT outputSize) {
+	// 和 HLSL 一样先计算纹理坐标再转换回像素坐标
+	const float inputPt = 1.0f / inputSize;
+
+	std::vector<NISSamplePos> result(outputSize);
+	for (UINT i = 0; i < outputSize; ++i) {
+		float pos = (i + 0.5f) / outputSize;
+		float srcPos = pos / inputPt + 0.5f;
+		float srcPosB = std::floor(srcPos);
+		float f = srcPos - srcPosB;
+
+		result[i] = { (int)srcPosB, f, (int)(f * kPhaseCount) };
+	}
+
+	return result;
+}
+
+bool CpuNIS::Scale(
+	const CpuImage& src,
+	UINT outputWidth,
+	UINT outputHeight,
+	CpuImage& dst,
+	const Params& params,
+	UINT bandHeight
+) const {
+	assert(&src != &dst);
+
+	if (!_initialized) {
+		SPDLOG_LOGGER_ERROR(logger, "CpuNIS 未初始化");
+		return false;
+	}
+
+	if (dst.GetWidth() != outputWidth || dst.GetHeight() != outputHeight) {
+		if (!dst.Create(outputWidth, outputHeight)) {
+			SPDLOG_LOGGER_ERROR(logger, "创建输出图像失败");
+			return false;
+		}
+	}
+
+	// 6x6 的采样范围为 [-3, 2]，边缘图和双线性插值还需要 +1
+	CpuImage temp;
+	const CpuImage& input = CpuImageUtils::EnsureBorder(src, 3, temp);
+
+	CpuPlane luma;
+	if (!CpuImageUtils::ComputeLuma(input, luma)) {
+		return false;
+	}
+
+	// 第一个通道：计算边缘图，每次计算 4 个像素
+	CpuImage edgeMap;
+	if (!edgeMap.Create(input.GetWidth(), input.GetHeight(), input.GetBorder())) {
+		SPDLOG_LOGGER_ERROR(logger, "创建边缘图失败");
+		return false;
+	}
+
+	CpuImageUtils::RunPass(edgeMap, bandHeight, sizeof(XMFLOAT4) + sizeof(float), [&](UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const float* rows[3] = { luma.GetRow(y - 1), luma.GetRow(y), luma.GetRow(y + 1) };
+			XMFLOAT4* out = edgeMap.GetRow(y);
+
+			for (UINT x = 0, width = input.GetWidth(); x < width; x += 4) {
+				XMVECTOR p[3][3];
+				for (int j = 0; j < 3; ++j) {
+					for (int k = 0; k < 3; ++k) {
+						p[j][k] = XMLoadFloat4((const XMFLOAT4*)&rows[j][x + k - 1]);
+					}
+				}
+
+				XMVECTOR w[4];
+				GetEdgeMap(p, w);
+
+				// 转置后每行为一个像素的四个权重。行尾多出的结果写入右侧边框，之后会被覆盖
+				// NIS.hlsl 中 shEdgeMap 的格式为 R16G16B16A16_FLOAT，这里同样舍入到半精度
+				XMMATRIX m = XMMatrixTranspose(XMMATRIX(w[0], w[1], w[2], w[3]));
+				for (int k = 0; k < 4; ++k) {
+					XMHALF4 h;
+					XMStoreHalf4(&h, m.r[k]);
+					XMStoreFloat4(&out[x + k], XMLoadHalf4(&h));
+				}
+			}
+		}
+	});
+
+	// 第二个通道：缩放
+	const std::vector<NISSamplePos> xPositions = CalcSamplePositions(input.GetWidth(), outputWidth);
+	const std::vector<NISSamplePos> yPositions = CalcSamplePositions(input.GetHeight(), outputHeight);
+
+	const NISContext con = { _coefScale, _coefUSM, MakeSharpnessConsts(params.sharpness) };
+
+	CpuImageUtils::RunPass(dst, bandHeight, NIS_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const NISSamplePos& yPos = yPositions[y];
+			const float fy = yPos.frac;
+
+			const float* lumaRows[6];
+			for (int i = 0; i < 6; ++i) {
+				lumaRows[i] = luma.GetRow(yPos.srcPosB - 3 + i);
+			}
+
+			const XMFLOAT4* edgeRows[2] = { edgeMap.GetRow(yPos.srcPosB), edgeMap.GetRow(yPos.srcPosB + 1) };
+			// 双线性插值的位置为 srcPos - 1
+			const XMFLOAT4* srcRows[2] = { input.GetRow(yPos.srcPosB - 1), input.GetRow(yPos.srcPosB) };
+
+			XMFLOAT4* out = dst.GetRow(y);
+
+			for (UINT x = 0; x < outputWidth; ++x) {
+				const NISSamplePos& xPos = xPositions[x];
+				const int bx = xPos.srcPosB;
+				const float fx = xPos.frac;
+
+				// load 6x6 support to regs
+				XMVECTOR rows[6][2];
+				float p[6][8];
+				for (int i = 0; i < 6; ++i) {
+					rows[i][0] = XMLoadFloat4((const XMFLOAT4*)&lumaRows[i][bx - 3]);
+					rows[i][1] = XMLoadFloat4((const XMFLOAT4*)&lumaRows[i][bx + 1]);
+					XMStoreFloat4((XMFLOAT4*)&p[i][0], rows[i][0]);
+					XMStoreFloat4((XMFLOAT4*)&p[i][4], rows[i][1]);
+				}
+
+				// get traditional scaler filter output
+				const float pixel_n = FilterNormal(con, rows, xPos.fracInt, yPos.fracInt);
+
+				// get directional filter bank output
+				const XMVECTOR opDirYU = GetDirFilters(con, p, fx, fy, xPos.fracInt, yPos.fracInt);
+
+				// generate weights for directional filters
+				const XMVECTOR h0 = XMVectorLerp(XMLoadFloat4(&edgeRows[0][bx]), XMLoadFloat4(&edgeRows[0][bx + 1]), fx);
+				const XMVECTOR h1 = XMVectorLerp(XMLoadFloat4(&edgeRows[1][bx]), XMLoadFloat4(&edgeRows[1][bx + 1]), fx);
+				const XMVECTOR w = XMVectorLerp(h0, h1, fy);
+
+				// final pixel is a weighted sum filter outputs
+				const float wSum = XMVectorGetX(XMVector4Dot(w, g_XMOne));
+				const float opY = (XMVectorGetX(XMVector4Dot(opDirYU, w)) + pixel_n * (NIS_SCALE_FLOAT - wSum)) * (1.0f / NIS_SCALE_FLOAT);
+
+				// do bilinear tap for chroma upscaling
+				XMVECTOR op = XMVectorLerp(
+					XMVectorLerp(XMLoadFloat4(&srcRows[0][bx - 1]), XMLoadFloat4(&srcRows[0][bx]), fx),
+					XMVectorLerp(XMLoadFloat4(&srcRows[1][bx - 1]), XMLoadFloat4(&srcRows[1][bx]), fx),
+					fy
+				);
+
+				const float corr = opY * (1.0f / NIS_SCALE_FLOAT) - GetY(op);
+				XMStoreFloat4(&out[x], XMVectorSelect(op, XMVectorAdd(op, XMVectorReplicate(corr)), g_XMSelect1110));
+			}
+		}
+	});
+
+	return true;
+}
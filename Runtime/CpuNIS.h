@@ -0,0 +1,43 @@
+#pragma once
+#include "pch.h"
+#include "CpuImage.h"
+
+
+// NIS 的 CPU 实现，移植自 NIS.hlsl
+// 系数表从效果使用的 NIS_Coef_Scale.dds 和 NIS_Coef_USM.dds（R16_FLOAT）中读取，保证和 GPU 版本一致
+// 边缘图和 GPU 版本一样以半精度保存
+class CpuNIS {
+public:
+	struct Params {
+		float sharpness = 0.5f;
+	};
+
+	// 加载系数表，多次缩放只需初始化一次
+	bool Initialize(
+		const wchar_t* coefScaleFile = L"effects\\NIS_Coef_Scale.dds",
+		const wchar_t* coefUSMFile = L"effects\\NIS_Coef_USM.dds"
+	);
+
+	// 将 src 缩放为 outputWidth x outputHeight 并存入 dst，src 和 dst 不能是同一个图像
+	// bandHeight 为 0 时自动选择能放入 L2 缓存的条带高度
+	bool Scale(
+		const CpuImage& src,
+		UINT outputWidth,
+		UINT outputHeight,
+		CpuImage& dst,
+		const Params& params = {},
+		UINT bandHeight = 0
+	) const;
+
+	// 系数表的相位数和每个相位的系数个数
+	static constexpr int PHASE_COUNT = 64;
+	static constexpr int FILTER_SIZE = 6;
+
+private:
+	static bool _LoadCoef(const wchar_t* fileName, float (&result)[PHASE_COUNT][8]);
+
+	// 每个相位的 6 个系数补齐到 8 个，以便用两个 SIMD 寄存器读取
+	alignas(16) float _coefScale[PHASE_COUNT][8]{};
+	alignas(16) float _coefUSM[PHASE_COUNT][8]{};
+	bool _initialized = false;
+};
@@ -0,0 +1,112 @@
+#pragma once
+#include "pch.h"
+#include <DirectXMath.h>
+
+
+// NVSharpen 和 NIS 共用的常量和函数，移植自 NVSharpen.hlsl 和 NIS.hlsl
+// 所有函数一次处理 4 个像素
+namespace CpuNISCommon {
+
+constexpr float kDetectRatio = 1127.f / 1024.f;
+constexpr float kDetectThres = 64.0f / 1024.0f;
+constexpr float kEps = 1.0f;
+constexpr float NIS_SCALE_FLOAT = 1.0f;
+constexpr float kMinContrastRatio = 2.0f;
+constexpr float kMaxContrastRatio = 10.0f;
+constexpr float kRatioNorm = 1.0f / (kMaxContrastRatio - kMinContrastRatio);
+constexpr float kContrastBoost = 1.0f;
+constexpr float kSharpStartY = 0.45f;
+constexpr float kSharpEndY = 0.9f;
+constexpr float kSharpScaleY = 1.0f / (kSharpEndY - kSharpStartY);
+
+// 由 sharpness 决定的常量
+struct SharpnessConsts {
+	float sharpStrengthMin;
+	float sharpStrengthScale;
+	float sharpLimitMin;
+	float sharpLimitScale;
+};
+
+inline SharpnessConsts MakeSharpnessConsts(float sharpness) {
+	const float sharpenSlider = sharpness - 0.5f;
+	const float minScale = (sharpenSlider >= 0.0f) ? 1.25f : 1.0f;
+	const float limitScale = (sharpenSlider >= 0.0f) ? 1.25f : 1.0f;
+
+	const float sharpStrengthMin = std::max(0.0f, 0.4f + sharpenSlider * minScale * 1.2f);
+	const float sharpStrengthMax = 1.6f + sharpenSlider * 1.8f;
+	const float sharpLimitMin = std::max(0.1f, 0.14f + sharpenSlider * limitScale * 0.32f);
+	const float sharpLimitMax = 0.5f + sharpenSlider * limitScale * 0.6f;
+
+	return {
+		sharpStrengthMin,
+		sharpStrengthMax - sharpStrengthMin,
+		sharpLimitMin,
+		sharpLimitMax - sharpLimitMin
+	};
+}
+
+// 比较结果转为 0 或 1
+inline XMVECTOR XM_CALLCONV MaskToFloat(FXMVECTOR mask) {
+	return XMVectorAndInt(mask, g_XMOne);
+}
+
+// 根据 3x3 的亮度计算 0、90、45、135 度方向的权重
+inline void GetEdgeMap(const XMVECTOR p[3][3], XMVECTOR result[4]) {
+	const XMVECTOR g_0 = XMVectorAbs(XMVectorSubtract(
+		XMVectorAdd(XMVectorAdd(p[0][0], p[0][1]), p[0][2]),
+		XMVectorAdd(XMVectorAdd(p[2][0], p[2][1]), p[2][2])));
+	const XMVECTOR g_45 = XMVectorAbs(XMVectorSubtract(
+		XMVectorAdd(XMVectorAdd(p[1][0], p[0][0]), p[0][1]),
+		XMVectorAdd(XMVectorAdd(p[2][1], p[2][2]), p[1][2])));
+	const XMVECTOR g_90 = XMVectorAbs(XMVectorSubtract(
+		XMVectorAdd(XMVectorAdd(p[0][0], p[1][0]), p[2][0]),
+		XMVectorAdd(XMVectorAdd(p[0][2], p[1][2]), p[2][2])));
+	const XMVECTOR g_135 = XMVectorAbs(XMVectorSubtract(
+		XMVectorAdd(XMVectorAdd(p[1][0], p[2][0]), p[2][1]),
+		XMVectorAdd(XMVectorAdd(p[0][1], p[0][2]), p[1][2])));
+
+	const XMVECTOR g_0_90_max = XMVectorMax(g_0, g_90);
+	const XMVECTOR g_0_90_min = XMVectorMin(g_0, g_90);
+	const XMVECTOR g_45_135_max = XMVectorMax(g_45, g_135);
+	const XMVECTOR g_45_135_min = XMVectorMin(g_45, g_135);
+
+	const XMVECTOR gSum = XMVectorAdd(g_0_90_max, g_45_135_max);
+	const XMVECTOR gSumNotZero = XMVectorNotEqual(gSum, g_XMZero);
+	XMVECTOR e_0_90 = XMVectorMin(XMVectorDivide(g_0_90_max, gSum), g_XMOne);
+	e_0_90 = XMVectorSelect(g_XMZero, e_0_90, gSumNotZero);
+	const XMVECTOR e_45_135 = XMVectorSelect(g_XMZero, XMVectorSubtract(g_XMOne, e_0_90), gSumNotZero);
+
+	XMVECTOR e = XMVectorAndInt(XMVectorAndInt(
+		XMVectorGreater(g_0_90_max, XMVectorScale(g_0_90_min, kDetectRatio)),
+		XMVectorGreater(g_0_90_max, XMVectorReplicate(kDetectThres))),
+		XMVectorGreater(g_0_90_max, g_45_135_min));
+	const XMVECTOR is0 = XMVectorEqual(g_0_90_max, g_0);
+	const XMVECTOR edge_0 = MaskToFloat(XMVectorAndInt(is0, e));
+	const XMVECTOR edge_90 = MaskToFloat(XMVectorAndCInt(e, is0));
+
+	e = XMVectorAndInt(XMVectorAndInt(
+		XMVectorGreater(g_45_135_max, XMVectorScale(g_45_135_min, kDetectRatio)),
+		XMVectorGreater(g_45_135_max, XMVectorReplicate(kDetectThres))),
+		XMVectorGreater(g_45_135_max, g_0_90_min));
+	const XMVECTOR is45 = XMVectorEqual(g_45_135_max, g_45);
+	const XMVECTOR edge_45 = MaskToFloat(XMVectorAndInt(is45, e));
+	const XMVECTOR edge_135 = MaskToFloat(XMVectorAndCInt(e, is45));
+
+	const XMVECTOR edgeSum = XMVectorAdd(XMVectorAdd(edge_0, edge_90), XMVectorAdd(edge_45, edge_135));
+	const XMVECTOR twoEdges = XMVectorGreaterOrEqual(edgeSum, XMVectorReplicate(2.0f));
+	const XMVECTOR oneEdge = XMVectorGreaterOrEqual(edgeSum, g_XMOne);
+
+	const XMVECTOR edge0IsOne = XMVectorEqual(edge_0, g_XMOne);
+	const XMVECTOR edge45IsOne = XMVectorEqual(edge_45, g_XMOne);
+
+	result[0] = XMVectorSelect(edge_0, XMVectorSelect(g_XMZero, e_0_90, edge0IsOne), twoEdges);
+	result[1] = XMVectorSelect(edge_90, XMVectorSelect(e_0_90, g_XMZero, edge0IsOne), twoEdges);
+	result[2] = XMVectorSelect(edge_45, XMVectorSelect(g_XMZero, e_45_135, edge45IsOne), twoEdges);
+	result[3] = XMVectorSelect(edge_135, XMVectorSelect(e_45_135, g_XMZero, edge45IsOne), twoEdges);
+
+	for (int k = 0; k < 4; ++k) {
+		result[k] = XMVectorSelect(g_XMZero, result[k], oneEdge);
+	}
+}
+
+}
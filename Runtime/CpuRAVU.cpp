@@ -0,0 +1,529 @@
+#include "pch.h"
+#include "CpuRAVU.h"
+#include "DDSReader.h"
+#include "StrUtils.h"
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+
+// 哈希桶的数量：24 个角度 x 4 个强度 x 3 个相干度
+static constexpr int BUCKET_COUNT = 288;
+
+// Lite 使用 5x5 窗口，Zoom 使用 6x6 窗口
+static constexpr int LITE_SIZE = 5;
+static constexpr int ZOOM_SIZE = 6;
+static constexpr int ZOOM_KERNEL_SIZE = ZOOM_SIZE * ZOOM_SIZE;
+// 每个网格点的权重占用的 XMFLOAT4 个数
+static constexpr int ZOOM_KERNEL_VECTORS = ZOOM_KERNEL_SIZE / 4;
+static constexpr int ZOOM_SUBPIX = CpuRAVUZoom::SUBPIX_SIZE;
+
+// 每个输出像素的工作集大小（字节），用于计算条带高度
+static constexpr size_t LITE_BYTES_PER_PIXEL = sizeof(XMFLOAT4) * 5 + sizeof(float);
+static constexpr size_t ZOOM_BYTES_PER_PIXEL = sizeof(XMFLOAT4) * 2 + sizeof(float) + sizeof(int);
+
+// 和 HLSL 中的 _rgb2yuv 相同
+static constexpr XMFLOAT3 LUMA_COEF = { 0.299f, 0.587f, 0.114f };
+
+
+// XMVector3TransformNormal 的参数，每行为原矩阵的一列
+static XMMATRIX GetRGB2YUV() {
+	return XMMATRIX(
+		0.299f, -0.169f, 0.5f, 0.0f,
+		0.587f, -0.331f, -0.419f, 0.0f,
+		0.114f, 0.5f, -0.081f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f
+	);
+}
+
+static XMMATRIX GetYUV2RGB() {
+	return XMMATRIX(
+		1.0f, 1.0f, 1.0f, 0.0f,
+		-0.00093f, -0.3437f, 1.77216f, 0.0f,
+		1.401687f, -0.71417f, 0.00099f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f
+	);
+}
+
+// 输入的 yuv 中 uv 已减去 0.5，返回的 alpha 为 1
+static XMVECTOR XM_CALLCONV YUVToRGB(FXMVECTOR yuv, CXMMATRIX yuv2rgb) {
+	return XMVectorSelect(g_XMOne, XMVector3TransformNormal(yuv, yuv2rgb), g_XMSelect1110);
+}
+
+static XMVECTOR XM_CALLCONV Load4(const float* row, int x) {
+	return XMLoadFloat4((const XMFLOAT4*)&row[x]);
+}
+
+// 根据梯度的结构张量计算哈希桶的索引，每次计算 4 个像素
+static XMVECTOR XM_CALLCONV CalcBucket(FXMVECTOR a, FXMVECTOR b, FXMVECTOR d) {
+	const XMVECTOR eps = XMVectorReplicate(1.192092896e-7f);
+	const XMVECTOR half = g_XMOneHalf;
+
+	const XMVECTOR T = XMVectorAdd(a, d);
+	const XMVECTOR D = XMVectorSubtract(XMVectorMultiply(a, d), XMVectorMultiply(b, b));
+	const XMVECTOR halfT = XMVectorMultiply(T, half);
+	const XMVECTOR delta = XMVectorSqrt(XMVectorMax(XMVectorSubtract(XMVectorMultiply(halfT, halfT), D), g_XMZero));
+	const XMVECTOR L1 = XMVectorAdd(halfT, delta);
+	// 理论上 L2 不小于 0，截断是为了防止舍入误差导致 NaN
+	const XMVECTOR L2 = XMVectorMax(XMVectorSubtract(halfT, delta), g_XMZero);
+	const XMVECTOR sqrtL1 = XMVectorSqrt(L1);
+	const XMVECTOR sqrtL2 = XMVectorSqrt(L2);
+
+	// theta = mod(atan2(b, L1 - a) + PI, PI)
+	XMVECTOR theta = XMVectorAdd(XMVectorATan2(b, XMVectorSubtract(L1, a)), g_XMPi);
+	theta = XMVectorSubtract(theta, XMVectorMultiply(g_XMPi, XMVectorFloor(XMVectorMultiply(theta, g_XMReciprocalPi))));
+	theta = XMVectorSelect(theta, g_XMZero, XMVectorLess(XMVectorAbs(b), eps));
+
+	const XMVECTOR lambda = sqrtL1;
+	const XMVECTOR sqrtSum = XMVectorAdd(sqrtL1, sqrtL2);
+	XMVECTOR mu = XMVectorDivide(XMVectorSubtract(sqrtL1, sqrtL2), sqrtSum);
+	mu = XMVectorSelect(mu, g_XMZero, XMVectorLess(sqrtSum, eps));
+
+	// 舍入误差可能使 theta 等于 PI，此时 GPU 上纹理寻址被截断到最后一个角度
+	XMVECTOR angle = XMVectorFloor(XMVectorMultiply(theta, XMVectorReplicate(24.0f / XM_PI)));
+	angle = XMVectorMin(angle, XMVectorReplicate(23.0f));
+
+	// 阈值单调递增，因此强度和相干度等于满足的阈值个数
+	const XMVECTOR strength = XMVectorAdd(XMVectorAdd(
+		XMVectorAndInt(XMVectorGreaterOrEqual(lambda, XMVectorReplicate(0.004f)), g_XMOne),
+		XMVectorAndInt(XMVectorGreaterOrEqual(lambda, XMVectorReplicate(0.016f)), g_XMOne)),
+		XMVectorAndInt(XMVectorGreaterOrEqual(lambda, XMVectorReplicate(0.05f)), g_XMOne));
+	const XMVECTOR coherence = XMVectorAdd(
+		XMVectorAndInt(XMVectorGreaterOrEqual(mu, XMVectorReplicate(0.25f)), g_XMOne),
+		XMVectorAndInt(XMVectorGreaterOrEqual(mu, g_XMOneHalf), g_XMOne));
+
+	// (angle * 4 + strength) * 3 + coherence
+	return XMVectorMultiplyAdd(XMVectorMultiplyAdd(angle, XMVectorReplicate(4.0f), strength), XMVectorReplicate(3.0f), coherence);
+}
+
+// 5x5 窗口，中心 3x3 个点的二阶中心差分
+// rows 为 y - 2 到 y + 2 的亮度行，计算 x 到 x + 3 四个像素
+static void HashLite4(const float* const rows[LITE_SIZE], int x, int result[4]) {
+	static constexpr float weights[3][3] = {
+		{ 0.1018680644198163f, 0.11543163961422666f, 0.1018680644198163f },
+		{ 0.11543163961422666f, 0.13080118386382833f, 0.11543163961422666f },
+		{ 0.1018680644198163f, 0.11543163961422666f, 0.1018680644198163f }
+	};
+
+	// l[dy][dx] 为偏移 (dx - 2, dy - 2) 处的亮度
+	XMVECTOR l[LITE_SIZE][LITE_SIZE];
+	for (int i = 0; i < LITE_SIZE; ++i) {
+		for (int j = 0; j < LITE_SIZE; ++j) {
+			l[i][j] = Load4(rows[i], x + j - 2);
+		}
+	}
+
+	XMVECTOR a = g_XMZero;
+	XMVECTOR b = g_XMZero;
+	XMVECTOR d = g_XMZero;
+	for (int i = 1; i <= 3; ++i) {
+		for (int j = 1; j <= 3; ++j) {
+			const XMVECTOR gx = XMVectorMultiply(XMVectorSubtract(l[i][j + 1], l[i][j - 1]), g_XMOneHalf);
+			const XMVECTOR gy = XMVectorMultiply(XMVectorSubtract(l[i + 1][j], l[i - 1][j]), g_XMOneHalf);
+			const XMVECTOR w = XMVectorReplicate(weights[i - 1][j - 1]);
+			const XMVECTOR wgx = XMVectorMultiply(gx, w);
+			a = XMVectorMultiplyAdd(wgx, gx, a);
+			b = XMVectorMultiplyAdd(wgx, gy, b);
+			d = XMVectorMultiplyAdd(XMVectorMultiply(gy, w), gy, d);
+		}
+	}
+
+	XMINT4 bucket;
+	XMStoreSInt4(&bucket, CalcBucket(a, b, d));
+	std::memcpy(result, &bucket, sizeof(bucket));
+}
+
+// 二阶或四阶中心差分，四阶差分需要的像素都在窗口内时使用四阶
+static XMVECTOR XM_CALLCONV Gradient(const XMVECTOR* v, int stride, int i) {
+	if (i >= 2 && i + 2 < ZOOM_SIZE) {
+		// (-v[i+2] + 8 * v[i+1] - 8 * v[i-1] + v[i-2]) / 12
+		XMVECTOR r = XMVectorSubtract(v[(i - 2) * stride], v[(i + 2) * stride]);
+		r = XMVectorMultiplyAdd(XMVectorSubtract(v[(i + 1) * stride], v[(i - 1) * stride]), XMVectorReplicate(8.0f), r);
+		return XMVectorMultiply(r, XMVectorReplicate(1.0f / 12.0f));
+	} else {
+		return XMVectorMultiply(XMVectorSubtract(v[(i + 1) * stride], v[(i - 1) * stride]), g_XMOneHalf);
+	}
+}
+
+// 6x6 窗口，中心 4x4 个点的梯度
+// rows 为 y - 2 到 y + 3 的亮度行，计算 x 到 x + 3 四个像素
+static void HashZoom4(const float* const rows[ZOOM_SIZE], int x, int result[4]) {
+	static constexpr float weights[4] = { 0.04792235409415088f, 0.06153352068439959f, 0.06153352068439959f, 0.04792235409415088f };
+	static constexpr float innerWeight = 0.07901060453704994f;
+
+	XMVECTOR l[ZOOM_SIZE][ZOOM_SIZE];
+	for (int i = 0; i < ZOOM_SIZE; ++i) {
+		for (int j = 0; j < ZOOM_SIZE; ++j) {
+			l[i][j] = Load4(rows[i], x + j - 2);
+		}
+	}
+
+	XMVECTOR a = g_XMZero;
+	XMVECTOR b = g_XMZero;
+	XMVECTOR d = g_XMZero;
+	for (int i = 1; i <= 4; ++i) {
+		for (int j = 1; j <= 4; ++j) {
+			const XMVECTOR gx = Gradient(&l[i][0], 1, j);
+			const XMVECTOR gy = Gradient(&l[0][j], ZOOM_SIZE, i);
+			const bool inner = i >= 2 && i <= 3 && j >= 2 && j <= 3;
+			const XMVECTOR w = XMVectorReplicate(inner ? innerWeight : (i == 1 || i == 4) ? weights[j - 1] : weights[i - 1]);
+			const XMVECTOR wgx = XMVectorMultiply(gx, w);
+			a = XMVectorMultiplyAdd(wgx, gx, a);
+			b = XMVectorMultiplyAdd(wgx, gy, b);
+			d = XMVectorMultiplyAdd(XMVectorMultiply(gy, w), gy, d);
+		}
+	}
+
+	XMINT4 bucket;
+	XMStoreSInt4(&bucket, CalcBucket(a, b, d));
+	std::memcpy(result, &bucket, sizeof(bucket));
+}
+
+// 每次迭代计算 8 个像素的哈希，即两组 SIMD 向量
+// 行尾多出的结果写入 result 的末尾，result 的大小至少为 width 向上取整到 8 的倍数
+template<typename HashFn>
+static void HashRow(HashFn hash, const float* const* rows, UINT width, int* result) {
+	for (UINT x = 0; x < width; x += 8) {
+		hash(rows, (int)x, result + x);
+		if (x + 4 < width) {
+			hash(rows, (int)x + 4, result + x + 4);
+		}
+	}
+}
+
+static bool LoadWeights(const wchar_t* fileName, UINT width, UINT height, CpuImage& result) {
+	if (!DDSReader::Load(fileName, result)) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("加载 {} 失败", StrUtils::UTF16ToUTF8(fileName)));
+		return false;
+	}
+
+	if (result.GetWidth() != width || result.GetHeight() != height) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("{} 的尺寸非法", StrUtils::UTF16ToUTF8(fileName)));
+		return false;
+	}
+
+	return true;
+}
+
+static bool PrepareOutput(UINT width, UINT height, CpuImage& dst) {
+	if (dst.GetWidth() == width && dst.GetHeight() == height) {
+		return true;
+	}
+
+	if (!dst.Create(width, height)) {
+		SPDLOG_LOGGER_ERROR(logger, "创建输出图像失败");
+		return false;
+	}
+
+	return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// RAVU_Lite_R3
+
+bool CpuRAVULite::Initialize(const wchar_t* weightsFile) {
+	// 每行为一个哈希桶，13 个纹素，每个纹素为 2x2 个输出像素的权重
+	static constexpr UINT LUT_WIDTH = (LITE_SIZE * LITE_SIZE + 1) / 2;
+
+	CpuImage lut;
+	if (!LoadWeights(weightsFile, LUT_WIDTH, BUCKET_COUNT, lut)) {
+		return false;
+	}
+
+	// 纹理中第 n 个样本的偏移为 (n / 5 - 2, n % 5 - 2)，样本 24 - n 使用第 n 个纹素的逆序
+	// 重新排列为行优先，每个哈希桶 25 个连续的 XMFLOAT4
+	_kernels.resize(size_t(BUCKET_COUNT) * LITE_SIZE * LITE_SIZE);
+	for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+		XMFLOAT4* kernel = &_kernels[size_t(bucket) * LITE_SIZE * LITE_SIZE];
+
+		for (int n = 0; n < LITE_SIZE * LITE_SIZE; ++n) {
+			const int col = n / LITE_SIZE;
+			const int row = n % LITE_SIZE;
+
+			if (n < (int)LUT_WIDTH) {
+				kernel[row * LITE_SIZE + col] = lut.At(n, bucket);
+			} else {
+				const XMFLOAT4& w = lut.At(LITE_SIZE * LITE_SIZE - 1 - n, bucket);
+				kernel[row * LITE_SIZE + col] = XMFLOAT4(w.w, w.z, w.y, w.x);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool CpuRAVULite::Scale(const CpuImage& src, CpuImage& dst, UINT bandHeight) const {
+	assert(&src != &dst);
+
+	if (_kernels.empty()) {
+		SPDLOG_LOGGER_ERROR(logger, "CpuRAVULite 未初始化");
+		return false;
+	}
+
+	const UINT width = src.GetWidth();
+	const UINT height = src.GetHeight();
+	if (!PrepareOutput(width * 2, height * 2, dst)) {
+		return false;
+	}
+
+	// 4 个像素一组读取时窗口右侧最多越过宽度 5 个像素，由边框和填充容纳
+	CpuImage temp;
+	const CpuImage& input = CpuImageUtils::EnsureBorder(src, CpuImage::DEFAULT_BORDER, temp);
+
+	CpuPlane luma;
+	if (!CpuImageUtils::ComputeLuma(input, luma, LUMA_COEF)) {
+		return false;
+	}
+
+	if (bandHeight == 0) {
+		bandHeight = CpuImageUtils::CalcBandHeight(width * LITE_BYTES_PER_PIXEL);
+	}
+
+	const XMMATRIX rgb2yuv = GetRGB2YUV();
+	const XMMATRIX yuv2rgb = GetYUV2RGB();
+
+	// 每个输入像素计算 2x2 个输出像素，因此按输入的行切分条带
+	CpuImageUtils::ParallelForBands(height, bandHeight, [&](UINT yBegin, UINT yEnd) {
+		std::vector<int> buckets((width + 7) & ~7u);
+
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const float* rows[LITE_SIZE];
+			for (int i = 0; i < LITE_SIZE; ++i) {
+				rows[i] = luma.GetRow(int(y) + i - 2);
+			}
+
+			HashRow(&HashLite4, rows, width, buckets.data());
+
+			const XMFLOAT4* srcRow = input.GetRow(y);
+			XMFLOAT4* dstRows[2] = { dst.GetRow(y * 2), dst.GetRow(y * 2 + 1) };
+
+			for (UINT x = 0; x < width; ++x) {
+				const XMFLOAT4* kernel = &_kernels[size_t(buckets[x]) * LITE_SIZE * LITE_SIZE];
+
+				XMVECTOR res = g_XMZero;
+				for (int i = 0; i < LITE_SIZE; ++i) {
+					const float* row = rows[i] + x - 2;
+					for (int j = 0; j < LITE_SIZE; ++j) {
+						res = XMVectorMultiplyAdd(XMVectorReplicate(row[j]), XMLoadFloat4(&kernel[i * LITE_SIZE + j]), res);
+					}
+				}
+				res = XMVectorSaturate(res);
+
+				// 色度取自输入像素，只计算一次
+				const XMVECTOR uv = XMVectorSelect(g_XMZero, XMVector3TransformNormal(XMLoadFloat4(&srcRow[x]), rgb2yuv), g_XMSelect0110);
+
+				// res 的分量依次为左上、左下、右上、右下
+				XMFLOAT4 r;
+				XMStoreFloat4(&r, res);
+				XMStoreFloat4(&dstRows[0][x * 2], YUVToRGB(XMVectorAdd(XMVectorReplicate(r.x), uv), yuv2rgb));
+				XMStoreFloat4(&dstRows[1][x * 2], YUVToRGB(XMVectorAdd(XMVectorReplicate(r.y), uv), yuv2rgb));
+				XMStoreFloat4(&dstRows[0][x * 2 + 1], YUVToRGB(XMVectorAdd(XMVectorReplicate(r.z), uv), yuv2rgb));
+				XMStoreFloat4(&dstRows[1][x * 2 + 1], YUVToRGB(XMVectorAdd(XMVectorReplicate(r.w), uv), yuv2rgb));
+			}
+
+			dst.ExtendRowBorder(y * 2, y * 2 + 2);
+		}
+	});
+
+	dst.ExtendVerticalBorder();
+	return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// RAVU_Zoom_R3
+
+bool CpuRAVUZoom::Initialize(const wchar_t* weightsFile) {
+	// 每个哈希桶占用 9 行（垂直方向的子像素），每行 5 组，每组 9 个纹素（水平方向的子像素）
+	// 每组的 4 个通道依次为 4 个样本的权重，共 18 个样本，另外 18 个样本使用子像素位置对称处的权重
+	static constexpr int GROUP_COUNT = 5;
+	static constexpr int HALF_KERNEL_SIZE = ZOOM_KERNEL_SIZE / 2;
+
+	CpuImage lut;
+	if (!LoadWeights(weightsFile, GROUP_COUNT * ZOOM_SUBPIX, BUCKET_COUNT * ZOOM_SUBPIX, lut)) {
+		return false;
+	}
+
+	// 纹理中第 n 个样本的偏移为 (n / 6 - 2, n % 6 - 2)，重新排列为行优先
+	auto sampleIndex = [](int n) {
+		return (n % ZOOM_SIZE) * ZOOM_SIZE + n / ZOOM_SIZE;
+	};
+
+	// 线性插值是线性的，因此在对称的网格点上插值等价于在镜像后的网格上插值，可以将两半合并到同一个网格点
+	_kernels.resize(size_t(BUCKET_COUNT) * ZOOM_SUBPIX * ZOOM_SUBPIX * ZOOM_KERNEL_VECTORS);
+	for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+		for (int sy = 0; sy < ZOOM_SUBPIX; ++sy) {
+			for (int sx = 0; sx < ZOOM_SUBPIX; ++sx) {
+				float* kernel = (float*)&_kernels[((size_t(bucket) * ZOOM_SUBPIX + sy) * ZOOM_SUBPIX + sx) * ZOOM_KERNEL_VECTORS];
+
+				for (int n = 0; n < HALF_KERNEL_SIZE; ++n) {
+					const int group = n / 4;
+					const int channel = n % 4;
+
+					const XMFLOAT4& w = lut.At(group * ZOOM_SUBPIX + sx, bucket * ZOOM_SUBPIX + sy);
+					kernel[sampleIndex(n)] = (&w.x)[channel];
+
+					const XMFLOAT4& wInv = lut.At(
+						group * ZOOM_SUBPIX + (ZOOM_SUBPIX - 1 - sx),
+						bucket * ZOOM_SUBPIX + (ZOOM_SUBPIX - 1 - sy)
+					);
+					kernel[sampleIndex(ZOOM_KERNEL_SIZE - 1 - n)] = (&wInv.x)[channel];
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+// 每个输出行或列的采样位置
+struct RAVUSamplePos {
+	// 左上方最近的输入像素
+	int base;
+	// 子像素网格中左上方的网格点
+	int subpix;
+	// 到该网格点的距离，单位为网格间距
+	float frac;
+};
+
+static std::vector<RAVUSamplePos> CalcSamplePositions(UINT inputSize, UINT outputSize) {
+	const float inputPt = 1.0f / inputSize;
+
+	std::vector<RAVUSamplePos> result(outputSize);
+	for (UINT i = 0; i < outputSize; ++i) {
+		const float pos = (i + 0.5f) / outputSize / inputPt - 0.5f;
+		const float base = std::floor(pos);
+
+		// LUT_POS 将子像素位置映射到第一个和最后一个网格点之间
+		const float subpix = (pos - base) * (ZOOM_SUBPIX - 1);
+		const int subpixInt = std::min((int)subpix, ZOOM_SUBPIX - 2);
+		result[i] = { (int)base, subpixInt, subpix - subpixInt };
+	}
+
+	return result;
+}
+
+bool CpuRAVUZoom::Scale(
+	const CpuImage& src,
+	UINT outputWidth,
+	UINT outputHeight,
+	CpuImage& dst,
+	UINT bandHeight
+) const {
+	assert(&src != &dst);
+
+	if (_kernels.empty()) {
+		SPDLOG_LOGGER_ERROR(logger, "CpuRAVUZoom 未初始化");
+		return false;
+	}
+
+	if (!PrepareOutput(outputWidth, outputHeight, dst)) {
+		return false;
+	}
+
+	const UINT width = src.GetWidth();
+	const UINT height = src.GetHeight();
+
+	CpuImage temp;
+	const CpuImage& input = CpuImageUtils::EnsureBorder(src, CpuImage::DEFAULT_BORDER, temp);
+
+	CpuPlane luma;
+	if (!CpuImageUtils::ComputeLuma(input, luma, LUMA_COEF)) {
+		return false;
+	}
+
+	// 第一个通道：转换到 YUV 并计算每个输入像素的哈希桶
+	// 哈希只和输入像素有关，因此放大时多个输出像素共用同一个哈希
+	CpuImage yuv;
+	CpuSurface<int> buckets;
+	if (!yuv.Create(width, height, input.GetBorder()) || !buckets.Create(width, height)) {
+		SPDLOG_LOGGER_ERROR(logger, "创建中间图像失败");
+		return false;
+	}
+
+	const XMMATRIX rgb2yuv = GetRGB2YUV();
+	const XMMATRIX yuv2rgb = GetYUV2RGB();
+	const XMVECTOR yuvOffset = XMVectorSet(0.0f, 0.5f, 0.5f, 0.0f);
+
+	CpuImageUtils::RunPass(buckets, bandHeight, sizeof(XMFLOAT4) * 2 + sizeof(float), [&](UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const float* rows[ZOOM_SIZE];
+			for (int i = 0; i < ZOOM_SIZE; ++i) {
+				rows[i] = luma.GetRow(int(y) + i - 2);
+			}
+
+			// 写入右侧边框的结果之后会被 ExtendRowBorder 覆盖
+			HashRow(&HashZoom4, rows, width, buckets.GetRow(y));
+
+			const XMFLOAT4* srcRow = input.GetRow(y);
+			XMFLOAT4* yuvRow = yuv.GetRow(y);
+			for (UINT x = 0; x < width; ++x) {
+				XMStoreFloat4(&yuvRow[x], XMVectorAdd(XMVector3TransformNormal(XMLoadFloat4(&srcRow[x]), rgb2yuv), yuvOffset));
+			}
+
+			yuv.ExtendRowBorder(y, y + 1);
+		}
+	});
+	yuv.ExtendVerticalBorder();
+
+	// 第二个通道：混合相邻 4 个网格点的权重后和 6x6 个样本做点积
+	const std::vector<RAVUSamplePos> xPositions = CalcSamplePositions(width, outputWidth);
+	const std::vector<RAVUSamplePos> yPositions = CalcSamplePositions(height, outputHeight);
+
+	CpuImageUtils::RunPass(dst, bandHeight, ZOOM_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const RAVUSamplePos& yPos = yPositions[y];
+			const XMVECTOR ty = XMVectorReplicate(yPos.frac);
+			const XMVECTOR ty1 = XMVectorReplicate(1.0f - yPos.frac);
+
+			const XMFLOAT4* rows[ZOOM_SIZE];
+			for (int i = 0; i < ZOOM_SIZE; ++i) {
+				rows[i] = yuv.GetRow(yPos.base + i - 2);
+			}
+			const int* bucketRow = buckets.GetRow(yPos.base);
+
+			XMFLOAT4* out = dst.GetRow(y);
+
+			for (UINT x = 0; x < outputWidth; ++x) {
+				const RAVUSamplePos& xPos = xPositions[x];
+				const int bx = xPos.base;
+				const XMVECTOR tx = XMVectorReplicate(xPos.frac);
+				const XMVECTOR tx1 = XMVectorReplicate(1.0f - xPos.frac);
+
+				const XMFLOAT4* k00 = &_kernels[((size_t(bucketRow[bx]) * ZOOM_SUBPIX + yPos.subpix) * ZOOM_SUBPIX + xPos.subpix) * ZOOM_KERNEL_VECTORS];
+				const XMFLOAT4* k01 = k00 + ZOOM_KERNEL_VECTORS;
+				const XMFLOAT4* k10 = k00 + ZOOM_SUBPIX * ZOOM_KERNEL_VECTORS;
+				const XMFLOAT4* k11 = k10 + ZOOM_KERNEL_VECTORS;
+
+				const XMVECTOR w00 = XMVectorMultiply(tx1, ty1);
+				const XMVECTOR w01 = XMVectorMultiply(tx, ty1);
+				const XMVECTOR w10 = XMVectorMultiply(tx1, ty);
+				const XMVECTOR w11 = XMVectorMultiply(tx, ty);
+
+				XMFLOAT4A kernel[ZOOM_KERNEL_VECTORS];
+				for (int i = 0; i < ZOOM_KERNEL_VECTORS; ++i) {
+					XMVECTOR k = XMVectorMultiply(XMLoadFloat4(&k00[i]), w00);
+					k = XMVectorMultiplyAdd(XMLoadFloat4(&k01[i]), w01, k);
+					k = XMVectorMultiplyAdd(XMLoadFloat4(&k10[i]), w10, k);
+					k = XMVectorMultiplyAdd(XMLoadFloat4(&k11[i]), w11, k);
+					XMStoreFloat4A(&kernel[i], k);
+				}
+
+				const float* weights = &kernel[0].x;
+				XMVECTOR res = g_XMZero;
+				for (int i = 0; i < ZOOM_SIZE; ++i) {
+					const XMFLOAT4* row = rows[i] + bx - 2;
+					for (int j = 0; j < ZOOM_SIZE; ++j) {
+						res = XMVectorMultiplyAdd(XMLoadFloat4(&row[j]), XMVectorReplicate(weights[i * ZOOM_SIZE + j]), res);
+					}
+				}
+
+				res = XMVectorSubtract(XMVectorSaturate(res), yuvOffset);
+				XMStoreFloat4(&out[x], YUVToRGB(res, yuv2rgb));
+			}
+		}
+	});
+
+	return true;
+}
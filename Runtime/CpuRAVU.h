@@ -0,0 +1,45 @@
+#pragma once
+#include "pch.h"
+#include "CpuImage.h"
+
+
+// RAVU 的 CPU 实现，移植自 RAVU_Lite_R3.hlsl 和 RAVU_Zoom_R3.hlsl
+// 权重从效果使用的 RAVU_*_Weights.dds 中读取，保证和 GPU 版本使用同一个模型
+// 加载时权重被重新排列为每个哈希桶一块连续的内存，采样顺序和图像的行优先顺序一致
+
+// 固定放大两倍
+class CpuRAVULite {
+public:
+	bool Initialize(const wchar_t* weightsFile = L"effects\\RAVU_Lite_R3_Weights.dds");
+
+	// 将 src 放大两倍并存入 dst，src 和 dst 不能是同一个图像
+	// bandHeight 为输入图像的条带高度，为 0 时自动选择
+	bool Scale(const CpuImage& src, CpuImage& dst, UINT bandHeight = 0) const;
+
+private:
+	// 每个哈希桶 25 个权重，按 5x5 窗口行优先排列，每个权重对应 2x2 个输出像素
+	std::vector<XMFLOAT4> _kernels;
+};
+
+// 任意缩放倍数
+class CpuRAVUZoom {
+public:
+	bool Initialize(const wchar_t* weightsFile = L"effects\\RAVU_Zoom_R3_Weights.dds");
+
+	// 将 src 缩放为 outputWidth x outputHeight 并存入 dst，src 和 dst 不能是同一个图像
+	bool Scale(
+		const CpuImage& src,
+		UINT outputWidth,
+		UINT outputHeight,
+		CpuImage& dst,
+		UINT bandHeight = 0
+	) const;
+
+	// 子像素位置被量化为 SUBPIX_SIZE x SUBPIX_SIZE 的网格，网格之间线性插值
+	static constexpr int SUBPIX_SIZE = 9;
+
+private:
+	// 每个哈希桶的每个子像素网格点有 36 个权重，按 6x6 窗口行优先排列
+	// 原纹理中的对称部分已展开，因此每个输出像素只需读取 4 个连续的块
+	std::vector<XMFLOAT4> _kernels;
+};
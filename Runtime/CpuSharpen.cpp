@@ -0,0 +1,1166 @@
+#include "pch.h"
+#include "CpuSharpen.h"
+#include "CpuNISCommon.h"
+#include "Utils.h"
+#include <thread>
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+
+// 各算法每个像素的工作集大小（字节），用于计算条带高度
+static constexpr size_t CAS_BYTES_PER_PIXEL = sizeof(XMFLOAT4) * 2;
+static constexpr size_t LUMA_SHARPEN_BYTES_PER_PIXEL = sizeof(XMFLOAT4) * 2;
+static constexpr size_t NV_SHARPEN_BYTES_PER_PIXEL = sizeof(XMFLOAT4) * 2 + sizeof(float);
+static constexpr size_t ADAPTIVE_SHARPEN_BYTES_PER_PIXEL = sizeof(XMFLOAT4) * 2 + sizeof(float) * 2;
+static constexpr size_t FINE_SHARP_BYTES_PER_PIXEL = sizeof(XMFLOAT4) * 2 + sizeof(float) * 4;
+
+
+static bool PrepareOutput(const CpuImage& src, CpuImage& dst) {
+	assert(&src != &dst);
+
+	if (dst.GetWidth() == src.GetWidth() && dst.GetHeight() == src.GetHeight()) {
+		return true;
+	}
+
+	if (!dst.Create(src.GetWidth(), src.GetHeight(), std::max(src.GetBorder(), CpuImage::DEFAULT_BORDER))) {
+		SPDLOG_LOGGER_ERROR(logger, "创建输出图像失败");
+		return false;
+	}
+
+	return true;
+}
+
+static bool PreparePlane(const CpuImage& src, CpuPlane& plane) {
+	if (plane.GetWidth() == src.GetWidth() && plane.GetHeight() == src.GetHeight()) {
+		return true;
+	}
+
+	return plane.Create(src.GetWidth(), src.GetHeight(), std::max(src.GetBorder(), CpuPlane::DEFAULT_BORDER));
+}
+
+static XMVECTOR XM_CALLCONV LoadPixel(const XMFLOAT4* row, int x) {
+	return XMLoadFloat4(&row[x]);
+}
+
+// 读取单通道图像中水平相邻的 4 个元素
+static XMVECTOR XM_CALLCONV Load4(const float* row, int x) {
+	return XMLoadFloat4((const XMFLOAT4*)&row[x]);
+}
+
+// 单通道图像的 SIMD 核函数每次计算水平相邻的 4 个像素
+// 行尾多出的结果写入右侧边框和填充，之后由 ExtendRowBorder 覆盖
+template<typename Fn>
+static void ForEach4(float* dstRow, UINT width, const Fn& func) {
+	for (UINT x = 0; x < width; x += 4) {
+		XMStoreFloat4((XMFLOAT4*)&dstRow[x], func((int)x));
+	}
+}
+
+static XMVECTOR XM_CALLCONV Min3(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) {
+	return XMVectorMin(XMVectorMin(a, b), c);
+}
+
+static XMVECTOR XM_CALLCONV Max3(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) {
+	return XMVectorMax(XMVectorMax(a, b), c);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// CAS
+// 移植自 CAS.hlsl
+
+bool CpuSharpen::CAS(const CpuImage& src, CpuImage& dst, const CASParams& params, UINT bandHeight) {
+	if (!PrepareOutput(src, dst)) {
+		return false;
+	}
+
+	CpuImage temp;
+	const CpuImage& input = CpuImageUtils::EnsureBorder(src, 1, temp);
+
+	const XMVECTOR peak = XMVectorReplicate(-1.0f / (8.0f + (5.0f - 8.0f) * params.sharpness));
+	const XMVECTOR two = XMVectorReplicate(2.0f);
+	const XMVECTOR four = XMVectorReplicate(4.0f);
+
+	CpuImageUtils::RunPass(dst, bandHeight, CAS_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const XMFLOAT4* r0 = input.GetRow(y - 1);
+			const XMFLOAT4* r1 = input.GetRow(y);
+			const XMFLOAT4* r2 = input.GetRow(y + 1);
+			XMFLOAT4* out = dst.GetRow(y);
+
+			for (int x = 0, width = (int)input.GetWidth(); x < width; ++x) {
+				// fetch a 3x3 neighborhood around the pixel 'e',
+				//	a b c
+				//	d(e)f
+				//	g h i
+				XMVECTOR a = LoadPixel(r0, x - 1);
+				XMVECTOR b = LoadPixel(r0, x);
+				XMVECTOR c = LoadPixel(r0, x + 1);
+				XMVECTOR d = LoadPixel(r1, x - 1);
+				XMVECTOR e = LoadPixel(r1, x);
+				XMVECTOR f = LoadPixel(r1, x + 1);
+				XMVECTOR g = LoadPixel(r2, x - 1);
+				XMVECTOR h = LoadPixel(r2, x);
+				XMVECTOR i = LoadPixel(r2, x + 1);
+
+				// Soft min and max. These are 2.0x bigger (factored out the extra multiply).
+				XMVECTOR mnRGB = XMVectorMin(XMVectorMin(XMVectorMin(d, e), XMVectorMin(f, b)), h);
+				XMVECTOR mnRGB2 = XMVectorMin(mnRGB, XMVectorMin(XMVectorMin(a, c), XMVectorMin(g, i)));
+				mnRGB = XMVectorAdd(mnRGB, mnRGB2);
+
+				XMVECTOR mxRGB = XMVectorMax(XMVectorMax(XMVectorMax(d, e), XMVectorMax(f, b)), h);
+				XMVECTOR mxRGB2 = XMVectorMax(mxRGB, XMVectorMax(XMVectorMax(a, c), XMVectorMax(g, i)));
+				mxRGB = XMVectorAdd(mxRGB, mxRGB2);
+
+				// Smooth minimum distance to signal limit divided by smooth max.
+				XMVECTOR ampRGB = XMVectorSaturate(XMVectorDivide(XMVectorMin(mnRGB, XMVectorSubtract(two, mxRGB)), mxRGB));
+
+				// Shaping amount of sharpening.
+				XMVECTOR wRGB = XMVectorMultiply(XMVectorSqrt(ampRGB), peak);
+
+				// Filter shape.
+				//  0 w 0
+				//  w 1 w
+				//  0 w 0
+				XMVECTOR weightRGB = XMVectorMultiplyAdd(four, wRGB, g_XMOne);
+				XMVECTOR window = XMVectorAdd(XMVectorAdd(b, d), XMVectorAdd(f, h));
+				XMVECTOR result = XMVectorSaturate(XMVectorDivide(XMVectorMultiplyAdd(window, wRGB, e), weightRGB));
+
+				XMStoreFloat4(&out[x], XMVectorSetW(result, 1.0f));
+			}
+		}
+	});
+
+	return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// LumaSharpen
+// 移植自 LumaSharpen.hlsl
+
+// 双线性插值的一个采样点。所有像素的采样偏移相同，因此权重只需计算一次
+struct BilinearTap {
+	int dx;
+	int dy;
+	XMFLOAT4 weights;
+};
+
+static BilinearTap MakeBilinearTap(float offsetX, float offsetY) {
+	// 纹理坐标 (x + 0.5 + offsetX) * pt 在纹素空间中对应 x + offsetX
+	float fx = std::floor(offsetX);
+	float fy = std::floor(offsetY);
+	float u = offsetX - fx;
+	float v = offsetY - fy;
+
+	return { (int)fx, (int)fy, XMFLOAT4((1 - u) * (1 - v), u * (1 - v), (1 - u) * v, u * v) };
+}
+
+static XMVECTOR XM_CALLCONV SampleBilinear(const CpuImage& img, int x, int y, const BilinearTap& tap) {
+	const XMFLOAT4* r0 = img.GetRow(y + tap.dy) + x + tap.dx;
+	const XMFLOAT4* r1 = img.GetRow(y + tap.dy + 1) + x + tap.dx;
+
+	XMVECTOR result = XMVectorScale(XMLoadFloat4(&r0[0]), tap.weights.x);
+	result = XMVectorMultiplyAdd(XMLoadFloat4(&r0[1]), XMVectorReplicate(tap.weights.y), result);
+	result = XMVectorMultiplyAdd(XMLoadFloat4(&r1[0]), XMVectorReplicate(tap.weights.z), result);
+	return XMVectorMultiplyAdd(XMLoadFloat4(&r1[1]), XMVectorReplicate(tap.weights.w), result);
+}
+
+// 各采样点相对于中心像素的偏移，返回强度的乘数
+static float GetLumaSharpenOffsets(const CpuSharpen::LumaSharpenParams& params, std::vector<XMFLOAT2>& offsets) {
+	const float bias = params.offsetBias;
+	float strengthMul = 1.0f;
+
+	switch (params.pattern) {
+	case 0:
+		// -- Pattern 1 -- A (fast) 7 tap gaussian using only 2+1 texture fetches.
+		offsets = { { bias / 3.0f, bias / 3.0f }, { -bias / 3.0f, -bias / 3.0f } };
+		strengthMul = 1.5f;
+		break;
+	case 1:
+		// -- Pattern 2 -- A 9 tap gaussian using 4+1 texture fetches.
+		offsets = {
+			{ 0.5f * bias, -0.5f * bias }, { -0.5f * bias, -0.5f * bias },
+			{ 0.5f * bias, 0.5f * bias }, { -0.5f * bias, 0.5f * bias }
+		};
+		break;
+	case 2:
+		// -- Pattern 3 -- An experimental 17 tap gaussian using 4+1 texture fetches.
+		offsets = {
+			{ 0.4f * bias, -1.2f * bias }, { -1.2f * bias, -0.4f * bias },
+			{ 1.2f * bias, 0.4f * bias }, { -0.4f * bias, 1.2f * bias }
+		};
+		strengthMul = 0.51f;
+		break;
+	case 3:
+		// -- Pattern 4 -- A 9 tap high pass (pyramid filter) using 4+1 texture fetches.
+		offsets = { { 0.5f, -bias }, { -bias, -0.5f }, { bias, 0.5f }, { -0.5f, bias } };
+		strengthMul = 0.666f;
+		break;
+	}
+
+	return strengthMul;
+}
+
+// 双线性采样还需要偏移之外的一个像素
+static UINT CalcLumaSharpenRadius(const std::vector<XMFLOAT2>& offsets) {
+	UINT radius = 1;
+	for (const XMFLOAT2& offset : offsets) {
+		radius = std::max(radius, (UINT)std::ceil(std::max(std::abs(offset.x), std::abs(offset.y))) + 1);
+	}
+	return radius;
+}
+
+UINT CpuSharpen::GetLumaSharpenRadius(const LumaSharpenParams& params) {
+	std::vector<XMFLOAT2> offsets;
+	GetLumaSharpenOffsets(params, offsets);
+	return CalcLumaSharpenRadius(offsets);
+}
+
+bool CpuSharpen::LumaSharpen(const CpuImage& src, CpuImage& dst, const LumaSharpenParams& params, UINT bandHeight) {
+	if (params.pattern < 0 || params.pattern > 3) {
+		SPDLOG_LOGGER_ERROR(logger, "pattern 的值非法");
+		return false;
+	}
+
+	if (!PrepareOutput(src, dst)) {
+		return false;
+	}
+
+	std::vector<XMFLOAT2> offsets;
+	const float strengthMul = GetLumaSharpenOffsets(params, offsets);
+
+	std::vector<BilinearTap> taps;
+	for (const XMFLOAT2& offset : offsets) {
+		taps.push_back(MakeBilinearTap(offset.x, offset.y));
+	}
+	const UINT radius = CalcLumaSharpenRadius(offsets);
+
+	CpuImage temp;
+	const CpuImage& input = CpuImageUtils::EnsureBorder(src, radius, temp);
+
+	const XMVECTOR tapScale = XMVectorReplicate(1.0f / taps.size());
+
+	// -- Combining the strength and luma multipliers --
+	const XMVECTOR sharpStrengthLuma = XMVectorScale(
+		XMVectorSet(CpuImageUtils::LUMA_BT709.x, CpuImageUtils::LUMA_BT709.y, CpuImageUtils::LUMA_BT709.z, 0),
+		params.sharpStrength * strengthMul
+	);
+	// Roll part of the clamp into the dot
+	const XMVECTOR sharpStrengthLumaClamp = XMVectorScale(sharpStrengthLuma, 0.5f / params.sharpClamp);
+	const XMVECTOR half = XMVectorReplicate(0.5f);
+	const XMVECTOR sharpClamp = XMVectorReplicate(params.sharpClamp);
+	const XMVECTOR sharpClamp2 = XMVectorReplicate(params.sharpClamp * 2.0f);
+
+	CpuImageUtils::RunPass(dst, bandHeight, LUMA_SHARPEN_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const XMFLOAT4* row = input.GetRow(y);
+			XMFLOAT4* out = dst.GetRow(y);
+
+			for (int x = 0, width = (int)input.GetWidth(); x < width; ++x) {
+				XMVECTOR ori = LoadPixel(row, x);
+
+				XMVECTOR blurOri = g_XMZero;
+				for (const BilinearTap& tap : taps) {
+					blurOri = XMVectorAdd(blurOri, SampleBilinear(input, x, y, tap));
+				}
+				blurOri = XMVectorMultiply(blurOri, tapScale);
+
+				// Subtracting the blurred image from the original image
+				XMVECTOR sharp = XMVectorSubtract(ori, blurOri);
+
+				// Calculate the luma, adjust the strength, scale up and clamp
+				XMVECTOR sharpLuma = XMVectorSaturate(XMVectorAdd(XMVector3Dot(sharp, sharpStrengthLumaClamp), half));
+				// scale down
+				sharpLuma = XMVectorSubtract(XMVectorMultiply(sharpClamp2, sharpLuma), sharpClamp);
+
+				XMVECTOR result = XMVectorSaturate(XMVectorAdd(ori, sharpLuma));
+				XMStoreFloat4(&out[x], XMVectorSetW(result, 1.0f));
+			}
+		}
+	});
+
+	return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// NVSharpen
+// 移植自 NVSharpen.hlsl，每次计算水平相邻的 4 个像素
+
+namespace NVSharpenImpl {
+
+using namespace CpuNISCommon;
+
+struct Consts {
+	XMVECTOR sharpStrengthMin;
+	XMVECTOR sharpStrengthScale;
+	XMVECTOR sharpLimitMin;
+	XMVECTOR sharpLimitScale;
+};
+
+static Consts MakeConsts(float sharpness) {
+	SharpnessConsts consts = MakeSharpnessConsts(sharpness);
+	return {
+		XMVectorReplicate(consts.sharpStrengthMin),
+		XMVectorReplicate(consts.sharpStrengthScale),
+		XMVectorReplicate(consts.sharpLimitMin),
+		XMVectorReplicate(consts.sharpLimitScale)
+	};
+}
+
+static XMVECTOR XM_CALLCONV CalcLTIFast(const XMVECTOR y[5]) {
+	const XMVECTOR a_min = Min3(y[0], y[1], y[2]);
+	const XMVECTOR a_max = Max3(y[0], y[1], y[2]);
+
+	const XMVECTOR b_min = Min3(y[2], y[3], y[4]);
+	const XMVECTOR b_max = Max3(y[2], y[3], y[4]);
+
+	const XMVECTOR a_cont = XMVectorSubtract(a_max, a_min);
+	const XMVECTOR b_cont = XMVectorSubtract(b_max, b_min);
+
+	const XMVECTOR cont_ratio = XMVectorDivide(XMVectorMax(a_cont, b_cont),
+		XMVectorAdd(XMVectorMin(a_cont, b_cont), XMVectorReplicate(kEps * (1.0f / NIS_SCALE_FLOAT))));
+	const XMVECTOR t = XMVectorSaturate(XMVectorScale(XMVectorSubtract(cont_ratio, XMVectorReplicate(kMinContrastRatio)), kRatioNorm));
+	return XMVectorScale(XMVectorSubtract(g_XMOne, t), kContrastBoost);
+}
+
+static XMVECTOR XM_CALLCONV EvalUSM(const XMVECTOR pxl[5], FXMVECTOR sharpnessStrength, FXMVECTOR sharpnessLimit) {
+	// USM profile
+	XMVECTOR y_usm = XMVectorScale(XMVectorAdd(pxl[1], pxl[3]), -0.6001f);
+	y_usm = XMVectorMultiplyAdd(pxl[2], XMVectorReplicate(1.2002f), y_usm);
+	// boost USM profile
+	y_usm = XMVectorMultiply(y_usm, sharpnessStrength);
+	// clamp to the limit
+	y_usm = XMVectorMin(sharpnessLimit, XMVectorMax(XMVectorNegate(sharpnessLimit), y_usm));
+	// reduce ringing
+	return XMVectorMultiply(y_usm, CalcLTIFast(pxl));
+}
+
+static XMVECTOR XM_CALLCONV Avg(FXMVECTOR a, FXMVECTOR b) {
+	return XMVectorScale(XMVectorAdd(a, b), 0.5f);
+}
+
+// 返回 0、90、45、135 度方向的 USM
+static void GetDirUSM(const XMVECTOR p[5][5], const Consts& consts, XMVECTOR result[4]) {
+	// sharpness boost & limit are the same for all directions
+	const XMVECTOR scaleY = XMVectorSubtract(g_XMOne,
+		XMVectorSaturate(XMVectorScale(XMVectorSubtract(p[2][2], XMVectorReplicate(kSharpStartY)), kSharpScaleY)));
+	// scale the ramp to sharpen as a function of luma
+	const XMVECTOR sharpnessStrength = XMVectorMultiplyAdd(scaleY, consts.sharpStrengthScale, consts.sharpStrengthMin);
+	// scale the ramp to limit USM as a function of luma
+	const XMVECTOR sharpnessLimit = XMVectorMultiply(
+		XMVectorMultiplyAdd(scaleY, consts.sharpLimitScale, consts.sharpLimitMin), p[2][2]);
+
+	// 0 deg filter
+	const XMVECTOR interp0Deg[5] = { p[0][2], p[1][2], p[2][2], p[3][2], p[4][2] };
+	result[0] = EvalUSM(interp0Deg, sharpnessStrength, sharpnessLimit);
+
+	// 90 deg filter
+	const XMVECTOR interp90Deg[5] = { p[2][0], p[2][1], p[2][2], p[2][3], p[2][4] };
+	result[1] = EvalUSM(interp90Deg, sharpnessStrength, sharpnessLimit);
+
+	// 45 deg filter
+	const XMVECTOR interp45Deg[5] = { p[1][1], Avg(p[2][1], p[1][2]), p[2][2], Avg(p[3][2], p[2][3]), p[3][3] };
+	result[2] = EvalUSM(interp45Deg, sharpnessStrength, sharpnessLimit);
+
+	// 135 deg filter
+	const XMVECTOR interp135Deg[5] = { p[3][1], Avg(p[3][2], p[2][1]), p[2][2], Avg(p[2][3], p[1][2]), p[1][3] };
+	result[3] = EvalUSM(interp135Deg, sharpnessStrength, sharpnessLimit);
+}
+
+}
+
+bool CpuSharpen::NVSharpen(const CpuImage& src, CpuImage& dst, const NVSharpenParams& params, UINT bandHeight) {
+	using namespace NVSharpenImpl;
+
+	if (!PrepareOutput(src, dst)) {
+		return false;
+	}
+
+	CpuImage temp;
+	const CpuImage& input = CpuImageUtils::EnsureBorder(src, 2, temp);
+
+	CpuPlane luma;
+	if (!CpuImageUtils::ComputeLuma(input, luma)) {
+		return false;
+	}
+
+	const Consts consts = MakeConsts(params.sharpness);
+
+	CpuImageUtils::RunPass(dst, bandHeight, NV_SHARPEN_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const float* rows[5];
+			for (int i = 0; i < 5; ++i) {
+				rows[i] = luma.GetRow(y + i - 2);
+			}
+
+			const XMFLOAT4* inRow = input.GetRow(y);
+			XMFLOAT4* out = dst.GetRow(y);
+
+			for (UINT x = 0, width = input.GetWidth(); x < width; x += 4) {
+				// load 5x5 support to regs
+				XMVECTOR p[5][5];
+				for (int i = 0; i < 5; ++i) {
+					for (int j = 0; j < 5; ++j) {
+						p[i][j] = Load4(rows[i], (int)x + j - 2);
+					}
+				}
+
+				// get directional filter bank output
+				XMVECTOR dirUSM[4];
+				GetDirUSM(p, consts, dirUSM);
+
+				// generate weights for directional filters
+				const XMVECTOR center[3][3] = {
+					{ p[1][1], p[1][2], p[1][3] },
+					{ p[2][1], p[2][2], p[2][3] },
+					{ p[3][1], p[3][2], p[3][3] }
+				};
+				XMVECTOR w[4];
+				GetEdgeMap(center, w);
+
+				// final USM is a weighted sum filter outputs
+				XMFLOAT4 usmY;
+				XMStoreFloat4(&usmY, XMVectorAdd(
+					XMVectorAdd(XMVectorMultiply(dirUSM[0], w[0]), XMVectorMultiply(dirUSM[1], w[1])),
+					XMVectorAdd(XMVectorMultiply(dirUSM[2], w[2]), XMVectorMultiply(dirUSM[3], w[3]))
+				));
+
+				const float* usm = &usmY.x;
+				for (UINT k = 0, n = std::min(4u, width - x); k < n; ++k) {
+					XMVECTOR op = LoadPixel(inRow, x + k);
+					XMStoreFloat4(&out[x + k], XMVectorSelect(op, XMVectorAdd(op, XMVectorReplicate(usm[k])), g_XMSelect1110));
+				}
+			}
+		}
+	});
+
+	return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// AdaptiveSharpen
+// 移植自 AdaptiveSharpen.hlsl
+// 第一个通道将边缘强度和近似 gamma 的亮度分别存入两个单通道图像，
+// 第二个通道只需读取它们和中心像素，无需重复计算 25 个采样点的亮度
+
+namespace AdaptiveSharpenImpl {
+
+constexpr float curveslope = 0.5f;
+
+constexpr float L_overshoot = 0.003f;
+constexpr float L_compr_low = 0.167f;
+constexpr float L_compr_high = 0.334f;
+
+constexpr float D_overshoot = 0.009f;
+constexpr float D_compr_low = 0.250f;
+constexpr float D_compr_high = 0.500f;
+
+constexpr float scale_lim = 0.1f;
+constexpr float scale_cs = 0.056f;
+
+constexpr float dW_lothr = 0.3f;
+constexpr float dW_hithr = 0.8f;
+
+constexpr float lowthr_mxw = 0.1f;
+
+constexpr float pm_p = 0.7f;
+
+// HLSL 版本中边缘强度加上 a_offset 后存储在 alpha 通道中，这里单独存储，因此无需偏移
+
+static float Saturate(float v) {
+	return std::clamp(v, 0.0f, 1.0f);
+}
+
+static float Lerp(float a, float b, float t) {
+	return a + (b - a) * t;
+}
+
+static float Smoothstep(float e0, float e1, float x) {
+	float t = Saturate((x - e0) / (e1 - e0));
+	return t * t * (3 - 2 * t);
+}
+
+// Soft if, fast linear approx
+static float SoftIf(float a, float b, float c, float maxedge) {
+	return Saturate((a + b + c + 0.056f) / (std::abs(maxedge) + 0.03f) - 0.85f);
+}
+
+// Soft limit, modified tanh
+static float SoftLim(float v, float s) {
+	float t = std::exp(2 * std::min(std::abs(v), s * 24) / s);
+	return (t - 1) / (t + 1) * s;
+}
+
+// Weighted power mean
+static float WPMean(float a, float b, float w) {
+	return std::pow(w * std::pow(std::abs(a), pm_p) + std::abs(1 - w) * std::pow(std::abs(b), pm_p), 1.0f / pm_p);
+}
+
+// 采样点的偏移
+// [                c22               ]
+// [           c24, c9,  c23          ]
+// [      c21, c1,  c2,  c3, c18      ]
+// [ c19, c10, c4,  c0,  c5, c11, c16 ]
+// [      c20, c6,  c7,  c8, c17      ]
+// [           c15, c12, c14          ]
+// [                c13               ]
+constexpr int OFFSETS[25][2] = {
+	{ 0, 0 }, { -1,-1 }, { 0,-1 }, { 1,-1 }, { -1, 0 },
+	{ 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 }, { 0,-2 },
+	{ -2, 0 }, { 2, 0 }, { 0, 2 }, { 0, 3 }, { 1, 2 },
+	{ -1, 2 }, { 3, 0 }, { 2, 1 }, { 2,-1 }, { -3, 0 },
+	{ -2, 1 }, { -2,-1 }, { 0,-3 }, { 1,-2 }, { -1,-2 }
+};
+
+}
+
+bool CpuSharpen::AdaptiveSharpen(const CpuImage& src, CpuImage& dst, const AdaptiveSharpenParams& params, UINT bandHeight) {
+	using namespace AdaptiveSharpenImpl;
+
+	if (!PrepareOutput(src, dst)) {
+		return false;
+	}
+
+	CpuImage temp;
+	const CpuImage& input = CpuImageUtils::EnsureBorder(src, 2, temp);
+
+	CpuPlane edgePlane;
+	CpuPlane lumaPlane;
+	if (!PreparePlane(input, edgePlane) || !PreparePlane(input, lumaPlane)) {
+		SPDLOG_LOGGER_ERROR(logger, "创建中间图像失败");
+		return false;
+	}
+	assert(edgePlane.GetBorder() >= 3);
+
+	// 第一个通道：边缘检测
+	{
+		const XMVECTOR ctlCoef = XMVectorSet(0.2558f, 0.6511f, 0.0931f, 0);
+		const XMVECTOR cCompCoef = XMVectorReplicate(-37.0f / 15.0f);
+
+		CpuImageUtils::RunPass(edgePlane, bandHeight, ADAPTIVE_SHARPEN_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+			for (UINT y = yBegin; y < yEnd; ++y) {
+				const XMFLOAT4* r[5];
+				for (int i = 0; i < 5; ++i) {
+					r[i] = input.GetRow(y + i - 2);
+				}
+
+				float* edgeRow = edgePlane.GetRow(y);
+				float* lumaRow = lumaPlane.GetRow(y);
+
+				for (int x = 0, width = (int)input.GetWidth(); x < width; ++x) {
+					// [                c9                ]
+					// [           c1,  c2,  c3           ]
+					// [      c10, c4,  c0,  c5, c11      ]
+					// [           c6,  c7,  c8           ]
+					// [                c12               ]
+					const XMVECTOR c0 = LoadPixel(r[2], x);
+					const XMVECTOR c1 = LoadPixel(r[1], x - 1);
+					const XMVECTOR c2 = LoadPixel(r[1], x);
+					const XMVECTOR c3 = LoadPixel(r[1], x + 1);
+					const XMVECTOR c4 = LoadPixel(r[2], x - 1);
+					const XMVECTOR c5 = LoadPixel(r[2], x + 1);
+					const XMVECTOR c6 = LoadPixel(r[3], x - 1);
+					const XMVECTOR c7 = LoadPixel(r[3], x);
+					const XMVECTOR c8 = LoadPixel(r[3], x + 1);
+					const XMVECTOR c9 = LoadPixel(r[0], x);
+					const XMVECTOR c10 = LoadPixel(r[2], x - 2);
+					const XMVECTOR c11 = LoadPixel(r[2], x + 2);
+					const XMVECTOR c12 = LoadPixel(r[4], x);
+
+					// Blur, gauss 3x3
+					XMVECTOR cross = XMVectorAdd(XMVectorAdd(c2, c4), XMVectorAdd(c5, c7));
+					XMVECTOR diag = XMVectorAdd(XMVectorAdd(c1, c3), XMVectorAdd(c6, c8));
+					XMVECTOR blur = XMVectorScale(XMVectorAdd(XMVectorAdd(XMVectorScale(cross, 2), diag), XMVectorScale(c0, 4)), 1.0f / 16);
+
+					// Contrast compression, center = 0.5, scaled to 1/3
+					float c_comp = Saturate(4.0f / 15.0f + 0.9f * std::exp2(XMVectorGetX(XMVector3Dot(blur, cCompCoef))));
+
+					// Edge detection
+					XMVECTOR e = XMVectorScale(XMVectorAbs(XMVectorSubtract(blur, c0)), 1.38f);
+					e = XMVectorMultiplyAdd(XMVectorReplicate(1.15f), XMVectorAdd(
+						XMVectorAdd(XMVectorAbs(XMVectorSubtract(blur, c2)), XMVectorAbs(XMVectorSubtract(blur, c4))),
+						XMVectorAdd(XMVectorAbs(XMVectorSubtract(blur, c5)), XMVectorAbs(XMVectorSubtract(blur, c7)))), e);
+					e = XMVectorMultiplyAdd(XMVectorReplicate(0.92f), XMVectorAdd(
+						XMVectorAdd(XMVectorAbs(XMVectorSubtract(blur, c1)), XMVectorAbs(XMVectorSubtract(blur, c3))),
+						XMVectorAdd(XMVectorAbs(XMVectorSubtract(blur, c6)), XMVectorAbs(XMVectorSubtract(blur, c8)))), e);
+					e = XMVectorMultiplyAdd(XMVectorReplicate(0.23f), XMVectorAdd(
+						XMVectorAdd(XMVectorAbs(XMVectorSubtract(blur, c9)), XMVectorAbs(XMVectorSubtract(blur, c10))),
+						XMVectorAdd(XMVectorAbs(XMVectorSubtract(blur, c11)), XMVectorAbs(XMVectorSubtract(blur, c12)))), e);
+
+					edgeRow[x] = XMVectorGetX(XMVector3Length(e)) * c_comp;
+
+					// Colour to luma, fast approx gamma, avg of rec. 709 & 601 luma coeffs
+					XMVECTOR sq = XMVectorSaturate(XMVectorMultiply(c0, XMVectorAbs(c0)));
+					lumaRow[x] = std::sqrt(XMVectorGetX(XMVector3Dot(ctlCoef, sq)));
+				}
+			}
+
+			lumaPlane.ExtendRowBorder(yBegin, yEnd);
+		});
+
+		lumaPlane.ExtendVerticalBorder();
+	}
+
+	// 第二个通道：锐化
+	const float curveHeight = params.curveHeight;
+
+	CpuImageUtils::RunPass(dst, bandHeight, ADAPTIVE_SHARPEN_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+		const float* edgeRows[7];
+		const float* lumaRows[7];
+
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			for (int i = 0; i < 7; ++i) {
+				edgeRows[i] = edgePlane.GetRow(y + i - 3);
+				lumaRows[i] = lumaPlane.GetRow(y + i - 3);
+			}
+
+			const XMFLOAT4* inRow = input.GetRow(y);
+			XMFLOAT4* out = dst.GetRow(y);
+
+			for (int x = 0, width = (int)input.GetWidth(); x < width; ++x) {
+				float edge[25];
+				float luma[25];
+				for (int k = 0; k < 25; ++k) {
+					edge[k] = edgeRows[OFFSETS[k][1] + 3][x + OFFSETS[k][0]];
+					luma[k] = lumaRows[OFFSETS[k][1] + 3][x + OFFSETS[k][0]];
+				}
+
+				// clip out of range colour data in c[0]
+				const XMVECTOR c0 = XMVectorSaturate(LoadPixel(inRow, x));
+				const float c_edge = edge[0];
+
+				// Allow for higher overshoot if the current edge pixel is surrounded by similar edge pixels
+				float maxedge = edge[0];
+				for (int k = 1; k <= 12; ++k) {
+					maxedge = std::max(maxedge, edge[k]);
+				}
+
+				// [          x          ]
+				// [       z, x, w       ]
+				// [    z, z, x, w, w    ]
+				// [ y, y, y, 0, y, y, y ]
+				// [    w, w, x, z, z    ]
+				// [       w, x, z       ]
+				// [          x          ]
+				float sbe = SoftIf(edge[2], edge[9], edge[22], maxedge) * SoftIf(edge[7], edge[12], edge[13], maxedge)  // x dir
+					+ SoftIf(edge[4], edge[10], edge[19], maxedge) * SoftIf(edge[5], edge[11], edge[16], maxedge)  // y dir
+					+ SoftIf(edge[1], edge[24], edge[21], maxedge) * SoftIf(edge[8], edge[14], edge[17], maxedge)  // z dir
+					+ SoftIf(edge[3], edge[23], edge[18], maxedge) * SoftIf(edge[6], edge[20], edge[15], maxedge); // w dir
+
+				const float csT = Smoothstep(2, 3.1f, sbe);
+				const float csX = Lerp(L_compr_low, L_compr_high, csT);
+				const float csY = Lerp(D_compr_low, D_compr_high, csT);
+
+				const float c0_Y = luma[0];
+
+				// Pre-calculated default squared kernel weights
+				// Transition to a concave kernel if the center edge val is above thr
+				const float dWT = Smoothstep(dW_lothr, dW_hithr, c_edge);
+				float dWx = Lerp(0.5f, 0.86602540378f, dWT);
+				float dWy = 1.0f;
+				float dWz = Lerp(1.41421356237f, 0.54772255751f, dWT);
+				dWx *= dWx;
+				dWz *= dWz;
+
+				const float mdiff_c0 = 0.02f + 3 * (std::abs(luma[0] - luma[2]) + std::abs(luma[0] - luma[4])
+					+ std::abs(luma[0] - luma[5]) + std::abs(luma[0] - luma[7])
+					+ 0.25f * (std::abs(luma[0] - luma[1]) + std::abs(luma[0] - luma[3])
+						+ std::abs(luma[0] - luma[6]) + std::abs(luma[0] - luma[8])));
+
+				// Center pixel diff
+				auto mdiff = [&luma](int a, int b, int c, int d, int e, int f, int g) {
+					return std::abs(luma[g] - luma[a]) + std::abs(luma[g] - luma[b])
+						+ std::abs(luma[g] - luma[c]) + std::abs(luma[g] - luma[d])
+						+ 0.5f * (std::abs(luma[g] - luma[e]) + std::abs(luma[g] - luma[f]));
+				};
+
+				// Use lower weights for pixels in a more active area relative to center pixel area
+				// This results in narrower and less visible overshoots around sharp edges
+				float weights[12] = {
+					std::min(mdiff_c0 / mdiff(24, 21, 2, 4, 9, 10, 1), dWy),   // c1
+					dWx,                                                    // c2
+					std::min(mdiff_c0 / mdiff(23, 18, 5, 2, 9, 11, 3), dWy),   // c3
+					dWx,                                                    // c4
+					dWx,                                                    // c5
+					std::min(mdiff_c0 / mdiff(4, 20, 15, 7, 10, 12, 6), dWy),   // c6
+					dWx,                                                    // c7
+					std::min(mdiff_c0 / mdiff(5, 7, 17, 14, 12, 11, 8), dWy),   // c8
+					std::min(mdiff_c0 / mdiff(2, 24, 23, 22, 1, 3, 9), dWz),   // c9
+					std::min(mdiff_c0 / mdiff(20, 19, 21, 4, 1, 6, 10), dWz),   // c10
+					std::min(mdiff_c0 / mdiff(17, 5, 18, 16, 3, 8, 11), dWz),   // c11
+					std::min(mdiff_c0 / mdiff(13, 15, 7, 14, 6, 8, 12), dWz)    // c12
+				};
+
+				weights[0] = (std::max(std::max((weights[8] + weights[9]) / 4, weights[0]), 0.25f) + weights[0]) / 2;
+				weights[2] = (std::max(std::max((weights[8] + weights[10]) / 4, weights[2]), 0.25f) + weights[2]) / 2;
+				weights[5] = (std::max(std::max((weights[9] + weights[11]) / 4, weights[5]), 0.25f) + weights[5]) / 2;
+				weights[7] = (std::max(std::max((weights[10] + weights[11]) / 4, weights[7]), 0.25f) + weights[7]) / 2;
+
+				// Calculate the negative part of the laplace kernel and the low threshold weight
+				float lowthrsum = 0;
+				float weightsum = 0;
+				float neg_laplace = 0;
+
+				for (int pix = 0; pix < 12; ++pix) {
+					float t = Saturate((edge[pix + 1] - 0.01f) / (lowthr_mxw - 0.01f));
+					float lowthr = t * t * (2.97f - 1.98f * t) + 0.01f; // t*t*(3 - a*3 - (2 - a*2)*t) + a
+
+					neg_laplace += std::pow(luma[pix + 1] + 0.06f, 2.4f) * (weights[pix] * lowthr);
+					weightsum += weights[pix] * lowthr;
+					lowthrsum += lowthr / 12;
+				}
+
+				neg_laplace = std::pow(std::abs(neg_laplace / weightsum), (1.0f / 2.4f)) - 0.06f;
+
+				// Compute sharpening magnitude function
+				float sharpen_val = curveHeight / (curveHeight * curveslope * std::pow(std::abs(c_edge), 3.5f) + 0.625f);
+
+				// Calculate sharpening diff and scale
+				float sharpdiff = (c0_Y - neg_laplace) * (lowthrsum * sharpen_val + 0.01f);
+
+				// Calculate local near min & max, partial sort
+				for (int i = 0; i < 3; ++i) {
+					float temp;
+
+					for (int j = i; j < 24 - i; j += 2) {
+						temp = luma[j];
+						luma[j] = std::min(luma[j], luma[j + 1]);
+						luma[j + 1] = std::max(temp, luma[j + 1]);
+					}
+
+					for (int jj = 24 - i; jj > i; jj -= 2) {
+						temp = luma[i];
+						luma[i] = std::min(luma[i], luma[jj]);
+						luma[jj] = std::max(temp, luma[jj]);
+
+						temp = luma[24 - i];
+						luma[24 - i] = std::max(luma[24 - i], luma[jj - 1]);
+						luma[jj - 1] = std::min(temp, luma[jj - 1]);
+					}
+				}
+
+				float nmax = (std::max(luma[22] + luma[23] * 2, c0_Y * 3) + luma[24]) / 4;
+				float nmin = (std::min(luma[2] + luma[1] * 2, c0_Y * 3) + luma[0]) / 4;
+
+				// Calculate tanh scale factors
+				float min_dist = std::min(std::abs(nmax - c0_Y), std::abs(c0_Y - nmin));
+				float pos_scale = min_dist + std::min(L_overshoot, 1.0001f - min_dist - c0_Y);
+				float neg_scale = min_dist + std::min(D_overshoot, 0.0001f + c0_Y - min_dist);
+
+				pos_scale = std::min(pos_scale, scale_lim * (1 - scale_cs) + pos_scale * scale_cs);
+				neg_scale = std::min(neg_scale, scale_lim * (1 - scale_cs) + neg_scale * scale_cs);
+
+				// Soft limited anti-ringing with tanh, wpmean to control compression slope
+				sharpdiff = WPMean(std::max(sharpdiff, 0.0f), SoftLim(std::max(sharpdiff, 0.0f), pos_scale), csX)
+					- WPMean(std::min(sharpdiff, 0.0f), SoftLim(std::min(sharpdiff, 0.0f), neg_scale), csY);
+
+				// Compensate for saturation loss/gain while making pixels brighter/darker
+				float sharpdiff_lim = Saturate(c0_Y + sharpdiff) - c0_Y;
+				float satmul = (c0_Y + std::max(sharpdiff_lim * 0.9f, sharpdiff_lim) * 1.03f + 0.03f) / (c0_Y + 0.03f);
+
+				XMVECTOR res = XMVectorReplicate(c0_Y + (sharpdiff_lim * 3 + sharpdiff) / 4);
+				res = XMVectorMultiplyAdd(XMVectorSubtract(c0, XMVectorReplicate(c0_Y)), XMVectorReplicate(satmul), res);
+
+				XMStoreFloat4(&out[x], XMVectorSetW(res, 1.0f));
+			}
+		}
+	});
+
+	return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// FineSharp
+// 移植自 FineSharp.hlsl
+// 除了颜色空间转换，所有通道只处理 Y 分量，因此 Y、U、V 分别存储在单通道图像中，
+// 中间通道每次计算水平相邻的 4 个像素
+
+namespace FineSharpImpl {
+
+constexpr float lstr = 1.49f;	// Modifier for non-linear sharpening
+constexpr float pstr = 1.272f;	// Exponent for non-linear sharpening
+
+// 比较交换，执行后 a 为较小值，b 为较大值
+static void XM_CALLCONV Sort(XMVECTOR& a, XMVECTOR& b) {
+	XMVECTOR t = XMVectorMin(a, b);
+	b = XMVectorMax(a, b);
+	a = t;
+}
+
+static XMVECTOR XM_CALLCONV Median3(XMVECTOR& a1, XMVECTOR& a2, XMVECTOR& a3) {
+	Sort(a2, a3);
+	Sort(a1, a2);
+	return XMVectorMin(a2, a3);
+}
+
+static XMVECTOR XM_CALLCONV Median5(XMVECTOR& a1, XMVECTOR& a2, XMVECTOR& a3, XMVECTOR& a4, XMVECTOR& a5) {
+	Sort(a1, a2);
+	Sort(a3, a4);
+	Sort(a1, a3);
+	Sort(a2, a4);
+	return Median3(a2, a3, a5);
+}
+
+static XMVECTOR Median9(XMVECTOR a[9]) {
+	Sort(a[0], a[1]);
+	Sort(a[2], a[3]);
+	Sort(a[4], a[5]);
+	Sort(a[6], a[7]);
+	Sort(a[0], a[2]);
+	Sort(a[4], a[6]);
+	Sort(a[0], a[4]);
+	Sort(a[2], a[4]);
+	Sort(a[2], a[6]);
+	Sort(a[1], a[3]);
+	Sort(a[5], a[7]);
+	Sort(a[3], a[7]);
+	Sort(a[3], a[5]);
+	Sort(a[1], a[5]);
+	return Median5(a[1], a[3], a[4], a[6], a[8]);
+}
+
+// sort9_partial2：将最小和最大的两个值排到两端
+static void Sort9Partial2(XMVECTOR a[9]) {
+	// sort_min_max9
+	Sort(a[0], a[1]);
+	Sort(a[2], a[3]);
+	Sort(a[4], a[5]);
+	Sort(a[6], a[7]);
+	Sort(a[0], a[2]);
+	Sort(a[4], a[6]);
+	Sort(a[0], a[4]);
+	Sort(a[1], a[3]);
+	Sort(a[5], a[6]);
+	Sort(a[3], a[7]);
+	Sort(a[0], a[8]);
+	Sort(a[7], a[8]);
+	// sort_min_max7
+	Sort(a[1], a[2]);
+	Sort(a[3], a[4]);
+	Sort(a[5], a[6]);
+	Sort(a[1], a[3]);
+	Sort(a[1], a[5]);
+	Sort(a[2], a[6]);
+	Sort(a[4], a[5]);
+	Sort(a[1], a[7]);
+	Sort(a[6], a[7]);
+}
+
+// 读取 3x3 邻域
+static void XM_CALLCONV Load3x3(const float* const rows[3], int x, XMVECTOR result[9]) {
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			result[i * 3 + j] = Load4(rows[i], x + j - 1);
+		}
+	}
+}
+
+static XMMATRIX RGBToYUV(float Kb, float Kr) {
+	// HLSL 中的 float3x3 按行存储，转置后用于 XMVector3TransformNormal
+	return XMMatrixTranspose(XMMATRIX(
+		Kr, 1 - Kr - Kb, Kb, 0,
+		-Kr / (2 * (1 - Kb)), (Kr + Kb - 1) / (2 * (1 - Kb)), (1 - Kb) / (2 * (1 - Kb)), 0,
+		(1 - Kr) / (2 * (1 - Kr)), (Kr + Kb - 1) / (2 * (1 - Kr)), -Kb / (2 * (1 - Kr)), 0,
+		0, 0, 0, 1
+	));
+}
+
+static XMMATRIX YUVToRGB(float Kb, float Kr) {
+	return XMMatrixTranspose(XMMATRIX(
+		1, 0, 2 * (1 - Kr), 0,
+		1, 2 * (1 - Kb) * Kb / (Kb + Kr - 1), 2 * Kr * (1 - Kr) / (Kb + Kr - 1), 0,
+		1, 2 * (1 - Kb), 0, 0,
+		0, 0, 0, 1
+	));
+}
+
+}
+
+bool CpuSharpen::FineSharp(const CpuImage& src, CpuImage& dst, const FineSharpParams& params, UINT bandHeight) {
+	using namespace FineSharpImpl;
+
+	if (!PrepareOutput(src, dst)) {
+		return false;
+	}
+
+	CpuPlane yPlane, uPlane, vPlane, tex1, tex2;
+	if (!PreparePlane(src, yPlane) || !PreparePlane(src, uPlane) || !PreparePlane(src, vPlane)
+		|| !PreparePlane(src, tex1) || !PreparePlane(src, tex2)) {
+		SPDLOG_LOGGER_ERROR(logger, "创建中间图像失败");
+		return false;
+	}
+
+	const UINT width = src.GetWidth();
+	const bool isSD = (params.referenceHeight ? params.referenceHeight : src.GetHeight()) <= 576;
+	const float Kb = isSD ? 0.114f : 0.0722f;
+	const float Kr = isSD ? 0.299f : 0.2126f;
+
+	auto getRows = [](const CpuPlane& plane, UINT y, const float* rows[3]) {
+		for (int i = 0; i < 3; ++i) {
+			rows[i] = plane.GetRow(y + i - 1);
+		}
+	};
+
+	// Pass 1：RGB -> YUV
+	{
+		const XMMATRIX m = RGBToYUV(Kb, Kr);
+		const XMVECTOR offset = XMVectorSet(0.0f, 0.5f, 0.5f, 0.0f);
+
+		CpuImageUtils::RunPass(yPlane, bandHeight, FINE_SHARP_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+			for (UINT y = yBegin; y < yEnd; ++y) {
+				const XMFLOAT4* in = src.GetRow(y);
+				float* yRow = yPlane.GetRow(y);
+				float* uRow = uPlane.GetRow(y);
+				float* vRow = vPlane.GetRow(y);
+
+				for (UINT x = 0; x < width; ++x) {
+					XMFLOAT4 yuv;
+					XMStoreFloat4(&yuv, XMVectorAdd(XMVector3TransformNormal(LoadPixel(in, x), m), offset));
+					yRow[x] = yuv.x;
+					uRow[x] = yuv.y;
+					vRow[x] = yuv.z;
+				}
+			}
+		});
+	}
+
+	// Pass 2：3x3 高斯模糊
+	CpuImageUtils::RunPass(tex1, bandHeight, FINE_SHARP_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const float* rows[3];
+			getRows(yPlane, y, rows);
+
+			ForEach4(tex1.GetRow(y), width, [&](int x) {
+				XMVECTOR t[9];
+				Load3x3(rows, x, t);
+
+				XMVECTOR o = XMVectorAdd(t[4], t[4]);
+				o = XMVectorAdd(o, XMVectorAdd(XMVectorAdd(t[1], t[3]), XMVectorAdd(t[5], t[7])));
+				o = XMVectorAdd(o, o);
+				o = XMVectorAdd(o, XMVectorAdd(XMVectorAdd(t[0], t[2]), XMVectorAdd(t[6], t[8])));
+				return XMVectorScale(o, 0.0625f);
+			});
+		}
+	});
+
+	// Pass 3：3x3 中值滤波
+	CpuImageUtils::RunPass(tex2, bandHeight, FINE_SHARP_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const float* rows[3];
+			getRows(tex1, y, rows);
+
+			ForEach4(tex2.GetRow(y), width, [&](int x) {
+				XMVECTOR t[9];
+				Load3x3(rows, x, t);
+				return Median9(t);
+			});
+		}
+	});
+
+	// Pass 4：非线性锐化和均衡
+	// 先计算每个像素的 SharpDiff 存入 tex1，再计算结果存入 tex2
+	{
+		const float sstr = params.sstr;
+		const float ldmp = sstr + 0.1f;	// "Low damp", to not over-enhance very small differences (noise coming out of flat areas)
+		const XMVECTOR k1 = XMVectorReplicate(sstr / 255.0f);
+		const XMVECTOR k2 = XMVectorReplicate(1.0f / (lstr / 255.0f));
+		const XMVECTOR k3 = XMVectorReplicate(1.0f / pstr);
+		const XMVECTOR k4 = XMVectorReplicate(ldmp / (255.0f * 255.0f));
+
+		CpuImageUtils::RunPass(tex1, bandHeight, FINE_SHARP_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+			for (UINT y = yBegin; y < yEnd; ++y) {
+				const float* yRow = yPlane.GetRow(y);
+				const float* blurRow = tex2.GetRow(y);
+
+				ForEach4(tex1.GetRow(y), width, [&](int x) {
+					XMVECTOR t = XMVectorSubtract(Load4(yRow, x), Load4(blurRow, x));
+					XMVECTOR sign = XMVectorSubtract(
+						XMVectorAndInt(XMVectorGreater(t, g_XMZero), g_XMOne),
+						XMVectorAndInt(XMVectorLess(t, g_XMZero), g_XMOne)
+					);
+					XMVECTOR t2 = XMVectorMultiply(t, t);
+					XMVECTOR result = XMVectorMultiply(sign, k1);
+					result = XMVectorMultiply(result, XMVectorPow(XMVectorMultiply(XMVectorAbs(t), k2), k3));
+					return XMVectorMultiply(result, XMVectorDivide(t2, XMVectorAdd(t2, k4)));
+				});
+			}
+		});
+
+		const XMVECTOR cstr = XMVectorReplicate(params.cstr);
+
+		CpuImageUtils::RunPass(tex2, bandHeight, FINE_SHARP_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+			for (UINT y = yBegin; y < yEnd; ++y) {
+				const float* rows[3];
+				getRows(tex1, y, rows);
+				const float* yRow = yPlane.GetRow(y);
+
+				ForEach4(tex2.GetRow(y), width, [&](int x) {
+					XMVECTOR t[9];
+					Load3x3(rows, x, t);
+
+					XMVECTOR o = XMVectorAdd(Load4(yRow, x), t[4]);
+					XMVECTOR sd = XMVectorAdd(t[4], t[4]);
+					sd = XMVectorAdd(sd, XMVectorAdd(XMVectorAdd(t[1], t[3]), XMVectorAdd(t[5], t[7])));
+					sd = XMVectorAdd(sd, sd);
+					sd = XMVectorAdd(sd, XMVectorAdd(XMVectorAdd(t[0], t[2]), XMVectorAdd(t[6], t[8])));
+					sd = XMVectorScale(sd, 0.0625f);
+					return XMVectorNegativeMultiplySubtract(cstr, sd, o);
+				});
+			}
+		});
+	}
+
+	// Pass 5：XSharpen，存入 tex1
+	CpuImageUtils::RunPass(tex1, bandHeight, FINE_SHARP_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+		const XMVECTOR k = XMVectorReplicate(9.9f);
+
+		for (UINT y = yBegin; y < yEnd; ++y) {
+			const float* rows[3];
+			getRows(tex2, y, rows);
+
+			ForEach4(tex1.GetRow(y), width, [&](int x) {
+				XMVECTOR t[9];
+				Load3x3(rows, x, t);
+
+				const XMVECTOR a = t[4];
+				XMVECTOR o = XMVectorAdd(XMVectorAdd(XMVectorAdd(t[0], t[1]), XMVectorAdd(t[2], t[3])),
+					XMVectorAdd(XMVectorAdd(t[5], t[6]), XMVectorAdd(t[7], t[8])));
+				o = XMVectorScale(XMVectorAdd(o, a), 1.0f / 9.0f);
+				o = XMVectorMultiplyAdd(k, XMVectorSubtract(a, o), a);
+
+				Sort9Partial2(t);
+				o = XMVectorMax(o, XMVectorMin(t[1], a));
+				return XMVectorMin(o, XMVectorMax(t[7], a));
+			});
+		}
+	});
+
+	// Pass 6：根据边缘混合，YUV -> RGB
+	{
+		const XMMATRIX m = YUVToRGB(Kb, Kr);
+		const XMVECTOR xstr = XMVectorReplicate(params.xstr);
+		const XMVECTOR xrep = XMVectorReplicate(params.xrep);
+
+		CpuImageUtils::RunPass(dst, bandHeight, FINE_SHARP_BYTES_PER_PIXEL, [&](UINT yBegin, UINT yEnd) {
+			for (UINT y = yBegin; y < yEnd; ++y) {
+				const float* rows[3];
+				getRows(tex1, y, rows);
+				const float* sharpRow = tex2.GetRow(y);
+				const float* uRow = uPlane.GetRow(y);
+				const float* vRow = vPlane.GetRow(y);
+				XMFLOAT4* out = dst.GetRow(y);
+
+				for (UINT x = 0; x < width; x += 4) {
+					XMVECTOR t[9];
+					Load3x3(rows, (int)x, t);
+
+					XMVECTOR edge = XMVectorAdd(XMVectorAdd(t[1], t[3]), XMVectorAdd(t[5], t[7]));
+					edge = XMVectorAbs(XMVectorNegativeMultiplySubtract(XMVectorReplicate(4.0f), t[4], edge));
+					XMVECTOR weight = XMVectorMultiply(xstr, XMVectorSubtract(g_XMOne, XMVectorSaturate(XMVectorMultiply(edge, xrep))));
+
+					XMFLOAT4 luma;
+					XMStoreFloat4(&luma, XMVectorLerpV(Load4(sharpRow, x), t[4], weight));
+
+					const float* l = &luma.x;
+					for (UINT k = 0, n = std::min(4u, width - x); k < n; ++k) {
+						XMVECTOR yuv = XMVectorSet(l[k], uRow[x + k] - 0.5f, vRow[x + k] - 0.5f, 0);
+						XMStoreFloat4(&out[x + k], XMVectorSetW(XMVector3TransformNormal(yuv, m), 1.0f));
+					}
+				}
+			}
+		});
+	}
+
+	return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmark
+
+void CpuSharpen::Benchmark(UINT width, UINT height, UINT iterations) {
+	// 合成测试图像：平滑渐变上叠加硬边缘和噪声，使各算法的分支都能被覆盖
+	CpuImage src;
+	if (!src.Create(width, height)) {
+		SPDLOG_LOGGER_ERROR(logger, "创建测试图像失败");
+		return;
+	}
+
+	UINT seed = 12345;
+	auto random = [&seed]() {
+		seed = seed * 1664525 + 1013904223;
+		return (seed >> 8) / float(1 << 24);
+	};
+
+	for (UINT y = 0; y < height; ++y) {
+		XMFLOAT4* row = src.GetRow(y);
+		for (UINT x = 0; x < width; ++x) {
+			float base = ((x / 64 + y / 64) % 2) ? 0.75f : 0.25f;
+			float grad = float(x) / width * 0.2f;
+			row[x] = XMFLOAT4(
+				std::clamp(base + grad + (random() - 0.5f) * 0.1f, 0.0f, 1.0f),
+				std::clamp(base - grad + (random() - 0.5f) * 0.1f, 0.0f, 1.0f),
+				std::clamp(base + (random() - 0.5f) * 0.1f, 0.0f, 1.0f),
+				1.0f
+			);
+		}
+	}
+	src.ExtendBorder();
+
+	const UINT threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	const size_t l2Size = CpuImageUtils::GetL2CacheSize();
+	SPDLOG_LOGGER_INFO(logger, fmt::format("CPU 锐化基准测试：{}x{}，{} 次迭代，{} 线程，L2 缓存 {} KB",
+		width, height, iterations, threadCount, l2Size / 1024));
+
+	CpuImage dst;
+
+	auto run = [&](const char* name, size_t bytesPerPixel, const std::function<bool(UINT)>& func) {
+		struct {
+			const char* desc;
+			UINT bandHeight;
+		} modes[] = {
+			{ "L2 条带", CpuImageUtils::CalcBandHeight(width * bytesPerPixel) },
+			{ "每线程一个条带", (height + threadCount - 1) / threadCount }
+		};
+
+		for (const auto& mode : modes) {
+			// 预热，同时分配输出图像
+			if (!func(mode.bandHeight)) {
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("{} 执行失败", name));
+				return;
+			}
+
+			int us = Utils::Measure([&]() {
+				for (UINT i = 0; i < iterations; ++i) {
+					func(mode.bandHeight);
+				}
+			});
+
+			double mps = double(width) * height * iterations / std::max(us, 1);
+			size_t bandBytes = size_t(width) * bytesPerPixel * mode.bandHeight;
+			SPDLOG_LOGGER_INFO(logger, fmt::format("{}（{}）：{:.1f} MP/s，{:.2f} ms/帧，条带高度 {}，条带工作集 {} KB（L2 的 {:.0f}%）",
+				name, mode.desc, mps, us / 1000.0 / iterations, mode.bandHeight, bandBytes / 1024, bandBytes * 100.0 / l2Size));
+		}
+	};
+
+	run("CAS", CAS_BYTES_PER_PIXEL, [&](UINT bandHeight) {
+		return CAS(src, dst, {}, bandHeight);
+	});
+	run("LumaSharpen", LUMA_SHARPEN_BYTES_PER_PIXEL, [&](UINT bandHeight) {
+		return LumaSharpen(src, dst, {}, bandHeight);
+	});
+	run("NVSharpen", NV_SHARPEN_BYTES_PER_PIXEL, [&](UINT bandHeight) {
+		return NVSharpen(src, dst, {}, bandHeight);
+	});
+	run("AdaptiveSharpen", ADAPTIVE_SHARPEN_BYTES_PER_PIXEL, [&](UINT bandHeight) {
+		return AdaptiveSharpen(src, dst, {}, bandHeight);
+	});
+	run("FineSharp", FINE_SHARP_BYTES_PER_PIXEL, [&](UINT bandHeight) {
+		return FineSharp(src, dst, {}, bandHeight);
+	});
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "pch.h"
+#include "CpuImage.h"
+
+
+// 锐化效果的 CPU 实现，用于没有可用 GPU 的场景（如批处理）
+// 算法和常量与 Effects 文件夹中同名的 HLSL 效果保持一致，参数的名称和默认值也相同
+// 所有函数均按行切分为条带并行执行，bandHeight 为 0 时自动选择能放入 L2 缓存的条带高度
+class CpuSharpen {
+public:
+	struct CASParams {
+		float sharpness = 0.4f;
+	};
+
+	struct LumaSharpenParams {
+		float sharpStrength = 0.65f;
+		float sharpClamp = 0.035f;
+		// 0 : Fast
+		// 1 : Normal
+		// 2 : Wider
+		// 3 : Pyramid shaped
+		int pattern = 1;
+		float offsetBias = 1.0f;
+	};
+
+	struct NVSharpenParams {
+		float sharpness = 0.5f;
+	};
+
+	struct AdaptiveSharpenParams {
+		float curveHeight = 1.0f;
+	};
+
+	struct FineSharpParams {
+		float sstr = 2.0f;
+		float cstr = 0.9f;
+		float xstr = 0.19f;
+		float xrep = 0.25f;
+		// 根据此高度选择 BT.601 或 BT.709 系数，为 0 时使用 src 的高度
+		// 分块处理时应设为整张图像的高度，否则各块的颜色可能不一致
+		UINT referenceHeight = 0;
+	};
+
+	// src 和 dst 不能是同一个图像
+	static bool CAS(const CpuImage& src, CpuImage& dst, const CASParams& params = {}, UINT bandHeight = 0);
+
+	static bool LumaSharpen(const CpuImage& src, CpuImage& dst, const LumaSharpenParams& params = {}, UINT bandHeight = 0);
+
+	// LumaSharpen 的采样半径取决于 pattern 和 offsetBias
+	static UINT GetLumaSharpenRadius(const LumaSharpenParams& params);
+
+	static bool NVSharpen(const CpuImage& src, CpuImage& dst, const NVSharpenParams& params = {}, UINT bandHeight = 0);
+
+	static bool AdaptiveSharpen(const CpuImage& src, CpuImage& dst, const AdaptiveSharpenParams& params = {}, UINT bandHeight = 0);
+
+	static bool FineSharp(const CpuImage& src, CpuImage& dst, const FineSharpParams& params = {}, UINT bandHeight = 0);
+
+	// 在合成图像上测量每个算法的吞吐量（MP/s）并写入日志
+	// 每个算法分别以 L2 大小的条带和每个线程一个条带执行，两者的差距反映了缓存局部性的影响
+	static void Benchmark(UINT width = 3840, UINT height = 2160, UINT iterations = 5);
+};
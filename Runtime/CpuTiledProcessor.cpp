@@ -0,0 +1,309 @@
+#include "pch.h"
+#include "CpuTiledProcessor.h"
+#include <thread>
+#include <atomic>
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+
+static UINT AlignUp(UINT value, UINT alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+bool CpuTiledProcessor::CreatePlan(const CpuEffectChain& chain, SIZE inputSize, UINT tileSize, size_t memoryBudget, Plan& plan) {
+	UINT halo, alignment;
+	if (!chain.GetTilingInfo(halo, alignment)) {
+		SPDLOG_LOGGER_ERROR(logger, "效果链的缩放比例不支持分块处理");
+		return false;
+	}
+
+	// 对齐保证 alignment 个输入像素的输出尺寸是精确的整数
+	SIZE outputSize, alignedOutputSize;
+	if (!chain.CalcOutputSize(inputSize, outputSize)
+		|| !chain.CalcOutputSize({ (LONG)alignment, (LONG)alignment }, alignedOutputSize)
+	) {
+		SPDLOG_LOGGER_ERROR(logger, "计算输出尺寸失败");
+		return false;
+	}
+
+	if (!CreatePlan(inputSize, outputSize, alignedOutputSize, halo, alignment,
+		tileSize > 0 ? tileSize : DEFAULT_TILE_SIZE, plan)
+	) {
+		return false;
+	}
+
+	if (tileSize > 0) {
+		return true;
+	}
+
+	// 至少能容纳一个块，否则不断减半
+	while (plan.tileSize > MIN_TILE_SIZE
+		&& EstimateBufferMemoryUsage(plan) + EstimateTileMemoryUsage(chain, plan) > memoryBudget
+	) {
+		CreatePlan(inputSize, outputSize, alignedOutputSize, halo, alignment, plan.tileSize / 2, plan);
+	}
+
+	return true;
+}
+
+bool CpuTiledProcessor::CreatePlan(
+	SIZE inputSize,
+	SIZE outputSize,
+	SIZE alignedOutputSize,
+	UINT halo,
+	UINT alignment,
+	UINT tileSize,
+	Plan& plan
+) {
+	plan = {};
+
+	if (inputSize.cx <= 0 || inputSize.cy <= 0 || alignment == 0 || tileSize == 0
+		|| halo % alignment != 0 || alignedOutputSize.cx <= 0 || alignedOutputSize.cy <= 0
+	) {
+		SPDLOG_LOGGER_ERROR(logger, "非法的分块参数");
+		return false;
+	}
+
+	plan.inputSize = inputSize;
+	plan.outputSize = outputSize;
+	plan.alignedOutputSize = alignedOutputSize;
+	plan.halo = halo;
+	plan.alignment = alignment;
+	plan.paddedInputSize = { (LONG)AlignUp(inputSize.cx, alignment), (LONG)AlignUp(inputSize.cy, alignment) };
+
+	const UINT maxTileSize = AlignUp(std::max(plan.paddedInputSize.cx, plan.paddedInputSize.cy), alignment);
+	plan.tileSize = std::min(AlignUp(std::max(tileSize, alignment), alignment), maxTileSize);
+	plan.columns = (plan.paddedInputSize.cx + plan.tileSize - 1) / plan.tileSize;
+	plan.rows = (plan.paddedInputSize.cy + plan.tileSize - 1) / plan.tileSize;
+	return true;
+}
+
+CpuTiledProcessor::Tile CpuTiledProcessor::GetTile(const Plan& plan, UINT column, UINT row) {
+	assert(column < plan.columns && row < plan.rows);
+
+	const UINT tileSize = plan.tileSize;
+	const UINT halo = plan.halo;
+	const UINT alignment = plan.alignment;
+
+	// 块的边界、halo 和补齐后的尺寸都是 alignment 的整数倍，因此映射到输出时没有舍入
+	const UINT left = column * tileSize;
+	const UINT top = row * tileSize;
+	const UINT right = std::min(left + tileSize, (UINT)plan.paddedInputSize.cx);
+	const UINT bottom = std::min(top + tileSize, (UINT)plan.paddedInputSize.cy);
+
+	Tile tile;
+	tile.inputRect = {
+		(LONG)(left > halo ? left - halo : 0),
+		(LONG)(top > halo ? top - halo : 0),
+		(LONG)std::min(right + halo, (UINT)plan.paddedInputSize.cx),
+		(LONG)std::min(bottom + halo, (UINT)plan.paddedInputSize.cy)
+	};
+
+	auto toOutputX = [&](UINT x) {
+		return LONG(x / alignment * plan.alignedOutputSize.cx);
+	};
+	auto toOutputY = [&](UINT y) {
+		return LONG(y / alignment * plan.alignedOutputSize.cy);
+	};
+
+	tile.outputRect = {
+		toOutputX(left),
+		toOutputY(top),
+		std::min(toOutputX(right), plan.outputSize.cx),
+		std::min(toOutputY(bottom), plan.outputSize.cy)
+	};
+
+	tile.outputOffset = {
+		toOutputX(left - tile.inputRect.left),
+		toOutputY(top - tile.inputRect.top)
+	};
+
+	return tile;
+}
+
+size_t CpuTiledProcessor::EstimateBufferMemoryUsage(const Plan& plan) {
+	// 输入缓冲区容纳一行块及其上下的 halo，输出缓冲区容纳一行块的输出
+	const size_t inputRows = std::min(plan.tileSize + plan.halo * 2, (UINT)plan.paddedInputSize.cy);
+	const size_t outputRows = plan.tileSize / plan.alignment * plan.alignedOutputSize.cy;
+	return (plan.paddedInputSize.cx * inputRows + plan.outputSize.cx * outputRows) * 4;
+}
+
+size_t CpuTiledProcessor::EstimateTileMemoryUsage(const CpuEffectChain& chain, const Plan& plan) {
+	// 效果链本身的占用加上转换为 B8G8R8A8 的输出
+	const LONG size = (LONG)(plan.tileSize + plan.halo * 2);
+	const size_t outputWidth = size / plan.alignment * plan.alignedOutputSize.cx;
+	const size_t outputHeight = size / plan.alignment * plan.alignedOutputSize.cy;
+	return chain.EstimateMemoryUsage({ size, size }) + outputWidth * outputHeight * 4;
+}
+
+UINT CpuTiledProcessor::CalcParallelTiles(const CpuEffectChain& chain, const Plan& plan, size_t memoryBudget) {
+	const size_t bufferSize = EstimateBufferMemoryUsage(plan);
+	const size_t tileSize = EstimateTileMemoryUsage(chain, plan);
+
+	size_t count = memoryBudget > bufferSize ? (memoryBudget - bufferSize) / tileSize : 0;
+	count = std::min<size_t>(count, plan.columns);
+	count = std::min<size_t>(count, std::max(std::thread::hardware_concurrency(), 1u));
+	return (UINT)std::max<size_t>(count, 1);
+}
+
+bool CpuTiledProcessor::Run(
+	const CpuEffectChain& chain,
+	const Plan& plan,
+	UINT parallelTiles,
+	const ReadRowsFn& readRows,
+	const WriteRowsFn& writeRows
+) {
+	auto processTile = [&](const BYTE* input, UINT width, UINT height, UINT pitch, std::vector<BYTE>& output, SIZE& outputSize) {
+		CpuImage tileInput;
+		if (!CpuImageUtils::FromBGRA8(input, width, height, pitch, tileInput)) {
+			SPDLOG_LOGGER_ERROR(logger, "FromBGRA8 失败");
+			return false;
+		}
+
+		CpuImage tileOutput;
+		if (!chain.ProcessTile(tileInput, plan.inputSize, tileOutput)) {
+			return false;
+		}
+
+		outputSize = { (LONG)tileOutput.GetWidth(), (LONG)tileOutput.GetHeight() };
+		output.resize(size_t(outputSize.cx) * outputSize.cy * 4);
+		CpuImageUtils::ToBGRA8(tileOutput, output.data(), outputSize.cx * 4);
+		return true;
+	};
+
+	return Run(plan, parallelTiles, readRows, processTile, writeRows);
+}
+
+bool CpuTiledProcessor::Run(
+	const Plan& plan,
+	UINT parallelTiles,
+	const ReadRowsFn& readRows,
+	const ProcessTileFn& processTile,
+	const WriteRowsFn& writeRows
+) {
+	const UINT inputWidth = plan.inputSize.cx;
+	const UINT inputHeight = plan.inputSize.cy;
+	const UINT paddedWidth = plan.paddedInputSize.cx;
+	const UINT inputPitch = paddedWidth * 4;
+	const UINT outputPitch = plan.outputSize.cx * 4;
+
+	std::vector<BYTE> inputBuf(size_t(inputPitch) * std::min(plan.tileSize + plan.halo * 2, (UINT)plan.paddedInputSize.cy));
+	std::vector<BYTE> outputBuf(size_t(outputPitch) * (plan.tileSize / plan.alignment * plan.alignedOutputSize.cy));
+
+	// 缓冲区中第一行和最后一行之后在原图中的行号
+	UINT bufferTop = 0;
+	UINT bufferBottom = 0;
+
+	auto getInputRow = [&](UINT y) {
+		assert(y >= bufferTop && y < bufferBottom);
+		return inputBuf.data() + size_t(y - bufferTop) * inputPitch;
+	};
+
+	for (UINT row = 0; row < plan.rows; ++row) {
+		const Tile firstTile = GetTile(plan, 0, row);
+		const UINT top = firstTile.inputRect.top;
+		const UINT bottom = firstTile.inputRect.bottom;
+
+		// 上一行块的 halo 和这一行重叠，保留重叠的部分，每行只解码一次
+		assert(top >= bufferTop && top <= bufferBottom);
+		if (top > bufferTop) {
+			std::memmove(inputBuf.data(), inputBuf.data() + size_t(top - bufferTop) * inputPitch, size_t(bufferBottom - top) * inputPitch);
+			bufferTop = top;
+		}
+
+		if (bottom > bufferBottom) {
+			const UINT readBegin = bufferBottom;
+			const UINT readEnd = std::min(bottom, inputHeight);
+			bufferBottom = bottom;
+
+			if (readEnd > readBegin) {
+				if (!readRows(readBegin, readEnd - readBegin, getInputRow(readBegin), inputPitch)) {
+					SPDLOG_LOGGER_ERROR(logger, "读取输入失败");
+					return false;
+				}
+
+				// 补齐的列复制边缘像素
+				for (UINT y = readBegin; y < readEnd; ++y) {
+					UINT* pixels = (UINT*)getInputRow(y);
+					std::fill(pixels + inputWidth, pixels + paddedWidth, pixels[inputWidth - 1]);
+				}
+			}
+
+			// 补齐的行复制最后一行
+			for (UINT y = std::max(readBegin, inputHeight); y < bottom; ++y) {
+				std::memcpy(getInputRow(y), getInputRow(inputHeight - 1), inputPitch);
+			}
+		}
+
+		std::atomic<UINT> nextColumn = 0;
+		std::atomic<bool> failed = false;
+
+		auto processTiles = [&]() {
+			std::vector<BYTE> tileBuf;
+			SIZE tileOutputSize{};
+
+			while (!failed) {
+				const UINT column = nextColumn++;
+				if (column >= plan.columns) {
+					break;
+				}
+
+				const Tile tile = GetTile(plan, column, row);
+				const UINT width = tile.inputRect.right - tile.inputRect.left;
+				const UINT height = tile.inputRect.bottom - tile.inputRect.top;
+
+				if (!processTile(getInputRow(tile.inputRect.top) + size_t(tile.inputRect.left) * 4,
+					width, height, inputPitch, tileBuf, tileOutputSize)
+				) {
+					SPDLOG_LOGGER_ERROR(logger, fmt::format("处理第 {} 行第 {} 列的块失败", row, column));
+					failed = true;
+					break;
+				}
+
+				const UINT tilePitch = tileOutputSize.cx * 4;
+
+				// 只保留不受块边缘影响的部分
+				const UINT outputWidth = tile.outputRect.right - tile.outputRect.left;
+				const UINT outputHeight = tile.outputRect.bottom - tile.outputRect.top;
+				if (tile.outputOffset.x + outputWidth > (UINT)tileOutputSize.cx
+					|| tile.outputOffset.y + outputHeight > (UINT)tileOutputSize.cy
+				) {
+					SPDLOG_LOGGER_ERROR(logger, "块的输出尺寸和分块规划不符");
+					failed = true;
+					break;
+				}
+
+				for (UINT y = 0; y < outputHeight; ++y) {
+					std::memcpy(
+						outputBuf.data() + size_t(y) * outputPitch + size_t(tile.outputRect.left) * 4,
+						tileBuf.data() + size_t(tile.outputOffset.y + y) * tilePitch + size_t(tile.outputOffset.x) * 4,
+						size_t(outputWidth) * 4
+					);
+				}
+			}
+		};
+
+		// 当前线程也参与处理
+		std::vector<std::thread> workers;
+		for (UINT i = 1; i < parallelTiles; ++i) {
+			workers.emplace_back(processTiles);
+		}
+		processTiles();
+		for (std::thread& t : workers) {
+			t.join();
+		}
+
+		if (failed) {
+			return false;
+		}
+
+		const UINT outputRows = firstTile.outputRect.bottom - firstTile.outputRect.top;
+		if (!writeRows(outputRows, outputBuf.data(), outputPitch)) {
+			SPDLOG_LOGGER_ERROR(logger, "写入输出失败");
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "pch.h"
+#include "CpuEffectChain.h"
+
+
+// 将超出内存预算的大图切分为若干块分别执行效果链，再拼接为完整的输出
+// 每块四周多读取 halo 个像素，丢弃输出中受块边缘影响的部分，因此拼接处没有接缝
+// 输入和输出都以行为单位流式读写，同一时刻只有一行块及其 halo 在内存中
+// 分块规划和流式读写和效果链无关，GpuEffectChain 也使用它们
+class CpuTiledProcessor {
+public:
+	// 分块的几何规划，只包含整数运算，和图像数据无关
+	struct Plan {
+		SIZE inputSize{};
+		// 输入的右侧和底部复制边缘像素补齐到 alignment 的整数倍
+		SIZE paddedInputSize{};
+		SIZE outputSize{};
+		// alignment x alignment 个输入像素对应的输出尺寸
+		SIZE alignedOutputSize{};
+		// 块的边长（输入像素），不包括 halo
+		UINT tileSize = 0;
+		UINT halo = 0;
+		UINT alignment = 1;
+		UINT columns = 0;
+		UINT rows = 0;
+	};
+
+	struct Tile {
+		// 需要读取的输入区域，包括 halo，已裁剪到 paddedInputSize 内
+		RECT inputRect{};
+		// 该块负责的输出区域，已裁剪到 outputSize 内
+		RECT outputRect{};
+		// outputRect 的左上角在该块输出图像中的位置
+		POINT outputOffset{};
+	};
+
+	// 读取原图的 [y, y + rowCount) 行，格式为 B8G8R8A8，每次调用的 y 递增
+	using ReadRowsFn = std::function<bool(UINT y, UINT rowCount, BYTE* data, UINT rowPitch)>;
+	// 按从上到下的顺序追加输出的若干行，格式为 B8G8R8A8
+	using WriteRowsFn = std::function<bool(UINT rowCount, const BYTE* data, UINT rowPitch)>;
+	// 处理一块，输入和输出都是 B8G8R8A8，输出的行距为宽度的 4 倍
+	using ProcessTileFn = std::function<bool(const BYTE* input, UINT width, UINT height, UINT pitch,
+		std::vector<BYTE>& output, SIZE& outputSize)>;
+
+	// tileSize 为 0 时根据 memoryBudget 选择
+	// 效果链的缩放比例不支持分块时返回 false
+	static bool CreatePlan(const CpuEffectChain& chain, SIZE inputSize, UINT tileSize, size_t memoryBudget, Plan& plan);
+
+	// 只计算几何规划，halo 和 alignment 的含义见 CpuEffectChain::GetTilingInfo
+	// alignedOutputSize 为 alignment x alignment 个输入像素对应的输出尺寸，tileSize 不能为 0
+	static bool CreatePlan(SIZE inputSize, SIZE outputSize, SIZE alignedOutputSize,
+		UINT halo, UINT alignment, UINT tileSize, Plan& plan);
+
+	static Tile GetTile(const Plan& plan, UINT column, UINT row);
+
+	// 同时处理的块数，每块都要占用 EstimateTileMemoryUsage 的内存
+	static UINT CalcParallelTiles(const CpuEffectChain& chain, const Plan& plan, size_t memoryBudget);
+
+	// 输入和输出缓冲区占用的内存，和块数无关
+	static size_t EstimateBufferMemoryUsage(const Plan& plan);
+
+	static size_t EstimateTileMemoryUsage(const CpuEffectChain& chain, const Plan& plan);
+
+	static bool Run(
+		const CpuEffectChain& chain,
+		const Plan& plan,
+		UINT parallelTiles,
+		const ReadRowsFn& readRows,
+		const WriteRowsFn& writeRows
+	);
+
+	// processTile 在 parallelTiles 个线程上同时调用
+	static bool Run(
+		const Plan& plan,
+		UINT parallelTiles,
+		const ReadRowsFn& readRows,
+		const ProcessTileFn& processTile,
+		const WriteRowsFn& writeRows
+	);
+
+	static constexpr UINT DEFAULT_TILE_SIZE = 2048;
+	static constexpr UINT MIN_TILE_SIZE = 256;
+};
@@ -6,6 +6,9 @@
 
 extern std::shared_ptr<spdlog::logger> logger;
 
+// 系统光标的显示状态、限制区域和移速是全局的，多屏幕模式下所有会话中同一时间只能有一个处于捕获状态
+static std::atomic<const CursorDrawer*> captureOwner = nullptr;
+
 constexpr const char* monochromeCursorPS = R"(
 Texture2D originTex : register(t0);
 Texture2D maskTex : register(t1);
@@ -38,14 +41,6 @@ bool CursorDrawer::Initialize(ComPtr<ID3D11Texture2D> renderTarget, const RECT&
 		_d3dDC = renderer.GetD3DDC();
 		_d3dDevice = renderer.GetD3DDevice();
 
-		_zoomFactorX = _zoomFactorY = App::GetInstance().GetCursorZoomFactor();
-		if (_zoomFactorX <= 0) {
-			D3D11_TEXTURE2D_DESC desc{};
-			app.GetFrameSource().GetOutput()->GetDesc(&desc);
-			_zoomFactorX = float(destRect.right - destRect.left) / desc.Width;
-			_zoomFactorY = float(destRect.bottom - destRect.top) / desc.Height;
-		}
-
 		if (!renderer.GetRenderTargetView(renderTarget.Get(), &_rtv)) {
 			SPDLOG_LOGGER_ERROR(logger, "GetRenderTargetView 失败");
 			return false;
@@ -57,7 +52,7 @@ bool CursorDrawer::Initialize(ComPtr<ID3D11Texture2D> renderTarget, const RECT&
 		}
 
 		ComPtr<ID3DBlob> blob;
-		if (!renderer.CompileShader(false, monochromeCursorPS, "main", &blob, "MonochromeCursorPS")) {
+		if (!renderer.CompileShader(Renderer::ShaderType::Pixel, monochromeCursorPS, "main", &blob, "MonochromeCursorPS")) {
 			SPDLOG_LOGGER_ERROR(logger, "编译 MonochromeCursorPS 失败");
 			return false;
 		}
@@ -90,6 +85,42 @@ bool CursorDrawer::Initialize(ComPtr<ID3D11Texture2D> renderTarget, const RECT&
 
 		_monoCursorSize = { GetSystemMetrics(SM_CXCURSOR), GetSystemMetrics(SM_CYCURSOR) };
 
+		D3D11_TEXTURE2D_DESC rtDesc;
+		renderTarget->GetDesc(&rtDesc);
+
+		_renderTargetSize = { (long)rtDesc.Width, (long)rtDesc.Height };
+	}
+
+	if (!SetDestRect(destRect)) {
+		SPDLOG_LOGGER_ERROR(logger, "SetDestRect 失败");
+		return false;
+	}
+	
+	if (!App::GetInstance().IsMultiMonitorMode() && !App::GetInstance().IsBreakpointMode()) {
+		if (App::GetInstance().IsAdjustCursorSpeed()) {
+			_AdjustCursorSpeed();
+		}
+
+		if (!MagShowSystemCursor(FALSE)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("MagShowSystemCursor 失败"));
+		}
+	}
+
+	SPDLOG_LOGGER_INFO(logger, "CursorDrawer 初始化完成");
+	return true;
+}
+
+bool CursorDrawer::SetDestRect(const RECT& destRect) {
+	App& app = App::GetInstance();
+	if (!app.IsNoCursor()) {
+		_zoomFactorX = _zoomFactorY = app.GetCursorZoomFactor();
+		if (_zoomFactorX <= 0) {
+			D3D11_TEXTURE2D_DESC desc{};
+			app.GetFrameSource().GetOutput()->GetDesc(&desc);
+			_zoomFactorX = float(destRect.right - destRect.left) / desc.Width;
+			_zoomFactorY = float(destRect.bottom - destRect.top) / desc.Height;
+		}
+
 		D3D11_TEXTURE2D_DESC desc{};
 		desc.Width = lroundf(_monoCursorSize.cx * _zoomFactorX);
 		desc.Height = lroundf(_monoCursorSize.cy * _zoomFactorY);
@@ -101,26 +132,35 @@ bool CursorDrawer::Initialize(ComPtr<ID3D11Texture2D> renderTarget, const RECT&
 		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
 		desc.Usage = D3D11_USAGE_DEFAULT;
 
-		hr = _d3dDevice->CreateTexture2D(&desc, nullptr, &_monoTmpTexture);
-		if (FAILED(hr)) {
-			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
-			return false;
+		D3D11_TEXTURE2D_DESC oldDesc{};
+		if (_monoTmpTexture) {
+			_monoTmpTexture->GetDesc(&oldDesc);
 		}
 
-		if (!renderer.GetRenderTargetView(_monoTmpTexture.Get(), &_monoTmpRtv)) {
-			SPDLOG_LOGGER_ERROR(logger, "GetRenderTargetView 失败");
-			return false;
-		}
+		// 光标的缩放比例不变时保留原来的纹理
+		if (oldDesc.Width != desc.Width || oldDesc.Height != desc.Height) {
+			Renderer& renderer = app.GetRenderer();
+			if (_monoTmpTexture) {
+				renderer.ReleaseViews(_monoTmpTexture.Get());
+			}
 
-		if (!renderer.GetShaderResourceView(_monoTmpTexture.Get(), &_monoTmpSrv)) {
-			SPDLOG_LOGGER_ERROR(logger, "GetShaderResourceView 失败");
-			return false;
-		}
+			HRESULT hr = _d3dDevice->CreateTexture2D(&desc, nullptr, _monoTmpTexture.ReleaseAndGetAddressOf());
+			if (FAILED(hr)) {
+				SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
+				return false;
+			}
 
-		D3D11_TEXTURE2D_DESC rtDesc;
-		renderTarget->GetDesc(&rtDesc);
+			if (!renderer.GetRenderTargetView(_monoTmpTexture.Get(), &_monoTmpRtv)) {
+				SPDLOG_LOGGER_ERROR(logger, "GetRenderTargetView 失败");
+				return false;
+			}
+
+			if (!renderer.GetShaderResourceView(_monoTmpTexture.Get(), &_monoTmpSrv)) {
+				SPDLOG_LOGGER_ERROR(logger, "GetShaderResourceView 失败");
+				return false;
+			}
+		}
 
-		_renderTargetSize = { (long)rtDesc.Width, (long)rtDesc.Height };
 		_destRect = destRect;
 	}
 
@@ -129,24 +169,14 @@ bool CursorDrawer::Initialize(ComPtr<ID3D11Texture2D> renderTarget, const RECT&
 
 	_clientScaleX = float(destRect.right - destRect.left) / srcSize.cx;
 	_clientScaleY = float(destRect.bottom - destRect.top) / srcSize.cy;
-	
-	if (!App::GetInstance().IsMultiMonitorMode() && !App::GetInstance().IsBreakpointMode()) {
+
+	if (!app.IsMultiMonitorMode() && !app.IsBreakpointMode()) {
 		// 非多屏幕模式下，限制光标在窗口内
-		
 		if (!ClipCursor(&srcFrameRect)) {
 			SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("ClipCursor 失败"));
 		}
-
-		if (App::GetInstance().IsAdjustCursorSpeed()) {
-			_AdjustCursorSpeed();
-		}
-
-		if (!MagShowSystemCursor(FALSE)) {
-			SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("MagShowSystemCursor 失败"));
-		}
 	}
 
-	SPDLOG_LOGGER_INFO(logger, "CursorDrawer 初始化完成");
 	return true;
 }
 
@@ -158,6 +188,10 @@ CursorDrawer::~CursorDrawer() {
 				SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("GetCursorPos 失败"));
 			}
 			_StopCapture(pt);
+
+			// 目标位置没有屏幕时无法离开捕获状态，也要让出光标
+			const CursorDrawer* expected = this;
+			captureOwner.compare_exchange_strong(expected, nullptr);
 		}
 	} else if (!App::GetInstance().IsBreakpointMode()) {
 		// CursorDrawer 析构时计时器已销毁
@@ -263,10 +297,45 @@ void CursorDrawer::_AdjustCursorSpeed() {
 }
 
 bool CursorDrawer::Update() {
-	if (!App::GetInstance().IsMultiMonitorMode()) {
-		return true;
+	App& app = App::GetInstance();
+
+	bool result = true;
+	if (app.IsMultiMonitorMode()) {
+		result = _UpdateCapture();
+	} else if (!app.IsNoCursor() && !app.IsBreakpointMode() && app.IsConfineCursorIn3DGames()) {
+		// 开启“在 3D 游戏中限制光标”则每帧都限制一次光标
+		ClipCursor(&app.GetSrcFrameRect());
+	}
+
+	// 确定要绘制的光标
+	_cursor = NULL;
+
+	if (app.IsNoCursor()) {
+		// 不绘制光标
+		return result;
+	}
+
+	if (app.IsMultiMonitorMode() && !_isUnderCapture) {
+		// 多屏幕模式下不处于捕获状态则不绘制光标
+		return result;
 	}
 
+	CURSORINFO ci{};
+	ci.cbSize = sizeof(ci);
+	if (!GetCursorInfo(&ci)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("GetCursorInfo 失败"));
+		return false;
+	}
+
+	if (ci.hCursor && ci.flags == CURSOR_SHOWING) {
+		_cursor = ci.hCursor;
+		_cursorPos = ci.ptScreenPos;
+	}
+
+	return result;
+}
+
+bool CursorDrawer::_UpdateCapture() {
 	// _DynamicClip 根据当前光标位置的四个方向有无屏幕来确定应该在哪些方向限制光标，但这无法
 	// 处理屏幕之间存在间隙的情况。解决办法是 _StopCapture 只在目标位置存在屏幕时才取消捕获，
 	// 当光标试图移动到间隙中时将被挡住。如果光标的速度足以跨越间隙，则它依然可以在屏幕间移动。
@@ -288,7 +357,9 @@ bool CursorDrawer::Update() {
 	} else {
 		const RECT& hostRect = App::GetInstance().GetHostWndRect();
 
-		if (PtInRect(&hostRect, cursorPt)) {
+		// 光标被其他会话捕获时，它在那个会话的源窗口中的位置可能落在本会话的主窗口内
+		const CursorDrawer* expected = nullptr;
+		if (PtInRect(&hostRect, cursorPt) && captureOwner.compare_exchange_strong(expected, this)) {
 			_StartCapture(cursorPt);
 			_DynamicClip(cursorPt);
 		}
@@ -427,7 +498,7 @@ bool CursorDrawer::_ResolveCursor(HCURSOR hCursor, _CursorInfo& result) const {
 
 	if(!result.hasInv) {
 		// 光标无反色部分，使用 WIC 将光标转换为带 Alpha 通道的图像
-		ComPtr<IWICImagingFactory2> wicFactory = App::GetInstance().GetWICImageFactory();
+		ComPtr<IWICImagingFactory2> wicFactory = App::GetWICImageFactory();
 		if (!wicFactory) {
 			SPDLOG_LOGGER_ERROR(logger, "获取 WICImageFactory 失败");
 			return false;
@@ -578,6 +649,7 @@ void CursorDrawer::_StopCapture(POINT cursorPt) {
 		SystemParametersInfo(SPI_SETCURSORS, 0, 0, 0);
 
 		_isUnderCapture = false;
+		captureOwner.store(nullptr);
 	} else {
 		// 目标位置不存在屏幕，则将光标限制在源窗口内
 		SetCursorPos(
@@ -588,45 +660,24 @@ void CursorDrawer::_StopCapture(POINT cursorPt) {
 }
 
 void CursorDrawer::Draw() {
-	if (App::GetInstance().IsNoCursor()) {
-		// 不绘制光标
-		return;
-	}
-
-	if (App::GetInstance().IsMultiMonitorMode()) {
-		// 多屏幕模式下不处于捕获状态则不绘制光标
-		if (!_isUnderCapture) {
-			return;
-		}
-	} else if (!App::GetInstance().IsBreakpointMode() && App::GetInstance().IsConfineCursorIn3DGames()) {
-		// 开启“在 3D 游戏中限制光标”则每帧都限制一次光标
-		ClipCursor(&App::GetInstance().GetSrcFrameRect());
-	}
-
-	CURSORINFO ci{};
-	ci.cbSize = sizeof(ci);
-	if (!GetCursorInfo(&ci)) {
-		SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("GetCursorInfo 失败"));
-		return;
-	}
-
-	if (!ci.hCursor || ci.flags != CURSOR_SHOWING) {
+	// 由 Update 确定
+	if (!_cursor) {
 		return;
 	}
 
 	_CursorInfo* info = nullptr;
 
-	auto it = _cursorMap.find(ci.hCursor);
+	auto it = _cursorMap.find(_cursor);
 	if (it != _cursorMap.end()) {
 		info = &it->second;
 	} else {
 		// 未在映射中找到，创建新映射
 		_CursorInfo t;
-		if (_ResolveCursor(ci.hCursor, t)) {
-			info = &_cursorMap[ci.hCursor];
+		if (_ResolveCursor(_cursor, t)) {
+			info = &_cursorMap[_cursor];
 			*info = t;
 
-			SPDLOG_LOGGER_INFO(logger, fmt::format("已解析光标：{}", (void*)ci.hCursor));
+			SPDLOG_LOGGER_INFO(logger, fmt::format("已解析光标：{}", (void*)_cursor));
 		} else {
 			SPDLOG_LOGGER_ERROR(logger, "解析光标失败");
 			return;
@@ -638,8 +689,8 @@ void CursorDrawer::Draw() {
 	// 映射坐标
 	const RECT& srcClient = App::GetInstance().GetSrcFrameRect();
 	POINT targetScreenPos = {
-		lroundf((ci.ptScreenPos.x - srcClient.left) * _clientScaleX - info->xHotSpot * _zoomFactorX),
-		lroundf((ci.ptScreenPos.y - srcClient.top) * _clientScaleY - info->yHotSpot * _zoomFactorY)
+		lroundf((_cursorPos.x - srcClient.left) * _clientScaleX - info->xHotSpot * _zoomFactorX),
+		lroundf((_cursorPos.y - srcClient.top) * _clientScaleY - info->yHotSpot * _zoomFactorY)
 	};
 
 	RECT cursorRect{
@@ -663,11 +714,12 @@ void CursorDrawer::Draw() {
 	float bottom = top - cursorSize.cy / FLOAT(_destRect.bottom - _destRect.top) * 2;
 
 	Renderer& renderer = App::GetInstance().GetRenderer();
+	StateTrackingContext& stateContext = renderer.GetStateContext();
 	renderer.SetSimpleVS(_vtxBuffer.Get());
-	_d3dDC->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	stateContext.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
 	
 	if (!info->hasInv) {
-		_d3dDC->OMSetRenderTargets(1, &_rtv, nullptr);
+		stateContext.OMSetRenderTargets(1, &_rtv);
 		D3D11_VIEWPORT vp{
 			(FLOAT)_destRect.left,
 			(FLOAT)_destRect.top,
@@ -676,7 +728,7 @@ void CursorDrawer::Draw() {
 			0.0f,
 			1.0f
 		};
-		_d3dDC->RSSetViewports(1, &vp);
+		stateContext.RSSetViewport(vp);
 
 		D3D11_MAPPED_SUBRESOURCE ms;
 		HRESULT hr = _d3dDC->Map(_vtxBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &ms);
@@ -713,12 +765,12 @@ void CursorDrawer::Draw() {
 	} else {
 		// 绘制带有反色部分的光标，首先将光标覆盖的纹理复制到 _monoTmpTexture 中
 		// 不知为何 CopySubresourceRegion 会大幅增加 GPU 占用
-		_d3dDC->OMSetRenderTargets(1, &_monoTmpRtv, nullptr);
+		stateContext.OMSetRenderTargets(1, &_monoTmpRtv);
 		D3D11_VIEWPORT vp{};
 		vp.Width = (FLOAT)cursorSize.cx;
 		vp.Height = (FLOAT)cursorSize.cy;
 		vp.MaxDepth = 1.0f;
-		_d3dDC->RSSetViewports(1, &vp);
+		stateContext.RSSetViewport(vp);
 		
 		D3D11_MAPPED_SUBRESOURCE ms;
 		HRESULT hr = _d3dDC->Map(_vtxBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &ms);
@@ -760,19 +812,18 @@ void CursorDrawer::Draw() {
 
 		_d3dDC->Unmap(_vtxBuffer.Get(), 0);
 
-		_d3dDC->PSSetShader(_monoCursorPS.Get(), nullptr, 0);
-		_d3dDC->PSSetConstantBuffers(0, 0, nullptr);
-		_d3dDC->OMSetRenderTargets(0, nullptr, nullptr);
+		stateContext.PSSetShader(_monoCursorPS.Get());
+		stateContext.OMSetRenderTargets(0, nullptr);
 		ID3D11ShaderResourceView* srv[2] = { _monoTmpSrv, info->texture.Get() };
-		_d3dDC->PSSetShaderResources(0, 2, srv);
-		_d3dDC->PSSetSamplers(0, 1, App::GetInstance().GetCursorInterpolationMode() == 0 ? &_pointSam : &_linearSam);
+		stateContext.PSSetShaderResources(0, 2, srv);
+		stateContext.PSSetSamplers(0, 1, App::GetInstance().GetCursorInterpolationMode() == 0 ? &_pointSam : &_linearSam);
 
-		_d3dDC->OMSetRenderTargets(1, &_rtv, nullptr);
+		stateContext.OMSetRenderTargets(1, &_rtv);
 		vp.TopLeftX = (FLOAT)_destRect.left;
 		vp.TopLeftY = (FLOAT)_destRect.top;
 		vp.Width = FLOAT(_destRect.right - _destRect.left);
 		vp.Height = FLOAT(_destRect.bottom - _destRect.top);
-		_d3dDC->RSSetViewports(1, &vp);
+		stateContext.RSSetViewport(vp);
 
 		_d3dDC->Draw(4, 0);
 	}
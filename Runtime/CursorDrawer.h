@@ -7,12 +7,25 @@ class CursorDrawer {
 public:
 	bool Initialize(ComPtr<ID3D11Texture2D> renderTarget, const RECT& destRect);
 
+	// 源窗口或输出区域改变后调用，重新计算光标的缩放和限制光标的区域
+	bool SetDestRect(const RECT& destRect);
+
 	~CursorDrawer();
 
+	// 每次检查是否需要渲染前调用，确定要绘制的光标
 	bool Update();
 
 	void Draw();
 
+	// 不绘制光标时为 NULL
+	HCURSOR GetCurrentCursor() const {
+		return _cursor;
+	}
+
+	POINT GetCurrentCursorPos() const {
+		return _cursorPos;
+	}
+
 private:
 	struct _CursorInfo {
 		ComPtr<ID3D11ShaderResourceView> texture = nullptr;
@@ -25,6 +38,9 @@ private:
 
 	bool _ResolveCursor(HCURSOR hCursor, _CursorInfo& result) const;
 
+	// 多屏幕模式下根据光标位置开始或停止捕获
+	bool _UpdateCapture();
+
 	void _StartCapture(POINT cursorPt);
 
 	void _StopCapture(POINT cursorPt);
@@ -47,6 +63,9 @@ private:
 	float _clientScaleY = 0;
 	std::unordered_map<HCURSOR, _CursorInfo> _cursorMap;
 
+	HCURSOR _cursor = NULL;
+	POINT _cursorPos{};
+
 	ComPtr<ID3D11DeviceContext> _d3dDC;
 	ComPtr<ID3D11Device> _d3dDevice;
 
@@ -0,0 +1,195 @@
+#include "pch.h"
+#include "DDSReader.h"
+#include "Utils.h"
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+using namespace DirectX::PackedVector;
+
+
+#pragma pack(push, 1)
+
+struct DDSPixelFormat {
+	UINT32 size;
+	UINT32 flags;
+	UINT32 fourCC;
+	UINT32 RGBBitCount;
+	UINT32 RBitMask;
+	UINT32 GBitMask;
+	UINT32 BBitMask;
+	UINT32 ABitMask;
+};
+
+struct DDSHeader {
+	UINT32 size;
+	UINT32 flags;
+	UINT32 height;
+	UINT32 width;
+	UINT32 pitchOrLinearSize;
+	UINT32 depth;
+	UINT32 mipMapCount;
+	UINT32 reserved1[11];
+	DDSPixelFormat ddspf;
+	UINT32 caps;
+	UINT32 caps2;
+	UINT32 caps3;
+	UINT32 caps4;
+	UINT32 reserved2;
+};
+
+struct DDSHeaderDXT10 {
+	UINT32 dxgiFormat;
+	UINT32 resourceDimension;
+	UINT32 miscFlag;
+	UINT32 arraySize;
+	UINT32 miscFlags2;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(DDSHeader) == 124, "DDS 头大小错误");
+static_assert(sizeof(DDSHeaderDXT10) == 20, "DDS DX10 扩展头大小错误");
+
+static constexpr UINT32 DDS_MAGIC = 0x20534444;	// "DDS "
+static constexpr UINT32 DDS_FOURCC = 0x00000004;
+static constexpr UINT32 FOURCC_DX10 = 0x30315844;	// "DX10"
+
+
+// 将 D3DFMT FourCC 转换为等价的 DXGI 格式
+static DXGI_FORMAT FourCCToFormat(UINT32 fourCC) {
+	switch (fourCC) {
+	case 111:	// D3DFMT_R16F
+		return DXGI_FORMAT_R16_FLOAT;
+	case 112:	// D3DFMT_G16R16F
+		return DXGI_FORMAT_R16G16_FLOAT;
+	case 113:	// D3DFMT_A16B16G16R16F
+		return DXGI_FORMAT_R16G16B16A16_FLOAT;
+	case 114:	// D3DFMT_R32F
+		return DXGI_FORMAT_R32_FLOAT;
+	case 115:	// D3DFMT_G32R32F
+		return DXGI_FORMAT_R32G32_FLOAT;
+	case 116:	// D3DFMT_A32B32G32R32F
+		return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	default:
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+// 获取通道数和每个通道的字节数，不支持的格式返回 false
+static bool GetFormatInfo(DXGI_FORMAT format, UINT& channels, UINT& bytesPerChannel) {
+	switch (format) {
+	case DXGI_FORMAT_R16_FLOAT:
+		channels = 1;
+		bytesPerChannel = 2;
+		return true;
+	case DXGI_FORMAT_R16G16_FLOAT:
+		channels = 2;
+		bytesPerChannel = 2;
+		return true;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		channels = 4;
+		bytesPerChannel = 2;
+		return true;
+	case DXGI_FORMAT_R32_FLOAT:
+		channels = 1;
+		bytesPerChannel = 4;
+		return true;
+	case DXGI_FORMAT_R32G32_FLOAT:
+		channels = 2;
+		bytesPerChannel = 4;
+		return true;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		channels = 4;
+		bytesPerChannel = 4;
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool DDSReader::Load(const wchar_t* fileName, CpuImage& result) {
+	std::vector<BYTE> buf;
+	if (!Utils::ReadFile(fileName, buf)) {
+		SPDLOG_LOGGER_ERROR(logger, "读取 DDS 文件失败");
+		return false;
+	}
+
+	size_t offset = sizeof(UINT32) + sizeof(DDSHeader);
+	if (buf.size() < offset || *(UINT32*)buf.data() != DDS_MAGIC) {
+		SPDLOG_LOGGER_ERROR(logger, "不是合法的 DDS 文件");
+		return false;
+	}
+
+	const DDSHeader& header = *(DDSHeader*)(buf.data() + sizeof(UINT32));
+	if (header.size != sizeof(DDSHeader) || header.ddspf.size != sizeof(DDSPixelFormat)) {
+		SPDLOG_LOGGER_ERROR(logger, "DDS 头非法");
+		return false;
+	}
+
+	if (!(header.ddspf.flags & DDS_FOURCC)) {
+		SPDLOG_LOGGER_ERROR(logger, "不支持的 DDS 格式");
+		return false;
+	}
+
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	if (header.ddspf.fourCC == FOURCC_DX10) {
+		if (buf.size() < offset + sizeof(DDSHeaderDXT10)) {
+			SPDLOG_LOGGER_ERROR(logger, "DDS 文件不完整");
+			return false;
+		}
+
+		const DDSHeaderDXT10& header10 = *(DDSHeaderDXT10*)(buf.data() + offset);
+		if (header10.resourceDimension != D3D11_RESOURCE_DIMENSION_TEXTURE2D || header10.arraySize > 1) {
+			SPDLOG_LOGGER_ERROR(logger, "只支持 2D 纹理");
+			return false;
+		}
+
+		format = (DXGI_FORMAT)header10.dxgiFormat;
+		offset += sizeof(DDSHeaderDXT10);
+	} else {
+		format = FourCCToFormat(header.ddspf.fourCC);
+	}
+
+	UINT channels = 0;
+	UINT bytesPerChannel = 0;
+	if (!GetFormatInfo(format, channels, bytesPerChannel)) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("不支持的 DDS 格式：{}", (int)format));
+		return false;
+	}
+
+	const UINT width = header.width;
+	const UINT height = header.height;
+	const size_t rowPitch = size_t(width) * channels * bytesPerChannel;
+	if (width == 0 || height == 0 || buf.size() - offset < rowPitch * height) {
+		SPDLOG_LOGGER_ERROR(logger, "DDS 文件不完整");
+		return false;
+	}
+
+	// 查找表通常使用点采样并按纹素中心寻址，因此无需边框
+	if (!result.Create(width, height, 0)) {
+		return false;
+	}
+
+	for (UINT y = 0; y < height; ++y) {
+		const BYTE* src = buf.data() + offset + rowPitch * y;
+		XMFLOAT4* dst = result.GetRow(y);
+
+		for (UINT x = 0; x < width; ++x) {
+			float values[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+			for (UINT c = 0; c < channels; ++c) {
+				if (bytesPerChannel == 2) {
+					values[c] = XMConvertHalfToFloat(*(const HALF*)src);
+				} else {
+					values[c] = *(const float*)src;
+				}
+				src += bytesPerChannel;
+			}
+
+			dst[x] = XMFLOAT4(values);
+		}
+	}
+
+	return true;
+}
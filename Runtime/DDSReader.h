@@ -0,0 +1,14 @@
+#pragma once
+#include "pch.h"
+#include "CpuImage.h"
+
+
+// 不依赖 D3D 设备的 DDS 读取器，用于在 CPU 上使用效果附带的查找表（如 NIS 和 RAVU 的权重）
+// 只读取第一个 mip，支持以下浮点格式：
+// R16_FLOAT、R16G16_FLOAT、R16G16B16A16_FLOAT、R32_FLOAT、R32G32_FLOAT、R32G32B32A32_FLOAT
+// 既支持 DX10 扩展头，也支持旧式头中对应的 D3DFMT FourCC
+// 缺少的通道和 D3D 中一样：RGB 补 0，A 补 1
+class DDSReader {
+public:
+	static bool Load(const wchar_t* fileName, CpuImage& result);
+};
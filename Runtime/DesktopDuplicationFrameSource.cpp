@@ -104,6 +104,11 @@ bool DesktopDuplicationFrameSource::Initialize() {
 	}
 	const RECT& srcFrameRect = App::GetInstance().GetSrcFrameRect();
 
+	if (!_InitializeDdpD3D()) {
+		SPDLOG_LOGGER_ERROR(logger, "初始化 D3D 失败");
+		return false;
+	}
+
 	D3D11_TEXTURE2D_DESC desc{};
 	desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
 	desc.Width = srcFrameRect.right - srcFrameRect.left;
@@ -113,40 +118,9 @@ bool DesktopDuplicationFrameSource::Initialize() {
 	desc.ArraySize = 1;
 	desc.SampleDesc.Count = 1;
 	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
-	HRESULT hr = App::GetInstance().GetRenderer().GetD3DDevice()->CreateTexture2D(&desc, nullptr, &_output);
-	if (FAILED(hr)) {
-		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
-		return false;
-	}
-
-	// 创建共享纹理
 	desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX;
-	hr = App::GetInstance().GetRenderer().GetD3DDevice()->CreateTexture2D(&desc, nullptr, &_sharedTex);
-	if (FAILED(hr)) {
-		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
-		return false;
-	}
-
-	hr = _sharedTex.As<IDXGIKeyedMutex>(&_sharedTexMutex);
-	if (FAILED(hr)) {
-		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("检索 IDXGIKeyedMutex 失败", hr));
-		return false;
-	}
-
-	ComPtr<IDXGIResource> sharedDxgiRes;
-	hr = _sharedTex.As<IDXGIResource>(&sharedDxgiRes);
-	if (FAILED(hr)) {
-		return false;
-	}
-
-	HANDLE hSharedTex = NULL;
-	hr = sharedDxgiRes->GetSharedHandle(&hSharedTex);
-	if (FAILED(hr)) {
-		return false;
-	}
-
-	if (!_InitializeDdpD3D(hSharedTex)) {
-		SPDLOG_LOGGER_ERROR(logger, "初始化 D3D 失败");
+	if (!_InitializeSlots(desc)) {
+		SPDLOG_LOGGER_ERROR(logger, "创建共享纹理失败");
 		return false;
 	}
 
@@ -156,7 +130,7 @@ bool DesktopDuplicationFrameSource::Initialize() {
 		return false;
 	}
 
-	hr = output->DuplicateOutput(
+	HRESULT hr = output->DuplicateOutput(
 		_ddpD3dDevice.Get(),
 		_outputDup.ReleaseAndGetAddressOf()
 	);
@@ -200,36 +174,41 @@ bool DesktopDuplicationFrameSource::Initialize() {
 
 
 FrameSourceBase::UpdateState DesktopDuplicationFrameSource::Update() {
-	UINT newFrameState = _newFrameState.load();
-	if (newFrameState == 2) {
-		// 第一帧之前不渲染
-		return UpdateState::Waiting;
-	} else if (newFrameState == 0) {
-		return UpdateState::NoUpdate;
+	AcquireSRWLockExclusive(&_slotLock);
+	const int oldSlot = _heldSlot;
+	const int newSlot = _readySlot;
+	if (newSlot >= 0) {
+		_heldSlot = newSlot;
+		_readySlot = -1;
 	}
+	ReleaseSRWLockExclusive(&_slotLock);
 
-	// 不必等待，当 newFrameState 变化时 DDP 线程已将锁释放
-	HRESULT hr = _sharedTexMutex->AcquireSync(1, 0);
-	if (hr == static_cast<HRESULT>(WAIT_TIMEOUT)) {
-		return UpdateState::Waiting;
+	if (newSlot < 0) {
+		// 第一帧之前不渲染
+		return oldSlot < 0 ? UpdateState::Waiting : UpdateState::NoUpdate;
 	}
-	
-	if (FAILED(hr)) {
+
+	// DDP 线程写入完成并释放锁后才会将纹理标记为就绪，因此很快就能获得
+	HRESULT hr = _slots[newSlot].mutex->AcquireSync(0, 100);
+	if (hr != S_OK) {
 		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("AcquireSync 失败", hr));
+
+		// 仍使用旧的纹理
+		AcquireSRWLockExclusive(&_slotLock);
+		_heldSlot = oldSlot;
+		ReleaseSRWLockExclusive(&_slotLock);
 		return UpdateState::Error;
 	}
 
-	_newFrameState.store(0);
-
-	const auto& dc = App::GetInstance().GetRenderer().GetD3DDC();
-	dc->CopyResource(_output.Get(), _sharedTex.Get());
-
-	_sharedTexMutex->ReleaseSync(0);
+	// 直到取走下一帧前一直持有当前帧，效果直接从中读取，不再复制
+	if (oldSlot >= 0) {
+		_slots[oldSlot].mutex->ReleaseSync(0);
+	}
 
 	return UpdateState::NewFrame;
 }
 
-bool DesktopDuplicationFrameSource::_InitializeDdpD3D(HANDLE hSharedTex) {
+bool DesktopDuplicationFrameSource::_InitializeDdpD3D() {
 	UINT createDeviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
 	if (Renderer::IsDebugLayersAvailable()) {
 		// 在 DEBUG 配置启用调试层
@@ -267,24 +246,59 @@ bool DesktopDuplicationFrameSource::_InitializeDdpD3D(HANDLE hSharedTex) {
 		return false;
 	}
 
-	// 获取共享纹理
-	hr = _ddpD3dDevice->OpenSharedResource(hSharedTex, IID_PPV_ARGS(&_ddpSharedTex));
-	if (FAILED(hr)) {
-		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("OpenSharedResource 失败", hr));
-		return false;
-	}
+	return true;
+}
 
-	hr = _ddpSharedTex.As<IDXGIKeyedMutex>(&_ddpSharedTexMutex);
-	if (FAILED(hr)) {
-		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("检索 IDXGIKeyedMutex 失败", hr));
-		return false;
+bool DesktopDuplicationFrameSource::_InitializeSlots(const D3D11_TEXTURE2D_DESC& desc) {
+	const auto& d3dDevice = App::GetInstance().GetRenderer().GetD3DDevice();
+
+	for (_Slot& slot : _slots) {
+		HRESULT hr = d3dDevice->CreateTexture2D(&desc, nullptr, &slot.tex);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
+			return false;
+		}
+
+		hr = slot.tex.As<IDXGIKeyedMutex>(&slot.mutex);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("检索 IDXGIKeyedMutex 失败", hr));
+			return false;
+		}
+
+		ComPtr<IDXGIResource> sharedDxgiRes;
+		hr = slot.tex.As<IDXGIResource>(&sharedDxgiRes);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("检索 IDXGIResource 失败", hr));
+			return false;
+		}
+
+		HANDLE hSharedTex = NULL;
+		hr = sharedDxgiRes->GetSharedHandle(&hSharedTex);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("GetSharedHandle 失败", hr));
+			return false;
+		}
+
+		// 获取共享纹理
+		hr = _ddpD3dDevice->OpenSharedResource(hSharedTex, IID_PPV_ARGS(&slot.ddpTex));
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("OpenSharedResource 失败", hr));
+			return false;
+		}
+
+		hr = slot.ddpTex.As<IDXGIKeyedMutex>(&slot.ddpMutex);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("检索 IDXGIKeyedMutex 失败", hr));
+			return false;
+		}
 	}
-	
+
 	return true;
 }
 
 DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParameter) {
 	DesktopDuplicationFrameSource& that = *(DesktopDuplicationFrameSource*)lpThreadParameter;
+	App::ThreadScope scope(that._app);
 
 	DXGI_OUTDUPL_FRAME_INFO info{};
 	ComPtr<IDXGIResource> dxgiRes;
@@ -363,13 +377,24 @@ DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParame
 			continue;
 		}
 
-		hr = that._ddpSharedTexMutex->AcquireSync(0, 100);
+		// 选择渲染器没有持有且不是待取走的纹理，渲染器一旦开始使用新帧，旧的纹理就可以再次写入
+		AcquireSRWLockExclusive(&that._slotLock);
+		int slotIdx = 0;
+		while (slotIdx == that._heldSlot || slotIdx == that._readySlot) {
+			++slotIdx;
+		}
+		ReleaseSRWLockExclusive(&that._slotLock);
+
+		_Slot& slot = that._slots[slotIdx];
+
+		// 渲染器可能还没有释放刚刚换下的纹理
+		hr = slot.ddpMutex->AcquireSync(0, 100);
 		while (hr == static_cast<HRESULT>(WAIT_TIMEOUT)) {
 			if (that._exiting.load()) {
 				return 0;
 			}
 
-			hr = that._ddpSharedTexMutex->AcquireSync(0, 100);
+			hr = slot.ddpMutex->AcquireSync(0, 100);
 		}
 
 		if (FAILED(hr)) {
@@ -377,10 +402,15 @@ DWORD WINAPI DesktopDuplicationFrameSource::_DDPThreadProc(LPVOID lpThreadParame
 			continue;
 		}
 
+		that._ddpD3dDC->CopySubresourceRegion(slot.ddpTex.Get(), 0, 0, 0, 0, d3dRes.Get(), 0, &that._frameInMonitor);
+		slot.ddpMutex->ReleaseSync(0);
+
+		// 渲染器没有取走的旧帧被丢弃
+		AcquireSRWLockExclusive(&that._slotLock);
+		that._readySlot = slotIdx;
+		ReleaseSRWLockExclusive(&that._slotLock);
 
-		that._ddpD3dDC->CopySubresourceRegion(that._ddpSharedTex.Get(), 0, 0, 0, 0, d3dRes.Get(), 0, &that._frameInMonitor);
-		that._ddpSharedTexMutex->ReleaseSync(1);
-		that._newFrameState.store(1);
+		App::GetInstance().GetRenderer().Wake();
 	}
 
 	return 0;
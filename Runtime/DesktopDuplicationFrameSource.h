@@ -1,5 +1,6 @@
 #pragma once
 #include "FrameSourceBase.h"
+#include <array>
 
 
 // 使用 Desktop Duplication API 捕获窗口
@@ -12,7 +13,19 @@ public:
 	bool Initialize() override;
 
 	ComPtr<ID3D11Texture2D> GetOutput() override {
-		return _output;
+		return _slots[0].tex;
+	}
+
+	UINT GetOutputCount() override {
+		return _SLOT_COUNT;
+	}
+
+	ComPtr<ID3D11Texture2D> GetOutputAt(UINT index) override {
+		return _slots[index].tex;
+	}
+
+	UINT GetOutputIndex() override {
+		return _heldSlot < 0 ? 0 : (UINT)_heldSlot;
 	}
 
 	UpdateState Update() override;
@@ -21,36 +34,51 @@ public:
 		return true;
 	}
 
+	bool IsFrameArrivalSignaled() override {
+		return true;
+	}
+
 	bool IsScreenCapture() override {
 		return true;
 	}
 
 private:
-	bool _InitializeDdpD3D(HANDLE hSharedTex);
+	bool _InitializeDdpD3D();
+
+	bool _InitializeSlots(const D3D11_TEXTURE2D_DESC& desc);
 
 	static DWORD WINAPI _DDPThreadProc(LPVOID lpThreadParameter);
 
-	ComPtr<ID3D11Texture2D> _output;
 	ComPtr<IDXGIOutputDuplication> _outputDup;
 	std::vector<BYTE> _dupMetaData;
 
 	HANDLE _hDDPThread = NULL;
 	std::atomic<bool> _exiting = false;
-	// 0: 等待新帧
-	// 1: 新帧到达
-	// 2: 等待第一帧
-	std::atomic<UINT> _newFrameState = 2;
 
 	// DDP 线程使用的 D3D 设备
 	ComPtr<ID3D11Device> _ddpD3dDevice;
 	ComPtr<ID3D11DeviceContext> _ddpD3dDC;
 
-	// 这些均指向同一个纹理
-	// 用于在 D3D Device 间同步对该纹理的访问
-	ComPtr<ID3D11Texture2D> _sharedTex;
-	ComPtr<IDXGIKeyedMutex> _sharedTexMutex;
-	ComPtr<ID3D11Texture2D> _ddpSharedTex;
-	ComPtr<IDXGIKeyedMutex> _ddpSharedTexMutex;
+	// DDP 线程轮流写入这些共享纹理，渲染器直接将它们作为效果的输入
+	// 三个纹理分别用于：渲染器正在使用、已写入等待渲染器取走、DDP 线程正在写入
+	static constexpr UINT _SLOT_COUNT = 3;
+
+	struct _Slot {
+		// 以下均指向同一个纹理
+		// 用于在 D3D Device 间同步对该纹理的访问，两边都只使用键 0
+		ComPtr<ID3D11Texture2D> tex;
+		ComPtr<IDXGIKeyedMutex> mutex;
+		ComPtr<ID3D11Texture2D> ddpTex;
+		ComPtr<IDXGIKeyedMutex> ddpMutex;
+	};
+	std::array<_Slot, _SLOT_COUNT> _slots;
+
+	// 由 _slotLock 保护，-1 表示没有
+	SRWLOCK _slotLock = SRWLOCK_INIT;
+	// 渲染器持有的纹理，直到取走下一帧前一直持有它的 keyed mutex
+	int _heldSlot = -1;
+	// DDP 线程最近写入完成的纹理
+	int _readySlot = -1;
 
 	RECT _srcClientInMonitor{};
 	D3D11_BOX _frameInMonitor{};
@@ -0,0 +1,570 @@
+#include "pch.h"
+#include "DeviceResources.h"
+#include "Utils.h"
+#include "StrUtils.h"
+#include "TextureLoader.h"
+#include "ResourcePool.h"
+#include <VertexTypes.h>
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+// 按适配器索引记录正在使用的共享资源，不延长它们的生命周期
+static std::unordered_map<UINT, std::weak_ptr<DeviceResources>> instances;
+static SRWLOCK instancesLock = SRWLOCK_INIT;
+
+
+std::shared_ptr<DeviceResources> DeviceResources::Get(UINT adapterIdx) {
+	AcquireSRWLockExclusive(&instancesLock);
+
+	std::shared_ptr<DeviceResources> result;
+	auto it = instances.find(adapterIdx);
+	if (it != instances.end()) {
+		result = it->second.lock();
+		if (result && result->IsDeviceRemoved()) {
+			SPDLOG_LOGGER_WARN(logger, "共享的 D3D 设备已被移除，将创建新的设备");
+			result.reset();
+		}
+	}
+
+	if (result) {
+		SPDLOG_LOGGER_INFO(logger, "复用其他会话的 D3D 设备");
+	} else {
+		result.reset(new DeviceResources());
+		if (result->_Initialize(adapterIdx)) {
+			instances[adapterIdx] = result;
+		} else {
+			SPDLOG_LOGGER_ERROR(logger, "初始化 DeviceResources 失败");
+			result.reset();
+		}
+	}
+
+	ReleaseSRWLockExclusive(&instancesLock);
+	return result;
+}
+
+static inline void LogAdapter(const DXGI_ADAPTER_DESC1& adapterDesc) {
+	SPDLOG_LOGGER_INFO(logger, fmt::format("当前图形适配器：\n\tVendorId：{:#x}\n\tDeviceId：{:#x}\n\t描述：{}",
+		adapterDesc.VendorId, adapterDesc.DeviceId, StrUtils::UTF16ToUTF8(adapterDesc.Description)));
+}
+
+static ComPtr<IDXGIAdapter1> ObtainGraphicsAdapter(IDXGIFactory1* dxgiFactory, UINT adapterIdx) {
+	ComPtr<IDXGIAdapter1> adapter;
+
+	HRESULT hr = dxgiFactory->EnumAdapters1(adapterIdx, adapter.ReleaseAndGetAddressOf());
+	if (SUCCEEDED(hr)) {
+		DXGI_ADAPTER_DESC1 desc;
+		HRESULT hr = adapter->GetDesc1(&desc);
+		if (FAILED(hr)) {
+			return nullptr;
+		}
+
+		LogAdapter(desc);
+		return adapter;
+	}
+
+	// 指定 GPU 失败，回落到普通方式
+	ComPtr<IDXGIAdapter1> warpAdapter;
+	DXGI_ADAPTER_DESC1 warpDesc;
+
+	for (UINT adapterIndex = 0;
+			SUCCEEDED(dxgiFactory->EnumAdapters1(adapterIndex,
+				adapter.ReleaseAndGetAddressOf()));
+			adapterIndex++
+	) {
+		DXGI_ADAPTER_DESC1 desc;
+		HRESULT hr = adapter->GetDesc1(&desc);
+		if (FAILED(hr)) {
+			return nullptr;
+		}
+
+		if (desc.Flags == DXGI_ADAPTER_FLAG_SOFTWARE) {
+			warpAdapter = adapter;
+			warpDesc = desc;
+			continue;
+		}
+
+		LogAdapter(desc);
+		return adapter;
+	}
+
+	// 回落到 Basic Render Driver Adapter（WARP）
+	// https://docs.microsoft.com/en-us/windows/win32/direct3darticles/directx-warp
+	if (warpAdapter) {
+		LogAdapter(warpDesc);
+		return warpAdapter;
+	} else {
+		return nullptr;
+	}
+}
+
+bool DeviceResources::_Initialize(UINT adapterIdx) {
+	HRESULT hr = CreateDXGIFactory1(IID_PPV_ARGS(_dxgiFactory.ReleaseAndGetAddressOf()));
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateDXGIFactory1 失败", hr));
+		return false;
+	}
+
+	UINT createDeviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
+	if (IsDebugLayersAvailable()) {
+		// 在 DEBUG 配置启用调试层
+		createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
+	}
+
+	D3D_FEATURE_LEVEL featureLevels[] = {
+		D3D_FEATURE_LEVEL_11_1,
+		D3D_FEATURE_LEVEL_11_0,
+		D3D_FEATURE_LEVEL_10_1,
+		D3D_FEATURE_LEVEL_10_0,
+		// 不支持功能级别 9.x，但这里加上没坏处
+		D3D_FEATURE_LEVEL_9_3,
+		D3D_FEATURE_LEVEL_9_2,
+		D3D_FEATURE_LEVEL_9_1,
+	};
+	UINT nFeatureLevels = ARRAYSIZE(featureLevels);
+
+	_graphicsAdapter = ObtainGraphicsAdapter(_dxgiFactory.Get(), adapterIdx);
+	if (!_graphicsAdapter) {
+		SPDLOG_LOGGER_ERROR(logger, "找不到可用 Adapter");
+		return false;
+	}
+
+	ComPtr<ID3D11Device> d3dDevice;
+	ComPtr<ID3D11DeviceContext> d3dDC;
+	hr = D3D11CreateDevice(
+		_graphicsAdapter.Get(),
+		D3D_DRIVER_TYPE_UNKNOWN,
+		nullptr,
+		createDeviceFlags,
+		featureLevels,
+		nFeatureLevels,
+		D3D11_SDK_VERSION,
+		&d3dDevice,
+		&_featureLevel,
+		&d3dDC
+	);
+
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("D3D11CreateDevice 失败", hr));
+		return false;
+	}
+
+	std::string_view fl;
+	switch (_featureLevel) {
+	case D3D_FEATURE_LEVEL_11_1:
+		fl = "11.1";
+		break;
+	case D3D_FEATURE_LEVEL_11_0:
+		fl = "11.0";
+		break;
+	case D3D_FEATURE_LEVEL_10_1:
+		fl = "10.1";
+		break;
+	case D3D_FEATURE_LEVEL_10_0:
+		fl = "10.0";
+		break;
+	case D3D_FEATURE_LEVEL_9_3:
+		fl = "9.3";
+		break;
+	case D3D_FEATURE_LEVEL_9_2:
+		fl = "9.2";
+		break;
+	case D3D_FEATURE_LEVEL_9_1:
+		fl = "9.1";
+		break;
+	default:
+		fl = "未知";
+		break;
+	}
+	SPDLOG_LOGGER_INFO(logger, fmt::format("已创建 D3D Device\n\t功能级别：{}", fl));
+
+	hr = d3dDevice.As<ID3D11Device1>(&_d3dDevice);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("获取 ID3D11Device1 失败", hr));
+		return false;
+	}
+
+	hr = d3dDC.As<ID3D11DeviceContext1>(&_d3dDC);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("获取 ID3D11DeviceContext1 失败", hr));
+		return false;
+	}
+
+	hr = _d3dDevice.As<IDXGIDevice1>(&_dxgiDevice);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("获取 IDXGIDevice 失败", hr));
+		return false;
+	}
+
+	// 多个会话的渲染线程、主线程和加载效果的线程都使用立即上下文
+	hr = _d3dDC.As<ID3D11Multithread>(&_d3dMultithread);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("获取 ID3D11Multithread 失败", hr));
+		return false;
+	}
+	_d3dMultithread->SetMultithreadProtected(TRUE);
+
+	return true;
+}
+
+bool DeviceResources::CompileShader(D3D_FEATURE_LEVEL featureLevel, ShaderType type, std::string_view hlsl,
+	const char* entryPoint, ID3DBlob** blob, const char* sourceName, ID3DInclude* include
+) {
+	ComPtr<ID3DBlob> errorMsgs = nullptr;
+
+	UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
+	const char* target;
+	const char* typeName;
+	if (type == ShaderType::Vertex) {
+		target = featureLevel >= D3D_FEATURE_LEVEL_11_0 ? "vs_5_0" :
+			(featureLevel == D3D_FEATURE_LEVEL_10_1 ? "vs_4_1" : "vs_4_0");
+		typeName = "顶点";
+	} else if (type == ShaderType::Pixel) {
+		target = featureLevel >= D3D_FEATURE_LEVEL_11_0 ? "ps_5_0" :
+			(featureLevel == D3D_FEATURE_LEVEL_10_1 ? "ps_4_1" : "ps_4_0");
+		typeName = "像素";
+	} else {
+		// cs_4_x 无法写入 RWTexture2D，因此只支持 cs_5_0
+		if (featureLevel < D3D_FEATURE_LEVEL_11_0) {
+			SPDLOG_LOGGER_ERROR(logger, "计算着色器需要功能级别 11.0");
+			return false;
+		}
+		target = "cs_5_0";
+		typeName = "计算";
+	}
+
+	HRESULT hr = D3DCompile(hlsl.data(), hlsl.size(), sourceName, nullptr, include,
+		entryPoint, target, flags, 0, blob, &errorMsgs);
+	if (FAILED(hr)) {
+		if (errorMsgs) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg(fmt::format("编译{}着色器失败：{}",
+				typeName, (const char*)errorMsgs->GetBufferPointer()), hr));
+		}
+		return false;
+	} else {
+		if (errorMsgs) {
+			// 显示警告消息
+			SPDLOG_LOGGER_WARN(logger, fmt::format("编译{}着色器时产生警告：{}",
+				typeName, (const char*)errorMsgs->GetBufferPointer()));
+		}
+	}
+
+	return true;
+}
+
+bool DeviceResources::IsDebugLayersAvailable() {
+#ifdef _DEBUG
+	static std::optional<bool> result = std::nullopt;
+
+	if (!result.has_value()) {
+		HRESULT hr = D3D11CreateDevice(
+			nullptr,
+			D3D_DRIVER_TYPE_NULL,       // There is no need to create a real hardware device.
+			nullptr,
+			D3D11_CREATE_DEVICE_DEBUG,  // Check for the SDK layers.
+			nullptr,                    // Any feature level will do.
+			0,
+			D3D11_SDK_VERSION,
+			nullptr,                    // No need to keep the D3D device reference.
+			nullptr,                    // No need to know the feature level.
+			nullptr                     // No need to keep the D3D device context reference.
+		);
+
+		result = SUCCEEDED(hr);
+	}
+
+	return result.value_or(false);
+#else
+	// Relaese 配置不使用调试层
+	return false;
+#endif
+}
+
+bool DeviceResources::GetSampler(EffectSamplerFilterType filterType, EffectSamplerAddressType addressType, ID3D11SamplerState** result) {
+	ID3D11SamplerState** sampler;
+	D3D11_TEXTURE_ADDRESS_MODE addressMode;
+	D3D11_FILTER filter;
+
+	if (filterType == EffectSamplerFilterType::Linear) {
+		filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+		if (addressType == EffectSamplerAddressType::Clamp) {
+			sampler = _linearClampSampler.GetAddressOf();
+			addressMode = D3D11_TEXTURE_ADDRESS_CLAMP;
+		} else {
+			sampler = _linearWrapSampler.GetAddressOf();
+			addressMode = D3D11_TEXTURE_ADDRESS_WRAP;
+		}
+	} else {
+		filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+		if (addressType == EffectSamplerAddressType::Clamp) {
+			sampler = _pointClampSampler.GetAddressOf();
+			addressMode = D3D11_TEXTURE_ADDRESS_CLAMP;
+		} else {
+			sampler = _pointWrapSampler.GetAddressOf();
+			addressMode = D3D11_TEXTURE_ADDRESS_WRAP;
+		}
+	}
+
+	AcquireSRWLockExclusive(&_lock);
+
+	if (*sampler) {
+		*result = *sampler;
+		ReleaseSRWLockExclusive(&_lock);
+		return true;
+	}
+
+	D3D11_SAMPLER_DESC desc{};
+	desc.Filter = filter;
+	desc.AddressU = addressMode;
+	desc.AddressV = addressMode;
+	desc.AddressW = addressMode;
+	desc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	desc.MinLOD = 0;
+	desc.MaxLOD = 0;
+	HRESULT hr = _d3dDevice->CreateSamplerState(&desc, sampler);
+	*result = *sampler;
+
+	ReleaseSRWLockExclusive(&_lock);
+
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 ID3D11SamplerState 出错", hr));
+		return false;
+	}
+
+	return true;
+}
+
+bool DeviceResources::GetAlphaBlendState(ID3D11BlendState** result) {
+	AcquireSRWLockExclusive(&_lock);
+
+	if (!_alphaBlendState) {
+		D3D11_BLEND_DESC desc{};
+		desc.RenderTarget[0].BlendEnable = TRUE;
+		desc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+		desc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+		desc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+		desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+		desc.RenderTarget[0].BlendOp = desc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+		HRESULT hr = _d3dDevice->CreateBlendState(&desc, &_alphaBlendState);
+		if (FAILED(hr)) {
+			ReleaseSRWLockExclusive(&_lock);
+			SPDLOG_LOGGER_CRITICAL(logger, MakeComErrorMsg("CreateBlendState 失败", hr));
+			return false;
+		}
+	}
+
+	*result = _alphaBlendState.Get();
+
+	ReleaseSRWLockExclusive(&_lock);
+	return true;
+}
+
+bool DeviceResources::GetFillVS(ID3D11VertexShader** result) {
+	AcquireSRWLockExclusive(&_lock);
+
+	if (!_fillVS) {
+		const char* src = "void m(uint i:SV_VERTEXID,out float4 p:SV_POSITION,out float2 c:TEXCOORD){c=float2(i&1,i>>1)*2;p=float4(c.x*2-1,-c.y*2+1,0,1);}";
+
+		ComPtr<ID3DBlob> blob;
+		if (!CompileShader(ShaderType::Vertex, src, "m", &blob, "FillVS")) {
+			ReleaseSRWLockExclusive(&_lock);
+			SPDLOG_LOGGER_ERROR(logger, "编译 FillVS 失败");
+			return false;
+		}
+
+		HRESULT hr = _d3dDevice->CreateVertexShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &_fillVS);
+		if (FAILED(hr)) {
+			ReleaseSRWLockExclusive(&_lock);
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 FillVS 失败", hr));
+			return false;
+		}
+	}
+
+	*result = _fillVS.Get();
+
+	ReleaseSRWLockExclusive(&_lock);
+	return true;
+}
+
+bool DeviceResources::GetSimpleVS(ID3D11VertexShader** result, ID3D11InputLayout** inputLayout) {
+	AcquireSRWLockExclusive(&_lock);
+
+	if (!_simpleVS) {
+		const char* src = "void m(float4 p:SV_POSITION,float2 c:TEXCOORD,out float4 q:SV_POSITION,out float2 d:TEXCOORD) {q=p;d=c;}";
+
+		ComPtr<ID3DBlob> blob;
+		if (!CompileShader(ShaderType::Vertex, src, "m", &blob, "SimpleVS")) {
+			ReleaseSRWLockExclusive(&_lock);
+			SPDLOG_LOGGER_ERROR(logger, "编译 SimpleVS 失败");
+			return false;
+		}
+
+		ComPtr<ID3D11VertexShader> simpleVS;
+		HRESULT hr = _d3dDevice->CreateVertexShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &simpleVS);
+		if (FAILED(hr)) {
+			ReleaseSRWLockExclusive(&_lock);
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 SimpleVS 失败", hr));
+			return false;
+		}
+
+		hr = _d3dDevice->CreateInputLayout(
+			VertexPositionTexture::InputElements,
+			VertexPositionTexture::InputElementCount,
+			blob->GetBufferPointer(),
+			blob->GetBufferSize(),
+			&_simpleIL
+		);
+		if (FAILED(hr)) {
+			ReleaseSRWLockExclusive(&_lock);
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 SimpleVS 输入布局失败", hr));
+			return false;
+		}
+
+		// 输入布局也创建成功后才记录，否则下次调用会跳过输入布局
+		_simpleVS = std::move(simpleVS);
+	}
+
+	*result = _simpleVS.Get();
+	*inputLayout = _simpleIL.Get();
+
+	ReleaseSRWLockExclusive(&_lock);
+	return true;
+}
+
+bool DeviceResources::GetCopyPS(ID3D11PixelShader** result) {
+	AcquireSRWLockExclusive(&_lock);
+
+	if (!_copyPS) {
+		const char* src = "Texture2D t:register(t0);SamplerState s:register(s0);float4 m(float4 p:SV_POSITION,float2 c:TEXCOORD):SV_Target{return t.Sample(s,c);}";
+
+		ComPtr<ID3DBlob> blob;
+		if (!CompileShader(ShaderType::Pixel, src, "m", &blob, "CopyPS")) {
+			ReleaseSRWLockExclusive(&_lock);
+			SPDLOG_LOGGER_ERROR(logger, "编译 CopyPS 失败");
+			return false;
+		}
+
+		HRESULT hr = _d3dDevice->CreatePixelShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &_copyPS);
+		if (FAILED(hr)) {
+			ReleaseSRWLockExclusive(&_lock);
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 CopyPS 失败", hr));
+			return false;
+		}
+	}
+
+	*result = _copyPS.Get();
+
+	ReleaseSRWLockExclusive(&_lock);
+	return true;
+}
+
+bool DeviceResources::_HashBytecode(ID3DBlob* cso, std::string& result) {
+	std::vector<BYTE> hash;
+	if (!Utils::Hasher::GetInstance().Hash(cso->GetBufferPointer(), cso->GetBufferSize(), hash)) {
+		SPDLOG_LOGGER_ERROR(logger, "计算 hash 失败");
+		return false;
+	}
+
+	result.assign(hash.begin(), hash.end());
+	return true;
+}
+
+bool DeviceResources::GetPixelShader(ID3DBlob* cso, ID3D11PixelShader** result) {
+	std::string key;
+	if (!_HashBytecode(cso, key)) {
+		return false;
+	}
+
+	AcquireSRWLockExclusive(&_lock);
+
+	ComPtr<ID3D11PixelShader>& shader = _pixelShaders[key];
+	if (!shader) {
+		HRESULT hr = _d3dDevice->CreatePixelShader(cso->GetBufferPointer(), cso->GetBufferSize(), nullptr, &shader);
+		if (FAILED(hr)) {
+			_pixelShaders.erase(key);
+			ReleaseSRWLockExclusive(&_lock);
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建像素着色器失败", hr));
+			return false;
+		}
+	}
+
+	*result = shader.Get();
+	(*result)->AddRef();
+
+	ReleaseSRWLockExclusive(&_lock);
+	return true;
+}
+
+bool DeviceResources::GetComputeShader(ID3DBlob* cso, ID3D11ComputeShader** result) {
+	std::string key;
+	if (!_HashBytecode(cso, key)) {
+		return false;
+	}
+
+	AcquireSRWLockExclusive(&_lock);
+
+	ComPtr<ID3D11ComputeShader>& shader = _computeShaders[key];
+	if (!shader) {
+		HRESULT hr = _d3dDevice->CreateComputeShader(cso->GetBufferPointer(), cso->GetBufferSize(), nullptr, &shader);
+		if (FAILED(hr)) {
+			_computeShaders.erase(key);
+			ReleaseSRWLockExclusive(&_lock);
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建计算着色器失败", hr));
+			return false;
+		}
+	}
+
+	*result = shader.Get();
+	(*result)->AddRef();
+
+	ReleaseSRWLockExclusive(&_lock);
+	return true;
+}
+
+ComPtr<ID3D11Texture2D> DeviceResources::GetAsset(const wchar_t* fileName) {
+	std::vector<BYTE> data;
+	if (!Utils::ReadFile(fileName, data)) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("读取 {} 失败", StrUtils::UTF16ToUTF8(fileName)));
+		return nullptr;
+	}
+
+	std::vector<BYTE> hash;
+	if (!Utils::Hasher::GetInstance().Hash(data.data(), data.size(), hash)) {
+		SPDLOG_LOGGER_ERROR(logger, "计算 hash 失败");
+		return nullptr;
+	}
+
+	AcquireSRWLockExclusive(&_lock);
+
+	auto it = _assets.find(fileName);
+	if (it != _assets.end() && it->second.hash == hash) {
+		ComPtr<ID3D11Texture2D> texture = it->second.texture;
+		ReleaseSRWLockExclusive(&_lock);
+
+		SPDLOG_LOGGER_INFO(logger, fmt::format("复用已加载的纹理 {}", StrUtils::UTF16ToUTF8(fileName)));
+		return texture;
+	}
+
+	ComPtr<ID3D11Texture2D> texture = TextureLoader::Load(fileName);
+	if (texture) {
+		// 文件被修改时替换旧的纹理，仍在使用旧纹理的效果不受影响
+		_assets[fileName] = { std::move(hash), texture };
+	}
+
+	ReleaseSRWLockExclusive(&_lock);
+	return texture;
+}
+
+void DeviceResources::GetAssetFootprint(UINT& count, size_t& size) {
+	AcquireSRWLockShared(&_lock);
+
+	count = (UINT)_assets.size();
+	size = 0;
+	for (const auto& [fileName, asset] : _assets) {
+		size += ResourcePool::GetTextureSize(asset.texture.Get());
+	}
+
+	ReleaseSRWLockShared(&_lock);
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include "pch.h"
+#include "EffectDesc.h"
+
+
+// 同一进程中所有缩放会话共享的 D3D 资源，每个图形适配器一份
+// 包括设备、采样器、内置着色器、效果的着色器对象和从文件加载的纹理
+// 交换链、帧源和效果的中间纹理属于各个会话，由 Renderer 管理
+// 立即上下文由所有会话共享，设置管线状态和绘制前必须调用 LockContext
+class DeviceResources {
+public:
+	// 已有会话在使用这个适配器时返回同一个对象，否则创建新的设备。失败时返回空
+	// 所有会话都释放后设备被销毁
+	static std::shared_ptr<DeviceResources> Get(UINT adapterIdx);
+
+	ComPtr<ID3D11Device1> GetD3DDevice() const {
+		return _d3dDevice;
+	}
+
+	ComPtr<ID3D11DeviceContext1> GetD3DDC() const {
+		return _d3dDC;
+	}
+
+	ComPtr<IDXGIDevice1> GetDXGIDevice() const {
+		return _dxgiDevice;
+	}
+
+	ComPtr<IDXGIFactory2> GetDXGIFactory() const {
+		return _dxgiFactory;
+	}
+
+	ComPtr<IDXGIAdapter1> GetGraphicsAdapter() const {
+		return _graphicsAdapter;
+	}
+
+	D3D_FEATURE_LEVEL GetFeatureLevel() const {
+		return _featureLevel;
+	}
+
+	// 锁定立即上下文，直到调用 UnlockContext。同一线程可以递归锁定
+	// 立即上下文开启了多线程保护，单个调用（如 CopyResource、Map）可以不锁定，
+	// 但管线状态在两次锁定之间可能被其他会话改变，锁定后应先清空状态
+	void LockContext() {
+		_d3dMultithread->Enter();
+	}
+
+	void UnlockContext() {
+		_d3dMultithread->Leave();
+	}
+
+	// 设备被移除后不再复用此对象
+	bool IsDeviceRemoved() const {
+		return _d3dDevice->GetDeviceRemovedReason() != S_OK;
+	}
+
+	enum class ShaderType {
+		Vertex,
+		Pixel,
+		// 需要功能级别 11.0
+		Compute
+	};
+
+	bool CompileShader(ShaderType type, std::string_view hlsl, const char* entryPoint,
+		ID3DBlob** blob, const char* sourceName = nullptr, ID3DInclude* include = nullptr) const {
+		return CompileShader(_featureLevel, type, hlsl, entryPoint, blob, sourceName, include);
+	}
+
+	// 按 featureLevel 选择着色器模型，编译不需要设备，因此可以在没有会话时使用
+	static bool CompileShader(D3D_FEATURE_LEVEL featureLevel, ShaderType type, std::string_view hlsl,
+		const char* entryPoint, ID3DBlob** blob, const char* sourceName = nullptr, ID3DInclude* include = nullptr);
+
+	// 测试 D3D 调试层是否可用
+	static bool IsDebugLayersAvailable();
+
+	// 以下函数可以在任意线程调用
+
+	bool GetSampler(EffectSamplerFilterType filterType, EffectSamplerAddressType addressType, ID3D11SamplerState** result);
+
+	bool GetAlphaBlendState(ID3D11BlendState** result);
+
+	bool GetFillVS(ID3D11VertexShader** result);
+
+	bool GetSimpleVS(ID3D11VertexShader** result, ID3D11InputLayout** inputLayout);
+
+	bool GetCopyPS(ID3D11PixelShader** result);
+
+	// 效果的着色器对象按字节码的 hash 共享，不同会话或重新加载的效果不会重复创建
+	bool GetPixelShader(ID3DBlob* cso, ID3D11PixelShader** result);
+
+	bool GetComputeShader(ID3DBlob* cso, ID3D11ComputeShader** result);
+
+	// 从 effects 文件夹加载纹理，内容相同时返回同一个纹理
+	ComPtr<ID3D11Texture2D> GetAsset(const wchar_t* fileName);
+
+	// 已加载的纹理的数量和估计的占用字节数
+	void GetAssetFootprint(UINT& count, size_t& size);
+
+private:
+	DeviceResources() {}
+
+	bool _Initialize(UINT adapterIdx);
+
+	// 返回字节码的 hash，用作着色器对象的键
+	static bool _HashBytecode(ID3DBlob* cso, std::string& result);
+
+	D3D_FEATURE_LEVEL _featureLevel = D3D_FEATURE_LEVEL_10_0;
+
+	ComPtr<IDXGIFactory2> _dxgiFactory;
+	ComPtr<IDXGIDevice1> _dxgiDevice;
+	ComPtr<IDXGIAdapter1> _graphicsAdapter;
+	ComPtr<ID3D11Device1> _d3dDevice;
+	ComPtr<ID3D11DeviceContext1> _d3dDC;
+	ComPtr<ID3D11Multithread> _d3dMultithread;
+
+	// 保护以下所有延迟创建的对象，它们可能在后台加载效果的线程上创建
+	SRWLOCK _lock = SRWLOCK_INIT;
+
+	ComPtr<ID3D11SamplerState> _linearClampSampler;
+	ComPtr<ID3D11SamplerState> _pointClampSampler;
+	ComPtr<ID3D11SamplerState> _linearWrapSampler;
+	ComPtr<ID3D11SamplerState> _pointWrapSampler;
+	ComPtr<ID3D11BlendState> _alphaBlendState;
+
+	ComPtr<ID3D11VertexShader> _fillVS;
+	ComPtr<ID3D11VertexShader> _simpleVS;
+	ComPtr<ID3D11InputLayout> _simpleIL;
+	ComPtr<ID3D11PixelShader> _copyPS;
+
+	// 键为字节码的 hash，设备销毁前不会淘汰
+	std::unordered_map<std::string, ComPtr<ID3D11PixelShader>> _pixelShaders;
+	std::unordered_map<std::string, ComPtr<ID3D11ComputeShader>> _computeShaders;
+
+	struct _Asset {
+		std::vector<BYTE> hash;
+		ComPtr<ID3D11Texture2D> texture;
+	};
+
+	std::unordered_map<std::wstring, _Asset> _assets;
+};
@@ -18,6 +18,11 @@
 #include "App.h"
 #include "Utils.h"
 #include "StrUtils.h"
+#include "BatchProcessor.h"
+#include "EffectCache.h"
+#include "CpuSharpen.h"
+#include "GpuEffectChain.h"
+#include <spdlog/sinks/stdout_sinks.h>
 
 
 static HINSTANCE hInst = NULL;
@@ -34,7 +39,7 @@ BOOL APIENTRY DllMain(
 		hInst = hModule;
 		break;
 	case DLL_PROCESS_DETACH:
-		App::GetInstance().~App();
+		App::Uninitialize();
 		break;
 	case DLL_THREAD_ATTACH:
 		break;
@@ -78,7 +83,7 @@ API_DECLSPEC BOOL WINAPI Initialize(
 	SetLogLevel(logLevel);
 
 	// 初始化 App
-	if (!App::GetInstance().Initialize(hInst)) {
+	if (!App::Initialize(hInst)) {
 		return FALSE;
 	}
 
@@ -126,28 +131,147 @@ API_DECLSPEC const char* WINAPI Run(
 		}
 	}
 
-	App& app = App::GetInstance();
-	if (!app.Run(hwndSrc, effectsJson, captureMode, frameRate,
+	// 每次调用 Run 是一个独立的会话，多个线程可以同时调用
+	App app;
+	App::ThreadScope scope(&app);
+	const bool success = app.Run(hwndSrc, effectsJson, captureMode, frameRate,
 		cursorZoomFactor, cursorInterpolationMode, adapterIdx, multiMonitorUsage,
-		RECT{(LONG)cropLeft, (LONG)cropTop, (LONG)cropRight, (LONG)cropBottom}, flags)
-	) {
+		RECT{(LONG)cropLeft, (LONG)cropTop, (LONG)cropRight, (LONG)cropBottom}, flags);
+
+	// 缓存在后台写入，返回前等待完成
+	EffectCache::GetInstance().Flush();
+
+	if (!success) {
 		// 初始化失败
 		SPDLOG_LOGGER_INFO(logger, "App.Run 失败");
 		return app.GetErrorMsg();
 	}
 
+	const EffectCache::MemCacheStats stats = EffectCache::GetInstance().GetMemCacheStats();
+	SPDLOG_LOGGER_INFO(logger, fmt::format("内存缓存：命中 {} 次，未命中 {} 次，淘汰 {} 项，当前 {} 项共 {} KB",
+		stats.hits, stats.misses, stats.evictions, stats.count, stats.size / 1024));
+
 	SPDLOG_LOGGER_INFO(logger, "即将退出");
 	logger->flush();
 
 	return nullptr;
 }
 
+// 每处理完一张图像调用一次，可能在任意工作线程上调用
+typedef void (WINAPI* BatchProgressCallback)(UINT processed, UINT total);
+
+// 离线处理图像，不需要源窗口
+// gpuAdapter 小于 0 时使用 CPU 实现的效果，不需要 D3D 设备；否则在该显卡上执行 MagpieFX 效果
+// 所有图像都处理成功时返回 TRUE
+API_DECLSPEC BOOL WINAPI RunBatch(
+	const char* effectsJson,
+	const wchar_t* input,	// 文件夹、单个文件或带通配符的路径
+	const wchar_t* outputDir,
+	const wchar_t* outputFormat,	// 输出文件的扩展名，为空时和输入相同
+	UINT decodeThreads,	// 各阶段的线程数，0：自动
+	UINT processThreads,
+	UINT encodeThreads,
+	UINT queueCapacity,	// 0：默认
+	UINT memoryBudgetMB,	// 0：默认
+	UINT tileSize,	// 超出内存预算的图像分块处理时块的边长，0：自动
+	int gpuAdapter,	// -1：使用 CPU
+	BatchProgressCallback progressCallback
+) {
+	BatchProcessor::Options options;
+	options.decodeThreads = decodeThreads;
+	options.processThreads = processThreads;
+	options.encodeThreads = encodeThreads;
+	options.tileSize = tileSize;
+	options.gpuAdapter = gpuAdapter;
+	if (queueCapacity > 0) {
+		options.queueCapacity = queueCapacity;
+	}
+	if (memoryBudgetMB > 0) {
+		options.memoryBudget = size_t(memoryBudgetMB) << 20;
+	}
+	if (outputFormat) {
+		options.outputFormat = outputFormat;
+	}
+
+	BatchProcessor::ProgressCallback callback;
+	if (progressCallback) {
+		callback = [progressCallback](UINT processed, UINT total) {
+			progressCallback(processed, total);
+		};
+	}
+
+	BatchProcessor::Result result;
+	if (!BatchProcessor().Run(effectsJson, input, outputDir, options, callback, result)) {
+		SPDLOG_LOGGER_ERROR(logger, "批处理失败");
+		logger->flush();
+		return FALSE;
+	}
+
+	logger->flush();
+	return result.failed == 0;
+}
+
+// 在合成图像上测量 CPU 锐化效果的吞吐量，结果写入日志并输出到控制台
+// 参数为 0 时使用 CpuSharpen::Benchmark 的默认值
+API_DECLSPEC void WINAPI RunCpuBenchmark(UINT width, UINT height, UINT iterations) {
+	// 临时添加控制台输出并确保输出 INFO 级别的结果，此时没有其他线程写日志
+	const spdlog::level::level_enum logLevel = logger->level();
+	logger->set_level(std::min(logLevel, spdlog::level::info));
+
+	auto consoleSink = std::make_shared<spdlog::sinks::stdout_sink_mt>();
+	consoleSink->set_level(spdlog::level::info);
+	consoleSink->set_pattern("%v");
+	logger->sinks().push_back(consoleSink);
+
+	CpuSharpen::Benchmark(width ? width : 3840, height ? height : 2160, iterations ? iterations : 5);
+
+	logger->flush();
+	logger->sinks().pop_back();
+	logger->set_level(logLevel);
+}
+
+// 在参考图像上比较两个效果链的吞吐量和输出，结果写入日志并输出到控制台
+// 参数为 0 时使用 GpuEffectChain::Benchmark 的默认值
+API_DECLSPEC void WINAPI RunGpuBenchmark(
+	UINT adapterIdx,
+	const char* baselineJson,
+	const char* effectsJson,
+	UINT width,
+	UINT height,
+	UINT iterations
+) {
+	const spdlog::level::level_enum logLevel = logger->level();
+	logger->set_level(std::min(logLevel, spdlog::level::info));
+
+	auto consoleSink = std::make_shared<spdlog::sinks::stdout_sink_mt>();
+	consoleSink->set_level(spdlog::level::info);
+	consoleSink->set_pattern("%v");
+	logger->sinks().push_back(consoleSink);
+
+	GpuEffectChain::Benchmark(adapterIdx, baselineJson, effectsJson,
+		width ? width : 1920, height ? height : 1080, iterations ? iterations : 20);
+
+	logger->flush();
+	logger->sinks().pop_back();
+	logger->set_level(logLevel);
+}
+
 
 // ----------------------------------------------------------------------------------------
 // 以下函数在用户界面的主线程上调用
 
 
 
+// 全屏期间更换所有会话的效果，未全屏时什么也不做
+API_DECLSPEC void WINAPI SetEffects(const char* effectsJson) {
+	App::SetEffectsJson(NULL, effectsJson);
+}
+
+// 只更换缩放 hwndSrc 的会话的效果
+API_DECLSPEC void WINAPI SetSessionEffects(HWND hwndSrc, const char* effectsJson) {
+	App::SetEffectsJson(hwndSrc, effectsJson);
+}
+
 API_DECLSPEC const char* WINAPI GetAllGraphicsAdapters(const char* delimiter) {
 	static std::string result;
 	result.clear();
@@ -3,6 +3,7 @@
 #include <yas/mem_streams.hpp>
 #include <yas/binary_oarchive.hpp>
 #include <yas/binary_iarchive.hpp>
+#include <yas/types/std/array.hpp>
 #include <yas/types/std/pair.hpp>
 #include <yas/types/std/string.hpp>
 #include <yas/types/std/vector.hpp>
@@ -127,12 +128,12 @@ void serialize(Archive& ar, EffectSamplerDesc& o) {
 
 template<typename Archive>
 void serialize(Archive& ar, EffectPassDesc& o) {
-	ar& o.inputs& o.outputs& o.cso;
+	ar& o.inputs& o.outputs& o.cso& o.isCompute& o.blockSize& o.numThreads& o.condition& o.usedInputs& o.usedSamplers& o.usedConstantBuffers;
 }
 
 template<typename Archive>
 void serialize(Archive& ar, EffectDesc& o) {
-	ar& o.outSizeExpr& o.constants& o.valueConstants& o.dynamicValueConstants& o.textures& o.samplers& o.passes;
+	ar& o.outSizeExpr& o.halfPrecision& o.halo& o.constants& o.valueConstants& o.dynamicValueConstants& o.textures& o.samplers& o.passes;
 }
 
 
@@ -153,47 +154,125 @@ std::wstring EffectCache::_GetCacheFileName(const wchar_t* fileName, std::string
 	return fmt::format(L".\\cache\\{}_{}.{}", ConvertFileName(fileName), StrUtils::UTF8ToUTF16(hash), _SUFFIX);
 }
 
-void EffectCache::_AddToMemCache(const std::wstring& cacheFileName, const EffectDesc& desc) {
-	_memCache[cacheFileName] = desc;
+size_t EffectCache::_EstimateMemSize(const EffectDesc& desc) {
+	size_t size = sizeof(EffectDesc) + desc.outSizeExpr.first.size() + desc.outSizeExpr.second.size();
 
-	if (_memCache.size() > _MAX_CACHE_COUNT) {
-		// 清理一半内存缓存
-		auto it = _memCache.begin();
-		std::advance(it, _memCache.size() / 2);
-		_memCache.erase(_memCache.begin(), it);
+	for (const EffectConstantDesc& d : desc.constants) {
+		size += sizeof(d) + d.name.size() + d.label.size();
+	}
+	for (const auto* constants : { &desc.valueConstants, &desc.dynamicValueConstants }) {
+		for (const EffectValueConstantDesc& d : *constants) {
+			size += sizeof(d) + d.name.size() + d.valueExpr.size();
+		}
+	}
+	for (const EffectIntermediateTextureDesc& d : desc.textures) {
+		size += sizeof(d) + d.name.size() + d.source.size() + d.sizeExpr.first.size() + d.sizeExpr.second.size();
+	}
+	for (const EffectSamplerDesc& d : desc.samplers) {
+		size += sizeof(d) + d.name.size();
+	}
+	for (const EffectPassDesc& d : desc.passes) {
+		size += sizeof(d) + (d.inputs.size() + d.outputs.size()) * sizeof(UINT);
+		if (d.cso) {
+			size += d.cso->GetBufferSize();
+		}
+	}
+
+	return size;
+}
 
-		SPDLOG_LOGGER_INFO(logger, "已清理内存缓存");
+void EffectCache::_AddToMemCache(const std::wstring& cacheFileName, const std::shared_ptr<const EffectDesc>& desc) {
+	const size_t size = _EstimateMemSize(*desc);
+
+	AcquireSRWLockExclusive(&_memCacheLock);
+
+	auto it = _memCacheMap.find(cacheFileName);
+	if (it != _memCacheMap.end()) {
+		_memCacheSize -= it->second->size;
+		_memCache.erase(it->second);
+		_memCacheMap.erase(it);
+	}
+
+	_memCache.push_front({ cacheFileName, desc, size });
+	_memCacheMap.emplace(cacheFileName, _memCache.begin());
+	_memCacheSize += size;
+
+	// 淘汰最久未使用的项，刚加入的项总是保留
+	size_t evicted = 0;
+	while (_memCacheSize > _MAX_MEM_CACHE_SIZE && _memCache.size() > 1) {
+		const _MemCacheItem& item = _memCache.back();
+		_memCacheSize -= item.size;
+		_memCacheMap.erase(item.cacheFileName);
+		_memCache.pop_back();
+		++evicted;
+	}
+	_memCacheStats.evictions += evicted;
+
+	ReleaseSRWLockExclusive(&_memCacheLock);
+
+	if (evicted > 0) {
+		SPDLOG_LOGGER_INFO(logger, fmt::format("已从内存缓存中淘汰 {} 项", evicted));
 	}
 }
 
+EffectCache::MemCacheStats EffectCache::GetMemCacheStats() {
+	AcquireSRWLockShared(&_memCacheLock);
+	MemCacheStats stats = _memCacheStats;
+	stats.count = _memCache.size();
+	stats.size = _memCacheSize;
+	ReleaseSRWLockShared(&_memCacheLock);
 
-bool EffectCache::Load(const wchar_t* fileName, std::string_view hash, EffectDesc& desc) {
-	if (App::GetInstance().IsDisableEffectCache()) {
-		return false;
+	return stats;
+}
+
+
+// 没有会话时（如测试中）缓存总是启用
+static bool IsCacheDisabled() {
+	App* app = App::GetCurrent();
+	return app && app->IsDisableEffectCache();
+}
+
+std::shared_ptr<const EffectDesc> EffectCache::Load(const wchar_t* fileName, std::string_view hash) {
+	if (IsCacheDisabled()) {
+		return nullptr;
 	}
 
 	std::wstring cacheFileName = _GetCacheFileName(fileName, hash);
 
-	auto it = _memCache.find(cacheFileName);
-	if (it != _memCache.end()) {
-		desc = it->second;
-		return true;
+	{
+		std::shared_ptr<const EffectDesc> result;
+
+		AcquireSRWLockExclusive(&_memCacheLock);
+		auto it = _memCacheMap.find(cacheFileName);
+		if (it != _memCacheMap.end()) {
+			// 移到最前
+			_memCache.splice(_memCache.begin(), _memCache, it->second);
+			result = it->second->desc;
+			++_memCacheStats.hits;
+		} else {
+			++_memCacheStats.misses;
+		}
+		ReleaseSRWLockExclusive(&_memCacheLock);
+
+		if (result) {
+			return result;
+		}
 	}
 
 	if (!Utils::FileExists(cacheFileName.c_str())) {
-		return false;
+		return nullptr;
 	}
 	
 	std::vector<BYTE> buf;
 	if (!Utils::ReadFile(cacheFileName.c_str(), buf) || buf.empty()) {
-		return false;
+		return nullptr;
 	}
 
 	if (buf.size() < 100) {
-		return false;
+		return nullptr;
 	}
 	
-	// 格式：HASH-VERSION-FL-{BODY}
+	// 格式：HASH-VERSION-{BODY}
 
 	// 检查哈希
 	std::vector<BYTE> bufHash;
@@ -203,14 +282,15 @@ bool EffectCache::Load(const wchar_t* fileName, std::string_view hash, EffectDes
 		bufHash
 	)) {
 		SPDLOG_LOGGER_ERROR(logger, "计算哈希失败");
-		return false;
+		return nullptr;
 	}
 
 	if (std::memcmp(buf.data(), bufHash.data(), bufHash.size()) != 0) {
 		SPDLOG_LOGGER_ERROR(logger, "缓存文件校验失败");
-		return false;
+		return nullptr;
 	}
 
+	std::shared_ptr<EffectDesc> desc = std::make_shared<EffectDesc>();
 	try {
 		yas::mem_istream mi(buf.data() + bufHash.size(), buf.size() - bufHash.size());
 		yas::binary_iarchive<yas::mem_istream, yas::binary> ia(mi);
@@ -220,37 +300,109 @@ bool EffectCache::Load(const wchar_t* fileName, std::string_view hash, EffectDes
 		ia& version;
 		if (version != _VERSION) {
 			SPDLOG_LOGGER_INFO(logger, "缓存版本不匹配");
-			return false;
-		}
-
-		// 检查 Direct3D 功能级别
-		D3D_FEATURE_LEVEL fl;
-		ia& fl;
-		if (fl != App::GetInstance().GetRenderer().GetFeatureLevel()) {
-			SPDLOG_LOGGER_INFO(logger, "功能级别不匹配");
-			return false;
+			return nullptr;
 		}
 
-
-		ia& desc;
+		ia& *desc;
 	} catch (...) {
 		SPDLOG_LOGGER_ERROR(logger, "反序列化失败");
-		desc = {};
-		return false;
+		return nullptr;
 	}
 
 	_AddToMemCache(cacheFileName, desc);
 	
 	SPDLOG_LOGGER_INFO(logger, "已读取缓存 " + StrUtils::UTF16ToUTF8(cacheFileName));
-	return true;
+	return desc;
 }
 
-void EffectCache::Save(const wchar_t* fileName, std::string_view hash, const EffectDesc& desc) {
-	if (App::GetInstance().IsDisableEffectCache()) {
+EffectCache::~EffectCache() {
+	// 正常情况下已在 Flush 中结束，进程退出时无法等待
+	if (_writerThread.joinable()) {
+		_writerThread.detach();
+	}
+}
+
+void EffectCache::Save(const wchar_t* fileName, std::string_view hash, const std::shared_ptr<const EffectDesc>& desc) {
+	if (IsCacheDisabled()) {
 		return;
 	}
 
-	// 格式：HASH-VERSION-FL-{BODY}
+	// 立即加入内存缓存，写入完成前也能命中
+	_AddToMemCache(_GetCacheFileName(fileName, hash), desc);
+
+	_SaveItem item{ fileName, std::string(hash), desc };
+
+	AcquireSRWLockExclusive(&_saveLock);
+	while (_saveQueue.size() >= _MAX_PENDING_SAVES) {
+		SleepConditionVariableSRW(&_saveQueueNotFull, &_saveLock, INFINITE, 0);
+	}
+
+	_saveQueue.push_back(std::move(item));
+	if (!_writerRunning) {
+		// 上一个写入线程已经退出，回收后重新启动
+		if (_writerThread.joinable()) {
+			_writerThread.join();
+		}
+		_writerThread = std::thread(&EffectCache::_WriterThreadProc, this);
+		_writerRunning = true;
+	}
+	ReleaseSRWLockExclusive(&_saveLock);
+
+	WakeConditionVariable(&_saveQueueNotEmpty);
+}
+
+void EffectCache::Flush() {
+	AcquireSRWLockExclusive(&_saveLock);
+
+	// 多个会话可能同时结束，每个调用者都等到写入线程清空队列并退出
+	++_flushCount;
+	WakeAllConditionVariable(&_saveQueueNotEmpty);
+	while (_writerRunning) {
+		SleepConditionVariableSRW(&_writerExited, &_saveLock, INFINITE, 0);
+	}
+	--_flushCount;
+
+	// 线程对象只由一个调用者取走，线程已经退出，join 不会阻塞
+	std::thread writerThread = std::move(_writerThread);
+	ReleaseSRWLockExclusive(&_saveLock);
+
+	if (writerThread.joinable()) {
+		writerThread.join();
+		SPDLOG_LOGGER_INFO(logger, "缓存已全部写入");
+	}
+}
+
+void EffectCache::_WriterThreadProc() {
+	while (true) {
+		AcquireSRWLockExclusive(&_saveLock);
+		while (_saveQueue.empty() && _flushCount == 0) {
+			SleepConditionVariableSRW(&_saveQueueNotEmpty, &_saveLock, INFINITE, 0);
+		}
+
+		if (_saveQueue.empty()) {
+			// 已要求退出且队列为空
+			_writerRunning = false;
+			ReleaseSRWLockExclusive(&_saveLock);
+
+			WakeAllConditionVariable(&_writerExited);
+			break;
+		}
+
+		_SaveItem item = std::move(_saveQueue.front());
+		_saveQueue.pop_front();
+		ReleaseSRWLockExclusive(&_saveLock);
+
+		WakeConditionVariable(&_saveQueueNotFull);
+
+		_WriteCacheFile(item);
+	}
+}
+
+void EffectCache::_WriteCacheFile(const _SaveItem& item) {
+	const wchar_t* fileName = item.fileName.c_str();
+	std::string_view hash = item.hash;
+
+	// 格式：HASH-VERSION-{BODY}
 
 	std::vector<BYTE> buf;
 	buf.reserve(4096);
@@ -261,8 +413,7 @@ void EffectCache::Save(const wchar_t* fileName, std::string_view hash, const Eff
 		yas::binary_oarchive<yas::vector_ostream<BYTE>, yas::binary> oa(os);
 
 		oa& _VERSION;
-		oa& App::GetInstance().GetRenderer().GetFeatureLevel();
-		oa& desc;
+		oa& *item.desc;
 	} catch (...) {
 		SPDLOG_LOGGER_ERROR(logger, "序列化失败");
 		return;
@@ -287,9 +438,13 @@ void EffectCache::Save(const wchar_t* fileName, std::string_view hash, const Eff
 			return;
 		}
 	} else {
-		// 删除所有该文件的缓存
-		std::wregex regex(fmt::format(L"^{}_[0-9,a-f]{{{}}}.{}$", ConvertFileName(fileName),
-				Utils::Hasher::GetInstance().GetHashLength() * 2, _SUFFIX), std::wregex::optimize | std::wregex::nosubs);
+		// 删除该文件的旧缓存
+		// hash 形如 源文件hash_功能级别，常量特化的变体再附加 _常量hash，半精度的变体附加 _half
+		// 同一源文件在不同功能级别下的缓存和变体都保留。旧版本的文件名中没有功能级别，也一并删除
+		const DWORD hashLen = Utils::Hasher::GetInstance().GetHashLength() * 2;
+		std::wregex regex(fmt::format(L"^{}_([0-9,a-f]{{{}}})(_[0-9,a-f]{{4}})?(_[0-9,a-f]{{{}}})?(_half)?.{}$",
+				ConvertFileName(fileName), hashLen, hashLen, _SUFFIX), std::wregex::optimize);
+		const std::wstring sourceHash = StrUtils::UTF8ToUTF16(hash.substr(0, hashLen));
 
 		WIN32_FIND_DATA findData;
 		HANDLE hFind = Utils::SafeHandle(FindFirstFile(L".\\cache\\*", &findData));
@@ -300,7 +455,12 @@ void EffectCache::Save(const wchar_t* fileName, std::string_view hash, const Eff
 				}
 
 				// 正则匹配文件名
-				if (!std::regex_match(findData.cFileName, regex)) {
+				std::wcmatch match;
+				if (!std::regex_match(findData.cFileName, match, regex)) {
+					continue;
+				}
+
+				if (match[1].str() == sourceHash) {
 					continue;
 				}
 
@@ -315,12 +475,20 @@ void EffectCache::Save(const wchar_t* fileName, std::string_view hash, const Eff
 		}
 	}
 	
+	// 先写入临时文件再重命名，读取时不会遇到写了一半的缓存
 	std::wstring cacheFileName = _GetCacheFileName(fileName, hash);
-	if (!Utils::WriteFile(cacheFileName.c_str(), buf.data(), buf.size())) {
+	std::wstring tempFileName = cacheFileName + L".tmp";
+	if (!Utils::WriteFile(tempFileName.c_str(), buf.data(), buf.size())) {
 		SPDLOG_LOGGER_ERROR(logger, "保存缓存失败");
+		DeleteFile(tempFileName.c_str());
+		return;
 	}
 
-	_AddToMemCache(cacheFileName, desc);
+	if (!MoveFileEx(tempFileName.c_str(), cacheFileName.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("重命名缓存文件失败"));
+		DeleteFile(tempFileName.c_str());
+		return;
+	}
 
 	SPDLOG_LOGGER_INFO(logger, "已保存缓存 " + StrUtils::UTF16ToUTF8(cacheFileName));
 }
@@ -3,6 +3,9 @@
 #include "StrUtils.h"
 #include "Utils.h"
 #include "EffectDesc.h"
+#include <list>
+#include <deque>
+#include <thread>
 
 
 class EffectCache {
@@ -12,16 +15,79 @@ public:
 		return instance;
 	}
 
-	bool Load(const wchar_t* fileName, std::string_view hash, EffectDesc& desc);
+	// 未命中时返回空
+	// 多个 EffectDrawer 共享同一个描述，它在被内存缓存淘汰后仍然有效
+	std::shared_ptr<const EffectDesc> Load(const wchar_t* fileName, std::string_view hash);
 
-	void Save(const wchar_t* fileName, std::string_view hash, const EffectDesc& desc);
+	// 立即加入内存缓存，写入文件由后台线程完成
+	// 等待写入的项过多时阻塞
+	void Save(const wchar_t* fileName, std::string_view hash, const std::shared_ptr<const EffectDesc>& desc);
+
+	// 等待所有缓存写入文件并结束后台线程，之后的 Save 会重新启动它
+	// 可以和 Save 以及其他 Flush 同时调用
+	void Flush();
+
+	struct MemCacheStats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		size_t count = 0;
+		// 估计的占用字节数
+		size_t size = 0;
+	};
+
+	MemCacheStats GetMemCacheStats();
 
 private:
-	void _AddToMemCache(const std::wstring& cacheFileName, const EffectDesc& desc);
+	~EffectCache();
+
+	struct _SaveItem {
+		std::wstring fileName;
+		// 包含功能级别，见 EffectCompiler::Compile
+		std::string hash;
+		std::shared_ptr<const EffectDesc> desc;
+	};
+
+	void _WriterThreadProc();
+
+	void _WriteCacheFile(const _SaveItem& item);
+
+	void _AddToMemCache(const std::wstring& cacheFileName, const std::shared_ptr<const EffectDesc>& desc);
+
+	// 字节码的大小加上描述中其他数据的大小
+	static size_t _EstimateMemSize(const EffectDesc& desc);
+
+	struct _MemCacheItem {
+		std::wstring cacheFileName;
+		std::shared_ptr<const EffectDesc> desc;
+		size_t size = 0;
+	};
+
+	// LRU 缓存，越靠前越是最近使用的
+	std::list<_MemCacheItem> _memCache;
+	std::unordered_map<std::wstring, std::list<_MemCacheItem>::iterator> _memCacheMap;
+	size_t _memCacheSize = 0;
+	MemCacheStats _memCacheStats;
+	// 保护内存缓存
+	SRWLOCK _memCacheLock = SRWLOCK_INIT;
+
+	// 超过此大小时淘汰最久未使用的项
+	static constexpr const size_t _MAX_MEM_CACHE_SIZE = 64 * 1024 * 1024;
 
-	std::unordered_map<std::wstring, EffectDesc> _memCache;
+	// 等待写入文件的缓存
+	std::deque<_SaveItem> _saveQueue;
+	// 以下成员都由 _saveLock 保护
+	std::thread _writerThread;
+	// 写入线程退出前清除，此时 _writerThread 可能仍需回收
+	bool _writerRunning = false;
+	// 正在等待的 Flush 调用数，不为 0 时写入线程清空队列后退出
+	UINT _flushCount = 0;
+	SRWLOCK _saveLock = SRWLOCK_INIT;
+	CONDITION_VARIABLE _saveQueueNotEmpty = CONDITION_VARIABLE_INIT;
+	CONDITION_VARIABLE _saveQueueNotFull = CONDITION_VARIABLE_INIT;
+	CONDITION_VARIABLE _writerExited = CONDITION_VARIABLE_INIT;
 
-	static constexpr const size_t _MAX_CACHE_COUNT = 100;
+	static constexpr const size_t _MAX_PENDING_SAVES = 16;
 
 	static std::wstring _GetCacheFileName(const wchar_t* fileName, std::string_view hash);
 
@@ -30,5 +96,5 @@ private:
 
 	// 缓存版本
 	// 当缓存文件结构有更改时将更新它，使得所有旧缓存失效
-	static constexpr const UINT _VERSION = 2;
+	static constexpr const UINT _VERSION = 9;
 };
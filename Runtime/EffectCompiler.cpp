@@ -4,6 +4,7 @@
 #include "Utils.h"
 #include <bitset>
 #include <charconv>
+#include <cmath>
 #include "EffectCache.h"
 #include "StrUtils.h"
 #include "App.h"
@@ -47,6 +48,19 @@ public:
 
 static PassInclude passInclude;
 
+// TENSOR 块声明的多通道纹理，每 4 个通道打包为一个中间纹理（切片）
+// 只在编译时使用，展开后的切片和普通的中间纹理没有区别
+struct TensorDesc {
+	std::string name;
+	UINT channels = 0;
+	// 切片在 textures 中是连续的
+	UINT firstTexture = 0;
+	UINT sliceCount = 0;
+};
+
+// 张量访问函数使用的内部采样器
+static constexpr const char* TENSOR_SAMPLER_NAME = "__T";
+
 UINT RemoveComments(std::string& source) {
 	// 确保以换行符结尾
 	if (source.back() != '\n') {
@@ -250,11 +264,36 @@ UINT GetNextExpr(std::string_view& source, std::string& expr) {
 	return 0;
 }
 
+// 解析逗号分隔的正整数，最少 1 个，最多 values.size() 个
+template<size_t N>
+static UINT GetNextUIntList(std::string_view& source, std::array<UINT, N>& values, size_t& count) {
+	std::string expr;
+	if (GetNextExpr(source, expr)) {
+		return 1;
+	}
+
+	std::vector<std::string_view> items = StrUtils::Split(expr, ',');
+	if (items.empty() || items.size() > N) {
+		return 1;
+	}
+
+	for (size_t i = 0; i < items.size(); ++i) {
+		std::string_view item = items[i];
+		const auto& result = std::from_chars(item.data(), item.data() + item.size(), values[i]);
+		if ((int)result.ec || result.ptr != item.data() + item.size() || values[i] == 0) {
+			return 1;
+		}
+	}
+
+	count = items.size();
+	return 0;
+}
+
 UINT ResolveHeader(std::string_view block, EffectDesc& desc) {
 	// 必需的选项：VERSION
-	// 可选的选项：OUTPUT_WIDTH，OUTPUT_HEIGHT
+	// 可选的选项：OUTPUT_WIDTH，OUTPUT_HEIGHT，HALF_PRECISION，HALO
 
-	std::bitset<3> processed;
+	std::bitset<5> processed;
 
 	std::string_view token;
 
@@ -304,6 +343,33 @@ UINT ResolveHeader(std::string_view block, EffectDesc& desc) {
 			if (GetNextExpr(block, desc.outSizeExpr.second)) {
 				return 1;
 			}
+		} else if (t == "HALF_PRECISION") {
+			if (processed[3]) {
+				return 1;
+			}
+			processed[3] = true;
+
+			if (GetNextToken<false>(block, token) != 2) {
+				return 1;
+			}
+
+			desc.halfPrecision = true;
+		} else if (t == "HALO") {
+			if (processed[4]) {
+				return 1;
+			}
+			processed[4] = true;
+
+			UINT halo;
+			if (GetNextNumber(block, halo)) {
+				return 1;
+			}
+
+			if (GetNextToken<false>(block, token) != 2) {
+				return 1;
+			}
+
+			desc.halo = (int)halo;
 		} else {
 			return 1;
 		}
@@ -695,6 +761,174 @@ UINT ResolveTexture(std::string_view block, EffectDesc& desc) {
 	return 0;
 }
 
+UINT ResolveTensor(std::string_view block, EffectDesc& desc, std::vector<TensorDesc>& tensors) {
+	// 必需的选项：CHANNELS
+	// 可选的选项：FORMAT，WIDTH，HEIGHT
+
+	std::bitset<4> processed;
+
+	std::string_view token;
+
+	UINT channels = 0;
+	// 最后一个切片的通道数不足 4 时使用更窄的格式
+	std::array<EffectIntermediateTextureFormat, 3> formats = {
+		EffectIntermediateTextureFormat::R16_FLOAT,
+		EffectIntermediateTextureFormat::R16G16_FLOAT,
+		EffectIntermediateTextureFormat::R16G16B16A16_FLOAT
+	};
+	std::pair<std::string, std::string> sizeExpr;
+
+	if (!CheckNextToken<true>(block, META_INDICATOR)) {
+		return 1;
+	}
+
+	if (!CheckNextToken<false>(block, "TENSOR")) {
+		return 1;
+	}
+	if (GetNextToken<false>(block, token) != 2) {
+		return 1;
+	}
+
+	while (true) {
+		if (!CheckNextToken<true>(block, META_INDICATOR)) {
+			break;
+		}
+
+		if (GetNextToken<false>(block, token)) {
+			return 1;
+		}
+
+		std::string t = StrUtils::ToUpperCase(token);
+
+		if (t == "CHANNELS") {
+			if (processed[0]) {
+				return 1;
+			}
+			processed[0] = true;
+
+			if (GetNextNumber(block, channels)) {
+				return 1;
+			}
+
+			if (GetNextToken<false>(block, token) != 2) {
+				return 1;
+			}
+
+			// 最多 8 个切片，这样一个 Pass 可以通过多渲染目标写入整个张量
+			if (channels == 0 || channels > 32) {
+				return 1;
+			}
+		} else if (t == "FORMAT") {
+			if (processed[1]) {
+				return 1;
+			}
+			processed[1] = true;
+
+			if (GetNextString(block, token)) {
+				return 1;
+			}
+
+			// 只支持有 1、2、4 通道版本的格式
+			static std::unordered_map<std::string, std::array<EffectIntermediateTextureFormat, 3>> formatMap = {
+				{"R8G8B8A8_UNORM", {
+					EffectIntermediateTextureFormat::R8_UNORM,
+					EffectIntermediateTextureFormat::R8G8_UNORM,
+					EffectIntermediateTextureFormat::R8G8B8A8_UNORM
+				}},
+				{"R16G16B16A16_UNORM", {
+					EffectIntermediateTextureFormat::R16_UNORM,
+					EffectIntermediateTextureFormat::R16G16_UNORM,
+					EffectIntermediateTextureFormat::R16G16B16A16_UNORM
+				}},
+				{"R16G16B16A16_FLOAT", {
+					EffectIntermediateTextureFormat::R16_FLOAT,
+					EffectIntermediateTextureFormat::R16G16_FLOAT,
+					EffectIntermediateTextureFormat::R16G16B16A16_FLOAT
+				}},
+				{"R32G32B32A32_FLOAT", {
+					EffectIntermediateTextureFormat::R32_FLOAT,
+					EffectIntermediateTextureFormat::R32G32_FLOAT,
+					EffectIntermediateTextureFormat::R32G32B32A32_FLOAT
+				}}
+			};
+
+			auto it = formatMap.find(std::string(token));
+			if (it == formatMap.end()) {
+				return 1;
+			}
+
+			formats = it->second;
+		} else if (t == "WIDTH") {
+			if (processed[2]) {
+				return 1;
+			}
+			processed[2] = true;
+
+			if (GetNextExpr(block, sizeExpr.first)) {
+				return 1;
+			}
+		} else if (t == "HEIGHT") {
+			if (processed[3]) {
+				return 1;
+			}
+			processed[3] = true;
+
+			if (GetNextExpr(block, sizeExpr.second)) {
+				return 1;
+			}
+		} else {
+			return 1;
+		}
+	}
+
+	if (!processed[0]) {
+		return 1;
+	}
+
+	// WIDTH 和 HEIGHT 必须成对出现
+	if (processed[2] ^ processed[3]) {
+		return 1;
+	}
+
+	// 代码部分
+	if (!CheckNextToken<true>(block, "Texture2D")) {
+		return 1;
+	}
+
+	if (GetNextToken<true>(block, token)) {
+		return 1;
+	}
+
+	if (token == "INPUT") {
+		return 1;
+	}
+
+	TensorDesc& tensor = tensors.emplace_back();
+	tensor.name = token;
+	tensor.channels = channels;
+	tensor.firstTexture = (UINT)desc.textures.size();
+	tensor.sliceCount = (channels + 3) / 4;
+
+	for (UINT i = 0; i < tensor.sliceCount; ++i) {
+		EffectIntermediateTextureDesc& texDesc = desc.textures.emplace_back();
+		texDesc.name = fmt::format("{}_{}", tensor.name, i);
+		texDesc.sizeExpr = sizeExpr;
+
+		const UINT sliceChannels = std::min(channels - i * 4, 4u);
+		texDesc.format = formats[sliceChannels == 1 ? 0 : (sliceChannels == 2 ? 1 : 2)];
+	}
+
+	if (!CheckNextToken<true>(block, ";")) {
+		return 1;
+	}
+
+	if (GetNextToken<true>(block, token) != 2) {
+		return 1;
+	}
+
+	return 0;
+}
+
 UINT ResolveSampler(std::string_view block, EffectDesc& desc) {
 	// 必选项：FILTER
 	// 可选项：ADDRESS
@@ -818,23 +1052,104 @@ UINT ResolveCommon(std::string_view& block) {
 	return 0;
 }
 
+// 记录着色器实际使用的资源槽，未被使用的资源已被编译器优化掉
+static bool ReflectPass(EffectPassDesc& passDesc) {
+	ComPtr<ID3D11ShaderReflection> reflector;
+	HRESULT hr = D3DReflect(passDesc.cso->GetBufferPointer(), passDesc.cso->GetBufferSize(), IID_PPV_ARGS(&reflector));
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("D3DReflect 失败", hr));
+		return false;
+	}
+
+	D3D11_SHADER_DESC shaderDesc;
+	hr = reflector->GetDesc(&shaderDesc);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("GetDesc 失败", hr));
+		return false;
+	}
+
+	passDesc.usedInputs = 0;
+	passDesc.usedSamplers = 0;
+	passDesc.usedConstantBuffers = 0;
+
+	for (UINT i = 0; i < shaderDesc.BoundResources; ++i) {
+		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+		hr = reflector->GetResourceBindingDesc(i, &bindDesc);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("GetResourceBindingDesc 失败", hr));
+			return false;
+		}
+
+		for (UINT slot = bindDesc.BindPoint; slot < bindDesc.BindPoint + bindDesc.BindCount; ++slot) {
+			switch (bindDesc.Type) {
+			case D3D_SIT_TEXTURE:
+				passDesc.usedInputs |= slot < 64 ? 1ull << slot : ~0ull;
+				break;
+			case D3D_SIT_SAMPLER:
+				passDesc.usedSamplers |= 1u << slot;
+				break;
+			case D3D_SIT_CBUFFER:
+				passDesc.usedConstantBuffers |= 1u << slot;
+				break;
+			default:
+				// UAV 总是绑定
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+// 生成和编译 hlsl 时使用的功能级别，它也是缓存的键的一部分
+// 没有会话时（如离线处理或测试中只解析效果）按功能级别 11.0 处理
+static D3D_FEATURE_LEVEL GetFeatureLevel() {
+	App* app = App::GetCurrent();
+	return app ? app->GetRenderer().GetFeatureLevel() : D3D_FEATURE_LEVEL_11_0;
+}
+
+static bool CompilePass(const std::string& passSource, EffectPassDesc& passDesc, size_t index) {
+	if (!DeviceResources::CompileShader(GetFeatureLevel(),
+		passDesc.isCompute ? DeviceResources::ShaderType::Compute : DeviceResources::ShaderType::Pixel,
+		passSource, "__M", passDesc.cso.ReleaseAndGetAddressOf(),
+		fmt::format("Pass{}", index + 1).c_str(), &passInclude
+	)) {
+		return false;
+	}
+
+	if (!ReflectPass(passDesc)) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("反射 Pass{} 失败", index + 1));
+		return false;
+	}
+
+	return true;
+}
+
 struct TPContext {
 	ULONG index;
 	std::vector<std::string>& passSources;
 	std::vector<EffectPassDesc>& passes;
+	// 线程池的线程不属于任何会话
+	App* app;
 };
 
 void NTAPI TPWork(PTP_CALLBACK_INSTANCE, PVOID Context, PTP_WORK) {
 	TPContext* con = (TPContext*)Context;
+	App::ThreadScope scope(con->app);
 	ULONG index = InterlockedIncrement(&con->index);
 	
-	if (!App::GetInstance().GetRenderer().CompileShader(false, con->passSources[index],
-		"__M", con->passes[index].cso.ReleaseAndGetAddressOf(), fmt::format("Pass{}", index + 1).c_str(), &passInclude)) {
+	if (!CompilePass(con->passSources[index], con->passes[index], index)) {
 		con->passes[index].cso = nullptr;
 	}
 }
 
-UINT ResolvePass(std::string_view block, EffectDesc& desc, std::vector<std::string>& passSources, const std::string& commonHlsl) {
+// 解析 PASS 块的指令，剩余的代码保存在 passBodies 中
+UINT ResolvePass(
+	std::string_view block,
+	EffectDesc& desc,
+	const std::vector<TensorDesc>& tensors,
+	std::vector<std::string>& passBodies
+) {
 	std::string_view token;
 
 	if (!CheckNextToken<true>(block, META_INDICATOR)) {
@@ -857,7 +1172,7 @@ UINT ResolvePass(std::string_view block, EffectDesc& desc, std::vector<std::stri
 		return 1;
 	}
 
-	if (index > passSources.size() || !passSources[index - 1].empty()) {
+	if (index > passBodies.size() || !passBodies[index - 1].empty()) {
 		return 1;
 	}
 
@@ -869,7 +1184,35 @@ UINT ResolvePass(std::string_view block, EffectDesc& desc, std::vector<std::stri
 		texNames.emplace(desc.textures[i].name, (UINT)i);
 	}
 
-	std::bitset<2> processed;
+	// 张量展开为它的所有切片
+	auto addTextures = [&](std::string_view name, std::vector<UINT>& result) {
+		auto tensorIt = std::find_if(tensors.begin(), tensors.end(),
+			[name](const TensorDesc& tensor) { return tensor.name == name; });
+		if (tensorIt == tensors.end()) {
+			auto it = texNames.find(name);
+			if (it == texNames.end()) {
+				// 未找到纹理名称
+				return false;
+			}
+
+			result.push_back(it->second);
+			texNames.erase(it);
+			return true;
+		}
+
+		for (UINT i = 0; i < tensorIt->sliceCount; ++i) {
+			auto it = texNames.find(desc.textures[tensorIt->firstTexture + i].name);
+			if (it == texNames.end()) {
+				return false;
+			}
+
+			result.push_back(it->second);
+			texNames.erase(it);
+		}
+		return true;
+	};
+
+	std::bitset<6> processed;
 
 	while (true) {
 		if (!CheckNextToken<true>(block, META_INDICATOR)) {
@@ -895,14 +1238,9 @@ UINT ResolvePass(std::string_view block, EffectDesc& desc, std::vector<std::stri
 
 			std::vector<std::string_view> inputs = StrUtils::Split(binds, ',');
 			for (const std::string_view& input : inputs) {
-				auto it = texNames.find(input);
-				if (it == texNames.end()) {
-					// 未找到纹理名称
+				if (!addTextures(input, passDesc.inputs)) {
 					return 1;
 				}
-
-				passDesc.inputs.push_back(it->second);
-				texNames.erase(it);
 			}
 		} else if (t == "SAVE") {
 			if (processed[1]) {
@@ -916,50 +1254,233 @@ UINT ResolvePass(std::string_view block, EffectDesc& desc, std::vector<std::stri
 			}
 
 			std::vector<std::string_view> outputs = StrUtils::Split(saves, ',');
-			if (outputs.size() > 8) {
-				// 最多 8 个输出
-				return 1;
-			}
-
 			for (const std::string_view& output : outputs) {
 				// INPUT 不能作为输出
 				if (output == "INPUT") {
 					return 1;
 				}
 
-				auto it = texNames.find(output);
-				if (it == texNames.end()) {
-					// 未找到纹理名称
+				if (!addTextures(output, passDesc.outputs)) {
 					return 1;
 				}
+			}
+
+			if (passDesc.outputs.size() > 8) {
+				// 最多 8 个输出，张量的每个切片都是一个输出
+				return 1;
+			}
+		} else if (t == "COMPUTE") {
+			if (processed[2]) {
+				return 1;
+			}
+			processed[2] = true;
+
+			if (GetNextToken<false>(block, token) != 2) {
+				return 1;
+			}
+
+			passDesc.isCompute = true;
+		} else if (t == "BLOCK_SIZE") {
+			if (processed[3]) {
+				return 1;
+			}
+			processed[3] = true;
+
+			// 省略高度时为正方形
+			std::array<UINT, 2> values{};
+			size_t count;
+			if (GetNextUIntList(block, values, count)) {
+				return 1;
+			}
+
+			passDesc.blockSize = { values[0], count == 1 ? values[0] : values[1] };
+		} else if (t == "NUM_THREADS") {
+			if (processed[4]) {
+				return 1;
+			}
+			processed[4] = true;
+
+			// 和 HLSL 的 numthreads 相同，省略的维度为 1
+			passDesc.numThreads = { 1, 1, 1 };
+			size_t count;
+			if (GetNextUIntList(block, passDesc.numThreads, count)) {
+				return 1;
+			}
+
+			// cs_5_0 的限制
+			const auto& [x, y, z] = passDesc.numThreads;
+			if (x > 1024 || y > 1024 || z > 64 || x * y * z > 1024) {
+				return 1;
+			}
+		} else if (t == "CONDITION") {
+			if (processed[5]) {
+				return 1;
+			}
+			processed[5] = true;
+
+			if (GetNextString(block, token)) {
+				return 1;
+			}
 
-				passDesc.outputs.push_back(it->second);
-				texNames.erase(it);
+			// 只能使用 int 类型的常量，构建时由它的值决定是否执行
+			auto it = std::find_if(desc.constants.begin(), desc.constants.end(),
+				[token](const EffectConstantDesc& c) { return c.name == token; });
+			if (it == desc.constants.end() || it->type != EffectConstantType::Int) {
+				return 1;
 			}
+
+			passDesc.condition = int(it - desc.constants.begin());
 		} else {
 			return 1;
 		}
 	}
 
-	std::string& passHlsl = passSources[index - 1];
-	passHlsl.reserve(size_t((commonHlsl.size() + block.size() + passDesc.inputs.size() * 30) * 1.5));
+	if (passDesc.isCompute) {
+		// 计算着色器 Pass 必须指定 BLOCK_SIZE 和 NUM_THREADS
+		if (!processed[3] || !processed[4]) {
+			return 1;
+		}
+	} else if (processed[3] || processed[4]) {
+		return 1;
+	}
 
-	for (int i = 0; i < passDesc.inputs.size(); ++i) {
-		passHlsl.append(fmt::format("Texture2D {}:register(t{});", desc.textures[passDesc.inputs[i]].name, i));
+	// 确保非空，用于检查重复的 PASS
+	std::string& passBody = passBodies[index - 1];
+	passBody = block;
+	if (passBody.empty() || passBody.back() != '\n') {
+		passBody.push_back('\n');
 	}
-	passHlsl.append(commonHlsl).append(block);
 
-	if (passHlsl.back() != '\n') {
-		passHlsl.push_back('\n');
+	return 0;
+}
+
+// 半精度变体将 float 系列的类型替换为 min16float，不影响纹理和常量缓冲区的声明
+static const std::string HALF_PRECISION_DEFINES = []() {
+	std::string result;
+	for (const char* suffix : { "", "1", "2", "3", "4" }) {
+		result.append(fmt::format("#define float{0} min16float{0}\n", suffix));
+	}
+	for (int i = 1; i <= 4; ++i) {
+		for (int j = 1; j <= 4; ++j) {
+			result.append(fmt::format("#define float{0}x{1} min16float{0}x{1}\n", i, j));
+		}
 	}
+	return result;
+}();
 
-	// main 函数
-	if (passDesc.outputs.size() <= 1) {
-		passHlsl.append(fmt::format("float4 __M(float4 p:SV_POSITION,float2 c:TEXCOORD):SV_TARGET"
-			"{{return Pass{}(c);}}", index));
+static const std::string HALF_PRECISION_UNDEFS = []() {
+	std::string result;
+	for (const char* suffix : { "", "1", "2", "3", "4" }) {
+		result.append(fmt::format("#undef float{}\n", suffix));
+	}
+	for (int i = 1; i <= 4; ++i) {
+		for (int j = 1; j <= 4; ++j) {
+			result.append(fmt::format("#undef float{}x{}\n", i, j));
+		}
+	}
+	return result;
+}();
+
+// 读取一个切片的 2x2 邻域中的一个通道，返回值的顺序和 Gather 相同
+// 功能级别 11 可以 Gather 任意通道，10.1 只能 Gather 红色通道，其他情况回退到 Load
+static std::string GetTensorGatherFunction(D3D_FEATURE_LEVEL featureLevel) {
+	static constexpr const char* LOAD_FALLBACK = "uint w,h;t.GetDimensions(w,h);int2 m=int2(w,h)-1;"
+		"int2 q=int2(floor(p*float2(w,h)-0.5));"
+		"return float4(t.Load(int3(clamp(q+int2(0,1),0,m),0))[i],t.Load(int3(clamp(q+1,0,m),0))[i],"
+		"t.Load(int3(clamp(q+int2(1,0),0,m),0))[i],t.Load(int3(clamp(q,0,m),0))[i]);";
+
+	if (featureLevel >= D3D_FEATURE_LEVEL_11_0) {
+		return fmt::format("float4 __G(Texture2D t,uint i,float2 p){{if(i==0)return t.GatherRed({0},p);"
+			"if(i==1)return t.GatherGreen({0},p);if(i==2)return t.GatherBlue({0},p);return t.GatherAlpha({0},p);}}\n",
+			TENSOR_SAMPLER_NAME);
+	} else if (featureLevel == D3D_FEATURE_LEVEL_10_1) {
+		return fmt::format("float4 __G(Texture2D t,uint i,float2 p){{if(i==0)return t.Gather({},p);{}}}\n",
+			TENSOR_SAMPLER_NAME, LOAD_FALLBACK);
 	} else {
-		// 多渲染目标
-		passHlsl.append("void __M(float4 p:SV_POSITION,float2 c:TEXCOORD,out float4 t0:SV_TARGET0,out float4 t1:SV_TARGET1");
+		return fmt::format("float4 __G(Texture2D t,uint i,float2 p){{{}}}\n", LOAD_FALLBACK);
+	}
+}
+
+// 张量的访问函数：
+// name_Sample(slice, pos) 返回一个切片
+// name_Channel(c, pos) 返回第 c 个通道
+// name_Gather(c, pos) 返回以 pos 为公共顶点的 2x2 个像素的第 c 个通道
+static std::string GetTensorAccessors(const EffectDesc& desc, const TensorDesc& tensor) {
+	std::string sample = fmt::format("float4 {}_Sample(uint s,float2 p){{", tensor.name);
+	std::string gather = fmt::format("float4 {}_Gather(uint c,float2 p){{", tensor.name);
+	for (UINT i = 0; i < tensor.sliceCount; ++i) {
+		const std::string& sliceName = desc.textures[tensor.firstTexture + i].name;
+		sample.append(fmt::format("if(s=={})return {}.SampleLevel({},p,0);", i, sliceName, TENSOR_SAMPLER_NAME));
+		gather.append(fmt::format("if(c<{})return __G({},c-{},p);", (i + 1) * 4, sliceName, i * 4));
+	}
+	sample.append("return 0;}\n");
+	gather.append("return 0;}\n");
+
+	return sample + fmt::format("float {0}_Channel(uint c,float2 p){{return {0}_Sample(c/4,p)[c%4];}}\n", tensor.name) + gather;
+}
+
+// 生成 Pass 的 hlsl，index 为 Pass 的序号，从 1 开始
+void GeneratePassSource(
+	const EffectDesc& desc,
+	const std::vector<TensorDesc>& tensors,
+	const EffectPassDesc& passDesc,
+	size_t index,
+	std::string_view passBody,
+	const std::string& commonHlsl,
+	bool halfPrecision,
+	D3D_FEATURE_LEVEL featureLevel,
+	std::string& passHlsl
+) {
+	passHlsl.reserve(size_t((commonHlsl.size() + passBody.size() + passDesc.inputs.size() * 30) * 1.5));
+
+	for (int i = 0; i < passDesc.inputs.size(); ++i) {
+		passHlsl.append(fmt::format("Texture2D {}:register(t{});", desc.textures[passDesc.inputs[i]].name, i));
+	}
+	if (passDesc.isCompute) {
+		// 输出为 UAV，没有 SAVE 时输出到 OUTPUT
+		if (passDesc.outputs.empty()) {
+			passHlsl.append("RWTexture2D<float4> OUTPUT:register(u0);");
+		} else {
+			for (int i = 0; i < passDesc.outputs.size(); ++i) {
+				passHlsl.append(fmt::format("RWTexture2D<float4> {}:register(u{});", desc.textures[passDesc.outputs[i]].name, i));
+			}
+		}
+	}
+	passHlsl.append(commonHlsl);
+
+	// 为绑定的张量生成访问函数
+	bool hasTensor = false;
+	for (const TensorDesc& tensor : tensors) {
+		if (std::find(passDesc.inputs.begin(), passDesc.inputs.end(), tensor.firstTexture) == passDesc.inputs.end()) {
+			continue;
+		}
+
+		if (!hasTensor) {
+			hasTensor = true;
+			passHlsl.append(GetTensorGatherFunction(featureLevel));
+		}
+		passHlsl.append(GetTensorAccessors(desc, tensor));
+	}
+
+	passHlsl.append(passBody);
+
+	if (halfPrecision) {
+		// main 函数的签名保持全精度
+		passHlsl.append(HALF_PRECISION_UNDEFS);
+	}
+
+	// main 函数
+	if (passDesc.isCompute) {
+		// 每个线程组处理一个 BLOCK_SIZE 大小的块，Pass 函数的参数为块左上角的位置和组内线程 ID
+		passHlsl.append(fmt::format("[numthreads({},{},{})]void __M(uint3 tid:SV_GroupThreadID,uint3 gid:SV_GroupID)"
+			"{{Pass{}(gid.xy*uint2({},{}),tid);}}", passDesc.numThreads[0], passDesc.numThreads[1],
+			passDesc.numThreads[2], index, passDesc.blockSize.first, passDesc.blockSize.second));
+	} else if (passDesc.outputs.size() <= 1) {
+		passHlsl.append(fmt::format("float4 __M(float4 p:SV_POSITION,float2 c:TEXCOORD):SV_TARGET"
+			"{{return Pass{}(c);}}", index));
+	} else {
+		// 多渲染目标
+		passHlsl.append("void __M(float4 p:SV_POSITION,float2 c:TEXCOORD,out float4 t0:SV_TARGET0,out float4 t1:SV_TARGET1");
 		for (int i = 2; i < passDesc.outputs.size(); ++i) {
 			passHlsl.append(fmt::format(",out float4 t{0}:SV_TARGET{0}", i));
 		}
@@ -969,12 +1490,420 @@ UINT ResolvePass(std::string_view block, EffectDesc& desc, std::vector<std::stri
 		}
 		passHlsl.append(");}");
 	}
+}
 
-	return 0;
+static bool IsIdentifierChar(char c) {
+	return StrUtils::isalnum(c) || c == '_';
+}
+
+// 查找所有独立出现的标识符 name
+static std::vector<size_t> FindIdentifier(std::string_view source, std::string_view name) {
+	std::vector<size_t> result;
+
+	for (size_t pos = source.find(name); pos != std::string_view::npos; pos = source.find(name, pos + 1)) {
+		if (pos > 0 && IsIdentifierChar(source[pos - 1])) {
+			continue;
+		}
+		size_t end = pos + name.size();
+		if (end < source.size() && IsIdentifierChar(source[end])) {
+			continue;
+		}
+
+		result.push_back(pos);
+	}
+
+	return result;
+}
+
+// 查找和 source[pos] 处的左括号匹配的右括号
+static size_t FindMatchingBracket(std::string_view source, size_t pos) {
+	const char open = source[pos];
+	const char close = open == '(' ? ')' : (open == '{' ? '}' : ']');
+
+	int depth = 0;
+	for (size_t i = pos; i < source.size(); ++i) {
+		if (source[i] == open) {
+			++depth;
+		} else if (source[i] == close) {
+			if (--depth == 0) {
+				return i;
+			}
+		}
+	}
+
+	return std::string_view::npos;
+}
+
+// 收集在全局作用域声明的函数、变量和结构体的名字
+static void GetTopLevelNames(std::string_view source, std::unordered_set<std::string_view>& names) {
+	int depth = 0;
+
+	for (size_t i = 0; i < source.size();) {
+		char c = source[i];
+		if (c == '(' || c == '{' || c == '[') {
+			++depth;
+			++i;
+			continue;
+		}
+		if (c == ')' || c == '}' || c == ']') {
+			--depth;
+			++i;
+			continue;
+		}
+
+		if (!(StrUtils::isalpha(c) || c == '_')) {
+			++i;
+			continue;
+		}
+
+		size_t end = i + 1;
+		while (end < source.size() && IsIdentifierChar(source[end])) {
+			++end;
+		}
+
+		if (depth == 0) {
+			// 后面紧跟这些符号的标识符是被声明的名字
+			std::string_view rest = source.substr(end);
+			RemoveLeadingBlanks<true>(rest);
+			if (!rest.empty() && std::string_view("(=;,[:{").find(rest[0]) != std::string_view::npos) {
+				names.insert(source.substr(i, end - i));
+			}
+		}
+
+		i = end;
+	}
+}
+
+// 返回 Pass 函数的函数体的范围 [begin, end) 和第一个参数的名字
+static bool FindPassFunction(std::string_view body, size_t index, std::string_view& param, size_t& begin, size_t& end) {
+	const std::string funcName = fmt::format("Pass{}", index);
+
+	for (size_t pos : FindIdentifier(body, funcName)) {
+		std::string_view t = body.substr(pos + funcName.size());
+		if (!CheckNextToken<true>(t, "(")) {
+			continue;
+		}
+
+		// float2 pos
+		std::string_view token;
+		if (GetNextToken<true>(t, token) || token != "float2") {
+			continue;
+		}
+		if (GetNextToken<true>(t, param)) {
+			continue;
+		}
+
+		size_t paramsEnd = FindMatchingBracket(body, body.find('(', pos));
+		if (paramsEnd == std::string_view::npos) {
+			return false;
+		}
+
+		// 函数体。函数声明之后是分号，继续查找定义
+		t = body.substr(paramsEnd + 1);
+		if (!CheckNextToken<true>(t, "{")) {
+			continue;
+		}
+
+		begin = t.data() - body.data() - 1;
+		end = FindMatchingBracket(body, begin);
+		if (end == std::string_view::npos) {
+			return false;
+		}
+
+		++end;
+		return true;
+	}
+
+	return false;
+}
+
+// 检查 source[pos] 处的 tex 是否为 tex.Sample(sampler, param) 的形式，成功时返回表达式的长度
+static size_t MatchSampleAtPos(std::string_view source, size_t pos, std::string_view tex, std::string_view param,
+	const std::unordered_set<std::string_view>& pointSamplers
+) {
+	std::string_view t = source.substr(pos + tex.size());
+	std::string_view token;
+
+	if (!CheckNextToken<true>(t, ".")) {
+		return 0;
+	}
+	if (GetNextToken<true>(t, token) || token != "Sample") {
+		return 0;
+	}
+	if (!CheckNextToken<true>(t, "(")) {
+		return 0;
+	}
+	if (GetNextToken<true>(t, token) || !pointSamplers.contains(token)) {
+		return 0;
+	}
+	if (!CheckNextToken<true>(t, ",")) {
+		return 0;
+	}
+	if (GetNextToken<true>(t, token) || token != param) {
+		return 0;
+	}
+	if (!CheckNextToken<true>(t, ")")) {
+		return 0;
+	}
+
+	return t.data() - source.data() - pos;
+}
+
+// 检查 source 中是否有对 name 的赋值
+static bool IsAssigned(std::string_view source, std::string_view name) {
+	for (size_t pos : FindIdentifier(source, name)) {
+		// 前置的自增和自减
+		std::string_view before = source.substr(0, pos);
+		while (!before.empty() && StrUtils::isspace(before.back())) {
+			before.remove_suffix(1);
+		}
+		if (before.ends_with("++") || before.ends_with("--")) {
+			return true;
+		}
+
+		std::string_view t = source.substr(pos + name.size());
+
+		// 跳过分量，如 pos.x
+		std::string_view rest = t;
+		std::string_view token;
+		if (CheckNextToken<true>(rest, ".") && GetNextToken<true>(rest, token) == 0) {
+			t = rest;
+		}
+
+		RemoveLeadingBlanks<true>(t);
+		if (t.starts_with("++") || t.starts_with("--")) {
+			return true;
+		}
+		if (t.size() >= 2 && std::string_view("+-*/%&|^").find(t[0]) != std::string_view::npos && t[1] == '=') {
+			return true;
+		}
+		if (t.starts_with("=") && !t.starts_with("==")) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// 融合后读取生产者的结果时模拟写入中间纹理时的截断
+static std::string GetFusedReadFunction(size_t producerIndex, EffectIntermediateTextureFormat format) {
+	std::string_view swizzle;
+	std::string_view suffix;
+	switch (format) {
+	case EffectIntermediateTextureFormat::R8_UNORM:
+	case EffectIntermediateTextureFormat::R16_UNORM:
+	case EffectIntermediateTextureFormat::R16_FLOAT:
+	case EffectIntermediateTextureFormat::R32_FLOAT:
+		swizzle = ".x";
+		suffix = ",0,0,1";
+		break;
+	case EffectIntermediateTextureFormat::R8G8_UNORM:
+	case EffectIntermediateTextureFormat::R16G16_UNORM:
+	case EffectIntermediateTextureFormat::R16G16_FLOAT:
+	case EffectIntermediateTextureFormat::R32G32_FLOAT:
+		swizzle = ".xy";
+		suffix = ",0,1";
+		break;
+	case EffectIntermediateTextureFormat::B5G6R5_UNORM:
+	case EffectIntermediateTextureFormat::R11G11B10_FLOAT:
+		swizzle = ".xyz";
+		suffix = ",1";
+		break;
+	default:
+		break;
+	}
+
+	std::string value = fmt::format("v{}", swizzle);
+	switch (format) {
+	case EffectIntermediateTextureFormat::R16_FLOAT:
+	case EffectIntermediateTextureFormat::R32_FLOAT:
+	case EffectIntermediateTextureFormat::R16G16_FLOAT:
+	case EffectIntermediateTextureFormat::R32G32_FLOAT:
+	case EffectIntermediateTextureFormat::R16G16B16A16_FLOAT:
+	case EffectIntermediateTextureFormat::R32G32B32A32_FLOAT:
+		break;
+	case EffectIntermediateTextureFormat::R11G11B10_FLOAT:
+		// 不能存储负数
+		value = fmt::format("max({},0)", value);
+		break;
+	default:
+		// UNORM
+		value = fmt::format("saturate({})", value);
+		break;
+	}
+
+	return fmt::format("float4 __F{0}(float2 p){{float4 v=Pass{0}(p);return float4({1}{2});}}\n",
+		producerIndex, value, suffix);
+}
+
+// 将只在当前像素被一个相同尺寸的 Pass 读取的中间纹理的生产者内联到消费者中
+// 只处理像素着色器 Pass，检测和改写都只基于 hlsl 文本，条件不满足时保持原样
+// 返回被内联的 Pass，它们的中间纹理不再被使用
+std::vector<bool> FusePasses(EffectDesc& desc, std::vector<std::string>& passBodies, const std::vector<std::string_view>& commons) {
+	const size_t passCount = desc.passes.size();
+	std::vector<bool> fused(passCount);
+
+	std::unordered_set<std::string_view> pointSamplers;
+	for (const EffectSamplerDesc& samDesc : desc.samplers) {
+		if (samDesc.filterType == EffectSamplerFilterType::Point) {
+			pointSamplers.insert(samDesc.name);
+		}
+	}
+
+	for (size_t i = 0; i < passCount; ++i) {
+		// 被跳过的 Pass 的输出绑定为空，不能内联
+		EffectPassDesc& producer = desc.passes[i];
+		if (producer.isCompute || producer.outputs.size() != 1 || producer.condition >= 0) {
+			continue;
+		}
+
+		const UINT texIdx = producer.outputs[0];
+		const EffectIntermediateTextureDesc& texDesc = desc.textures[texIdx];
+		if (!texDesc.source.empty()) {
+			continue;
+		}
+
+		// 中间纹理只能由这个 Pass 写入，且只有一个 Pass 读取
+		size_t consumerIdx = 0;
+		UINT readers = 0;
+		bool otherWriters = false;
+		for (size_t j = 0; j < passCount; ++j) {
+			if (fused[j]) {
+				continue;
+			}
+
+			const EffectPassDesc& d = desc.passes[j];
+			if (std::find(d.inputs.begin(), d.inputs.end(), texIdx) != d.inputs.end()) {
+				consumerIdx = j;
+				++readers;
+			}
+			if (j != i && std::find(d.outputs.begin(), d.outputs.end(), texIdx) != d.outputs.end()) {
+				otherWriters = true;
+			}
+		}
+		if (readers != 1 || otherWriters || consumerIdx <= i) {
+			continue;
+		}
+
+		EffectPassDesc& consumer = desc.passes[consumerIdx];
+		if (consumer.isCompute) {
+			continue;
+		}
+
+		// 尺寸必须相同才能在当前像素求值
+		const std::pair<std::string, std::string>& consumerSize = consumer.outputs.empty()
+			? desc.outSizeExpr : desc.textures[consumer.outputs[0]].sizeExpr;
+		if (consumerSize.first.empty() || consumerSize != texDesc.sizeExpr) {
+			continue;
+		}
+
+		// 中间的 Pass 不能改变生产者的输入，消费者也不能写入生产者的输入
+		bool inputsChanged = false;
+		for (size_t k = i + 1; k <= consumerIdx && !inputsChanged; ++k) {
+			for (UINT output : desc.passes[k].outputs) {
+				if (std::find(producer.inputs.begin(), producer.inputs.end(), output) != producer.inputs.end()) {
+					inputsChanged = true;
+					break;
+				}
+			}
+		}
+		if (inputsChanged) {
+			continue;
+		}
+
+		const std::string& producerBody = passBodies[i];
+		std::string& consumerBody = passBodies[consumerIdx];
+
+		// 生产者的宏会影响消费者的代码
+		if (producerBody.find('#') != std::string::npos) {
+			continue;
+		}
+
+		if (std::any_of(commons.begin(), commons.end(),
+			[&](std::string_view c) { return !FindIdentifier(c, texDesc.name).empty(); })
+		) {
+			continue;
+		}
+
+		// 全局作用域的名字不能冲突
+		{
+			std::unordered_set<std::string_view> producerNames;
+			std::unordered_set<std::string_view> consumerNames;
+			GetTopLevelNames(producerBody, producerNames);
+			GetTopLevelNames(consumerBody, consumerNames);
+
+			if (std::any_of(producerNames.begin(), producerNames.end(),
+				[&](std::string_view name) { return consumerNames.contains(name); })
+			) {
+				continue;
+			}
+		}
+
+		// 中间纹理只能在消费者的 Pass 函数中以 tex.Sample(点采样器, pos) 的形式读取，且 pos 不能被修改
+		std::string_view param;
+		size_t funcBegin, funcEnd;
+		if (!FindPassFunction(consumerBody, consumerIdx + 1, param, funcBegin, funcEnd)) {
+			continue;
+		}
+
+		std::string_view funcBody = std::string_view(consumerBody).substr(funcBegin, funcEnd - funcBegin);
+		if (IsAssigned(funcBody, param)) {
+			continue;
+		}
+
+		std::vector<std::pair<size_t, size_t>> sites;
+		bool canFuse = true;
+		for (size_t pos : FindIdentifier(consumerBody, texDesc.name)) {
+			size_t len = 0;
+			if (pos > funcBegin && pos < funcEnd) {
+				len = MatchSampleAtPos(consumerBody, pos, texDesc.name, param, pointSamplers);
+			}
+
+			if (len == 0) {
+				canFuse = false;
+				break;
+			}
+
+			sites.emplace_back(pos, len);
+		}
+		if (!canFuse || sites.empty()) {
+			continue;
+		}
+
+		// 改写消费者，从后向前替换
+		const std::string readFunc = fmt::format("__F{}({})", i + 1, param);
+		for (auto it = sites.rbegin(); it != sites.rend(); ++it) {
+			consumerBody.replace(it->first, it->second, readFunc);
+		}
+		consumerBody = producerBody + GetFusedReadFunction(i + 1, texDesc.format) + consumerBody;
+
+		// 消费者继承生产者的输入
+		consumer.inputs.erase(std::find(consumer.inputs.begin(), consumer.inputs.end(), texIdx));
+		for (UINT input : producer.inputs) {
+			if (std::find(consumer.inputs.begin(), consumer.inputs.end(), input) == consumer.inputs.end()) {
+				consumer.inputs.push_back(input);
+			}
+		}
+
+		fused[i] = true;
+		SPDLOG_LOGGER_INFO(logger, fmt::format("已将 Pass{} 内联到 Pass{}", i + 1, consumerIdx + 1));
+	}
+
+	return fused;
 }
 
-UINT ResolvePasses(const std::vector<std::string_view>& blocks, const std::vector<std::string_view>& commons, EffectDesc& desc) {
-	// 可选项：BIND，SAVE
+UINT ResolvePasses(
+	const std::vector<std::string_view>& blocks,
+	const std::vector<std::string_view>& commons,
+	EffectDesc& desc,
+	const std::vector<TensorDesc>& tensors,
+	UINT flags,
+	const std::vector<Constant32>* specializedConstants,
+	std::vector<std::string>* generatedSources
+) {
+	// 可选项：BIND，SAVE，COMPUTE，BLOCK_SIZE，NUM_THREADS，CONDITION
+
+	const bool halfPrecision = desc.halfPrecision && (flags & EffectCompiler::COMPILE_FLAG_HALF_PRECISION);
 
 	std::string commonHlsl;
 
@@ -985,7 +1914,32 @@ UINT ResolvePasses(const std::vector<std::string_view>& blocks, const std::vecto
 	}
 	commonHlsl.reserve(size_t(reservedSize * 1.5f));
 
-	if (!desc.constants.empty() || !desc.valueConstants.empty()) {
+	if (specializedConstants) {
+		if (specializedConstants->size() < desc.constants.size() + desc.valueConstants.size()) {
+			SPDLOG_LOGGER_ERROR(logger, "特化常量的数量不足");
+			return 1;
+		}
+
+		// 常量特化为字面量
+		auto appendConstant = [&](EffectConstantType type, const std::string& name, Constant32 value) {
+			if (type == EffectConstantType::Int) {
+				commonHlsl.append(fmt::format("static const int {}={};", name, value.intVal));
+			} else if (std::isfinite(value.floatVal)) {
+				// 最短的能精确还原的表示
+				commonHlsl.append(fmt::format("static const float {}={};", name, value.floatVal));
+			} else {
+				commonHlsl.append(fmt::format("static const float {}=asfloat({}u);", name, (UINT)value.intVal));
+			}
+		};
+
+		size_t i = 0;
+		for (const auto& d : desc.constants) {
+			appendConstant(d.type, d.name, (*specializedConstants)[i++]);
+		}
+		for (const auto& d : desc.valueConstants) {
+			appendConstant(d.type, d.name, (*specializedConstants)[i++]);
+		}
+	} else if (!desc.constants.empty() || !desc.valueConstants.empty()) {
 		// 常量缓冲区
 		commonHlsl.append("cbuffer __C:register(b0){");
 		for (const auto& d : desc.constants) {
@@ -1018,6 +1972,10 @@ UINT ResolvePasses(const std::vector<std::string_view>& blocks, const std::vecto
 	}
 	commonHlsl.push_back('\n');
 
+	if (halfPrecision) {
+		commonHlsl.append(HALF_PRECISION_DEFINES);
+	}
+
 	for (const auto& c : commons) {
 		commonHlsl.append(c);
 
@@ -1028,19 +1986,19 @@ UINT ResolvePasses(const std::vector<std::string_view>& blocks, const std::vecto
 
 	std::string_view token;
 
-	std::vector<std::string> passSources(blocks.size());
+	std::vector<std::string> passBodies(blocks.size());
 	desc.passes.resize(blocks.size());
 
 	for (size_t i = 0; i < blocks.size(); ++i) {
-		if (ResolvePass(blocks[i], desc, passSources, commonHlsl)) {
+		if (ResolvePass(blocks[i], desc, tensors, passBodies)) {
 			SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 Pass{} 失败", i + 1));
 			return 1;
 		}
 	}
 
 	// 确保每个 PASS 都存在
-	for (size_t i = 0; i < passSources.size(); ++i) {
-		if (passSources[i].empty()) {
+	for (size_t i = 0; i < passBodies.size(); ++i) {
+		if (passBodies[i].empty()) {
 			SPDLOG_LOGGER_ERROR(logger, fmt::format("Pass{} 为空", i + 1));
 			return 1;
 		}
@@ -1051,13 +2009,75 @@ UINT ResolvePasses(const std::vector<std::string_view>& blocks, const std::vecto
 		SPDLOG_LOGGER_ERROR(logger, "最后一个 Pass 不能有 SAVE 指令");
 		return 1;
 	}
+	if (desc.passes.back().condition >= 0) {
+		SPDLOG_LOGGER_ERROR(logger, "最后一个 Pass 不能有 CONDITION 指令");
+		return 1;
+	}
+
+	std::vector<bool> fused = FusePasses(desc, passBodies, commons);
+
+	// 生成 hlsl 时保留 Pass 原本的序号，使错误信息和源文件对应
+	const D3D_FEATURE_LEVEL featureLevel = GetFeatureLevel();
+	std::vector<std::string> passSources;
+	std::vector<EffectPassDesc> passes;
+	for (size_t i = 0; i < passBodies.size(); ++i) {
+		if (fused[i]) {
+			continue;
+		}
+
+		GeneratePassSource(desc, tensors, desc.passes[i], i + 1, passBodies[i], commonHlsl,
+			halfPrecision, featureLevel, passSources.emplace_back());
+		passes.emplace_back(std::move(desc.passes[i]));
+	}
+	desc.passes = std::move(passes);
+
+	if (std::find(fused.begin(), fused.end(), true) != fused.end()) {
+		// 删除不再使用的中间纹理。INPUT 始终保留
+		std::vector<bool> used(desc.textures.size());
+		used[0] = true;
+		for (const EffectPassDesc& passDesc : desc.passes) {
+			for (UINT idx : passDesc.inputs) {
+				used[idx] = true;
+			}
+			for (UINT idx : passDesc.outputs) {
+				used[idx] = true;
+			}
+		}
+
+		std::vector<UINT> newIndices(desc.textures.size());
+		std::vector<EffectIntermediateTextureDesc> textures;
+		for (size_t i = 0; i < desc.textures.size(); ++i) {
+			// 从文件加载的纹理不会被内联
+			if (used[i] || !desc.textures[i].source.empty()) {
+				newIndices[i] = (UINT)textures.size();
+				textures.emplace_back(std::move(desc.textures[i]));
+			}
+		}
+		desc.textures = std::move(textures);
+
+		for (EffectPassDesc& passDesc : desc.passes) {
+			for (UINT& idx : passDesc.inputs) {
+				idx = newIndices[idx];
+			}
+			for (UINT& idx : passDesc.outputs) {
+				idx = newIndices[idx];
+			}
+		}
+	}
+
+	if (generatedSources) {
+		*generatedSources = passSources;
+	}
+
+	if (flags & EffectCompiler::COMPILE_FLAG_NO_COMPILE) {
+		return 0;
+	}
 
 	// 编译生成的 hlsl
 	assert(!passSources.empty());
-	Renderer& renderer = App::GetInstance().GetRenderer();
 
 	if (passSources.size() == 1) {
-		if (!renderer.CompileShader(false, passSources[0], "__M", desc.passes[0].cso.ReleaseAndGetAddressOf(), "Pass1", &passInclude)) {
+		if (!CompilePass(passSources[0], desc.passes[0], 0)) {
 			SPDLOG_LOGGER_ERROR(logger, "编译 Pass1 失败");
 			return 1;
 		}
@@ -1066,7 +2086,8 @@ UINT ResolvePasses(const std::vector<std::string_view>& blocks, const std::vecto
 		TPContext context = {
 			0,
 			passSources,
-			desc.passes
+			desc.passes,
+			App::GetCurrent()
 		};
 
 		PTP_WORK work = CreateThreadpoolWork(TPWork, &context, nullptr);
@@ -1076,7 +2097,9 @@ UINT ResolvePasses(const std::vector<std::string_view>& blocks, const std::vecto
 				SubmitThreadpoolWork(work);
 			}
 
-			renderer.CompileShader(false, passSources[0], "__M", desc.passes[0].cso.ReleaseAndGetAddressOf(), "Pass1", &passInclude);
+			if (!CompilePass(passSources[0], desc.passes[0], 0)) {
+				desc.passes[0].cso = nullptr;
+			}
 
 			WaitForThreadpoolWorkCallbacks(work, FALSE);
 			CloseThreadpoolWork(work);
@@ -1092,7 +2115,7 @@ UINT ResolvePasses(const std::vector<std::string_view>& blocks, const std::vecto
 
 			// 回退到单线程
 			for (size_t i = 0; i < passSources.size(); ++i) {
-				if (!renderer.CompileShader(false, passSources[i], "__M", desc.passes[i].cso.ReleaseAndGetAddressOf(), fmt::format("Pass{}", i + 1).c_str(), &passInclude)) {
+				if (!CompilePass(passSources[i], desc.passes[i], i)) {
 					SPDLOG_LOGGER_ERROR(logger, fmt::format("编译 Pass{} 失败", i + 1));
 					return 1;
 				}
@@ -1104,43 +2127,14 @@ UINT ResolvePasses(const std::vector<std::string_view>& blocks, const std::vecto
 }
 
 
-UINT EffectCompiler::Compile(const wchar_t* fileName, EffectDesc& desc) {
-	desc = {};
-
-	std::string source;
-	if (!Utils::ReadTextFile(fileName, source)) {
-		SPDLOG_LOGGER_ERROR(logger, "读取源文件失败");
-		return 1;
-	}
-
-	if (source.empty()) {
-		SPDLOG_LOGGER_ERROR(logger, "源文件为空");
-		return 1;
-	}
-
-	// 移除注释
-	if (RemoveComments(source)) {
-		SPDLOG_LOGGER_ERROR(logger, "删除注释失败");
-		return 1;
-	}
-
-	std::string md5;
-	if (!App::GetInstance().IsDisableEffectCache()) {
-		std::vector<BYTE> hash;
-		if (!Utils::Hasher::GetInstance().Hash(source.data(), source.size(), hash)) {
-			SPDLOG_LOGGER_ERROR(logger, "计算 hash 失败");
-		} else {
-			md5 = Utils::Bin2Hex(hash.data(), hash.size());
-
-			if (EffectCache::GetInstance().Load(fileName, md5, desc)) {
-				// 已从缓存中读取
-				return 0;
-			}
-		}
-	}
-
-	std::string_view sourceView(source);
-
+// 解析已删除注释的源码并编译所有 Pass，desc 中的名字是复制的，不引用 source
+static UINT ResolveSource(
+	std::string_view sourceView,
+	EffectDesc& desc,
+	UINT flags,
+	const std::vector<Constant32>* specializedConstants,
+	std::vector<std::string>* passSources
+) {
 	// 检查头
 	if (!CheckMagic(sourceView)) {
 		SPDLOG_LOGGER_ERROR(logger, "检查 MagpieFX 头失败");
@@ -1151,6 +2145,7 @@ UINT EffectCompiler::Compile(const wchar_t* fileName, EffectDesc& desc) {
 		Header,
 		Constant,
 		Texture,
+		Tensor,
 		Sampler,
 		Common,
 		Pass
@@ -1159,6 +2154,7 @@ UINT EffectCompiler::Compile(const wchar_t* fileName, EffectDesc& desc) {
 	std::string_view headerBlock;
 	std::vector<std::string_view> constantBlocks;
 	std::vector<std::string_view> textureBlocks;
+	std::vector<std::string_view> tensorBlocks;
 	std::vector<std::string_view> samplerBlocks;
 	std::vector<std::string_view> commonBlocks;
 	std::vector<std::string_view> passBlocks;
@@ -1177,6 +2173,9 @@ UINT EffectCompiler::Compile(const wchar_t* fileName, EffectDesc& desc) {
 		case BlockType::Texture:
 			textureBlocks.push_back(sourceView.substr(curBlockOff, len));
 			break;
+		case BlockType::Tensor:
+			tensorBlocks.push_back(sourceView.substr(curBlockOff, len));
+			break;
 		case BlockType::Sampler:
 			samplerBlocks.push_back(sourceView.substr(curBlockOff, len));
 			break;
@@ -1213,6 +2212,8 @@ UINT EffectCompiler::Compile(const wchar_t* fileName, EffectDesc& desc) {
 					completeCurrentBlock(len, BlockType::Constant);
 				} else if (blockType == "TEXTURE") {
 					completeCurrentBlock(len, BlockType::Texture);
+				} else if (blockType == "TENSOR") {
+					completeCurrentBlock(len, BlockType::Tensor);
 				} else if (blockType == "SAMPLER") {
 					completeCurrentBlock(len, BlockType::Sampler);
 				} else if (blockType == "COMMON") {
@@ -1262,6 +2263,14 @@ UINT EffectCompiler::Compile(const wchar_t* fileName, EffectDesc& desc) {
 		}
 	}
 
+	std::vector<TensorDesc> tensors;
+	for (size_t i = 0; i < tensorBlocks.size(); ++i) {
+		if (ResolveTensor(tensorBlocks[i], desc, tensors)) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 Tensor#{} 块失败", i + 1));
+			return 1;
+		}
+	}
+
 	for (size_t i = 0; i < samplerBlocks.size(); ++i) {
 		if (ResolveSampler(samplerBlocks[i], desc)) {
 			SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 Sampler#{} 块失败", i + 1));
@@ -1269,6 +2278,14 @@ UINT EffectCompiler::Compile(const wchar_t* fileName, EffectDesc& desc) {
 		}
 	}
 
+	if (!tensors.empty()) {
+		// 张量的访问函数使用点采样
+		EffectSamplerDesc& samDesc = desc.samplers.emplace_back();
+		samDesc.filterType = EffectSamplerFilterType::Point;
+		samDesc.addressType = EffectSamplerAddressType::Clamp;
+		samDesc.name = TENSOR_SAMPLER_NAME;
+	}
+
 	{
 		// 确保没有重复的名字
 		std::unordered_set<std::string> names;
@@ -1293,6 +2310,13 @@ UINT EffectCompiler::Compile(const wchar_t* fileName, EffectDesc& desc) {
 			}
 			names.insert(d.name);
 		}
+		for (const auto& d : tensors) {
+			if (names.find(d.name) != names.end()) {
+				SPDLOG_LOGGER_ERROR(logger, "标识符重复");
+				return 1;
+			}
+			names.insert(d.name);
+		}
 	}
 
 	for (size_t i = 0; i < commonBlocks.size(); ++i) {
@@ -1302,12 +2326,130 @@ UINT EffectCompiler::Compile(const wchar_t* fileName, EffectDesc& desc) {
 		}
 	}
 
-	if (ResolvePasses(passBlocks, commonBlocks, desc)) {
+	if (ResolvePasses(passBlocks, commonBlocks, desc, tensors, flags, specializedConstants, passSources)) {
 		SPDLOG_LOGGER_ERROR(logger, "解析 Pass 块失败");
 		return 1;
 	}
 
-	EffectCache::GetInstance().Save(fileName, md5, desc);
+	return 0;
+}
+
+UINT EffectCompiler::Compile(
+	const wchar_t* fileName,
+	std::shared_ptr<const EffectDesc>& result,
+	UINT flags,
+	const std::vector<Constant32>* specializedConstants,
+	std::string* cacheKey
+) {
+	result.reset();
+	if (cacheKey) {
+		cacheKey->clear();
+	}
+
+	std::string source;
+	if (!Utils::ReadTextFile(fileName, source)) {
+		SPDLOG_LOGGER_ERROR(logger, "读取源文件失败");
+		return 1;
+	}
+
+	if (source.empty()) {
+		SPDLOG_LOGGER_ERROR(logger, "源文件为空");
+		return 1;
+	}
+
+	// 移除注释
+	if (RemoveComments(source)) {
+		SPDLOG_LOGGER_ERROR(logger, "删除注释失败");
+		return 1;
+	}
+
+	std::string md5;
+	if (!(flags & COMPILE_FLAG_NO_COMPILE) && !App::GetInstance().IsDisableEffectCache()) {
+		std::vector<BYTE> hash;
+		if (!Utils::Hasher::GetInstance().Hash(source.data(), source.size(), hash)) {
+			SPDLOG_LOGGER_ERROR(logger, "计算 hash 失败");
+		} else {
+			md5 = Utils::Bin2Hex(hash.data(), hash.size());
+
+			// 生成的 hlsl 和编译目标都取决于功能级别，不同显卡上的会话不能共用缓存
+			md5 += fmt::format("_{:04x}", (UINT)GetFeatureLevel());
+
+			if (specializedConstants) {
+				// 特化的变体附加常量值的 hash
+				if (!Utils::Hasher::GetInstance().Hash((void*)specializedConstants->data(),
+					specializedConstants->size() * sizeof(Constant32), hash)
+				) {
+					SPDLOG_LOGGER_ERROR(logger, "计算 hash 失败");
+					md5.clear();
+				} else {
+					md5 += "_" + Utils::Bin2Hex(hash.data(), hash.size());
+				}
+			}
+
+			if (!md5.empty() && (flags & COMPILE_FLAG_HALF_PRECISION)) {
+				md5 += "_half";
+			}
+		}
+
+		if (md5.empty() && (flags & COMPILE_FLAG_DEFER_SAVE)) {
+			// 调用者无法区分结果是否来自缓存
+			return 1;
+		}
+
+		if (!md5.empty()) {
+			result = EffectCache::GetInstance().Load(fileName, md5);
+			if (result) {
+				// 已从缓存中读取
+				return 0;
+			}
+		}
+	}
+
+	std::shared_ptr<EffectDesc> descPtr = std::make_shared<EffectDesc>();
+	if (UINT ret = ResolveSource(source, *descPtr, flags, specializedConstants, nullptr)) {
+		return ret;
+	}
+
+	result = std::move(descPtr);
+
+	if (flags & COMPILE_FLAG_DEFER_SAVE) {
+		if (cacheKey) {
+			*cacheKey = std::move(md5);
+		}
+	} else if (!md5.empty()) {
+		EffectCache::GetInstance().Save(fileName, md5, result);
+	}
+
+	return 0;
+}
+
+UINT EffectCompiler::CompileSource(
+	std::string source,
+	std::shared_ptr<const EffectDesc>& result,
+	UINT flags,
+	const std::vector<Constant32>* specializedConstants,
+	std::vector<std::string>* passSources
+) {
+	result.reset();
+	if (passSources) {
+		passSources->clear();
+	}
+
+	if (source.empty()) {
+		SPDLOG_LOGGER_ERROR(logger, "源文件为空");
+		return 1;
+	}
+
+	if (RemoveComments(source)) {
+		SPDLOG_LOGGER_ERROR(logger, "删除注释失败");
+		return 1;
+	}
+
+	std::shared_ptr<EffectDesc> descPtr = std::make_shared<EffectDesc>();
+	if (UINT ret = ResolveSource(source, *descPtr, flags, specializedConstants, passSources)) {
+		return ret;
+	}
 
+	result = std::move(descPtr);
 	return 0;
 }
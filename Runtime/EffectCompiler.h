@@ -7,7 +7,37 @@ class EffectCompiler {
 public:
 	EffectCompiler() = default;
 
-	static UINT Compile(const wchar_t* fileName, EffectDesc& desc);
+	enum CompileFlags : UINT {
+		// 只解析不编译着色器，也不读写缓存，用于之后特化常量时再编译
+		COMPILE_FLAG_NO_COMPILE = 0x1,
+		// 生成半精度的变体：float 系列的类型被替换为 min16float，只对使用了 HALF_PRECISION 指令的效果有效
+		COMPILE_FLAG_HALF_PRECISION = 0x2,
+		// 编译结果不保存到缓存，而是将缓存的键写入 cacheKey，由调用者验证后再保存
+		// 从缓存读取时 cacheKey 为空
+		COMPILE_FLAG_DEFER_SAVE = 0x4
+	};
+
+	// specializedConstants 不为空时按顺序包含 constants 和 valueConstants 的值，
+	// 它们在生成的 hlsl 中成为 static const 字面量，编译器可以折叠常量并删除无用的分支
+	// 成功时 desc 指向编译结果，来自缓存时和其他调用者共享，因此是只读的
+	static UINT Compile(
+		const wchar_t* fileName,
+		std::shared_ptr<const EffectDesc>& desc,
+		UINT flags = 0,
+		const std::vector<Constant32>* specializedConstants = nullptr,
+		std::string* cacheKey = nullptr
+	);
+
+	// 编译内存中的源码，不读写缓存
+	// passSources 不为空时返回生成的 hlsl，和 desc->passes 一一对应
+	// 和 COMPILE_FLAG_NO_COMPILE 一起使用时不需要渲染器，用于测试解析和代码生成
+	static UINT CompileSource(
+		std::string source,
+		std::shared_ptr<const EffectDesc>& desc,
+		UINT flags = 0,
+		const std::vector<Constant32>* specializedConstants = nullptr,
+		std::vector<std::string>* passSources = nullptr
+	);
 
 	// 当前 MagpieFX 版本
 	static constexpr UINT VERSION = 1;
@@ -1,6 +1,7 @@
 #pragma once
 #include "pch.h"
 #include <variant>
+#include <array>
 
 
 enum class EffectIntermediateTextureFormat {
@@ -58,6 +59,11 @@ struct EffectValueConstantDesc {
 	std::string valueExpr;
 };
 
+union Constant32 {
+	int intVal;
+	float floatVal;
+};
+
 struct EffectConstantDesc {
 	std::string name;
 	std::string label;
@@ -71,12 +77,35 @@ struct EffectPassDesc {
 	std::vector<UINT> inputs;
 	std::vector<UINT> outputs;
 	ComPtr<ID3DBlob> cso;
+
+	// 计算着色器 Pass，输出通过 UAV 写入
+	bool isCompute = false;
+	// 每个线程组负责的输出像素块
+	std::pair<UINT, UINT> blockSize{};
+	std::array<UINT, 3> numThreads{};
+
+	// 由 CONDITION 指令指定，为 int 常量在 constants 中的索引，-1 表示总是执行
+	// 常量的值为 0 时跳过此 Pass，只由跳过的 Pass 写入的中间纹理不会被创建
+	int condition = -1;
+
+	// 编译后通过反射得到的着色器实际使用的资源，第 i 位表示第 i 个槽
+	// 被优化掉的输入、采样器和常量缓冲区无需绑定。超过 64 个输入时 usedInputs 全部置位
+	uint64_t usedInputs = 0;
+	UINT usedSamplers = 0;
+	UINT usedConstantBuffers = 0;
 };
 
 struct EffectDesc {
 	// 用于计算效果的输出，空值表示支持任意大小的输出
 	std::pair<std::string, std::string> outSizeExpr;
 
+	// 允许生成半精度的变体，由 HALF_PRECISION 指令指定
+	bool halfPrecision = false;
+
+	// 由 HALO 指令指定，为输出像素依赖的输入像素距离该像素在输入中对应位置的最大距离（输入像素）
+	// 离线处理时用于分块，-1 表示未指定，这样的效果只能整张处理
+	int halo = -1;
+
 	std::vector<EffectConstantDesc> constants;
 	std::vector<EffectValueConstantDesc> valueConstants;
 	std::vector<EffectValueConstantDesc> dynamicValueConstants;
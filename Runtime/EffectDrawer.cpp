@@ -4,8 +4,8 @@
 #include "Utils.h"
 #include <VertexTypes.h>
 #include "EffectCompiler.h"
-#include "TextureLoader.h"
 #include "StrUtils.h"
+#include "EffectCache.h"
 
 #ifdef _UNICODE
 #undef _UNICODE
@@ -19,85 +19,126 @@
 
 extern std::shared_ptr<spdlog::logger> logger;
 
-// 所有 EffectDrawer 共享一个实例
-static mu::Parser exprParser;
+// 同一线程上的所有 EffectDrawer 共享一个实例
+// 多个会话的渲染线程和加载效果的线程同时求值，因此每个线程使用自己的实例
+struct ExprContext {
+	ExprContext() {
+		parser.DefineVar("INPUT_WIDTH", &inputWidth);
+		parser.DefineVar("INPUT_HEIGHT", &inputHeight);
+		parser.DefineVar("INPUT_PT_X", &inputPtX);
+		parser.DefineVar("INPUT_PT_Y", &inputPtY);
+		parser.DefineVar("OUTPUT_WIDTH", &outputWidth);
+		parser.DefineVar("OUTPUT_HEIGHT", &outputHeight);
+		parser.DefineVar("OUTPUT_PT_X", &outputPtX);
+		parser.DefineVar("OUTPUT_PT_Y", &outputPtY);
+		parser.DefineVar("SCALE_X", &scaleX);
+		parser.DefineVar("SCALE_Y", &scaleY);
+		parser.DefineVar("FRAME_COUNT", &frameCount);
+		parser.DefineVar("CURSOR_X", &cursorX);
+		parser.DefineVar("CURSOR_Y", &cursorY);
+	}
+
+	ExprContext(const ExprContext&) = delete;
+	ExprContext(ExprContext&&) = delete;
+
+	mu::Parser parser;
+
+	double inputWidth = 0;
+	double inputHeight = 0;
+	double inputPtX = 0;
+	double inputPtY = 0;
+	double outputWidth = 0;
+	double outputHeight = 0;
+	double outputPtX = 0;
+	double outputPtY = 0;
+	double scaleX = 0;
+	double scaleY = 0;
+	double frameCount = 0;
+	double cursorX = 0;
+	double cursorY = 0;
+};
+
+static ExprContext& GetExprContext() {
+	thread_local ExprContext context;
+	return context;
+}
 
 void SetExprVars(SIZE inputSize, SIZE outputSize) {
 	assert(inputSize.cx > 0 && inputSize.cy > 0);
 
-	static double inputWidth = 0;
-	static double inputHeight = 0;
-	static double inputPtX = 0;
-	static double inputPtY = 0;
-	static double outputWidth = 0;
-	static double outputHeight = 0;
-	static double outputPtX = 0;
-	static double outputPtY = 0;
-	static double scaleX = 0;
-	static double scaleY = 0;
-
-	static bool init = false;
-
-	if (!init) {
-		init = true;
-
-		exprParser.DefineVar("INPUT_WIDTH", &inputWidth);
-		exprParser.DefineVar("INPUT_HEIGHT", &inputHeight);
-		exprParser.DefineVar("INPUT_PT_X", &inputPtX);
-		exprParser.DefineVar("INPUT_PT_Y", &inputPtY);
-		exprParser.DefineVar("OUTPUT_WIDTH", &outputWidth);
-		exprParser.DefineVar("OUTPUT_HEIGHT", &outputHeight);
-		exprParser.DefineVar("OUTPUT_PT_X", &outputPtX);
-		exprParser.DefineVar("OUTPUT_PT_Y", &outputPtY);
-		exprParser.DefineVar("SCALE_X", &scaleX);
-		exprParser.DefineVar("SCALE_Y", &scaleY);
-	}
-
-	inputWidth = inputSize.cx;
-	inputHeight = inputSize.cy;
-	inputPtX = 1.0f / inputSize.cx;
-	inputPtY = 1.0f / inputSize.cy;
-	outputWidth = outputSize.cx;
-	outputHeight = outputSize.cy;
-	outputPtX = 1.0f / outputSize.cx;
-	outputPtY = 1.0f / outputSize.cy;
-	scaleX = inputPtX * outputWidth;
-	scaleY = inputPtY * outputHeight;
+	ExprContext& context = GetExprContext();
+	context.inputWidth = inputSize.cx;
+	context.inputHeight = inputSize.cy;
+	context.inputPtX = 1.0f / inputSize.cx;
+	context.inputPtY = 1.0f / inputSize.cy;
+	context.outputWidth = outputSize.cx;
+	context.outputHeight = outputSize.cy;
+	context.outputPtX = 1.0f / outputSize.cx;
+	context.outputPtY = 1.0f / outputSize.cy;
+	context.scaleX = context.inputPtX * context.outputWidth;
+	context.scaleY = context.inputPtY * context.outputHeight;
 }
 
 void SetExprDynamicVars(int frameCount, double cursorX, double cursorY) {
-	static double frameCount_ = 0;
-	static double cursorX_ = 0;
-	static double cursorY_ = 0;
+	ExprContext& context = GetExprContext();
+	context.frameCount = frameCount;
+	context.cursorX = cursorX;
+	context.cursorY = cursorY;
+}
 
-	static bool init = false;
+bool EvalExpr(const std::string& expr, double& value) {
+	try {
+		mu::Parser& parser = GetExprContext().parser;
+		parser.SetExpr(expr);
+		value = parser.Eval();
+	} catch (...) {
+		return false;
+	}
 
-	if (!init) {
-		init = true;
+	return true;
+}
 
-		exprParser.DefineVar("FRAME_COUNT", &frameCount_);
-		exprParser.DefineVar("CURSOR_X", &cursorX_);
-		exprParser.DefineVar("CURSOR_Y", &cursorY_);
-	}
+// 将掩码中置位的连续槽合并为 (起始槽, 数量) 的区间，第 64 个及之后的槽总是视为置位
+static void GetSlotRanges(uint64_t mask, size_t slotCount, std::vector<std::pair<UINT, UINT>>& ranges) {
+	ranges.clear();
+
+	for (UINT i = 0; i < slotCount; ++i) {
+		if (i < 64 && !((mask >> i) & 1)) {
+			continue;
+		}
 
-	frameCount_ = frameCount;
-	cursorX_ = cursorX;
-	cursorY_ = cursorY;
+		if (!ranges.empty() && ranges.back().first + ranges.back().second == i) {
+			++ranges.back().second;
+		} else {
+			ranges.emplace_back(i, 1);
+		}
+	}
 }
 
 
 EffectDrawer::EffectDrawer(const EffectDrawer& other) {
+	_fileName = other._fileName;
 	_d3dDevice = other._d3dDevice;
 	_d3dDC = other._d3dDC;
 	_samplers = other._samplers;
 	_textures = other._textures;
+	_psSamplerRanges = other._psSamplerRanges;
+	_csSamplerRanges = other._csSamplerRanges;
+	_psConstantBufferRanges = other._psConstantBufferRanges;
+	_csConstantBufferRanges = other._csConstantBufferRanges;
 	_constNamesMap = other._constNamesMap;
 	_constants = other._constants;
 	_constantBuffer = other._constantBuffer;
 	_vertexShader = other._vertexShader;
 	_outputSize = other._outputSize;
+	_exprInputSize = other._exprInputSize;
+	_exprOutputSize = other._exprOutputSize;
 	_effectDesc = other._effectDesc;
+	_passDescs = other._passDescs;
 	_passes = other._passes;
+	_specializedValues = other._specializedValues;
+	_halfPrecisionDesc = other._halfPrecisionDesc;
+	_halfPrecisionCacheKey = other._halfPrecisionCacheKey;
 
 	for (_Pass& pass : _passes) {
 		pass.SetParent(this);
@@ -105,17 +146,28 @@ EffectDrawer::EffectDrawer(const EffectDrawer& other) {
 }
 
 EffectDrawer::EffectDrawer(EffectDrawer&& other) noexcept {
+	_fileName = std::move(other._fileName);
 	_d3dDevice = std::move(other._d3dDevice);
 	_d3dDC = std::move(other._d3dDC);
 	_samplers = std::move(other._samplers);
 	_textures = std::move(other._textures);
+	_psSamplerRanges = std::move(other._psSamplerRanges);
+	_csSamplerRanges = std::move(other._csSamplerRanges);
+	_psConstantBufferRanges = std::move(other._psConstantBufferRanges);
+	_csConstantBufferRanges = std::move(other._csConstantBufferRanges);
 	_constNamesMap = std::move(other._constNamesMap);
 	_constants = std::move(other._constants);
 	_constantBuffer = std::move(other._constantBuffer);
 	_vertexShader = std::move(other._vertexShader);
 	_outputSize = std::move(other._outputSize);
+	_exprInputSize = other._exprInputSize;
+	_exprOutputSize = other._exprOutputSize;
 	_effectDesc = std::move(other._effectDesc);
+	_passDescs = std::move(other._passDescs);
 	_passes = std::move(other._passes);
+	_specializedValues = std::move(other._specializedValues);
+	_halfPrecisionDesc = std::move(other._halfPrecisionDesc);
+	_halfPrecisionCacheKey = std::move(other._halfPrecisionCacheKey);
 
 	for (_Pass& pass : _passes) {
 		pass.SetParent(this);
@@ -123,6 +175,9 @@ EffectDrawer::EffectDrawer(EffectDrawer&& other) noexcept {
 }
 
 bool EffectDrawer::Initialize(const wchar_t* fileName) {
+	_fileName = fileName;
+
+	// 特化常量时也编译通用的着色器，尺寸改变后、特化的着色器编译完成前使用
 	bool result = false;
 	int duration = Utils::Measure([&]() {
 		result = !EffectCompiler::Compile(fileName, _effectDesc);
@@ -135,20 +190,31 @@ bool EffectDrawer::Initialize(const wchar_t* fileName) {
 		SPDLOG_LOGGER_INFO(logger, fmt::format("编译 {} 用时 {} 毫秒", StrUtils::UTF16ToUTF8(fileName), duration / 1000.0f));
 	}
 
+	// 描述可能和其他实例共享，Build 和半精度验证会修改 Pass，因此复制一份
+	_passDescs = _effectDesc->passes;
+
 	Renderer& renderer = App::GetInstance().GetRenderer();
 	_d3dDevice = renderer.GetD3DDevice();
 	_d3dDC = renderer.GetD3DDC();
 
-	_samplers.resize(_effectDesc.samplers.size());
+	_samplers.resize(_effectDesc->samplers.size());
 	for (size_t i = 0; i < _samplers.size(); ++i) {
-		EffectSamplerDesc& desc = _effectDesc.samplers[i];
+		const EffectSamplerDesc& desc = _effectDesc->samplers[i];
 		if (!renderer.GetSampler(desc.filterType, desc.addressType, &_samplers[i])) {
 			SPDLOG_LOGGER_ERROR(logger, fmt::format("创建采样器 {} 失败", desc.name));
 			return false;
 		}
 	}
 
-	_passes.resize(_effectDesc.passes.size());
+	_passes.resize(_passDescs.size());
+
+	// 特化常量时由 Specialize 编译半精度变体，没有常量时特化的着色器就是通用的着色器
+	const bool specialize = App::GetInstance().IsSpecializeEffectConstants()
+		&& !(_effectDesc->constants.empty() && _effectDesc->valueConstants.empty());
+	if (!specialize && App::GetInstance().IsHalfPrecisionEffects() && _effectDesc->halfPrecision) {
+		_CompileHalfPrecision(nullptr);
+	}
+
 	for (size_t i = 0; i < _passes.size(); ++i) {
 		if (!_passes[i].Initialize(this, i)) {
 			SPDLOG_LOGGER_ERROR(logger, fmt::format("Pass{} 初始化失败", i + 1));
@@ -157,12 +223,12 @@ bool EffectDrawer::Initialize(const wchar_t* fileName) {
 	}
 
 	// 大小必须为 4 的倍数
-	_constants.resize((_effectDesc.constants.size() + _effectDesc.valueConstants.size() + 3) / 4 * 4);
-	_dynamicConstants.resize((_effectDesc.dynamicValueConstants.size() + 3) / 4 * 4);
+	_constants.resize((_effectDesc->constants.size() + _effectDesc->valueConstants.size() + 3) / 4 * 4);
+	_dynamicConstants.resize((_effectDesc->dynamicValueConstants.size() + 3) / 4 * 4);
 
 	// 设置常量默认值
-	for (size_t i = 0; i < _effectDesc.constants.size(); ++i) {
-		const auto& c = _effectDesc.constants[i];
+	for (size_t i = 0; i < _effectDesc->constants.size(); ++i) {
+		const auto& c = _effectDesc->constants[i];
 		if (c.type == EffectConstantType::Float) {
 			_constants[i].floatVal = std::get<float>(c.defaultValue);
 		} else {
@@ -171,8 +237,8 @@ bool EffectDrawer::Initialize(const wchar_t* fileName) {
 	}
 
 	// 用于快速查找常量名
-	for (UINT i = 0; i < _effectDesc.constants.size(); ++i) {
-		_constNamesMap.emplace(_effectDesc.constants[i].name, i);
+	for (UINT i = 0; i < _effectDesc->constants.size(); ++i) {
+		_constNamesMap.emplace(_effectDesc->constants[i].name, i);
 	}
 	
 	return true;
@@ -184,7 +250,7 @@ EffectDrawer::ConstantType EffectDrawer::GetConstantType(std::string_view name)
 		return ConstantType::NotFound;
 	}
 
-	return _effectDesc.constants[it->second].type == EffectConstantType::Float ?
+	return _effectDesc->constants[it->second].type == EffectConstantType::Float ?
 		ConstantType::Float : ConstantType::Int;
 }
 
@@ -195,7 +261,7 @@ bool EffectDrawer::SetConstant(std::string_view name, float value) {
 	}
 	UINT index = it->second;
 
-	const auto& desc = _effectDesc.constants[index];
+	const auto& desc = _effectDesc->constants[index];
 	if (desc.type != EffectConstantType::Float) {
 		return false;
 	}
@@ -229,7 +295,7 @@ bool EffectDrawer::SetConstant(std::string_view name, int value) {
 	}
 	UINT index = it->second;
 
-	const auto& desc = _effectDesc.constants[index];
+	const auto& desc = _effectDesc->constants[index];
 	if (desc.type != EffectConstantType::Int) {
 		return false;
 	}
@@ -265,10 +331,11 @@ bool EffectDrawer::CalcOutputSize(SIZE inputSize, SIZE& outputSize) const {
 		SetExprVars(inputSize, {});
 
 		try {
-			exprParser.SetExpr(_effectDesc.outSizeExpr.first);
-			outputSize.cx = std::lround(exprParser.Eval());
-			exprParser.SetExpr(_effectDesc.outSizeExpr.second);
-			outputSize.cy = std::lround(exprParser.Eval());
+			mu::Parser& parser = GetExprContext().parser;
+			parser.SetExpr(_effectDesc->outSizeExpr.first);
+			outputSize.cx = std::lround(parser.Eval());
+			parser.SetExpr(_effectDesc->outSizeExpr.second);
+			outputSize.cy = std::lround(parser.Eval());
 		} catch (...) {
 			return false;
 		}
@@ -278,7 +345,7 @@ bool EffectDrawer::CalcOutputSize(SIZE inputSize, SIZE& outputSize) const {
 }
 
 bool EffectDrawer::CanSetOutputSize() const {
-	return _effectDesc.outSizeExpr.first.empty();
+	return _effectDesc->outSizeExpr.first.empty();
 }
 
 void EffectDrawer::SetOutputSize(SIZE value) {
@@ -286,14 +353,15 @@ void EffectDrawer::SetOutputSize(SIZE value) {
 }
 
 
-bool EvalConstants(const std::vector<EffectValueConstantDesc>& descs, std::vector<Constant32>& constants, size_t base = 0) {
+bool EvalConstants(const std::vector<EffectValueConstantDesc>& descs, std::vector<Constant32>& constants, size_t base) {
 	for (size_t i = 0; i < descs.size(); ++i) {
 		const auto& d = descs[i];
 
 		double value;
 		try {
-			exprParser.SetExpr(d.valueExpr);
-			value = exprParser.Eval();
+			mu::Parser& parser = GetExprContext().parser;
+			parser.SetExpr(d.valueExpr);
+			value = parser.Eval();
 		} catch (...) {
 			SPDLOG_LOGGER_ERROR(logger, fmt::format("计算表达式 {} 失败", d.valueExpr));
 			return false;
@@ -320,27 +388,53 @@ bool EffectDrawer::Build(ComPtr<ID3D11Texture2D> input, ComPtr<ID3D11Texture2D>
 		return false;
 	}
 	
+	_exprInputSize = inputSize;
+	_exprOutputSize = outputSize;
 	SetExprVars(inputSize, outputSize);
 	SetExprDynamicVars(0, 0, 0);
 
+	// 计算着色器 Pass 的输出需要作为 UAV，最后一项为 OUTPUT
+	// 只由跳过的 Pass 写入的中间纹理无需创建
+	std::vector<bool> isUavOutput(_effectDesc->textures.size() + 1);
+	std::vector<bool> isWritten(_effectDesc->textures.size() + 1);
+	for (const EffectPassDesc& passDesc : _passDescs) {
+		if (_IsPassSkipped(passDesc)) {
+			continue;
+		}
+
+		for (UINT output : passDesc.outputs) {
+			isWritten[output] = true;
+			if (passDesc.isCompute) {
+				isUavOutput[output] = true;
+			}
+		}
+	}
+
 	// 创建中间纹理
-	_textures.resize(_effectDesc.textures.size() + 1);
+	_textures.resize(_effectDesc->textures.size() + 1);
 	_textures[0] = input;
-	for (size_t i = 1; i < _effectDesc.textures.size(); ++i) {
-		if (!_effectDesc.textures[i].source.empty()) {
-			// 从文件加载纹理
-			_textures[i] = TextureLoader::Load((L"effects\\" + StrUtils::UTF8ToUTF16(_effectDesc.textures[i].source)).c_str());
+	for (size_t i = 1; i < _effectDesc->textures.size(); ++i) {
+		if (!_effectDesc->textures[i].source.empty()) {
+			// 从文件加载纹理，多个效果使用同一文件时共享
+			_textures[i] = App::GetInstance().GetRenderer().GetDeviceResources().GetAsset(
+				(L"effects\\" + StrUtils::UTF8ToUTF16(_effectDesc->textures[i].source)).c_str());
 			if (!_textures[i]) {
-				SPDLOG_LOGGER_ERROR(logger, fmt::format("加载纹理 {} 失败", _effectDesc.textures[i].source));
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("加载纹理 {} 失败", _effectDesc->textures[i].source));
 				return false;
 			}
+		} else if (!isWritten[i]) {
+			if (_textures[i]) {
+				App::GetInstance().GetRenderer().ReleaseViews(_textures[i].Get());
+				_textures[i] = nullptr;
+			}
 		} else {
 			SIZE texSize{};
 			try {
-				exprParser.SetExpr(_effectDesc.textures[i].sizeExpr.first);
-				texSize.cx = std::lround(exprParser.Eval());
-				exprParser.SetExpr(_effectDesc.textures[i].sizeExpr.second);
-				texSize.cy = std::lround(exprParser.Eval());
+				mu::Parser& parser = GetExprContext().parser;
+				parser.SetExpr(_effectDesc->textures[i].sizeExpr.first);
+				texSize.cx = std::lround(parser.Eval());
+				parser.SetExpr(_effectDesc->textures[i].sizeExpr.second);
+				texSize.cy = std::lround(parser.Eval());
 			} catch (const mu::ParserError& e) {
 				SPDLOG_LOGGER_ERROR(logger, fmt::format("计算中间纹理尺寸失败：{}", e.GetMsg()));
 				return false;
@@ -352,7 +446,7 @@ bool EffectDrawer::Build(ComPtr<ID3D11Texture2D> input, ComPtr<ID3D11Texture2D>
 			}
 
 			D3D11_TEXTURE2D_DESC desc{};
-			desc.Format = EffectIntermediateTextureDesc::DXGI_FORMAT_MAP[(UINT)_effectDesc.textures[i].format];
+			desc.Format = EffectIntermediateTextureDesc::DXGI_FORMAT_MAP[(UINT)_effectDesc->textures[i].format];
 			desc.Width = texSize.cx;
 			desc.Height = texSize.cy;
 			desc.Usage = D3D11_USAGE_DEFAULT;
@@ -361,6 +455,22 @@ bool EffectDrawer::Build(ComPtr<ID3D11Texture2D> input, ComPtr<ID3D11Texture2D>
 			desc.SampleDesc.Count = 1;
 			desc.SampleDesc.Quality = 0;
 			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+			if (isUavOutput[i]) {
+				desc.BindFlags |= D3D11_BIND_UNORDERED_ACCESS;
+			}
+
+			// 重新构建时尺寸没有改变的纹理无需重新创建
+			if (_textures[i]) {
+				D3D11_TEXTURE2D_DESC oldDesc;
+				_textures[i]->GetDesc(&oldDesc);
+				if (oldDesc.Width == desc.Width && oldDesc.Height == desc.Height
+					&& oldDesc.Format == desc.Format && oldDesc.BindFlags == desc.BindFlags) {
+					continue;
+				}
+
+				App::GetInstance().GetRenderer().ReleaseViews(_textures[i].Get());
+			}
+
 			HRESULT hr = App::GetInstance().GetRenderer().GetD3DDevice()->CreateTexture2D(
 				&desc, nullptr, _textures[i].ReleaseAndGetAddressOf());
 			if (FAILED(hr)) {
@@ -373,18 +483,32 @@ bool EffectDrawer::Build(ComPtr<ID3D11Texture2D> input, ComPtr<ID3D11Texture2D>
 	_textures.back() = output;
 
 	
-	if (!EvalConstants(_effectDesc.valueConstants, _constants, _effectDesc.constants.size())) {
+	if (!EvalConstants(_effectDesc->valueConstants, _constants, _effectDesc->constants.size())) {
 		SPDLOG_LOGGER_ERROR(logger, "计算常量失败");
 		return false;
 	}
 
 	// 每帧更新的常量也计算一次，用于检测表达式语法错误
-	if (!EvalConstants(_effectDesc.dynamicValueConstants, _dynamicConstants)) {
+	if (!EvalConstants(_effectDesc->dynamicValueConstants, _dynamicConstants)) {
 		SPDLOG_LOGGER_ERROR(logger, "计算动态常量失败");
 		return false;
 	}
 	
-	if (!_constants.empty()) {
+	if (_specializedValues) {
+		// 按位比较，和编译时的值相同时才能使用特化的着色器
+		const bool same = std::equal(_specializedValues->begin(), _specializedValues->end(), _constants.begin(),
+			[](Constant32 l, Constant32 r) { return l.intVal == r.intVal; });
+		if (!same) {
+			// 输入或输出尺寸改变，不在这里重新编译，由 Renderer 在后台重新特化
+			SPDLOG_LOGGER_INFO(logger, fmt::format("{} 的常量已改变，暂时使用通用的着色器", StrUtils::UTF16ToUTF8(_fileName)));
+			if (!_UseGenericPasses()) {
+				SPDLOG_LOGGER_ERROR(logger, "_UseGenericPasses 失败");
+				return false;
+			}
+		}
+	}
+
+	if (!_specializedValues && !_constants.empty()) {
 		// 创建常量缓冲区
 		D3D11_BUFFER_DESC bd{};
 		bd.Usage = D3D11_USAGE_DEFAULT;
@@ -419,12 +543,40 @@ bool EffectDrawer::Build(ComPtr<ID3D11Texture2D> input, ComPtr<ID3D11Texture2D>
 		}
 	}
 
+	if (!_BuildPasses(outputSize)) {
+		SPDLOG_LOGGER_ERROR(logger, "_BuildPasses 失败");
+		return false;
+	}
+
+	return true;
+}
+
+bool EffectDrawer::SetInput(ComPtr<ID3D11Texture2D> input) {
+	if (_textures.front() == input) {
+		return true;
+	}
+
+	ID3D11ShaderResourceView* inputSrv = nullptr;
+	if (!App::GetInstance().GetRenderer().GetShaderResourceView(input.Get(), &inputSrv)) {
+		SPDLOG_LOGGER_ERROR(logger, "获取 ShaderResourceView 失败");
+		return false;
+	}
+
+	_textures.front() = input;
+	for (_Pass& pass : _passes) {
+		pass.SetInput(inputSrv);
+	}
+
+	return true;
+}
+
+bool EffectDrawer::_BuildPasses(SIZE outputSize) {
 	for (size_t i = 0; i < _passes.size(); ++i) {
-		EffectPassDesc& desc = _effectDesc.passes[i];
+		EffectPassDesc& desc = _passDescs[i];
 
 		// 为空时表示输出到 OUTPUT
 		if (desc.outputs.empty()) {
-			desc.outputs.push_back(UINT(_effectDesc.textures.size()));
+			desc.outputs.push_back(UINT(_effectDesc->textures.size()));
 		}
 
 		if (!_passes[i].Build(i < _passes.size() - 1 ? std::optional<SIZE>() : outputSize)
@@ -434,13 +586,81 @@ bool EffectDrawer::Build(ComPtr<ID3D11Texture2D> input, ComPtr<ID3D11Texture2D>
 		}
 	}
 
+	_CalcBindingRanges();
+	return true;
+}
+
+void EffectDrawer::_CalcBindingRanges() {
+	// 只绑定至少有一个 Pass 使用的采样器和常量缓冲区
+	UINT psSamplers = 0;
+	UINT csSamplers = 0;
+	UINT psConstantBuffers = 0;
+	UINT csConstantBuffers = 0;
+	for (const EffectPassDesc& desc : _passDescs) {
+		(desc.isCompute ? csSamplers : psSamplers) |= desc.usedSamplers;
+		(desc.isCompute ? csConstantBuffers : psConstantBuffers) |= desc.usedConstantBuffers;
+	}
+
+	GetSlotRanges(psSamplers, _samplers.size(), _psSamplerRanges);
+	GetSlotRanges(csSamplers, _samplers.size(), _csSamplerRanges);
+	// b0 为 __C，b1 为 __D
+	GetSlotRanges(psConstantBuffers, 2, _psConstantBufferRanges);
+	GetSlotRanges(csConstantBuffers, 2, _csConstantBufferRanges);
+}
+
+bool EffectDrawer::CanCopyConstants(const EffectDrawer& other) const {
+	if (!IsSameEffect(other)) {
+		return false;
+	}
+
+	// 跳过的 Pass 改变时需要重新创建中间纹理
+	for (const EffectPassDesc& desc : _passDescs) {
+		if (_IsPassSkipped(desc) != other._IsPassSkipped(desc)) {
+			return false;
+		}
+	}
+
 	return true;
 }
 
+void EffectDrawer::CopyConstants(const EffectDrawer& other) {
+	assert(IsSameEffect(other));
+
+	// 之后的 valueConstants 由 Build 计算，保留原来的值
+	std::copy_n(other._constants.begin(), _effectDesc->constants.size(), _constants.begin());
+
+	if (_constantBuffer) {
+		_d3dDC->UpdateSubresource(_constantBuffer.Get(), 0, nullptr, _constants.data(), 0, 0);
+	}
+}
+
+void EffectDrawer::ReleaseViews() {
+	Renderer& renderer = App::GetInstance().GetRenderer();
+
+	// 输入和输出不属于此效果，从文件加载的纹理由 ResourcePool 管理
+	for (size_t i = 1; i < _effectDesc->textures.size() && i < _textures.size(); ++i) {
+		if (_effectDesc->textures[i].source.empty() && _textures[i]) {
+			renderer.ReleaseViews(_textures[i].Get());
+		}
+	}
+
+	for (_Pass& pass : _passes) {
+		pass.ReleaseViews();
+	}
+}
+
 void EffectDrawer::Draw(bool noUpdate) {
+	UpdateDynamicConstants();
+	DrawPasses(noUpdate);
+}
+
+void EffectDrawer::UpdateDynamicConstants() {
 	if (_dynamicConstantBuffer) {
+		// 表达式变量属于当前线程，其中的尺寸可能来自其他效果
+		SetExprVars(_exprInputSize, _exprOutputSize);
+
 		// 更新常量
-		if (!EvalConstants(_effectDesc.dynamicValueConstants, _dynamicConstants)) {
+		if (!EvalConstants(_effectDesc->dynamicValueConstants, _dynamicConstants)) {
 			SPDLOG_LOGGER_ERROR(logger, "计算动态常量失败");
 		}
 
@@ -453,15 +673,24 @@ void EffectDrawer::Draw(bool noUpdate) {
 			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("Map 失败", hr));
 		}
 	}
+}
+
+void EffectDrawer::DrawPasses(bool noUpdate) {
+	StateTrackingContext& stateContext = App::GetInstance().GetRenderer().GetStateContext();
 
 	ID3D11Buffer* t[2] = { _constantBuffer.Get(), _dynamicConstantBuffer.Get()};
-	if (t[0]) {
-		_d3dDC->PSSetConstantBuffers(0, t[1] ? 2 : 1, t);
-	} else {
-		_d3dDC->PSSetConstantBuffers(0, 0, nullptr);
+	for (auto [start, count] : _psConstantBufferRanges) {
+		stateContext.PSSetConstantBuffers(start, count, t + start);
+	}
+	for (auto [start, count] : _psSamplerRanges) {
+		stateContext.PSSetSamplers(start, count, _samplers.data() + start);
+	}
+	for (auto [start, count] : _csConstantBufferRanges) {
+		stateContext.CSSetConstantBuffers(start, count, t + start);
+	}
+	for (auto [start, count] : _csSamplerRanges) {
+		stateContext.CSSetSamplers(start, count, _samplers.data() + start);
 	}
-
-	_d3dDC->PSSetSamplers(0, (UINT)_samplers.size(), _samplers.data());
 
 	if (noUpdate) {
 		// 此帧内容无变化，只渲染最后一个 pass
@@ -473,7 +702,349 @@ void EffectDrawer::Draw(bool noUpdate) {
 	}
 }
 
-// 所有 Effect 共享 exprParser，每帧渲染前由 Renderer 调用一次
+bool EffectDrawer::Specialize(SIZE inputSize) {
+	SIZE outputSize;
+	if (!CalcOutputSize(inputSize, outputSize)) {
+		SPDLOG_LOGGER_ERROR(logger, "CalcOutputSize 失败");
+		return false;
+	}
+
+	// 表达式变量属于当前线程，和 Build 时的计算方式相同
+	SetExprVars(inputSize, outputSize);
+	SetExprDynamicVars(0, 0, 0);
+
+	if (!EvalConstants(_effectDesc->valueConstants, _constants, _effectDesc->constants.size())) {
+		SPDLOG_LOGGER_ERROR(logger, "计算常量失败");
+		return false;
+	}
+
+	const size_t count = _effectDesc->constants.size() + _effectDesc->valueConstants.size();
+	std::vector<Constant32> values(_constants.begin(), _constants.begin() + count);
+
+	if (count == 0) {
+		// 没有常量时和通用的着色器相同
+		_specializedValues = std::move(values);
+		return true;
+	}
+
+	std::shared_ptr<const EffectDesc> desc;
+	bool result = false;
+	int duration = Utils::Measure([&]() {
+		result = !EffectCompiler::Compile(_fileName.c_str(), desc, 0, &values);
+	});
+
+	if (!result) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("编译特化的 {} 失败", StrUtils::UTF16ToUTF8(_fileName)));
+		return false;
+	} else {
+		SPDLOG_LOGGER_INFO(logger, fmt::format("编译特化的 {} 用时 {} 毫秒", StrUtils::UTF16ToUTF8(_fileName), duration / 1000.0f));
+	}
+
+	_passDescs = desc->passes;
+
+	// 通用的着色器的半精度变体不再使用
+	_halfPrecisionDesc.reset();
+	_halfPrecisionCacheKey.clear();
+	if (App::GetInstance().IsHalfPrecisionEffects() && _effectDesc->halfPrecision) {
+		_CompileHalfPrecision(&values);
+	}
+
+	for (size_t i = 0; i < _passes.size(); ++i) {
+		if (!_passes[i].Initialize(this, i)) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("Pass{} 初始化失败", i + 1));
+			return false;
+		}
+	}
+
+	_specializedValues = std::move(values);
+	return true;
+}
+
+bool EffectDrawer::_UseGenericPasses() {
+	_specializedValues.reset();
+	// 只是暂时使用，不再验证半精度变体
+	_halfPrecisionDesc.reset();
+	_halfPrecisionCacheKey.clear();
+	_passDescs = _effectDesc->passes;
+
+	for (size_t i = 0; i < _passes.size(); ++i) {
+		if (!_passes[i].Initialize(this, i)) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("Pass{} 初始化失败", i + 1));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void EffectDrawer::_CompileHalfPrecision(const std::vector<Constant32>* specializedConstants) {
+	std::shared_ptr<const EffectDesc> desc;
+	std::string cacheKey;
+	bool result = false;
+	int duration = Utils::Measure([&]() {
+		result = !EffectCompiler::Compile(_fileName.c_str(), desc,
+			EffectCompiler::COMPILE_FLAG_HALF_PRECISION | EffectCompiler::COMPILE_FLAG_DEFER_SAVE,
+			specializedConstants, &cacheKey);
+	});
+
+	if (!result || desc->passes.size() != _passDescs.size()) {
+		// 例如使用了不支持 min16float 的内建函数
+		SPDLOG_LOGGER_WARN(logger, fmt::format("编译半精度的 {} 失败，将使用全精度", StrUtils::UTF16ToUTF8(_fileName)));
+		return;
+	}
+
+	SPDLOG_LOGGER_INFO(logger, fmt::format("编译半精度的 {} 用时 {} 毫秒", StrUtils::UTF16ToUTF8(_fileName), duration / 1000.0f));
+
+	if (cacheKey.empty() && !App::GetInstance().IsDisableEffectCache()) {
+		// 只有通过验证的变体才会被缓存
+		_passDescs = desc->passes;
+		SPDLOG_LOGGER_INFO(logger, "使用缓存中的半精度变体");
+	} else {
+		_halfPrecisionDesc = std::move(desc);
+		_halfPrecisionCacheKey = std::move(cacheKey);
+	}
+}
+
+void GenerateReferenceImage(UINT index, UINT width, UINT height, std::vector<BYTE>& data) {
+	data.resize(size_t(width) * height * 4);
+
+	UINT seed = 0x9E3779B9;
+	for (UINT y = 0; y < height; ++y) {
+		for (UINT x = 0; x < width; ++x) {
+			BYTE* pixel = &data[(size_t(y) * width + x) * 4];
+
+			if (index == 0) {
+				pixel[0] = BYTE(x * 255 / std::max(width - 1, 1u));
+				pixel[1] = BYTE(y * 255 / std::max(height - 1, 1u));
+				pixel[2] = BYTE((x + y) * 255 / std::max(width + height - 2, 1u));
+			} else if (index == 1) {
+				float r2 = float(x) * x + float(y) * y;
+				pixel[0] = BYTE(127.5f + 127.5f * std::sinf(r2 * 0.002f));
+				pixel[1] = BYTE(127.5f + 127.5f * std::sinf(r2 * 0.003f + 1));
+				pixel[2] = ((x / 2 + y / 2) % 2) ? 255 : 0;
+			} else {
+				for (int i = 0; i < 3; ++i) {
+					seed = seed * 1664525 + 1013904223;
+					pixel[i] = BYTE(seed >> 24);
+				}
+			}
+
+			pixel[3] = 255;
+		}
+	}
+}
+
+double CalcPSNR(const std::vector<BYTE>& a, const std::vector<BYTE>& b) {
+	assert(a.size() == b.size());
+
+	double sum = 0;
+	size_t count = 0;
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (i % 4 == 3) {
+			continue;
+		}
+
+		double diff = double(a[i]) - double(b[i]);
+		sum += diff * diff;
+		++count;
+	}
+
+	const double mse = sum / std::max<size_t>(count, 1);
+	return mse == 0 ? std::numeric_limits<double>::infinity() : 10 * std::log10(255.0 * 255.0 / mse);
+}
+
+bool EffectDrawer::ValidateHalfPrecision(SIZE inputSize) {
+	if (!_halfPrecisionDesc) {
+		return true;
+	}
+
+	Renderer& renderer = App::GetInstance().GetRenderer();
+
+	std::shared_ptr<const EffectDesc> halfDesc = std::move(_halfPrecisionDesc);
+	std::string cacheKey = std::move(_halfPrecisionCacheKey);
+
+	SIZE outputSize;
+	if (!CalcOutputSize(inputSize, outputSize)) {
+		SPDLOG_LOGGER_ERROR(logger, "CalcOutputSize 失败");
+		return false;
+	}
+
+	std::vector<EffectPassDesc> fullPasses = _passDescs;
+	std::vector<EffectPassDesc> halfPasses = halfDesc->passes;
+	// 和 Build 中相同，为空时输出到 OUTPUT
+	if (halfPasses.back().outputs.empty()) {
+		halfPasses.back().outputs.push_back(UINT(_effectDesc->textures.size()));
+	}
+
+	// 参考图像和真正的输入尺寸相同，因此中间纹理可以在 Build 时复用
+	D3D11_TEXTURE2D_DESC desc{};
+	desc.Width = inputSize.cx;
+	desc.Height = inputSize.cy;
+	desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
+	ComPtr<ID3D11Texture2D> refInput;
+	HRESULT hr = _d3dDevice->CreateTexture2D(&desc, nullptr, &refInput);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
+		return false;
+	}
+
+	// 输出使用 8 位的格式，和最终显示的精度相同
+	desc.Width = outputSize.cx;
+	desc.Height = outputSize.cy;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET | D3D11_BIND_UNORDERED_ACCESS;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
+	ComPtr<ID3D11Texture2D> refOutput;
+	hr = _d3dDevice->CreateTexture2D(&desc, nullptr, &refOutput);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
+		return false;
+	}
+
+	// 效果可能在构建前被丢弃，不保留视图。中间纹理保留，Build 时尺寸相同可以复用
+	Utils::ScopeExit se([&]() {
+		ReleaseViews();
+		renderer.ReleaseViews(refInput.Get());
+		renderer.ReleaseViews(refOutput.Get());
+		if (!_textures.empty()) {
+			_textures.front() = nullptr;
+			_textures.back() = nullptr;
+		}
+	});
+
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	ComPtr<ID3D11Texture2D> staging;
+	hr = _d3dDevice->CreateTexture2D(&desc, nullptr, &staging);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
+		return false;
+	}
+
+	ID3D11RenderTargetView* refOutputRtv = nullptr;
+	if (!renderer.GetRenderTargetView(refOutput.Get(), &refOutputRtv)) {
+		SPDLOG_LOGGER_ERROR(logger, "获取 RenderTargetView 失败");
+		return false;
+	}
+
+	// 在参考纹理上构建以创建中间纹理和常量缓冲区
+	if (!Build(refInput, refOutput)) {
+		SPDLOG_LOGGER_ERROR(logger, "Build 失败");
+		return false;
+	}
+
+	const UINT inputWidth = inputSize.cx;
+	const UINT inputHeight = inputSize.cy;
+	const UINT outputWidth = desc.Width;
+	const UINT outputHeight = desc.Height;
+	std::vector<BYTE> refImage;
+
+	// 依次在每张参考图像上执行效果，结果按行拼接
+	auto render = [&](const std::vector<EffectPassDesc>& passes, std::vector<BYTE>& result) {
+		_passDescs = passes;
+		for (size_t i = 0; i < _passes.size(); ++i) {
+			if (!_passes[i].Initialize(this, i)) {
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("Pass{} 初始化失败", i + 1));
+				return false;
+			}
+		}
+		if (!_BuildPasses(outputSize)) {
+			SPDLOG_LOGGER_ERROR(logger, "_BuildPasses 失败");
+			return false;
+		}
+
+		result.clear();
+		result.reserve(size_t(outputWidth) * outputHeight * 4 * REFERENCE_IMAGE_COUNT);
+
+		for (UINT i = 0; i < REFERENCE_IMAGE_COUNT; ++i) {
+			GenerateReferenceImage(i, inputWidth, inputHeight, refImage);
+
+			// 在加载效果的线程上执行，和渲染线程以及其他会话共用立即上下文和状态记录
+			DeviceResources& deviceResources = renderer.GetDeviceResources();
+			deviceResources.LockContext();
+			Utils::ScopeExit se([&]() {
+				renderer.GetStateContext().ClearState();
+				deviceResources.UnlockContext();
+			});
+			renderer.GetStateContext().ClearState();
+
+			_d3dDC->UpdateSubresource(refInput.Get(), 0, nullptr, refImage.data(), inputWidth * 4, 0);
+
+			static constexpr FLOAT BLACK[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			_d3dDC->ClearRenderTargetView(refOutputRtv, BLACK);
+
+			Draw();
+
+			_d3dDC->CopyResource(staging.Get(), refOutput.Get());
+
+			D3D11_MAPPED_SUBRESOURCE ms;
+			hr = _d3dDC->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &ms);
+			if (FAILED(hr)) {
+				SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("Map 失败", hr));
+				return false;
+			}
+
+			for (UINT y = 0; y < outputHeight; ++y) {
+				const BYTE* row = (const BYTE*)ms.pData + size_t(y) * ms.RowPitch;
+				result.insert(result.end(), row, row + size_t(outputWidth) * 4);
+			}
+
+			_d3dDC->Unmap(staging.Get(), 0);
+		}
+
+		return true;
+	};
+
+	std::vector<BYTE> fullResult;
+	std::vector<BYTE> halfResult;
+	bool success = render(fullPasses, fullResult) && render(halfPasses, halfResult);
+
+	double psnr = 0;
+	if (success) {
+		psnr = CalcPSNR(fullResult, halfResult);
+		SPDLOG_LOGGER_INFO(logger, fmt::format("半精度变体的 PSNR：{:.2f} dB", psnr));
+	} else {
+		SPDLOG_LOGGER_ERROR(logger, "验证半精度变体失败");
+	}
+
+	const bool useHalf = success && psnr >= HALF_PRECISION_MIN_PSNR;
+	if (useHalf) {
+		SPDLOG_LOGGER_INFO(logger, "使用半精度变体");
+		if (!cacheKey.empty()) {
+			EffectCache::GetInstance().Save(_fileName.c_str(), cacheKey, halfDesc);
+		}
+	} else {
+		SPDLOG_LOGGER_INFO(logger, "半精度变体的误差过大，将使用全精度");
+	}
+
+	// 只把选择的 Pass 交给 Build，渲染线程上在真正的输入和输出上重新构建
+	_passDescs = useHalf ? std::move(halfPasses) : std::move(fullPasses);
+	for (size_t i = 0; i < _passes.size(); ++i) {
+		if (!_passes[i].Initialize(this, i)) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("Pass{} 初始化失败", i + 1));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// 渲染线程上的所有 Effect 共享表达式变量，每帧渲染前由 Renderer 调用一次
 bool EffectDrawer::UpdateExprDynamicVars() {
 	int frameCount = App::GetInstance().GetRenderer().GetTimer().GetFrameCount();
 
@@ -499,12 +1070,18 @@ bool EffectDrawer::_Pass::Initialize(EffectDrawer* parent, size_t index) {
 	_parent = parent;
 	_index = index;
 
-	const EffectPassDesc& passDesc = _parent->_effectDesc.passes[index];
-	HRESULT hr = renderer.GetD3DDevice()->CreatePixelShader(
-		passDesc.cso->GetBufferPointer(), passDesc.cso->GetBufferSize(), nullptr, &_pixelShader);
-	if (FAILED(hr)) {
-		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建像素着色器失败", hr));
-		return false;
+	// 着色器对象由所有会话共享
+	const EffectPassDesc& passDesc = _parent->_passDescs[index];
+	if (passDesc.isCompute) {
+		if (!renderer.GetDeviceResources().GetComputeShader(passDesc.cso.Get(), &_computeShader)) {
+			SPDLOG_LOGGER_ERROR(logger, "GetComputeShader 失败");
+			return false;
+		}
+	} else {
+		if (!renderer.GetDeviceResources().GetPixelShader(passDesc.cso.Get(), &_pixelShader)) {
+			SPDLOG_LOGGER_ERROR(logger, "GetPixelShader 失败");
+			return false;
+		}
 	}
 
 	return true;
@@ -512,17 +1089,49 @@ bool EffectDrawer::_Pass::Initialize(EffectDrawer* parent, size_t index) {
 
 bool EffectDrawer::_Pass::Build(std::optional<SIZE> outputSize) {
 	Renderer& renderer = App::GetInstance().GetRenderer();
-	const EffectPassDesc& passDesc = _parent->_effectDesc.passes[_index];
+	const EffectPassDesc& passDesc = _parent->_passDescs[_index];
+
+	_skipped = _parent->_IsPassSkipped(passDesc);
+	if (_skipped) {
+		// 输出的纹理没有创建
+		return true;
+	}
 
 	_inputs.resize(passDesc.inputs.size() * 2);
 	// 后半部分留空
 	for (size_t i = 0; i < passDesc.inputs.size(); ++i) {
-		if (!renderer.GetShaderResourceView(_parent->_textures[passDesc.inputs[i]].Get(), &_inputs[i])) {
+		ID3D11Texture2D* input = _parent->_textures[passDesc.inputs[i]].Get();
+		if (!input) {
+			// 被跳过的 Pass 的输出，绑定为空，读取的结果为 0
+			_inputs[i] = nullptr;
+			continue;
+		}
+
+		if (!renderer.GetShaderResourceView(input, &_inputs[i])) {
 			SPDLOG_LOGGER_ERROR(logger,"获取 ShaderResourceView 失败");
 			return false;
 		}
 	}
 
+	// 不绑定被编译器优化掉的输入
+	GetSlotRanges(passDesc.usedInputs, passDesc.inputs.size(), _inputRanges);
+
+	D3D11_TEXTURE2D_DESC desc;
+	_parent->_textures[passDesc.outputs[0]]->GetDesc(&desc);
+	SIZE outputTextureSize = { (LONG)desc.Width, (LONG)desc.Height };
+
+	if (passDesc.isCompute) {
+		if (!_BuildCompute(outputSize, outputTextureSize)) {
+			SPDLOG_LOGGER_ERROR(logger, "_BuildCompute 失败");
+			return false;
+		}
+
+		if (!_uavTexture) {
+			// 直接写入输出纹理，无需渲染
+			return true;
+		}
+	}
+
 	_outputs.resize(passDesc.outputs.size());
 	for (size_t i = 0; i < _outputs.size(); ++i) {
 		if (!App::GetInstance().GetRenderer().GetRenderTargetView(_parent->_textures[passDesc.outputs[i]].Get(), &_outputs[i])) {
@@ -531,16 +1140,13 @@ bool EffectDrawer::_Pass::Build(std::optional<SIZE> outputSize) {
 		}
 	}
 
-	D3D11_TEXTURE2D_DESC desc;
-	_parent->_textures[passDesc.outputs[0]]->GetDesc(&desc);
-	SIZE outputTextureSize = { (LONG)desc.Width, (LONG)desc.Height };
-
 	_vp.Width = (float)outputTextureSize.cx;
 	_vp.Height = (float)outputTextureSize.cy;
 	_vp.MinDepth = 0.0f;
 	_vp.MaxDepth = 1.0f;
 
-	// 创建顶点缓冲区
+	// 创建顶点缓冲区，重新构建时输出可能不再需要居中
+	_vtxBuffer = nullptr;
 	float outputLeft, outputTop, outputRight, outputBottom;
 	if (outputSize.has_value() && (outputTextureSize.cx != outputSize->cx || outputTextureSize.cy != outputSize->cy)) {
 		outputLeft = std::floorf(((float)outputTextureSize.cx - outputSize->cx) / 2) * 2 / outputTextureSize.cx - 1;
@@ -571,24 +1177,170 @@ bool EffectDrawer::_Pass::Build(std::optional<SIZE> outputSize) {
 	return true;
 }
 
+bool EffectDrawer::_Pass::_BuildCompute(std::optional<SIZE> outputSize, SIZE outputTextureSize) {
+	Renderer& renderer = App::GetInstance().GetRenderer();
+	const EffectPassDesc& passDesc = _parent->_passDescs[_index];
+
+	// 重新构建时释放之前创建的纹理
+	if (_uavTexture) {
+		renderer.ReleaseViews(_uavTexture.Get());
+		_uavTexture = nullptr;
+		_uavTextureSrv = nullptr;
+	}
+
+	// 最后一个 Pass 只写入 outputSize 大小的区域
+	SIZE dispatchSize = outputSize.value_or(outputTextureSize);
+
+	D3D11_TEXTURE2D_DESC desc;
+	_parent->_textures[passDesc.outputs[0]]->GetDesc(&desc);
+
+	// UAV 不能指定偏移，因此输出需要居中时也要先写入中间纹理
+	if (!(desc.BindFlags & D3D11_BIND_UNORDERED_ACCESS)
+		|| dispatchSize.cx != outputTextureSize.cx || dispatchSize.cy != outputTextureSize.cy
+	) {
+		// 只有 Effect 的输出纹理可能无法作为 UAV，此时只有一个输出
+		assert(passDesc.outputs.size() == 1);
+
+		// B8G8R8A8_UNORM 等格式不一定支持作为 UAV，回退到 R8G8B8A8_UNORM
+		UINT formatSupport = 0;
+		HRESULT hr = _parent->_d3dDevice->CheckFormatSupport(desc.Format, &formatSupport);
+		if (FAILED(hr) || !(formatSupport & D3D11_FORMAT_SUPPORT_TYPED_UNORDERED_ACCESS_VIEW)) {
+			desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+
+		desc.Width = dispatchSize.cx;
+		desc.Height = dispatchSize.cy;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.MipLevels = 1;
+		desc.ArraySize = 1;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+		hr = _parent->_d3dDevice->CreateTexture2D(&desc, nullptr, &_uavTexture);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
+			return false;
+		}
+
+		if (!renderer.GetShaderResourceView(_uavTexture.Get(), &_uavTextureSrv)) {
+			SPDLOG_LOGGER_ERROR(logger, "获取 ShaderResourceView 失败");
+			return false;
+		}
+
+		if (!renderer.GetSampler(EffectSamplerFilterType::Point, EffectSamplerAddressType::Clamp, &_copySampler)) {
+			SPDLOG_LOGGER_ERROR(logger, "GetSampler 失败");
+			return false;
+		}
+	}
+
+	_uavs.resize(passDesc.outputs.size() * 2);
+	// 后半部分留空
+	for (size_t i = 0; i < passDesc.outputs.size(); ++i) {
+		ID3D11Texture2D* texture = _uavTexture ? _uavTexture.Get() : _parent->_textures[passDesc.outputs[i]].Get();
+		if (!renderer.GetUnorderedAccessView(texture, &_uavs[i])) {
+			SPDLOG_LOGGER_ERROR(logger, "获取 UnorderedAccessView 失败");
+			return false;
+		}
+	}
+
+	_dispatchX = (dispatchSize.cx + passDesc.blockSize.first - 1) / passDesc.blockSize.first;
+	_dispatchY = (dispatchSize.cy + passDesc.blockSize.second - 1) / passDesc.blockSize.second;
+
+	return true;
+}
+
+void EffectDrawer::_Pass::ReleaseViews() {
+	if (_uavTexture) {
+		App::GetInstance().GetRenderer().ReleaseViews(_uavTexture.Get());
+	}
+}
+
+void EffectDrawer::_Pass::SetInput(ID3D11ShaderResourceView* input) {
+	if (_skipped) {
+		return;
+	}
+
+	const EffectPassDesc& passDesc = _parent->_passDescs[_index];
+	for (size_t i = 0; i < passDesc.inputs.size(); ++i) {
+		// 0 为 INPUT
+		if (passDesc.inputs[i] == 0) {
+			_inputs[i] = input;
+		}
+	}
+}
+
 void EffectDrawer::_Pass::Draw() {
-	ComPtr<ID3D11DeviceContext> d3dDC = _parent->_d3dDC;
+	if (_skipped) {
+		return;
+	}
 
-	d3dDC->OMSetRenderTargets((UINT)_outputs.size(), _outputs.data(), nullptr);
-	d3dDC->RSSetViewports(1, &_vp);
+	if (_computeShader) {
+		_DrawCompute();
 
-	d3dDC->PSSetShader(_pixelShader.Get(), nullptr, 0);
+		if (!_uavTexture) {
+			return;
+		}
+	}
 
-	UINT nInputs = (UINT)(_inputs.size() / 2);
-	d3dDC->PSSetShaderResources(0, nInputs, _inputs.data());
+	Renderer& renderer = App::GetInstance().GetRenderer();
+	StateTrackingContext& stateContext = renderer.GetStateContext();
+
+	stateContext.OMSetRenderTargets((UINT)_outputs.size(), _outputs.data());
+	stateContext.RSSetViewport(_vp);
+
+	UINT nInputs = 0;
+	if (_computeShader) {
+		// 将计算着色器的输出复制到输出纹理
+		renderer.SetCopyPS(_copySampler, _uavTextureSrv);
+	} else {
+		stateContext.PSSetShader(_pixelShader.Get());
+
+		nInputs = (UINT)(_inputs.size() / 2);
+		for (auto [start, count] : _inputRanges) {
+			stateContext.PSSetShaderResources(start, count, _inputs.data() + start);
+		}
+	}
 
 	if (_vtxBuffer) {
-		App::GetInstance().GetRenderer().SetSimpleVS(_vtxBuffer.Get());
-		d3dDC->Draw(4, 0);
+		renderer.SetSimpleVS(_vtxBuffer.Get());
+		stateContext.Draw(4, 0);
+	} else {
+		renderer.SetFillVS();
+		stateContext.Draw(3, 0);
+	}
+
+	// 解绑输入，否则之后无法作为输出
+	if (_computeShader) {
+		ID3D11ShaderResourceView* srv = nullptr;
+		stateContext.PSSetShaderResources(0, 1, &srv);
 	} else {
-		App::GetInstance().GetRenderer().SetFillVS();
-		d3dDC->Draw(3, 0);
+		for (auto [start, count] : _inputRanges) {
+			stateContext.PSSetShaderResources(start, count, _inputs.data() + nInputs + start);
+		}
+	}
+}
+
+void EffectDrawer::_Pass::_DrawCompute() {
+	StateTrackingContext& stateContext = App::GetInstance().GetRenderer().GetStateContext();
+
+	// 解绑上一个 Pass 的渲染目标，否则无法作为输入或 UAV
+	stateContext.OMSetRenderTargets(0, nullptr);
+
+	stateContext.CSSetShader(_computeShader.Get());
+
+	UINT nInputs = (UINT)(_inputs.size() / 2);
+	UINT nOutputs = (UINT)(_uavs.size() / 2);
+	for (auto [start, count] : _inputRanges) {
+		stateContext.CSSetShaderResources(start, count, _inputs.data() + start);
 	}
+	stateContext.CSSetUnorderedAccessViews(0, nOutputs, _uavs.data());
 
-	d3dDC->PSSetShaderResources(0, nInputs, _inputs.data() + nInputs);
+	stateContext.Dispatch(_dispatchX, _dispatchY, 1);
+
+	stateContext.CSSetUnorderedAccessViews(0, nOutputs, _uavs.data() + nOutputs);
+	for (auto [start, count] : _inputRanges) {
+		stateContext.CSSetShaderResources(start, count, _inputs.data() + nInputs + start);
+	}
 }
@@ -4,10 +4,23 @@
 #include <optional>
 
 
-union Constant32 {
-	int intVal;
-	float floatVal;
-};
+// MagpieFX 表达式的求值，变量属于当前线程
+void SetExprVars(SIZE inputSize, SIZE outputSize);
+
+void SetExprDynamicVars(int frameCount, double cursorX, double cursorY);
+
+bool EvalExpr(const std::string& expr, double& value);
+
+// 计算 descs 中的表达式，结果从 constants[base] 开始保存
+bool EvalConstants(const std::vector<EffectValueConstantDesc>& descs, std::vector<Constant32>& constants, size_t base = 0);
+
+// 验证半精度变体使用的参考图像，依次为平滑的渐变、高频的同心圆和伪随机噪声，格式为 B8G8R8A8
+constexpr UINT REFERENCE_IMAGE_COUNT = 3;
+
+void GenerateReferenceImage(UINT index, UINT width, UINT height, std::vector<BYTE>& data);
+
+// 两张相同尺寸的 8 位图像的 PSNR，只比较 RGB 通道，两者相同时返回无穷大
+double CalcPSNR(const std::vector<BYTE>& a, const std::vector<BYTE>& b);
 
 
 class EffectDrawer {
@@ -38,15 +51,55 @@ public:
 
 	void SetOutputSize(SIZE value);
 
+	// 特化常量时，常量的值和 Specialize 时相同才使用特化的着色器，否则使用通用的着色器
 	bool Build(ComPtr<ID3D11Texture2D> input, ComPtr<ID3D11Texture2D> output);
 
+	// 计算输入为 inputSize 时常量的值，将它们作为字面量编译特化的着色器
+	// 不使用设备上下文，在加载效果的线程上调用
+	bool Specialize(SIZE inputSize);
+
+	// 在参考图像上比较半精度变体和全精度的输出，PSNR 达到阈值时使用半精度变体并保存到缓存
+	// 没有等待验证的变体时什么也不做。在加载效果的线程上调用，之后的 Build 使用选择的 Pass
+	bool ValidateHalfPrecision(SIZE inputSize);
+
+	// 是否正在使用特化的着色器
+	bool IsSpecialized() const {
+		return _specializedValues.has_value();
+	}
+
+	// 更换输入纹理而不重新构建，新纹理的尺寸和格式必须和构建时相同
+	bool SetInput(ComPtr<ID3D11Texture2D> input);
+
+	// 更新动态常量并绘制
 	void Draw(bool noUpdate = false);
 
+	void UpdateDynamicConstants();
+
+	// 只设置状态并绘制，不更新动态常量，因此可以录制到命令列表中
+	void DrawPasses(bool noUpdate = false);
+
 	bool HasDynamicConstants() const {
 		return !_dynamicConstants.empty();
 	}
 
+	// 两者使用同一个效果时只有常量可能不同
+	bool IsSameEffect(const EffectDrawer& other) const {
+		return _effectDesc == other._effectDesc;
+	}
+
+	// 两者是同一个效果，且 CONDITION 指令跳过的 Pass 相同时才能只复制常量
+	bool CanCopyConstants(const EffectDrawer& other) const;
+
+	// 使用 other 的常量并更新常量缓冲区，两者必须是同一个效果
+	void CopyConstants(const EffectDrawer& other);
+
+	// 释放中间纹理的视图，用于即将销毁的效果
+	void ReleaseViews();
+
 	static bool UpdateExprDynamicVars();
+
+	// 在参考图像上生成的输出的 PSNR 低于此值时不使用半精度变体
+	static constexpr double HALF_PRECISION_MIN_PSNR = 40.0;
 private:
 	class _Pass {
 	public:
@@ -56,30 +109,76 @@ private:
 
 		void Draw();
 
+		// 将读取 INPUT 的槽替换为 input
+		void SetInput(ID3D11ShaderResourceView* input);
+
 		void SetParent(EffectDrawer* parent) {
 			_parent = parent;
 		}
+
+		void ReleaseViews();
 	private:
+		bool _BuildCompute(std::optional<SIZE> outputSize, SIZE outputTextureSize);
+
+		void _DrawCompute();
+
 		EffectDrawer* _parent = nullptr;
 		size_t _index = 0;
+		// CONDITION 指定的常量为 0，不构建也不绘制
+		bool _skipped = false;
 		
 		ComPtr<ID3D11PixelShader> _pixelShader;
+		ComPtr<ID3D11ComputeShader> _computeShader;
 
 		// 后半部分为空，用于解绑
 		std::vector<ID3D11ShaderResourceView*> _inputs;
 		std::vector<ID3D11RenderTargetView*> _outputs;
 		std::vector<ID3D11SamplerState*> _samplers;
+		// 着色器实际使用的输入，为 (起始槽, 数量) 的区间
+		std::vector<std::pair<UINT, UINT>> _inputRanges;
+
+		// 计算着色器 Pass 使用，后半部分为空，用于解绑
+		std::vector<ID3D11UnorderedAccessView*> _uavs;
+		UINT _dispatchX = 0;
+		UINT _dispatchY = 0;
+		// 输出纹理无法作为 UAV 或输出需要居中时，先写入此纹理再复制到输出
+		ComPtr<ID3D11Texture2D> _uavTexture;
+		ID3D11ShaderResourceView* _uavTextureSrv = nullptr;
+		ID3D11SamplerState* _copySampler = nullptr;
 
 		ComPtr<ID3D11Buffer> _vtxBuffer;
 		D3D11_VIEWPORT _vp{};
 	};
 
+	// 改为使用 Initialize 时编译的通用的着色器
+	bool _UseGenericPasses();
+
+	// 编译半精度的变体，缓存中已有的变体已通过验证，直接使用，否则等待 ValidateHalfPrecision 验证
+	// 失败时继续使用全精度
+	void _CompileHalfPrecision(const std::vector<Constant32>* specializedConstants);
+
+	bool _BuildPasses(SIZE outputSize);
+
+	bool _IsPassSkipped(const EffectPassDesc& desc) const {
+		return desc.condition >= 0 && _constants[desc.condition].intVal == 0;
+	}
+
+	void _CalcBindingRanges();
+
+	std::wstring _fileName;
+
 	ComPtr<ID3D11Device> _d3dDevice;
 	ComPtr<ID3D11DeviceContext> _d3dDC;
 
 	std::vector<ID3D11SamplerState*> _samplers;
 	std::vector<ComPtr<ID3D11Texture2D>> _textures;
 
+	// 所有 Pass 实际使用的采样器和常量缓冲区，为 (起始槽, 数量) 的区间
+	std::vector<std::pair<UINT, UINT>> _psSamplerRanges;
+	std::vector<std::pair<UINT, UINT>> _csSamplerRanges;
+	std::vector<std::pair<UINT, UINT>> _psConstantBufferRanges;
+	std::vector<std::pair<UINT, UINT>> _csConstantBufferRanges;
+
 	std::unordered_map<std::string_view, UINT> _constNamesMap;
 	std::vector<Constant32> _constants;
 	std::vector<Constant32> _dynamicConstants;
@@ -90,6 +189,20 @@ private:
 
 	std::optional<SIZE> _outputSize;
 
-	EffectDesc _effectDesc{};
+	// Build 时的输入和输出尺寸，渲染线程计算动态常量前重新设置到表达式变量中
+	SIZE _exprInputSize{};
+	SIZE _exprOutputSize{};
+
+	// 来自缓存时和其他实例共享
+	std::shared_ptr<const EffectDesc> _effectDesc;
+	// 当前使用的 Pass，可能是全精度或半精度的变体
+	std::vector<EffectPassDesc> _passDescs;
 	std::vector<_Pass> _passes;
+
+	// 特化的着色器中 constants 和 valueConstants 的值，使用通用的着色器时为空
+	std::optional<std::vector<Constant32>> _specializedValues;
+
+	// 等待验证的半精度变体和保存到缓存时使用的键
+	std::shared_ptr<const EffectDesc> _halfPrecisionDesc;
+	std::string _halfPrecisionCacheKey;
 };
@@ -6,21 +6,16 @@
 
 bool FrameRateDrawer::Initialize(ComPtr<ID3D11Texture2D> renderTarget, const RECT& destRect) {
 	Renderer& renderer = App::GetInstance().GetRenderer();
-	_d3dDC = renderer.GetD3DDC();
 	if (!renderer.GetRenderTargetView(renderTarget.Get(), &_rtv)) {
 		return false;
 	}
 
-	_vp.MaxDepth = 1.0f;
-	_vp.TopLeftX = (FLOAT)destRect.left;
-	_vp.TopLeftY = (FLOAT)destRect.top;
-	_vp.Width = FLOAT(destRect.right - destRect.left);
-	_vp.Height = FLOAT(destRect.bottom - destRect.top);
+	SetDestRect(destRect);
 
 	_spriteBatch.reset(new SpriteBatch(renderer.GetD3DDC().Get()));
 
 	// 从资源文件获取字体
-	HMODULE hInst = App::GetInstance().GetHInstance();
+	HMODULE hInst = App::GetHInstance();
 	HRSRC hRsrc = FindResource(hInst, MAKEINTRESOURCE(IDR_FRAME_RATE_FONT), RT_RCDATA);
 	if (!hRsrc) {
 		return false;
@@ -35,16 +30,27 @@ bool FrameRateDrawer::Initialize(ComPtr<ID3D11Texture2D> renderTarget, const REC
 	return true;
 }
 
-void FrameRateDrawer::Draw() {
-	const StepTimer& timer = App::GetInstance().GetRenderer().GetTimer();
+void FrameRateDrawer::SetDestRect(const RECT& destRect) {
+	_vp.MaxDepth = 1.0f;
+	_vp.TopLeftX = (FLOAT)destRect.left;
+	_vp.TopLeftY = (FLOAT)destRect.top;
+	_vp.Width = FLOAT(destRect.right - destRect.left);
+	_vp.Height = FLOAT(destRect.bottom - destRect.top);
+}
 
-	_d3dDC->OMSetRenderTargets(1, &_rtv, nullptr);
-	_d3dDC->RSSetViewports(1, &_vp);
+std::string FrameRateDrawer::GetText() const {
+	return fmt::format("{} FPS", App::GetInstance().GetRenderer().GetTimer().GetFramesPerSecond());
+}
+
+void FrameRateDrawer::Draw() {
+	StateTrackingContext& stateContext = App::GetInstance().GetRenderer().GetStateContext();
+	stateContext.OMSetRenderTargets(1, &_rtv);
+	stateContext.RSSetViewport(_vp);
 
 	_spriteBatch->Begin(SpriteSortMode::SpriteSortMode_Immediate);
 
 	constexpr float posX = 10.0f, posY = 10.0f;
-	std::string fpsStr = fmt::format("{} FPS", timer.GetFramesPerSecond());
+	std::string fpsStr = GetText();
 
 	// 右下角浓阴影，左上角淡阴影
 	_spriteFont->DrawString(_spriteBatch.get(), fpsStr.c_str(),
@@ -55,4 +61,7 @@ void FrameRateDrawer::Draw() {
 		XMFLOAT2(posX, posY), Colors::White);
 
 	_spriteBatch->End();
+
+	// SpriteBatch 直接修改了设备上下文的状态
+	stateContext.ClearState();
 }
@@ -8,10 +8,14 @@ class FrameRateDrawer {
 public:
 	bool Initialize(ComPtr<ID3D11Texture2D> renderTarget, const RECT& destRect);
 
+	void SetDestRect(const RECT& destRect);
+
 	void Draw();
 
+	// 将要绘制的文字
+	std::string GetText() const;
+
 private:
-	ComPtr<ID3D11DeviceContext> _d3dDC;
 	D3D11_VIEWPORT _vp{};
 
 	ID3D11RenderTargetView* _rtv = nullptr;
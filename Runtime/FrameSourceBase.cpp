@@ -7,6 +7,8 @@
 extern std::shared_ptr<spdlog::logger> logger;
 
 
+FrameSourceBase::FrameSourceBase() : _app(App::GetCurrent()) {}
+
 bool FrameSourceBase::_GetMapToOriginDPI(HWND hWnd, double& a, double& bx, double& by) {
 	// HDC 中的 HBITMAP 尺寸为窗口的原始尺寸
 	// 通过 GetWindowRect 获得的尺寸为窗口的 DPI 缩放后尺寸
@@ -2,9 +2,11 @@
 #include "pch.h"
 
 
+class App;
+
 class FrameSourceBase {
 public:
-	FrameSourceBase() {}
+	FrameSourceBase();
 
 	virtual ~FrameSourceBase() {}
 
@@ -14,8 +16,25 @@ public:
 
 	virtual bool Initialize() = 0;
 
+	// 所有输出纹理的尺寸和格式都相同，此纹理可用于查询它们的描述
 	virtual ComPtr<ID3D11Texture2D> GetOutput() = 0;
 
+	// 帧源可以轮流写入多个输出纹理，渲染器直接将当前帧所在的纹理作为效果的输入，无需再复制一次
+	// 这些纹理必须可以作为着色器资源，且在成为当前帧后直到下一个新帧前保持不变
+	virtual UINT GetOutputCount() {
+		return 1;
+	}
+
+	virtual ComPtr<ID3D11Texture2D> GetOutputAt(UINT index) {
+		assert(index == 0);
+		return GetOutput();
+	}
+
+	// 当前帧所在的输出纹理，Update 返回 NewFrame 后可能改变
+	virtual UINT GetOutputIndex() {
+		return 0;
+	}
+
 	enum class UpdateState {
 		NewFrame,
 		NoUpdate,
@@ -29,7 +48,14 @@ public:
 
 	virtual bool IsScreenCapture() = 0;
 
+	// 新帧到达时是否会调用 Renderer::Wake。不会唤醒的帧源在渲染线程空闲时需要轮询
+	virtual bool IsFrameArrivalSignaled() {
+		return false;
+	}
+
 protected:
+	// 创建帧源的会话，帧源自己的线程和捕获回调需要先绑定到该会话
+	App* _app = nullptr;
 
 	// 获取坐标系 1 到坐标系 2 的映射关系
 	// 坐标系 1：屏幕坐标系，即虚拟化后的坐标系。原点为屏幕左上角
@@ -14,6 +14,7 @@ public:
 		return _output;
 	}
 
+	// 无法得知源窗口的内容是否改变，每次都返回 NewFrame，因此渲染线程不会进入空闲状态
 	UpdateState Update() override;
 
 	bool HasRoundCornerInWin11() override {
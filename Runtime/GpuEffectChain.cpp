@@ -0,0 +1,836 @@
+#include "pch.h"
+#include "GpuEffectChain.h"
+#include "EffectCompiler.h"
+#include "EffectDrawer.h"
+#include "Utils.h"
+#include "StrUtils.h"
+#include "DDSReader.h"
+#include <rapidjson/document.h>
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+
+bool GpuEffectChain::Initialize(const std::string& effectsJson, UINT adapterIdx, bool halfPrecision) {
+	_deviceResources = DeviceResources::Get(adapterIdx);
+	if (!_deviceResources) {
+		SPDLOG_LOGGER_ERROR(logger, "获取 DeviceResources 失败");
+		return false;
+	}
+
+	// 效果按功能级别 11.0 编译
+	if (_deviceResources->GetFeatureLevel() < D3D_FEATURE_LEVEL_11_0) {
+		SPDLOG_LOGGER_ERROR(logger, "离线处理需要功能级别 11.0");
+		return false;
+	}
+
+	rapidjson::Document doc;
+	if (doc.Parse(effectsJson.c_str(), effectsJson.size()).HasParseError()) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 json 失败\n\t错误码：{}", doc.GetParseError()));
+		return false;
+	}
+
+	if (!doc.IsArray() || doc.GetArray().Empty()) {
+		SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：根元素不为数组或为空");
+		return false;
+	}
+
+	for (const auto& effectJson : doc.GetArray()) {
+		if (!effectJson.IsObject()) {
+			SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：根数组中存在非法成员");
+			return false;
+		}
+
+		auto effectName = effectJson.FindMember("effect");
+		if (effectName == effectJson.MemberEnd() || !effectName->value.IsString()) {
+			SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：未找到 effect 属性或该属性的值不合法");
+			return false;
+		}
+
+		_Effect& effect = _effects.emplace_back();
+		effect.name = effectName->value.GetString();
+
+		std::string source;
+		if (!Utils::ReadTextFile((L"effects\\" + StrUtils::UTF8ToUTF16(effect.name) + L".hlsl").c_str(), source)) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("读取 {} 失败", effect.name));
+			return false;
+		}
+
+		// 没有会话，不读写缓存
+		if (EffectCompiler::CompileSource(std::move(source), effect.desc,
+			halfPrecision ? EffectCompiler::COMPILE_FLAG_HALF_PRECISION : 0)
+		) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("编译 {} 失败", effect.name));
+			return false;
+		}
+
+		const EffectDesc& desc = *effect.desc;
+
+		effect.sourceTextures.resize(desc.textures.size());
+		for (size_t i = 1; i < desc.textures.size(); ++i) {
+			const std::string& source = desc.textures[i].source;
+			if (!source.empty() && !_LoadSourceTexture(source, effect.sourceTextures[i])) {
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("加载纹理 {} 失败", source));
+				return false;
+			}
+		}
+
+		effect.samplers.resize(desc.samplers.size());
+		for (size_t i = 0; i < desc.samplers.size(); ++i) {
+			if (!_deviceResources->GetSampler(desc.samplers[i].filterType, desc.samplers[i].addressType, &effect.samplers[i])) {
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("创建采样器 {} 失败", desc.samplers[i].name));
+				return false;
+			}
+		}
+
+		effect.pixelShaders.resize(desc.passes.size());
+		effect.computeShaders.resize(desc.passes.size());
+		for (size_t i = 0; i < desc.passes.size(); ++i) {
+			const EffectPassDesc& passDesc = desc.passes[i];
+			if (passDesc.isCompute) {
+				if (!_deviceResources->GetComputeShader(passDesc.cso.Get(), &effect.computeShaders[i])) {
+					SPDLOG_LOGGER_ERROR(logger, "GetComputeShader 失败");
+					return false;
+				}
+			} else {
+				if (!_deviceResources->GetPixelShader(passDesc.cso.Get(), &effect.pixelShaders[i])) {
+					SPDLOG_LOGGER_ERROR(logger, "GetPixelShader 失败");
+					return false;
+				}
+			}
+		}
+
+		// 大小必须为 4 的倍数
+		effect.constants.resize((desc.constants.size() + desc.valueConstants.size() + 3) / 4 * 4);
+		for (size_t i = 0; i < desc.constants.size(); ++i) {
+			const auto& c = desc.constants[i];
+			if (c.type == EffectConstantType::Float) {
+				effect.constants[i].floatVal = std::get<float>(c.defaultValue);
+			} else {
+				effect.constants[i].intVal = std::get<int>(c.defaultValue);
+			}
+		}
+
+		// 和 EffectDrawer::CanSetOutputSize 一致：未指定输出尺寸的效果可以使用 scale 属性
+		const bool canSetOutputSize = desc.outSizeExpr.first.empty();
+
+		for (const auto& prop : effectJson.GetObject()) {
+			std::string_view name = prop.name.GetString();
+
+			if (name == "effect") {
+				continue;
+			}
+
+			if (canSetOutputSize && name == "scale") {
+				if (!prop.value.IsArray()) {
+					SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：非法的 scale 属性");
+					return false;
+				}
+
+				const auto& scale = prop.value.GetArray();
+				if (scale.Size() != 2 || !scale[0].IsNumber() || !scale[1].IsNumber()) {
+					SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：非法的 scale 属性");
+					return false;
+				}
+
+				static float DELTA = 1e-5f;
+
+				effect.scaleX = scale[0].GetFloat();
+				effect.scaleY = scale[1].GetFloat();
+				if (effect.scaleX < DELTA || effect.scaleY < DELTA) {
+					SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：离线处理时 scale 属性只能为正数");
+					return false;
+				}
+
+				continue;
+			}
+
+			auto it = std::find_if(desc.constants.begin(), desc.constants.end(),
+				[&](const EffectConstantDesc& c) { return c.name == name; });
+			if (it == desc.constants.end()) {
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 json 失败：非法成员 {}", name));
+				return false;
+			}
+
+			// 和 EffectDrawer::SetConstant 一样检查取值范围
+			Constant32& value = effect.constants[it - desc.constants.begin()];
+			bool isValid = true;
+			if (it->type == EffectConstantType::Float) {
+				if (!prop.value.IsNumber()) {
+					SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 json 失败：成员 {} 的类型非法", name));
+					return false;
+				}
+
+				value.floatVal = prop.value.GetFloat();
+				if (it->minValue.index() == 1 && value.floatVal < std::get<float>(it->minValue)) {
+					isValid = false;
+				}
+				if (it->maxValue.index() == 1 && value.floatVal > std::get<float>(it->maxValue)) {
+					isValid = false;
+				}
+			} else {
+				if (prop.value.IsInt()) {
+					value.intVal = prop.value.GetInt();
+				} else if (prop.value.IsBool()) {
+					// bool 值视为 int
+					value.intVal = (int)prop.value.GetBool();
+				} else {
+					SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 json 失败：成员 {} 的类型非法", name));
+					return false;
+				}
+
+				if (it->minValue.index() == 2 && value.intVal < std::get<int>(it->minValue)) {
+					isValid = false;
+				}
+				if (it->maxValue.index() == 2 && value.intVal > std::get<int>(it->maxValue)) {
+					isValid = false;
+				}
+			}
+
+			if (!isValid) {
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("解析 json 失败：成员 {} 的值非法", name));
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool GpuEffectChain::_LoadSourceTexture(const std::string& source, ComPtr<ID3D11Texture2D>& result) const {
+	// TextureLoader 依赖会话的渲染器，这里只支持查找表使用的 DDS 文件
+	if (!StrUtils::ToLowerCase(source).ends_with(".dds")) {
+		SPDLOG_LOGGER_ERROR(logger, "离线处理只支持从 DDS 文件加载纹理");
+		return false;
+	}
+
+	CpuImage img;
+	if (!DDSReader::Load((L"effects\\" + StrUtils::UTF8ToUTF16(source)).c_str(), img)) {
+		return false;
+	}
+
+	// 保持读取到的精度
+	D3D11_TEXTURE2D_DESC desc{};
+	desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	desc.Width = img.GetWidth();
+	desc.Height = img.GetHeight();
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initData{};
+	initData.pSysMem = img.GetRow(0);
+	initData.SysMemPitch = img.GetPitch() * sizeof(XMFLOAT4);
+
+	HRESULT hr = _deviceResources->GetD3DDevice()->CreateTexture2D(&desc, &initData, &result);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
+		return false;
+	}
+
+	return true;
+}
+
+bool GpuEffectChain::_CalcEffectOutputSize(const _Effect& effect, SIZE inputSize, SIZE& outputSize) {
+	const EffectDesc& desc = *effect.desc;
+	if (desc.outSizeExpr.first.empty()) {
+		outputSize = effect.scaleX == 0 ? inputSize : SIZE{
+			std::lround(inputSize.cx * effect.scaleX),
+			std::lround(inputSize.cy * effect.scaleY)
+		};
+		return true;
+	}
+
+	SetExprVars(inputSize, {});
+
+	double width, height;
+	if (!EvalExpr(desc.outSizeExpr.first, width) || !EvalExpr(desc.outSizeExpr.second, height)) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("计算 {} 的输出尺寸失败", effect.name));
+		return false;
+	}
+
+	outputSize = { std::lround(width), std::lround(height) };
+	return true;
+}
+
+bool GpuEffectChain::CalcOutputSize(SIZE inputSize, SIZE& outputSize) const {
+	outputSize = inputSize;
+	for (const _Effect& effect : _effects) {
+		if (!_CalcEffectOutputSize(effect, outputSize, outputSize)) {
+			return false;
+		}
+
+		if (outputSize.cx <= 0 || outputSize.cy <= 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool GpuEffectChain::_GetEffectScale(const _Effect& effect, double& scaleX, double& scaleY) {
+	// 输出尺寸由表达式计算的效果在较大的输入上测量，舍入误差可以忽略
+	static constexpr LONG REFERENCE_SIZE = 4096;
+
+	SIZE outputSize;
+	if (!_CalcEffectOutputSize(effect, { REFERENCE_SIZE, REFERENCE_SIZE }, outputSize)) {
+		return false;
+	}
+
+	scaleX = (double)outputSize.cx / REFERENCE_SIZE;
+	scaleY = (double)outputSize.cy / REFERENCE_SIZE;
+	return scaleX > 0 && scaleY > 0;
+}
+
+bool GpuEffectChain::GetTilingInfo(UINT& halo, UINT& alignment) const {
+	std::vector<std::pair<double, double>> scales;
+	for (const _Effect& effect : _effects) {
+		if (effect.desc->halo < 0) {
+			SPDLOG_LOGGER_INFO(logger, fmt::format("{} 没有 HALO 指令，不支持分块处理", effect.name));
+			return false;
+		}
+
+		auto& [scaleX, scaleY] = scales.emplace_back();
+		if (!_GetEffectScale(effect, scaleX, scaleY)) {
+			return false;
+		}
+	}
+
+	// 找到最小的 n 使 n 乘以每一步的累积缩放比例都是整数
+	alignment = 0;
+	for (UINT n = 1; n <= MAX_TILE_ALIGNMENT && alignment == 0; ++n) {
+		bool isInteger = true;
+		double scaleX = 1;
+		double scaleY = 1;
+		for (const auto& scale : scales) {
+			scaleX *= scale.first;
+			scaleY *= scale.second;
+			if (std::abs(n * scaleX - std::round(n * scaleX)) > 1e-3
+				|| std::abs(n * scaleY - std::round(n * scaleY)) > 1e-3
+			) {
+				isInteger = false;
+				break;
+			}
+		}
+
+		if (isInteger) {
+			alignment = n;
+		}
+	}
+
+	if (alignment == 0) {
+		return false;
+	}
+
+	// 后面的效果在缩放后的图像上采样，折算到输入空间的半径不同
+	double radiusX = 0;
+	double radiusY = 0;
+	double scaleX = 1;
+	double scaleY = 1;
+	for (size_t i = 0; i < _effects.size(); ++i) {
+		radiusX += _effects[i].desc->halo / scaleX;
+		radiusY += _effects[i].desc->halo / scaleY;
+		scaleX *= scales[i].first;
+		scaleY *= scales[i].second;
+	}
+
+	halo = (UINT)std::ceil(std::max(radiusX, radiusY) - 1e-6);
+	halo = (halo + alignment - 1) / alignment * alignment;
+	return true;
+}
+
+bool GpuEffectChain::CalcMaxTextureSize(SIZE inputSize, SIZE& result) const {
+	result = inputSize;
+
+	SIZE curSize = inputSize;
+	for (const _Effect& effect : _effects) {
+		SIZE nextSize;
+		if (!_CalcEffectOutputSize(effect, curSize, nextSize)) {
+			return false;
+		}
+
+		result.cx = std::max(result.cx, nextSize.cx);
+		result.cy = std::max(result.cy, nextSize.cy);
+
+		// 中间纹理，不考虑被跳过的 Pass
+		SetExprVars(curSize, nextSize);
+		const std::vector<EffectIntermediateTextureDesc>& textures = effect.desc->textures;
+		for (size_t i = 1; i < textures.size(); ++i) {
+			if (!textures[i].source.empty()) {
+				continue;
+			}
+
+			double width, height;
+			if (!EvalExpr(textures[i].sizeExpr.first, width) || !EvalExpr(textures[i].sizeExpr.second, height)) {
+				SPDLOG_LOGGER_ERROR(logger, "计算中间纹理尺寸失败");
+				return false;
+			}
+
+			result.cx = std::max(result.cx, std::lround(width));
+			result.cy = std::max(result.cy, std::lround(height));
+		}
+
+		curSize = nextSize;
+	}
+
+	return true;
+}
+
+bool GpuEffectChain::CreateTilePlan(SIZE inputSize, UINT tileSize, size_t memoryBudget, CpuTiledProcessor::Plan& plan) const {
+	UINT halo, alignment;
+	if (!GetTilingInfo(halo, alignment)) {
+		SPDLOG_LOGGER_ERROR(logger, "效果链不支持分块处理");
+		return false;
+	}
+
+	SIZE outputSize, alignedOutputSize;
+	if (!CalcOutputSize(inputSize, outputSize)
+		|| !CalcOutputSize({ (LONG)alignment, (LONG)alignment }, alignedOutputSize)
+	) {
+		SPDLOG_LOGGER_ERROR(logger, "计算输出尺寸失败");
+		return false;
+	}
+
+	if (!CpuTiledProcessor::CreatePlan(inputSize, outputSize, alignedOutputSize, halo, alignment,
+		tileSize > 0 ? tileSize : CpuTiledProcessor::DEFAULT_TILE_SIZE, plan)
+	) {
+		return false;
+	}
+
+	if (tileSize > 0) {
+		return true;
+	}
+
+	auto fits = [&]() {
+		const LONG size = LONG(plan.tileSize + plan.halo * 2);
+		SIZE maxTextureSize;
+		if (!CalcMaxTextureSize({ size, size }, maxTextureSize)
+			|| (UINT)std::max(maxTextureSize.cx, maxTextureSize.cy) > MAX_TEXTURE_SIZE
+		) {
+			return false;
+		}
+
+		// 块的输入和输出在内存中的副本
+		const size_t outputWidth = size / plan.alignment * plan.alignedOutputSize.cx;
+		const size_t outputHeight = size / plan.alignment * plan.alignedOutputSize.cy;
+		const size_t tileMemory = (size_t(size) * size + outputWidth * outputHeight) * 4;
+		return CpuTiledProcessor::EstimateBufferMemoryUsage(plan) + tileMemory <= memoryBudget;
+	};
+
+	while (plan.tileSize > CpuTiledProcessor::MIN_TILE_SIZE && !fits()) {
+		CpuTiledProcessor::CreatePlan(inputSize, outputSize, alignedOutputSize, halo, alignment, plan.tileSize / 2, plan);
+	}
+
+	return true;
+}
+
+bool GpuEffectChain::Process(
+	const BYTE* input,
+	UINT width,
+	UINT height,
+	UINT pitch,
+	std::vector<BYTE>& output,
+	SIZE& outputSize
+) const {
+	ID3D11Device1* d3dDevice = _deviceResources->GetD3DDevice().Get();
+	ID3D11DeviceContext1* d3dDC = _deviceResources->GetD3DDC().Get();
+
+	D3D11_TEXTURE2D_DESC desc{};
+	desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	desc.Width = width;
+	desc.Height = height;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initData{};
+	initData.pSysMem = input;
+	initData.SysMemPitch = pitch;
+
+	ComPtr<ID3D11Texture2D> curTex;
+	HRESULT hr = d3dDevice->CreateTexture2D(&desc, &initData, &curTex);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
+		return false;
+	}
+
+	// 效果间的纹理使用 R8G8B8A8_UNORM，精度和 Renderer 使用的 B8G8R8A8_UNORM 相同，并且总是可以作为 UAV
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET | D3D11_BIND_UNORDERED_ACCESS;
+
+	// 和其他会话共用立即上下文，锁定后先清空状态
+	_deviceResources->LockContext();
+	Utils::ScopeExit se([&]() {
+		d3dDC->ClearState();
+		_deviceResources->UnlockContext();
+	});
+	d3dDC->ClearState();
+
+	SIZE curSize = { (LONG)width, (LONG)height };
+	for (const _Effect& effect : _effects) {
+		SIZE nextSize;
+		if (!_CalcEffectOutputSize(effect, curSize, nextSize)) {
+			return false;
+		}
+
+		if (nextSize.cx <= 0 || nextSize.cy <= 0
+			|| (UINT)nextSize.cx > MAX_TEXTURE_SIZE || (UINT)nextSize.cy > MAX_TEXTURE_SIZE
+		) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("{} 的输出尺寸 {}x{} 非法", effect.name, nextSize.cx, nextSize.cy));
+			return false;
+		}
+
+		desc.Width = nextSize.cx;
+		desc.Height = nextSize.cy;
+		ComPtr<ID3D11Texture2D> nextTex;
+		hr = d3dDevice->CreateTexture2D(&desc, nullptr, &nextTex);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
+			return false;
+		}
+
+		if (!_DrawEffect(effect, curTex.Get(), curSize, nextTex.Get(), nextSize)) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("执行 {} 失败", effect.name));
+			return false;
+		}
+
+		curTex = std::move(nextTex);
+		curSize = nextSize;
+	}
+
+	desc.Width = curSize.cx;
+	desc.Height = curSize.cy;
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	ComPtr<ID3D11Texture2D> staging;
+	hr = d3dDevice->CreateTexture2D(&desc, nullptr, &staging);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
+		return false;
+	}
+
+	d3dDC->CopyResource(staging.Get(), curTex.Get());
+
+	D3D11_MAPPED_SUBRESOURCE ms;
+	hr = d3dDC->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &ms);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("Map 失败", hr));
+		return false;
+	}
+
+	// 转换为 B8G8R8A8
+	outputSize = curSize;
+	output.resize(size_t(curSize.cx) * curSize.cy * 4);
+	for (LONG y = 0; y < curSize.cy; ++y) {
+		const BYTE* src = (const BYTE*)ms.pData + size_t(y) * ms.RowPitch;
+		BYTE* dst = output.data() + size_t(y) * curSize.cx * 4;
+		for (LONG x = 0; x < curSize.cx; ++x) {
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+			dst[3] = src[3];
+			src += 4;
+			dst += 4;
+		}
+	}
+
+	d3dDC->Unmap(staging.Get(), 0);
+	return true;
+}
+
+bool GpuEffectChain::_DrawEffect(
+	const _Effect& effect,
+	ID3D11Texture2D* input,
+	SIZE inputSize,
+	ID3D11Texture2D* output,
+	SIZE outputSize
+) const {
+	const EffectDesc& desc = *effect.desc;
+	ID3D11Device1* d3dDevice = _deviceResources->GetD3DDevice().Get();
+	ID3D11DeviceContext1* d3dDC = _deviceResources->GetD3DDC().Get();
+
+	SetExprVars(inputSize, outputSize);
+	SetExprDynamicVars(0, 0, 0);
+
+	std::vector<Constant32> constants = effect.constants;
+	std::vector<Constant32> dynamicConstants((desc.dynamicValueConstants.size() + 3) / 4 * 4);
+	if (!EvalConstants(desc.valueConstants, constants, desc.constants.size())
+		|| !EvalConstants(desc.dynamicValueConstants, dynamicConstants)
+	) {
+		SPDLOG_LOGGER_ERROR(logger, "计算常量失败");
+		return false;
+	}
+
+	// b0 为 __C，b1 为 __D
+	ComPtr<ID3D11Buffer> constantBuffers[2];
+	const std::vector<Constant32>* constantValues[2] = { &constants, &dynamicConstants };
+	for (int i = 0; i < 2; ++i) {
+		if (constantValues[i]->empty()) {
+			continue;
+		}
+
+		D3D11_BUFFER_DESC bd{};
+		bd.Usage = D3D11_USAGE_IMMUTABLE;
+		bd.ByteWidth = 4 * (UINT)constantValues[i]->size();
+		bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA initData{};
+		initData.pSysMem = constantValues[i]->data();
+
+		HRESULT hr = d3dDevice->CreateBuffer(&bd, &initData, &constantBuffers[i]);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateBuffer 失败", hr));
+			return false;
+		}
+	}
+
+	// 最后一项为 OUTPUT。和 EffectDrawer::Build 相同，只由跳过的 Pass 写入的中间纹理无需创建
+	const UINT outputIdx = (UINT)desc.textures.size();
+	std::vector<bool> isUavOutput(outputIdx + 1);
+	std::vector<bool> isRtvOutput(outputIdx + 1);
+	for (const EffectPassDesc& passDesc : desc.passes) {
+		if (_IsPassSkipped(effect, passDesc)) {
+			continue;
+		}
+
+		if (passDesc.outputs.empty()) {
+			(passDesc.isCompute ? isUavOutput : isRtvOutput)[outputIdx] = true;
+		}
+		for (UINT idx : passDesc.outputs) {
+			(passDesc.isCompute ? isUavOutput : isRtvOutput)[idx] = true;
+		}
+	}
+
+	std::vector<ComPtr<ID3D11Texture2D>> textures(outputIdx + 1);
+	textures[0] = input;
+	textures[outputIdx] = output;
+	for (UINT i = 1; i < outputIdx; ++i) {
+		if (effect.sourceTextures[i]) {
+			textures[i] = effect.sourceTextures[i];
+			continue;
+		}
+
+		if (!isUavOutput[i] && !isRtvOutput[i]) {
+			continue;
+		}
+
+		double width, height;
+		if (!EvalExpr(desc.textures[i].sizeExpr.first, width) || !EvalExpr(desc.textures[i].sizeExpr.second, height)) {
+			SPDLOG_LOGGER_ERROR(logger, "计算中间纹理尺寸失败");
+			return false;
+		}
+
+		D3D11_TEXTURE2D_DESC texDesc{};
+		texDesc.Format = EffectIntermediateTextureDesc::DXGI_FORMAT_MAP[(UINT)desc.textures[i].format];
+		texDesc.Width = (UINT)std::lround(width);
+		texDesc.Height = (UINT)std::lround(height);
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.MipLevels = 1;
+		texDesc.ArraySize = 1;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.SampleDesc.Quality = 0;
+		texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+		if (isUavOutput[i]) {
+			texDesc.BindFlags |= D3D11_BIND_UNORDERED_ACCESS;
+		}
+
+		if (texDesc.Width == 0 || texDesc.Height == 0 || texDesc.Width > MAX_TEXTURE_SIZE || texDesc.Height > MAX_TEXTURE_SIZE) {
+			SPDLOG_LOGGER_ERROR(logger, "非法的中间纹理尺寸");
+			return false;
+		}
+
+		HRESULT hr = d3dDevice->CreateTexture2D(&texDesc, nullptr, &textures[i]);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 Texture2D 失败", hr));
+			return false;
+		}
+	}
+
+	// 被跳过的 Pass 的输出没有创建，绑定为空，读取的结果为 0
+	std::vector<ComPtr<ID3D11ShaderResourceView>> srvs(outputIdx + 1);
+	std::vector<ComPtr<ID3D11RenderTargetView>> rtvs(outputIdx + 1);
+	std::vector<ComPtr<ID3D11UnorderedAccessView>> uavs(outputIdx + 1);
+	for (UINT i = 0; i <= outputIdx; ++i) {
+		if (!textures[i]) {
+			continue;
+		}
+
+		HRESULT hr = S_OK;
+		if (i < outputIdx) {
+			hr = d3dDevice->CreateShaderResourceView(textures[i].Get(), nullptr, &srvs[i]);
+		}
+		if (SUCCEEDED(hr) && isRtvOutput[i]) {
+			hr = d3dDevice->CreateRenderTargetView(textures[i].Get(), nullptr, &rtvs[i]);
+		}
+		if (SUCCEEDED(hr) && isUavOutput[i]) {
+			hr = d3dDevice->CreateUnorderedAccessView(textures[i].Get(), nullptr, &uavs[i]);
+		}
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建视图失败", hr));
+			return false;
+		}
+	}
+
+	ID3D11VertexShader* fillVS;
+	if (!_deviceResources->GetFillVS(&fillVS)) {
+		SPDLOG_LOGGER_ERROR(logger, "GetFillVS 失败");
+		return false;
+	}
+
+	d3dDC->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	d3dDC->IASetInputLayout(nullptr);
+	d3dDC->VSSetShader(fillVS, nullptr, 0);
+
+	ID3D11Buffer* cbs[2] = { constantBuffers[0].Get(), constantBuffers[1].Get() };
+	d3dDC->PSSetConstantBuffers(0, 2, cbs);
+	d3dDC->CSSetConstantBuffers(0, 2, cbs);
+	if (!effect.samplers.empty()) {
+		d3dDC->PSSetSamplers(0, (UINT)effect.samplers.size(), effect.samplers.data());
+		d3dDC->CSSetSamplers(0, (UINT)effect.samplers.size(), effect.samplers.data());
+	}
+
+	for (size_t i = 0; i < desc.passes.size(); ++i) {
+		const EffectPassDesc& passDesc = desc.passes[i];
+		if (_IsPassSkipped(effect, passDesc)) {
+			continue;
+		}
+
+		// 为空时表示输出到 OUTPUT
+		const std::vector<UINT> outputs = passDesc.outputs.empty() ? std::vector<UINT>{ outputIdx } : passDesc.outputs;
+
+		std::vector<ID3D11ShaderResourceView*> inputs(passDesc.inputs.size());
+		for (size_t j = 0; j < inputs.size(); ++j) {
+			inputs[j] = srvs[passDesc.inputs[j]].Get();
+		}
+		// 用于解绑
+		const std::vector<ID3D11ShaderResourceView*> nullInputs(inputs.size());
+
+		D3D11_TEXTURE2D_DESC outputDesc;
+		textures[outputs[0]]->GetDesc(&outputDesc);
+
+		if (passDesc.isCompute) {
+			std::vector<ID3D11UnorderedAccessView*> passUavs(outputs.size());
+			for (size_t j = 0; j < outputs.size(); ++j) {
+				passUavs[j] = uavs[outputs[j]].Get();
+			}
+			const std::vector<ID3D11UnorderedAccessView*> nullUavs(outputs.size());
+
+			d3dDC->CSSetShader(effect.computeShaders[i].Get(), nullptr, 0);
+			if (!inputs.empty()) {
+				d3dDC->CSSetShaderResources(0, (UINT)inputs.size(), inputs.data());
+			}
+			d3dDC->CSSetUnorderedAccessViews(0, (UINT)passUavs.size(), passUavs.data(), nullptr);
+
+			d3dDC->Dispatch(
+				(outputDesc.Width + passDesc.blockSize.first - 1) / passDesc.blockSize.first,
+				(outputDesc.Height + passDesc.blockSize.second - 1) / passDesc.blockSize.second,
+				1
+			);
+
+			d3dDC->CSSetUnorderedAccessViews(0, (UINT)nullUavs.size(), nullUavs.data(), nullptr);
+			if (!inputs.empty()) {
+				d3dDC->CSSetShaderResources(0, (UINT)nullInputs.size(), nullInputs.data());
+			}
+		} else {
+			std::vector<ID3D11RenderTargetView*> passRtvs(outputs.size());
+			for (size_t j = 0; j < outputs.size(); ++j) {
+				passRtvs[j] = rtvs[outputs[j]].Get();
+			}
+
+			D3D11_VIEWPORT vp{};
+			vp.Width = (float)outputDesc.Width;
+			vp.Height = (float)outputDesc.Height;
+			vp.MaxDepth = 1.0f;
+
+			d3dDC->OMSetRenderTargets((UINT)passRtvs.size(), passRtvs.data(), nullptr);
+			d3dDC->RSSetViewports(1, &vp);
+			d3dDC->PSSetShader(effect.pixelShaders[i].Get(), nullptr, 0);
+			if (!inputs.empty()) {
+				d3dDC->PSSetShaderResources(0, (UINT)inputs.size(), inputs.data());
+			}
+
+			d3dDC->Draw(3, 0);
+
+			// 解绑输入和输出，之后的 Pass 可能交换两者
+			d3dDC->OMSetRenderTargets(0, nullptr, nullptr);
+			if (!inputs.empty()) {
+				d3dDC->PSSetShaderResources(0, (UINT)nullInputs.size(), nullInputs.data());
+			}
+		}
+	}
+
+	return true;
+}
+
+void GpuEffectChain::Benchmark(
+	UINT adapterIdx,
+	const std::string& baselineJson,
+	const std::string& effectsJson,
+	UINT width,
+	UINT height,
+	UINT iterations
+) {
+	GpuEffectChain chains[2];
+	const std::string* jsons[2] = { &baselineJson, &effectsJson };
+	for (int i = 0; i < 2; ++i) {
+		if (!chains[i].Initialize(*jsons[i], adapterIdx)) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("初始化效果链失败：{}", *jsons[i]));
+			return;
+		}
+	}
+
+	SIZE outputSize{};
+	if (!chains[0].CalcOutputSize({ (LONG)width, (LONG)height }, outputSize)) {
+		SPDLOG_LOGGER_ERROR(logger, "计算输出尺寸失败");
+		return;
+	}
+
+	DXGI_ADAPTER_DESC1 adapterDesc{};
+	chains[0]._deviceResources->GetGraphicsAdapter()->GetDesc1(&adapterDesc);
+	SPDLOG_LOGGER_INFO(logger, fmt::format("GPU 基准测试：{}x{} -> {}x{}，{} 次迭代，{}",
+		width, height, outputSize.cx, outputSize.cy, iterations, StrUtils::UTF16ToUTF8(adapterDesc.Description)));
+
+	// 在所有参考图像上比较输出
+	std::vector<BYTE> input;
+	std::vector<BYTE> results[2];
+	std::vector<BYTE> output;
+	for (UINT i = 0; i < REFERENCE_IMAGE_COUNT; ++i) {
+		GenerateReferenceImage(i, width, height, input);
+
+		for (int j = 0; j < 2; ++j) {
+			if (!chains[j].Process(input.data(), width, height, width * 4, output, outputSize)) {
+				SPDLOG_LOGGER_ERROR(logger, fmt::format("执行效果链失败：{}", *jsons[j]));
+				return;
+			}
+
+			results[j].insert(results[j].end(), output.begin(), output.end());
+		}
+	}
+
+	if (results[0].size() != results[1].size()) {
+		SPDLOG_LOGGER_ERROR(logger, "两个效果链的输出尺寸不同");
+		return;
+	}
+
+	// 最后一张参考图像为伪随机噪声，作为计时的输入
+	for (int i = 0; i < 2; ++i) {
+		int us = Utils::Measure([&]() {
+			for (UINT j = 0; j < iterations; ++j) {
+				chains[i].Process(input.data(), width, height, width * 4, output, outputSize);
+			}
+		});
+
+		double mps = double(width) * height * iterations / std::max(us, 1);
+		SPDLOG_LOGGER_INFO(logger, fmt::format("{}：{:.1f} MP/s，{:.2f} ms/帧",
+			*jsons[i], mps, us / 1000.0 / std::max(iterations, 1u)));
+	}
+
+	SPDLOG_LOGGER_INFO(logger, fmt::format("参考图像上的 PSNR：{:.2f} dB", CalcPSNR(results[0], results[1])));
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "pch.h"
+#include "EffectDesc.h"
+#include "DeviceResources.h"
+#include "CpuTiledProcessor.h"
+
+
+// 在 GPU 上离线执行 MagpieFX 效果链，格式和 Renderer 使用的 json 相同，用于批处理
+// 没有缩放会话，因此效果不读写缓存，按功能级别 11.0 编译，scale 属性只能为正数，动态常量中的帧数和光标位置都为 0
+// 从文件加载的纹理只支持 DDSReader 可以读取的 DDS 文件。立即上下文和同一进程中的会话共享，每次处理时锁定，因此同一时刻只处理一张图像或一块
+class GpuEffectChain {
+public:
+	// halfPrecision 为 true 时使用了 HALF_PRECISION 指令的效果编译为半精度的变体，不经过验证
+	bool Initialize(const std::string& effectsJson, UINT adapterIdx, bool halfPrecision = false);
+
+	bool CalcOutputSize(SIZE inputSize, SIZE& outputSize) const;
+
+	// 含义和 CpuEffectChain::GetTilingInfo 相同，每个效果的采样半径由 HALO 指令指定
+	// 有效果未指定 HALO 或缩放比例无法用分母不超过 MAX_TILE_ALIGNMENT 的分数表示时返回 false
+	bool GetTilingInfo(UINT& halo, UINT& alignment) const;
+
+	// 输入为 inputSize 时所有纹理中最大的宽和高，任一边超过 MAX_TEXTURE_SIZE 时只能分块处理
+	bool CalcMaxTextureSize(SIZE inputSize, SIZE& result) const;
+
+	// tileSize 为 0 时从 DEFAULT_TILE_SIZE 开始减半，直到纹理尺寸和内存占用都不超出限制
+	// 效果链不支持分块时返回 false
+	bool CreateTilePlan(SIZE inputSize, UINT tileSize, size_t memoryBudget, CpuTiledProcessor::Plan& plan) const;
+
+	// 处理一张图像或分块处理时的一块，输入和输出都是 B8G8R8A8，输出的行距为宽度的 4 倍
+	bool Process(const BYTE* input, UINT width, UINT height, UINT pitch, std::vector<BYTE>& output, SIZE& outputSize) const;
+
+	// 在参考图像上测量 baselineJson 和 effectsJson 两个效果链每帧的耗时（MP/s）并写入日志，包含上传和回读
+	// 同时记录两者在所有参考图像上的输出的 PSNR，用于验证两种实现等价
+	static void Benchmark(UINT adapterIdx, const std::string& baselineJson, const std::string& effectsJson,
+		UINT width = 1920, UINT height = 1080, UINT iterations = 20);
+
+	static constexpr UINT MAX_TEXTURE_SIZE = D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+	static constexpr UINT MAX_TILE_ALIGNMENT = 64;
+
+private:
+	struct _Effect {
+		std::string name;
+		std::shared_ptr<const EffectDesc> desc;
+		// constants 的值，valueConstants 在处理时计算，大小为 4 的倍数
+		std::vector<Constant32> constants;
+		// 未指定输出尺寸的效果使用 scale 属性，为 0 表示输出尺寸和输入相同
+		float scaleX = 0;
+		float scaleY = 0;
+
+		// 和 desc->textures 一一对应，只有从文件加载的纹理不为空
+		std::vector<ComPtr<ID3D11Texture2D>> sourceTextures;
+		std::vector<ID3D11SamplerState*> samplers;
+		// 和 desc->passes 一一对应，每项只有一个不为空
+		std::vector<ComPtr<ID3D11PixelShader>> pixelShaders;
+		std::vector<ComPtr<ID3D11ComputeShader>> computeShaders;
+	};
+
+	bool _LoadSourceTexture(const std::string& source, ComPtr<ID3D11Texture2D>& result) const;
+
+	static bool _CalcEffectOutputSize(const _Effect& effect, SIZE inputSize, SIZE& outputSize);
+
+	// 按整张图像计算的缩放比例，分块时每块的比例必须和它相同
+	static bool _GetEffectScale(const _Effect& effect, double& scaleX, double& scaleY);
+
+	static bool _IsPassSkipped(const _Effect& effect, const EffectPassDesc& desc) {
+		return desc.condition >= 0 && effect.constants[desc.condition].intVal == 0;
+	}
+
+	bool _DrawEffect(const _Effect& effect, ID3D11Texture2D* input, SIZE inputSize,
+		ID3D11Texture2D* output, SIZE outputSize) const;
+
+	std::shared_ptr<DeviceResources> _deviceResources;
+	std::vector<_Effect> _effects;
+};
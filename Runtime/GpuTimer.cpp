@@ -0,0 +1,92 @@
+#include "pch.h"
+#include "GpuTimer.h"
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+
+bool GpuTimer::Initialize(ID3D11Device* d3dDevice) {
+	for (_Frame& frame : _frames) {
+		D3D11_QUERY_DESC desc{};
+		desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+		HRESULT hr = d3dDevice->CreateQuery(&desc, &frame.disjoint);
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateQuery 失败", hr));
+			return false;
+		}
+
+		desc.Query = D3D11_QUERY_TIMESTAMP;
+		hr = d3dDevice->CreateQuery(&desc, &frame.begin);
+		if (SUCCEEDED(hr)) {
+			hr = d3dDevice->CreateQuery(&desc, &frame.end);
+		}
+		if (FAILED(hr)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateQuery 失败", hr));
+			_frames[0].disjoint = nullptr;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void GpuTimer::Begin(ID3D11DeviceContext* d3dDC) {
+	_Frame& frame = _frames[_cur];
+	if (frame.pending) {
+		// 所有查询都在等待结果，跳过这次测量
+		return;
+	}
+
+	d3dDC->Begin(frame.disjoint.Get());
+	d3dDC->End(frame.begin.Get());
+	_measuring = true;
+}
+
+void GpuTimer::End(ID3D11DeviceContext* d3dDC) {
+	if (!_measuring) {
+		return;
+	}
+	_measuring = false;
+
+	_Frame& frame = _frames[_cur];
+	d3dDC->End(frame.end.Get());
+	d3dDC->End(frame.disjoint.Get());
+	frame.pending = true;
+
+	_cur = (_cur + 1) % (UINT)_frames.size();
+}
+
+bool GpuTimer::GetResult(ID3D11DeviceContext* d3dDC, float& milliseconds) {
+	// 从最早提交的查询开始找
+	for (UINT i = 0; i < (UINT)_frames.size(); ++i) {
+		_Frame& frame = _frames[(_cur + i) % _frames.size()];
+		if (!frame.pending) {
+			continue;
+		}
+
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		if (d3dDC->GetData(frame.disjoint.Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+			// 更晚的查询也不会完成
+			return false;
+		}
+		frame.pending = false;
+
+		UINT64 begin = 0;
+		UINT64 end = 0;
+		if (d3dDC->GetData(frame.begin.Get(), &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK
+			|| d3dDC->GetData(frame.end.Get(), &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK
+		) {
+			return false;
+		}
+
+		// 期间 GPU 频率改变过，结果不可靠
+		if (disjoint.Disjoint || disjoint.Frequency == 0 || end < begin) {
+			return false;
+		}
+
+		milliseconds = float(double(end - begin) * 1000 / disjoint.Frequency);
+		return true;
+	}
+
+	return false;
+}
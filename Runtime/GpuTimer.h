@@ -0,0 +1,36 @@
+#pragma once
+#include "pch.h"
+#include <array>
+
+
+// 使用时间戳查询测量一段命令在 GPU 上的用时
+// 查询结果在几帧后才可用，因此轮流使用多组查询，读取时不等待
+class GpuTimer {
+public:
+	bool Initialize(ID3D11Device* d3dDevice);
+
+	bool IsInitialized() const {
+		return _frames[0].disjoint != nullptr;
+	}
+
+	void Begin(ID3D11DeviceContext* d3dDC);
+
+	void End(ID3D11DeviceContext* d3dDC);
+
+	// 读取最早的已完成的测量，单位为毫秒。没有可用的结果时返回 false
+	bool GetResult(ID3D11DeviceContext* d3dDC, float& milliseconds);
+
+private:
+	struct _Frame {
+		ComPtr<ID3D11Query> disjoint;
+		ComPtr<ID3D11Query> begin;
+		ComPtr<ID3D11Query> end;
+		// 已提交，等待读取结果
+		bool pending = false;
+	};
+
+	std::array<_Frame, 4> _frames;
+	// 下一次测量使用的查询，也是最早提交的查询
+	UINT _cur = 0;
+	bool _measuring = false;
+};
@@ -143,7 +143,6 @@ bool GraphicsCaptureFrameSource::Initialize() {
 		return false;
 	}
 
-	InitializeConditionVariable(&_cv);
 	InitializeCriticalSectionEx(&_cs, 4000, CRITICAL_SECTION_NO_DEBUG_INFO);
 
 	App::GetInstance().SetErrorMsg(ErrorMessages::GENERIC);
@@ -152,20 +151,10 @@ bool GraphicsCaptureFrameSource::Initialize() {
 }
 
 FrameSourceBase::UpdateState GraphicsCaptureFrameSource::Update() {
-	// 每次睡眠 1 毫秒等待新帧到达，防止 CPU 占用过高
-	BOOL update = FALSE;
-
+	// 新帧到达时会唤醒渲染线程，因此这里无需等待
 	EnterCriticalSection(&_cs);
-
-	if (!_newFrameArrived) {
-		SleepConditionVariableCS(&_cv, &_cs, 1);
-	}
-
-	if (_newFrameArrived) {
-		_newFrameArrived = false;
-		update = TRUE;
-	}
-
+	const bool update = _newFrameArrived;
+	_newFrameArrived = false;
 	LeaveCriticalSection(&_cs);
 
 	if (update) {
@@ -193,10 +182,12 @@ FrameSourceBase::UpdateState GraphicsCaptureFrameSource::Update() {
 
 		App::GetInstance().GetRenderer().GetD3DDC()
 			->CopySubresourceRegion(_output.Get(), 0, 0, 0, 0, withFrame.Get(), 0, &_frameBox);
+		_hasFrame = true;
 
 		return UpdateState::NewFrame;
 	} else {
-		return UpdateState::Waiting;
+		// 第一帧之前不渲染
+		return _hasFrame ? UpdateState::NoUpdate : UpdateState::Waiting;
 	}
 }
 
@@ -349,12 +340,14 @@ bool GraphicsCaptureFrameSource::_CaptureFromMonitor(winrt::impl::com_ref<IGraph
 }
 
 void GraphicsCaptureFrameSource::_OnFrameArrived(winrt::Direct3D11CaptureFramePool const&, winrt::IInspectable const&) {
-	// 更改标志，如果主线程正在等待，唤醒主线程
+	// 更改标志，然后唤醒渲染线程
 	EnterCriticalSection(&_cs);
 	_newFrameArrived = true;
 	LeaveCriticalSection(&_cs);
 
-	WakeConditionVariable(&_cv);
+	// 在线程池中调用
+	App::ThreadScope scope(_app);
+	App::GetInstance().GetRenderer().Wake();
 }
 
 GraphicsCaptureFrameSource::~GraphicsCaptureFrameSource() {
@@ -33,6 +33,10 @@ public:
 		return true;
 	}
 
+	bool IsFrameArrivalSignaled() override {
+		return true;
+	}
+
 	bool IsScreenCapture() override {
 		return _isScreenCapture;
 	}
@@ -58,9 +62,10 @@ private:
 	winrt::Direct3D11CaptureFramePool::FrameArrived_revoker _frameArrived;
 
 	// 用于线程同步
-	CONDITION_VARIABLE _cv{};
 	CRITICAL_SECTION _cs{};
 	bool _newFrameArrived = false;
+	// 已复制过至少一帧，只在渲染线程上使用
+	bool _hasFrame = false;
 
 	ComPtr<ID3D11Texture2D> _output;
 };
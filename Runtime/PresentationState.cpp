@@ -0,0 +1,24 @@
+#include "pch.h"
+#include "PresentationState.h"
+
+
+bool PresentationState::Update(const Inputs& inputs) {
+	bool dirty = _invalidated || inputs.newFrame || inputs.hasDynamicConstants
+		|| inputs.cursor != _cursor || inputs.overlayText != _overlayText;
+
+	// 光标不可见时位置无关紧要
+	if (!dirty && inputs.cursor) {
+		dirty = inputs.cursorPos.x != _cursorPos.x || inputs.cursorPos.y != _cursorPos.y;
+	}
+
+	if (!dirty) {
+		return false;
+	}
+
+	_invalidated = false;
+	_cursor = inputs.cursor;
+	_cursorPos = inputs.cursorPos;
+	_overlayText = inputs.overlayText;
+
+	return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "pch.h"
+
+
+// 判断这一帧的呈现内容是否可能和上次呈现时不同
+// 只比较输入，不涉及 D3D，因此可以脱离渲染器单独使用
+class PresentationState {
+public:
+	struct Inputs {
+		// 帧源有新帧
+		bool newFrame = false;
+		// 有效果使用了动态常量，如 frameCount
+		bool hasDynamicConstants = false;
+		// 不绘制光标时为 NULL
+		HCURSOR cursor = NULL;
+		POINT cursorPos{};
+		// 叠加层（如帧率）显示的文字，不显示时为空
+		std::string overlayText;
+	};
+
+	// 返回 true 表示需要渲染并呈现，此时记录 inputs 作为上次呈现的状态
+	bool Update(const Inputs& inputs);
+
+	// 下一帧强制呈现，如首帧或重新构建效果后
+	void Invalidate() {
+		_invalidated = true;
+	}
+
+private:
+	bool _invalidated = true;
+
+	HCURSOR _cursor = NULL;
+	POINT _cursorPos{};
+	std::string _overlayText;
+};
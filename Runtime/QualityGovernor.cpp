@@ -0,0 +1,118 @@
+#include "pch.h"
+#include "QualityGovernor.h"
+
+
+void QualityGovernor::Reset(UINT levelCount) {
+	_levelCount = std::max(levelCount, 1u);
+	_level = 0;
+	_switchingFrom.reset();
+	_upWindows = _options.upWindows;
+	_probing = false;
+
+	OnSwitched();
+}
+
+std::optional<UINT> QualityGovernor::Update(float gpuTime, float budget, float droppedRatio) {
+	if (_levelCount < 2 || budget <= 0) {
+		return std::nullopt;
+	}
+
+	if (_switchingFrom) {
+		// 切换尚未完成，样本仍来自原来的效果
+		if (++_switchingSamples < _options.switchTimeoutSamples) {
+			return std::nullopt;
+		}
+
+		// 没有收到切换的结果，仍在使用原来的效果
+		OnSwitchFailed();
+		return std::nullopt;
+	}
+
+	if (_settleSamples > 0) {
+		--_settleSamples;
+		return std::nullopt;
+	}
+
+	_windowSum += gpuTime;
+	_windowDroppedSum += droppedRatio;
+	if (++_windowCount < _options.windowSize) {
+		return std::nullopt;
+	}
+
+	const float ratio = _windowSum / _windowCount / budget;
+	const float dropped = _windowDroppedSum / _windowCount;
+	_windowSum = 0;
+	_windowDroppedSum = 0;
+	_windowCount = 0;
+	++_windowsSinceSwitch;
+
+	if (ratio > _options.downRatio || (dropped > _options.dropRatio && ratio >= _options.upRatio)) {
+		_goodWindows = 0;
+
+		if (_level + 1 >= _levelCount) {
+			// 已是开销最低的级别
+			return std::nullopt;
+		}
+
+		if (_probing) {
+			// 刚升级就超出预算，下次等待更久
+			_upWindows = std::min(_upWindows * 2, _options.maxUpWindows);
+			_probing = false;
+		}
+
+		return _SwitchTo(_level + 1);
+	}
+
+	if (_probing && _windowsSinceSwitch >= _upWindows) {
+		// 升级后保持了足够久，恢复默认的等待时间
+		_probing = false;
+		_upWindows = _options.upWindows;
+	}
+
+	if (_level > 0 && ratio < _options.upRatio && dropped == 0) {
+		if (++_goodWindows >= _upWindows) {
+			_probing = true;
+			return _SwitchTo(_level - 1);
+		}
+	} else {
+		_goodWindows = 0;
+	}
+
+	return std::nullopt;
+}
+
+void QualityGovernor::OnSwitched() {
+	_switchingFrom.reset();
+	_switchingSamples = 0;
+	_windowsSinceSwitch = 0;
+
+	DiscardSamples();
+}
+
+void QualityGovernor::OnSwitchFailed() {
+	if (!_switchingFrom) {
+		return;
+	}
+
+	_level = *_switchingFrom;
+	_probing = false;
+	OnSwitched();
+}
+
+void QualityGovernor::DiscardSamples() {
+	_settleSamples = _options.settleSamples;
+
+	_windowSum = 0;
+	_windowDroppedSum = 0;
+	_windowCount = 0;
+	_goodWindows = 0;
+}
+
+UINT QualityGovernor::_SwitchTo(UINT level) {
+	_switchingFrom = _level;
+	_switchingSamples = 0;
+	_level = level;
+	_goodWindows = 0;
+
+	return level;
+}
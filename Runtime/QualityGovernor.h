@@ -0,0 +1,90 @@
+#pragma once
+#include "pch.h"
+#include <optional>
+
+
+// 根据效果的 GPU 用时和丢帧在质量阶梯上选择级别，级别 0 质量最高，级别越高开销越低
+// 超出预算或 GPU 负载较高时丢帧立即降级；有足够余量并保持一段时间后才尝试升级，升级后很快又超出预算时下次等待的时间加倍
+// 只处理数字，不涉及 D3D，因此可以脱离渲染器单独使用
+class QualityGovernor {
+public:
+	struct Options {
+		// 每个窗口包含的样本数，取平均值后和预算比较
+		UINT windowSize = 10;
+		// 平均用时超过预算的此比例时降级
+		float downRatio = 0.8f;
+		// 平均用时低于预算的此比例且没有丢帧时可以升级
+		float upRatio = 0.4f;
+		// 丢帧的比例超过此值，且平均用时不低于 upRatio 时降级
+		// GPU 用时很低时丢帧不是效果造成的，降级无济于事
+		float dropRatio = 0.05f;
+		// 升级前需要连续有余量的窗口数，升级失败后加倍，直到 maxUpWindows
+		UINT upWindows = 8;
+		UINT maxUpWindows = 128;
+		// 切换后丢弃的样本数，新的效果可能还在预热
+		UINT settleSamples = 5;
+		// 等待切换完成的最多样本数，超时后认为切换失败，回到原来的级别
+		// 切换失败时渲染器会调用 OnSwitchFailed，超时只是防止遗漏结果的保险
+		UINT switchTimeoutSamples = 400;
+	};
+
+	QualityGovernor() = default;
+
+	explicit QualityGovernor(const Options& options) : _options(options) {}
+
+	// 开始新的质量阶梯，回到级别 0
+	void Reset(UINT levelCount);
+
+	// 提供一个样本：这段时间内每帧的平均 GPU 用时和每帧的预算，单位相同
+	// droppedRatio 为这段时间内丢失的帧占应呈现的帧的比例，无法统计时为 0
+	// 返回新的级别表示应切换到该级别的效果，切换完成后需调用 OnSwitched，失败时调用 OnSwitchFailed
+	std::optional<UINT> Update(float gpuTime, float budget, float droppedRatio = 0);
+
+	// 由 Update 发起的切换已完成。之前的样本作废
+	void OnSwitched();
+
+	// 由 Update 发起的切换失败，回到原来的级别。没有正在进行的切换时什么也不做
+	void OnSwitchFailed();
+
+	// 效果被替换，但不是由此类发起的切换，如重新特化或效果文件被修改。之前的样本作废
+	void DiscardSamples();
+
+	// 切换中时为切换的目标
+	UINT GetLevel() const {
+		return _level;
+	}
+
+	bool IsSwitching() const {
+		return _switchingFrom.has_value();
+	}
+
+	UINT GetLevelCount() const {
+		return _levelCount;
+	}
+
+private:
+	UINT _SwitchTo(UINT level);
+
+	Options _options;
+
+	UINT _levelCount = 1;
+	UINT _level = 0;
+
+	// 发起切换前的级别，切换完成前不为空
+	std::optional<UINT> _switchingFrom;
+	UINT _switchingSamples = 0;
+	// 还需丢弃的样本数
+	UINT _settleSamples = 0;
+
+	float _windowSum = 0;
+	float _windowDroppedSum = 0;
+	UINT _windowCount = 0;
+	// 切换后经过的窗口数
+	UINT _windowsSinceSwitch = 0;
+	// 连续有余量的窗口数
+	UINT _goodWindows = 0;
+	// 当前升级前需要的窗口数
+	UINT _upWindows = 0;
+	// 上次切换是升级，且之后还没有保持 _upWindows 个窗口
+	bool _probing = false;
+};
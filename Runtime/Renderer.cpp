@@ -6,6 +6,8 @@
 #include <VertexTypes.h>
 #include "EffectCompiler.h"
 #include <rapidjson/document.h>
+#include <rapidjson/writer.h>
+#include <rapidjson/stringbuffer.h>
 
 
 extern std::shared_ptr<spdlog::logger> logger;
@@ -27,6 +29,12 @@ bool Renderer::Initialize() {
 		return false;
 	}
 
+	_wakeEvent.reset(CreateEvent(nullptr, FALSE, FALSE, nullptr));
+	if (!_wakeEvent) {
+		SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("CreateEvent 失败"));
+		return false;
+	}
+
 	int frameRate = App::GetInstance().GetFrameRate();
 	
 	if (frameRate > 0) {
@@ -41,10 +49,33 @@ bool Renderer::Initialize() {
 	return true;
 }
 
+// 限制帧率时为帧率对应的时间，否则为主窗口所在屏幕的刷新间隔
+static float GetFrameBudget() {
+	int frameRate = App::GetInstance().GetFrameRate();
+	if (frameRate > 0) {
+		return 1000.0f / frameRate;
+	}
+
+	HMONITOR hMonitor = MonitorFromWindow(App::GetInstance().GetHwndHost(), MONITOR_DEFAULTTONEAREST);
+	MONITORINFOEX mi{};
+	mi.cbSize = sizeof(mi);
+	DEVMODE dm{};
+	dm.dmSize = sizeof(dm);
+	if (!hMonitor || !GetMonitorInfo(hMonitor, &mi) || !EnumDisplaySettings(mi.szDevice, ENUM_CURRENT_SETTINGS, &dm)
+		|| dm.dmDisplayFrequency <= 1
+	) {
+		SPDLOG_LOGGER_ERROR(logger, "获取屏幕刷新率失败，假定为 60Hz");
+		return 1000.0f / 60;
+	}
+
+	return 1000.0f / dm.dmDisplayFrequency;
+}
+
 bool Renderer::InitializeEffectsAndCursor(const std::string& effectsJson) {
+	// 效果在后台编译，完成前直接缩放帧源的输出，首帧无需等待编译
 	RECT destRect;
-	if (!_ResolveEffectsJson(effectsJson, destRect)) {
-		SPDLOG_LOGGER_ERROR(logger, "_ResolveEffectsJson 失败");
+	if (!_BuildEffects(destRect)) {
+		SPDLOG_LOGGER_ERROR(logger, "_BuildEffects 失败");
 		return false;
 	}
 	
@@ -60,6 +91,25 @@ bool Renderer::InitializeEffectsAndCursor(const std::string& effectsJson) {
 		return false;
 	}
 
+	if (App::GetInstance().IsAdaptiveQuality()) {
+		_frameBudget = GetFrameBudget();
+		SPDLOG_LOGGER_INFO(logger, fmt::format("已开启自适应质量，每帧的预算为 {:.2f} 毫秒", _frameBudget));
+
+		// 失败时只是无法切换质量
+		if (!_gpuTimer.Initialize(_d3dDevice.Get())) {
+			SPDLOG_LOGGER_ERROR(logger, "初始化 GpuTimer 失败");
+		}
+	}
+
+	// 效果文件被修改时自动重新加载，失败不影响全屏
+	_effectsChangeNotification = FindFirstChangeNotification(L"effects", TRUE,
+		FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+	if (_effectsChangeNotification == INVALID_HANDLE_VALUE) {
+		SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("FindFirstChangeNotification 失败"));
+	}
+
+	ReloadEffects(effectsJson);
+
 	return true;
 }
 
@@ -73,6 +123,11 @@ void Renderer::Render() {
 }
 
 bool Renderer::GetRenderTargetView(ID3D11Texture2D* texture, ID3D11RenderTargetView** result) {
+	AcquireSRWLockExclusive(&_viewLock);
+	Utils::ScopeExit se([this]() {
+		ReleaseSRWLockExclusive(&_viewLock);
+	});
+
 	auto it = _rtvMap.find(texture);
 	if (it != _rtvMap.end()) {
 		*result = it->second.Get();
@@ -91,6 +146,11 @@ bool Renderer::GetRenderTargetView(ID3D11Texture2D* texture, ID3D11RenderTargetV
 }
 
 bool Renderer::GetShaderResourceView(ID3D11Texture2D* texture, ID3D11ShaderResourceView** result) {
+	AcquireSRWLockExclusive(&_viewLock);
+	Utils::ScopeExit se([this]() {
+		ReleaseSRWLockExclusive(&_viewLock);
+	});
+
 	auto it = _srvMap.find(texture);
 	if (it != _srvMap.end()) {
 		*result = it->second.Get();
@@ -108,223 +168,93 @@ bool Renderer::GetShaderResourceView(ID3D11Texture2D* texture, ID3D11ShaderResou
 	}
 }
 
-bool Renderer::SetFillVS() {
-	if (!_fillVS) {
-		const char* src = "void m(uint i:SV_VERTEXID,out float4 p:SV_POSITION,out float2 c:TEXCOORD){c=float2(i&1,i>>1)*2;p=float4(c.x*2-1,-c.y*2+1,0,1);}";
+bool Renderer::GetUnorderedAccessView(ID3D11Texture2D* texture, ID3D11UnorderedAccessView** result) {
+	AcquireSRWLockExclusive(&_viewLock);
+	Utils::ScopeExit se([this]() {
+		ReleaseSRWLockExclusive(&_viewLock);
+	});
 
-		ComPtr<ID3DBlob> blob;
-		if (!CompileShader(true, src, "m", &blob, "FillVS")) {
-			SPDLOG_LOGGER_ERROR(logger, "编译 FillVS 失败");
-			return false;
-		}
-
-		HRESULT hr = _d3dDevice->CreateVertexShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &_fillVS);
-		if (FAILED(hr)) {
-			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 FillVS 失败", hr));
-			return false;
-		}
+	auto it = _uavMap.find(texture);
+	if (it != _uavMap.end()) {
+		*result = it->second.Get();
+		return true;
 	}
-	
-	_d3dDC->IASetInputLayout(nullptr);
-	_d3dDC->IASetVertexBuffers(0, 0, nullptr, nullptr, nullptr);
-	_d3dDC->VSSetShader(_fillVS.Get(), nullptr, 0);
 
-	return true;
-}
-
-
-bool Renderer::SetCopyPS(ID3D11SamplerState* sampler, ID3D11ShaderResourceView* input) {
-	if (!_copyPS) {
-		const char* src = "Texture2D t:register(t0);SamplerState s:register(s0);float4 m(float4 p:SV_POSITION,float2 c:TEXCOORD):SV_Target{return t.Sample(s,c);}";
-
-		ComPtr<ID3DBlob> blob;
-		if (!CompileShader(false, src, "m", &blob, "CopyPS")) {
-			SPDLOG_LOGGER_ERROR(logger, "编译 CopyPS 失败");
-			return false;
-		}
-
-		HRESULT hr = _d3dDevice->CreatePixelShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &_copyPS);
-		if (FAILED(hr)) {
-			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 CopyPS 失败", hr));
-			return false;
-		}
+	ComPtr<ID3D11UnorderedAccessView>& r = _uavMap[texture];
+	HRESULT hr = _d3dDevice->CreateUnorderedAccessView(texture, nullptr, &r);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateUnorderedAccessView 失败", hr));
+		return false;
+	} else {
+		*result = r.Get();
+		return true;
 	}
-
-	_d3dDC->PSSetShader(_copyPS.Get(), nullptr, 0);
-	_d3dDC->PSSetConstantBuffers(0, 0, nullptr);
-	_d3dDC->PSSetShaderResources(0, 1, &input);
-	_d3dDC->PSSetSamplers(0, 1, &sampler);
-
-	return true;
 }
 
-bool Renderer::SetSimpleVS(ID3D11Buffer* simpleVB) {
-	if (!_simpleVS) {
-		const char* src = "void m(float4 p:SV_POSITION,float2 c:TEXCOORD,out float4 q:SV_POSITION,out float2 d:TEXCOORD) {q=p;d=c;}";
-
-		ComPtr<ID3DBlob> blob;
-		if (!CompileShader(true, src, "m", &blob, "SimpleVS")) {
-			SPDLOG_LOGGER_ERROR(logger, "编译 SimpleVS 失败");
-			return false;
-		}
-
-		HRESULT hr = _d3dDevice->CreateVertexShader(blob->GetBufferPointer(), blob->GetBufferSize(), nullptr, &_simpleVS);
-		if (FAILED(hr)) {
-			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 SimpleVS 失败", hr));
-			return false;
-		}
+void Renderer::ReleaseViews(ID3D11Texture2D* texture) {
+	AcquireSRWLockExclusive(&_viewLock);
+	_rtvMap.erase(texture);
+	_srvMap.erase(texture);
+	_uavMap.erase(texture);
+	ReleaseSRWLockExclusive(&_viewLock);
+}
 
-		hr = _d3dDevice->CreateInputLayout(
-			VertexPositionTexture::InputElements,
-			VertexPositionTexture::InputElementCount,
-			blob->GetBufferPointer(),
-			blob->GetBufferSize(),
-			&_simpleIL
-		);
-		if (FAILED(hr)) {
-			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 SimpleVS 输入布局失败", hr));
-			return false;
-		}
+bool Renderer::SetFillVS() {
+	ID3D11VertexShader* fillVS;
+	if (!_deviceResources->GetFillVS(&fillVS)) {
+		SPDLOG_LOGGER_ERROR(logger, "GetFillVS 失败");
+		return false;
 	}
-
-	_d3dDC->IASetInputLayout(_simpleIL.Get());
-
-	UINT stride = sizeof(VertexPositionTexture);
-	UINT offset = 0;
-	_d3dDC->IASetVertexBuffers(0, 1, &simpleVB, &stride, &offset);
-
-	_d3dDC->VSSetShader(_simpleVS.Get(), nullptr, 0);
+	
+	_curStateContext->IASetInputLayout(nullptr);
+	_curStateContext->IASetVertexBuffer(nullptr, 0, 0);
+	_curStateContext->VSSetShader(fillVS);
 
 	return true;
 }
 
-static inline void LogAdapter(const DXGI_ADAPTER_DESC1& adapterDesc) {
-	SPDLOG_LOGGER_INFO(logger, fmt::format("当前图形适配器：\n\tVendorId：{:#x}\n\tDeviceId：{:#x}\n\t描述：{}",
-		adapterDesc.VendorId, adapterDesc.DeviceId, StrUtils::UTF16ToUTF8(adapterDesc.Description)));
-}
-
-static ComPtr<IDXGIAdapter1> ObtainGraphicsAdapter(IDXGIFactory1* dxgiFactory, UINT adapterIdx) {
-	ComPtr<IDXGIAdapter1> adapter;
-
-	HRESULT hr = dxgiFactory->EnumAdapters1(adapterIdx, adapter.ReleaseAndGetAddressOf());
-	if (SUCCEEDED(hr)) {
-		DXGI_ADAPTER_DESC1 desc;
-		HRESULT hr = adapter->GetDesc1(&desc);
-		if (FAILED(hr)) {
-			return nullptr;
-		}
 
-		LogAdapter(desc);
-		return adapter;
+bool Renderer::SetCopyPS(ID3D11SamplerState* sampler, ID3D11ShaderResourceView* input) {
+	ID3D11PixelShader* copyPS;
+	if (!_deviceResources->GetCopyPS(&copyPS)) {
+		SPDLOG_LOGGER_ERROR(logger, "GetCopyPS 失败");
+		return false;
 	}
 
-	// 指定 GPU 失败，回落到普通方式
-	ComPtr<IDXGIAdapter1> warpAdapter;
-	DXGI_ADAPTER_DESC1 warpDesc;
+	_curStateContext->PSSetShader(copyPS);
+	_curStateContext->PSSetShaderResources(0, 1, &input);
+	_curStateContext->PSSetSamplers(0, 1, &sampler);
 
-	for (UINT adapterIndex = 0;
-			SUCCEEDED(dxgiFactory->EnumAdapters1(adapterIndex,
-				adapter.ReleaseAndGetAddressOf()));
-			adapterIndex++
-	) {
-		DXGI_ADAPTER_DESC1 desc;
-		HRESULT hr = adapter->GetDesc1(&desc);
-		if (FAILED(hr)) {
-			return nullptr;
-		}
-
-		if (desc.Flags == DXGI_ADAPTER_FLAG_SOFTWARE) {
-			warpAdapter = adapter;
-			warpDesc = desc;
-			continue;
-		}
-
-		LogAdapter(desc);
-		return adapter;
-	}
-
-	// 回落到 Basic Render Driver Adapter（WARP）
-	// https://docs.microsoft.com/en-us/windows/win32/direct3darticles/directx-warp
-	if (warpAdapter) {
-		LogAdapter(warpDesc);
-		return warpAdapter;
-	} else {
-		return nullptr;
-	}
+	return true;
 }
 
-bool Renderer::CompileShader(bool isVS, std::string_view hlsl, const char* entryPoint,
-	ID3DBlob** blob, const char* sourceName, ID3DInclude* include
-) {
-	ComPtr<ID3DBlob> errorMsgs = nullptr;
-
-	UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
-	const char* target;
-	if (isVS) {
-		target = _featureLevel >= D3D_FEATURE_LEVEL_11_0 ? "vs_5_0" :
-			(_featureLevel == D3D_FEATURE_LEVEL_10_1 ? "vs_4_1" : "vs_4_0");
-	} else {
-		target = _featureLevel >= D3D_FEATURE_LEVEL_11_0 ? "ps_5_0" :
-			(_featureLevel == D3D_FEATURE_LEVEL_10_1 ? "ps_4_1" : "ps_4_0");
-	} 
-
-	HRESULT hr = D3DCompile(hlsl.data(), hlsl.size(), sourceName, nullptr, include,
-		entryPoint, target, flags, 0, blob, &errorMsgs);
-	if (FAILED(hr)) {
-		if (errorMsgs) {
-			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg(fmt::format("编译{}着色器失败：{}",
-				isVS ? "顶点" : "像素", (const char*)errorMsgs->GetBufferPointer()), hr));
-		}
+bool Renderer::SetSimpleVS(ID3D11Buffer* simpleVB) {
+	ID3D11VertexShader* simpleVS;
+	ID3D11InputLayout* simpleIL;
+	if (!_deviceResources->GetSimpleVS(&simpleVS, &simpleIL)) {
+		SPDLOG_LOGGER_ERROR(logger, "GetSimpleVS 失败");
 		return false;
-	} else {
-		if (errorMsgs) {
-			// 显示警告消息
-			SPDLOG_LOGGER_WARN(logger, fmt::format("编译{}着色器时产生警告：{}",
-				isVS ? "顶点" : "像素", (const char*)errorMsgs->GetBufferPointer()));
-		}
 	}
 
-	return true;
-}
+	_curStateContext->IASetInputLayout(simpleIL);
+	_curStateContext->IASetVertexBuffer(simpleVB, sizeof(VertexPositionTexture), 0);
+	_curStateContext->VSSetShader(simpleVS);
 
-bool Renderer::IsDebugLayersAvailable() {
-#ifdef _DEBUG
-	static std::optional<bool> result = std::nullopt;
-
-	if (!result.has_value()) {
-		HRESULT hr = D3D11CreateDevice(
-			nullptr,
-			D3D_DRIVER_TYPE_NULL,       // There is no need to create a real hardware device.
-			nullptr,
-			D3D11_CREATE_DEVICE_DEBUG,  // Check for the SDK layers.
-			nullptr,                    // Any feature level will do.
-			0,
-			D3D11_SDK_VERSION,
-			nullptr,                    // No need to keep the D3D device reference.
-			nullptr,                    // No need to know the feature level.
-			nullptr                     // No need to keep the D3D device context reference.
-		);
-
-		result = SUCCEEDED(hr);
-	}
-
-	return result.value_or(false);
-#else
-	// Relaese 配置不使用调试层
-	return false;
-#endif
+	return true;
 }
 
 bool Renderer::_InitD3D() {
-	HRESULT hr = CreateDXGIFactory1(IID_PPV_ARGS(_dxgiFactory.ReleaseAndGetAddressOf()));
-	if (FAILED(hr)) {
+	// 和其他会话共享设备
+	_deviceResources = DeviceResources::Get(App::GetInstance().GetAdapterIdx());
+	if (!_deviceResources) {
+		SPDLOG_LOGGER_ERROR(logger, "获取 DeviceResources 失败");
 		return false;
 	}
 
 	// 检查可变帧率支持
 	BOOL supportTearing = FALSE;
 	ComPtr<IDXGIFactory5> dxgiFactory5;
-	hr = _dxgiFactory.As<IDXGIFactory5>(&dxgiFactory5);
+	HRESULT hr = _deviceResources->GetDXGIFactory().As<IDXGIFactory5>(&dxgiFactory5);
 	if (FAILED(hr)) {
 		SPDLOG_LOGGER_WARN(logger, MakeComErrorMsg("获取 IDXGIFactory5 失败", hr));
 	} else {
@@ -342,95 +272,29 @@ bool Renderer::_InitD3D() {
 		return false;
 	}
 
-	UINT createDeviceFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
-	if (IsDebugLayersAvailable()) {
-		// 在 DEBUG 配置启用调试层
-		createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
-	}
-
-	D3D_FEATURE_LEVEL featureLevels[] = {
-		D3D_FEATURE_LEVEL_11_1,
-		D3D_FEATURE_LEVEL_11_0,
-		D3D_FEATURE_LEVEL_10_1,
-		D3D_FEATURE_LEVEL_10_0,
-		// 不支持功能级别 9.x，但这里加上没坏处
-		D3D_FEATURE_LEVEL_9_3,
-		D3D_FEATURE_LEVEL_9_2,
-		D3D_FEATURE_LEVEL_9_1,
-	};
-	UINT nFeatureLevels = ARRAYSIZE(featureLevels);
-
-	_graphicsAdapter = ObtainGraphicsAdapter(_dxgiFactory.Get(), App::GetInstance().GetAdapterIdx());
-	if (!_graphicsAdapter) {
-		SPDLOG_LOGGER_ERROR(logger, "找不到可用 Adapter");
-		return false;
-	}
-
-	ComPtr<ID3D11Device> d3dDevice;
-	ComPtr<ID3D11DeviceContext> d3dDC;
-	hr = D3D11CreateDevice(
-		_graphicsAdapter.Get(),
-		D3D_DRIVER_TYPE_UNKNOWN,
-		nullptr,
-		createDeviceFlags,
-		featureLevels,
-		nFeatureLevels,
-		D3D11_SDK_VERSION,
-		&d3dDevice,
-		&_featureLevel,
-		&d3dDC
-	);
-
-	if (FAILED(hr)) {
-		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("D3D11CreateDevice 失败", hr));
-		return false;
-	}
-
-	std::string_view fl;
-	switch (_featureLevel) {
-	case D3D_FEATURE_LEVEL_11_1:
-		fl = "11.1";
-		break;
-	case D3D_FEATURE_LEVEL_11_0:
-		fl = "11.0";
-		break;
-	case D3D_FEATURE_LEVEL_10_1:
-		fl = "10.1";
-		break;
-	case D3D_FEATURE_LEVEL_10_0:
-		fl = "10.0";
-		break;
-	case D3D_FEATURE_LEVEL_9_3:
-		fl = "9.3";
-		break;
-	case D3D_FEATURE_LEVEL_9_2:
-		fl = "9.2";
-		break;
-	case D3D_FEATURE_LEVEL_9_1:
-		fl = "9.1";
-		break;
-	default:
-		fl = "未知";
-		break;
-	}
-	SPDLOG_LOGGER_INFO(logger, fmt::format("已创建 D3D Device\n\t功能级别：{}", fl));
-
-	hr = d3dDevice.As<ID3D11Device1>(&_d3dDevice);
-	if (FAILED(hr)) {
-		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("获取 ID3D11Device1 失败", hr));
-		return false;
-	}
-
-	hr = d3dDC.As<ID3D11DeviceContext1>(&_d3dDC);
-	if (FAILED(hr)) {
-		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("获取 ID3D11DeviceContext1 失败", hr));
-		return false;
-	}
-
-	hr = _d3dDevice.As<IDXGIDevice1>(&_dxgiDevice);
-	if (FAILED(hr)) {
-		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("获取 IDXGIDevice 失败", hr));
-		return false;
+	_d3dDevice = _deviceResources->GetD3DDevice();
+	_d3dDC = _deviceResources->GetD3DDC();
+	_stateContext.Initialize(_d3dDC);
+	// 设备上下文可能残留着其他会话设置的状态
+	_deviceResources->LockContext();
+	_stateContext.ClearState();
+	_deviceResources->UnlockContext();
+
+	if (App::GetInstance().IsRecordEffectCommandList()) {
+		// 驱动不支持时命令列表由运行时模拟，没有好处
+		D3D11_FEATURE_DATA_THREADING threading{};
+		hr = _d3dDevice->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(threading));
+		if (SUCCEEDED(hr) && threading.DriverCommandLists) {
+			hr = _d3dDevice->CreateDeferredContext1(0, &_deferredDC);
+			if (SUCCEEDED(hr)) {
+				_deferredStateContext.Initialize(_deferredDC);
+				SPDLOG_LOGGER_INFO(logger, "将效果录制为命令列表");
+			} else {
+				SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateDeferredContext1 失败", hr));
+			}
+		} else {
+			SPDLOG_LOGGER_INFO(logger, "驱动不支持命令列表，将直接渲染效果");
+		}
 	}
 
 	return true;
@@ -448,11 +312,13 @@ bool Renderer::_CreateSwapChain() {
 	sd.SampleDesc.Quality = 0;
 	sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT | DXGI_USAGE_SHADER_INPUT;
 	sd.BufferCount = (App::GetInstance().IsDisableLowLatency() && App::GetInstance().GetFrameRate() == 0) ? 3 : 2;
+	_backBufferCount = sd.BufferCount;
 	sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
 	sd.Flags = App::GetInstance().GetFrameRate() != 0 ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
+	ComPtr<IDXGIFactory2> dxgiFactory = _deviceResources->GetDXGIFactory();
 	ComPtr<IDXGISwapChain1> dxgiSwapChain = nullptr;
-	HRESULT hr = _dxgiFactory->CreateSwapChainForHwnd(
+	HRESULT hr = dxgiFactory->CreateSwapChainForHwnd(
 		_d3dDevice.Get(),
 		App::GetInstance().GetHwndHost(),
 		&sd,
@@ -472,7 +338,7 @@ bool Renderer::_CreateSwapChain() {
 	}
 
 	if (App::GetInstance().GetFrameRate() != 0) {
-		hr = _dxgiDevice->SetMaximumFrameLatency(1);
+		hr = _deviceResources->GetDXGIDevice()->SetMaximumFrameLatency(1);
 		if (FAILED(hr)) {
 			SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("SetMaximumFrameLatency 失败", hr));
 		}
@@ -487,7 +353,7 @@ bool Renderer::_CreateSwapChain() {
 		}
 	}
 
-	hr = _dxgiFactory->MakeWindowAssociation(App::GetInstance().GetHwndHost(), DXGI_MWA_NO_ALT_ENTER);
+	hr = dxgiFactory->MakeWindowAssociation(App::GetInstance().GetHwndHost(), DXGI_MWA_NO_ALT_ENTER);
 	if (FAILED(hr)) {
 		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("MakeWindowAssociation 失败", hr));
 	}
@@ -535,62 +401,244 @@ bool Renderer::_CreateSwapChain() {
 	return true;
 }
 
-void Renderer::_Render() {
-	int frameRate = App::GetInstance().GetFrameRate();
+Renderer::~Renderer() {
+	StopReloadThread();
+	StopRenderThread();
+
+	if (_effectsChangeNotification != INVALID_HANDLE_VALUE) {
+		FindCloseChangeNotification(_effectsChangeNotification);
+	}
+}
 
-	if (!_waitingForNextFrame && frameRate == 0) {
-		WaitForSingleObjectEx(_frameLatencyWaitableObject.get(), 1000, TRUE);
+// 光标移动或形状改变时唤醒渲染线程
+static void CALLBACK CursorWinEventProc(HWINEVENTHOOK, DWORD, HWND, LONG idObject, LONG, DWORD, DWORD) {
+	if (idObject == OBJID_CURSOR) {
+		App::GetInstance().GetRenderer().Wake();
 	}
+}
+
+// 光标的移动、显示和隐藏、形状改变（NAMECHANGE）
+// 进程外的钩子监听的每个事件都要发送到渲染线程，因此不使用 SHOW 到 NAMECHANGE 的整个范围，
+// 其中的 FOCUS、SELECTION、STATECHANGE 等事件在系统中非常频繁
+static constexpr std::pair<DWORD, DWORD> CURSOR_EVENT_RANGES[] = {
+	{ EVENT_OBJECT_LOCATIONCHANGE, EVENT_OBJECT_LOCATIONCHANGE },
+	{ EVENT_OBJECT_SHOW, EVENT_OBJECT_HIDE },
+	{ EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE }
+};
+
+bool Renderer::StartRenderThread() {
+	assert(!_renderThread.joinable());
+
+	_stopRenderThread = false;
+	// 渲染线程和创建它的主线程属于同一个会话
+	_renderThread = std::thread([this, app = App::GetCurrent()]() {
+		App::ThreadScope scope(app);
+		_RenderThreadProc();
+	});
+	return true;
+}
 
-	if (!_CheckSrcState()) {
-		SPDLOG_LOGGER_INFO(logger, "源窗口状态改变，退出全屏");
-		App::GetInstance().Close();
+void Renderer::StopRenderThread() {
+	if (!_renderThread.joinable()) {
 		return;
 	}
 
-	auto state = App::GetInstance().GetFrameSource().Update();
+	_stopRenderThread = true;
+	Wake();
+	_renderThread.join();
+
+	SPDLOG_LOGGER_INFO(logger, "渲染线程已退出");
+}
+
+void Renderer::_RenderThreadProc() {
+	SPDLOG_LOGGER_INFO(logger, "渲染线程已启动");
+
+	// 帧源可能使用 WinRT 对象
+	winrt::init_apartment(winrt::apartment_type::multi_threaded);
+
+	// 进程外的 WinEvent 回调通过本线程的消息队列调用
+	HWINEVENTHOOK hooks[std::size(CURSOR_EVENT_RANGES)]{};
+	for (size_t i = 0; i < std::size(hooks); ++i) {
+		const auto [eventMin, eventMax] = CURSOR_EVENT_RANGES[i];
+		hooks[i] = SetWinEventHook(eventMin, eventMax, NULL, CursorWinEventProc, 0, 0, WINEVENT_OUTOFCONTEXT);
+		if (!hooks[i]) {
+			SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("SetWinEventHook 失败"));
+		}
+	}
+
+	while (!_stopRenderThread) {
+		_WaitForWakeUp();
+
+		if (_stopRenderThread) {
+			break;
+		}
+
+		// 在两帧之间替换效果
+		_ApplyReloadedEffects();
+
+		Render();
+	}
+
+	for (HWINEVENTHOOK hook : hooks) {
+		if (hook) {
+			UnhookWinEvent(hook);
+		}
+	}
+
+	_stateContext.LogStats();
+
+	winrt::uninit_apartment();
+}
+
+void Renderer::_WaitForWakeUp() {
+	HANDLE handle = _wakeEvent.get();
+	DWORD timeout = 0;
+	bool waitForLatency = false;
+
+	if (_waitingForNextFrame || _idle) {
+		// 帧源尚无第一帧或上一帧没有呈现，等待帧源或光标唤醒
+		timeout = App::GetInstance().GetFrameSource().IsFrameArrivalSignaled() ? _IDLE_TIMEOUT : _IDLE_POLL_INTERVAL;
+	} else if (App::GetInstance().GetFrameRate() == 0) {
+		// 垂直同步：等待交换链可以接受新帧
+		// 没有呈现时不会释放等待对象，因此每次 Present 后只等待一次
+		if (!_frameLatencyWaited) {
+			handle = _frameLatencyWaitableObject.get();
+			timeout = 1000;
+			waitForLatency = true;
+		}
+	} else {
+		// 限制帧率时等到下一帧的时间点
+		timeout = _timer.GetMillisecondsUntilNextFrame();
+	}
+
+	while (true) {
+		DWORD ret = MsgWaitForMultipleObjectsEx(1, &handle, timeout, QS_ALLINPUT, MWMO_ALERTABLE | MWMO_INPUTAVAILABLE);
+
+		MSG msg;
+		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+			DispatchMessage(&msg);
+		}
+
+		// 等待帧延迟对象时不因消息而提前返回
+		if (ret != WAIT_OBJECT_0 + 1 || !waitForLatency || _stopRenderThread) {
+			break;
+		}
+	}
+
+	if (waitForLatency) {
+		_frameLatencyWaited = true;
+	}
+}
+
+void Renderer::_Render() {
+	int frameRate = App::GetInstance().GetFrameRate();
+
+	FrameSourceBase& frameSource = App::GetInstance().GetFrameSource();
+	auto state = frameSource.Update();
 	_waitingForNextFrame = state == FrameSourceBase::UpdateState::Waiting
 		|| state == FrameSourceBase::UpdateState::Error;
 	if (_waitingForNextFrame) {
+		// 帧源跟不上时错过的刷新不是效果造成的
+		_frameStatsValid = false;
 		return;
 	}
 
-	_d3dDC->ClearState();
-	// 所有渲染都使用三角形带拓扑
-	_d3dDC->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	// 第一个效果直接读取帧源中当前帧所在的纹理
+	const UINT inputIndex = frameSource.GetOutputIndex();
+	if (inputIndex != _effectInputIndex) {
+		ComPtr<ID3D11Texture2D> input = frameSource.GetOutputAt(inputIndex);
+		if (_effects.empty() || _effects.front().SetInput(input)) {
+			_effectInput = std::move(input);
+			_effectInputIndex = inputIndex;
+		} else {
+			SPDLOG_LOGGER_ERROR(logger, "切换效果的输入失败");
+		}
+	}
 
 	if (!_cursorDrawer.Update()) {
 		SPDLOG_LOGGER_ERROR(logger, "更新光标位置失败");
 	}
 
+	// 内容无变化时跳过渲染和 Present，让 GPU 可以进入低功耗状态
+	PresentationState::Inputs inputs;
+	inputs.newFrame = state == FrameSourceBase::UpdateState::NewFrame;
+	inputs.hasDynamicConstants = std::any_of(_effects.begin(), _effects.end(),
+		[](const EffectDrawer& effect) { return effect.HasDynamicConstants(); });
+	inputs.cursor = _cursorDrawer.GetCurrentCursor();
+	inputs.cursorPos = _cursorDrawer.GetCurrentCursorPos();
+	if (App::GetInstance().IsShowFPS()) {
+		inputs.overlayText = _frameRateDrawer.GetText();
+	}
+
+	_idle = !_presentationState.Update(inputs);
+	if (_idle) {
+		// 没有呈现的刷新不是丢帧，重新开始统计
+		_frameStatsValid = false;
+		return;
+	}
+
+	// 立即上下文由所有会话共享，绘制一帧期间不能被其他会话打断
+	// Present 前解锁，避免等待垂直同步时阻塞其他会话
+	_deviceResources->LockContext();
+
+	// Present 会解绑后缓冲，其他会话也可能改变了状态，因此每帧从空的状态开始
+	_stateContext.ClearState();
+
+	if (_backBufferClearCount > 0) {
+		--_backBufferClearCount;
+
+		ID3D11RenderTargetView* backBufferRtv = nullptr;
+		if (GetRenderTargetView(_backBuffer.Get(), &backBufferRtv)) {
+			static constexpr FLOAT BLACK[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			_d3dDC->ClearRenderTargetView(backBufferRtv, BLACK);
+		}
+	}
+	// 所有渲染都使用三角形带拓扑
+	_stateContext.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+
 	// 更新常量
 	if (!EffectDrawer::UpdateExprDynamicVars()) {
 		SPDLOG_LOGGER_ERROR(logger, "UpdateExprDynamicVars 失败");
 	}
 
-	if (state == FrameSourceBase::UpdateState::NewFrame) {
-		for (EffectDrawer& effect : _effects) {
-			effect.Draw();
-		}
-	} else {
-		// 此帧内容无变化
-		// 从第一个有动态常量的 Effect 开始渲染
+	// 此帧从哪个 Effect 开始渲染
+	size_t firstEffect = 0;
+	if (state != FrameSourceBase::UpdateState::NewFrame && !_redrawAll) {
+		// 此帧内容无变化，从第一个有动态常量的 Effect 开始渲染
 		// 如果没有则只渲染最后一个 Effect 的最后一个 pass
+		while (firstEffect < _effects.size() && !_effects[firstEffect].HasDynamicConstants()) {
+			++firstEffect;
+		}
+	}
 
-		size_t i = 0;
-		for (; i < _effects.size(); ++i) {
-			if (_effects[i].HasDynamicConstants()) {
-				break;
-			}
+	// 只测量渲染了所有效果的帧，只渲染一部分的帧的用时不能反映效果的开销
+	const bool measureGpuTime = _gpuTimer.IsInitialized() && !_effects.empty() && firstEffect == 0;
+	if (measureGpuTime) {
+		_gpuTimer.Begin(_d3dDC.Get());
+	}
+
+	if (_effects.empty()) {
+		_DrawPassthrough();
+	} else if (firstEffect == 0) {
+		_redrawAll = false;
+		_DrawAllEffects();
+	} else if (firstEffect == _effects.size()) {
+		_effects.back().Draw(true);
+	} else {
+		for (size_t i = firstEffect; i < _effects.size(); ++i) {
+			_effects[i].Draw();
 		}
+	}
 
-		if (i == _effects.size()) {
-			// 只渲染最后一个 Effect 的最后一个 pass
-			_effects.back().Draw(true);
-		} else {
-			for (; i < _effects.size(); ++i) {
-				_effects[i].Draw();
-			}
+	if (measureGpuTime) {
+		_gpuTimer.End(_d3dDC.Get());
+
+		float gpuTime;
+		if (_gpuTimer.GetResult(_d3dDC.Get(), gpuTime)) {
+			AcquireSRWLockExclusive(&_gpuTimeLock);
+			_gpuTimeSum += gpuTime;
+			++_gpuTimeCount;
+			ReleaseSRWLockExclusive(&_gpuTimeLock);
 		}
 	}
 
@@ -600,11 +648,114 @@ void Renderer::_Render() {
 
 	_cursorDrawer.Draw();
 
+	_deviceResources->UnlockContext();
+
 	if (frameRate != 0) {
 		_dxgiSwapChain->Present(0, DXGI_PRESENT_ALLOW_TEARING);
 	} else {
 		_dxgiSwapChain->Present(1, 0);
+
+		if (_gpuTimer.IsInitialized()) {
+			_UpdateDroppedFrames();
+		}
+	}
+	_frameLatencyWaited = false;
+	++_presentedFrameCount;
+}
+
+// 垂直同步时每次刷新都应显示新的一帧，两次统计间刷新的次数多于显示的帧数说明有帧错过了刷新
+void Renderer::_UpdateDroppedFrames() {
+	DXGI_FRAME_STATISTICS stats{};
+	HRESULT hr = _dxgiSwapChain->GetFrameStatistics(&stats);
+	if (FAILED(hr)) {
+		// 交换链不在屏幕上或统计不连续，如 DXGI_ERROR_FRAME_STATISTICS_DISJOINT
+		_frameStatsValid = false;
+		return;
+	}
+
+	if (_frameStatsValid && stats.PresentCount > _lastFrameStats.PresentCount) {
+		const UINT presents = stats.PresentCount - _lastFrameStats.PresentCount;
+		const UINT refreshes = stats.PresentRefreshCount - _lastFrameStats.PresentRefreshCount;
+
+		AcquireSRWLockExclusive(&_gpuTimeLock);
+		_expectedFrameCount += std::max(presents, refreshes);
+		_droppedFrameCount += refreshes > presents ? refreshes - presents : 0;
+		ReleaseSRWLockExclusive(&_gpuTimeLock);
+	}
+
+	_lastFrameStats = stats;
+	_frameStatsValid = true;
+}
+
+void Renderer::_DrawPassthrough() {
+	ID3D11RenderTargetView* backBufferRtv = nullptr;
+	if (!GetRenderTargetView(_backBuffer.Get(), &backBufferRtv)) {
+		SPDLOG_LOGGER_ERROR(logger, "获取 RenderTargetView 失败");
+		return;
+	}
+
+	ID3D11ShaderResourceView* inputSrv = nullptr;
+	if (!GetShaderResourceView(_effectInput.Get(), &inputSrv)) {
+		SPDLOG_LOGGER_ERROR(logger, "获取 ShaderResourceView 失败");
+		return;
+	}
+
+	ID3D11SamplerState* sampler = nullptr;
+	if (!GetSampler(EffectSamplerFilterType::Linear, EffectSamplerAddressType::Clamp, &sampler)) {
+		SPDLOG_LOGGER_ERROR(logger, "GetSampler 失败");
+		return;
 	}
+
+	_stateContext.OMSetRenderTargets(1, &backBufferRtv);
+
+	D3D11_VIEWPORT vp{};
+	vp.TopLeftX = (FLOAT)_passthroughRect.left;
+	vp.TopLeftY = (FLOAT)_passthroughRect.top;
+	vp.Width = FLOAT(_passthroughRect.right - _passthroughRect.left);
+	vp.Height = FLOAT(_passthroughRect.bottom - _passthroughRect.top);
+	vp.MaxDepth = 1.0f;
+	_stateContext.RSSetViewport(vp);
+
+	SetFillVS();
+	SetCopyPS(sampler, inputSrv);
+	_stateContext.Draw(3, 0);
+}
+
+void Renderer::_DrawAllEffects() {
+	if (!_deferredDC) {
+		for (EffectDrawer& effect : _effects) {
+			effect.Draw();
+		}
+		return;
+	}
+
+	// 在立即上下文中更新动态常量，执行命令列表时使用的是最新的值
+	for (EffectDrawer& effect : _effects) {
+		effect.UpdateDynamicConstants();
+	}
+
+	// 每个输入纹理对应一个命令列表，第一次使用时录制
+	ComPtr<ID3D11CommandList>& commandList = _commandLists[_effectInputIndex];
+	if (!commandList) {
+		_curStateContext = &_deferredStateContext;
+		_deferredStateContext.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+		for (EffectDrawer& effect : _effects) {
+			effect.DrawPasses();
+		}
+		_curStateContext = &_stateContext;
+
+		if (!_deferredStateContext.FinishCommandList(commandList)) {
+			SPDLOG_LOGGER_ERROR(logger, "录制命令列表失败");
+			for (EffectDrawer& effect : _effects) {
+				effect.DrawPasses();
+			}
+			return;
+		}
+	}
+
+	_stateContext.ExecuteCommandList(commandList.Get());
+	// 执行后状态被清空
+	_stateContext.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
 }
 
 bool CheckForeground(HWND hwndForeground) {
@@ -700,7 +851,7 @@ bool CheckForeground(HWND hwndForeground) {
 	return false;
 }
 
-bool Renderer::_CheckSrcState() {
+bool Renderer::CheckSrcState() {
 	HWND hwndSrc = App::GetInstance().GetHwndSrc();
 
 	if (!App::GetInstance().IsBreakpointMode()) {
@@ -716,28 +867,92 @@ bool Renderer::_CheckSrcState() {
 		return false;
 	}
 
+	return true;
+}
+
+bool Renderer::IsSrcWndRectChanged() {
 	RECT rect;
-	if (!GetWindowRect(hwndSrc, &rect)) {
-		SPDLOG_LOGGER_ERROR(logger, "GetWindowRect 失败");
+	if (!GetWindowRect(App::GetInstance().GetHwndSrc(), &rect)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("GetWindowRect 失败"));
+		return false;
+	}
+
+	if (rect == _srcWndRect) {
+		_pendingSrcWndRect = rect;
 		return false;
 	}
 
-	if (_srcWndRect != rect) {
-		SPDLOG_LOGGER_INFO(logger, "源窗口位置或大小改变");
+	// 拖动或调整窗口大小时会持续改变，等到两次检查间不再改变时才重新构建
+	if (rect != _pendingSrcWndRect) {
+		_pendingSrcWndRect = rect;
 		return false;
 	}
 
 	return true;
 }
 
-bool Renderer::_ResolveEffectsJson(const std::string& effectsJson, RECT& destRect) {
-	_effectInput = App::GetInstance().GetFrameSource().GetOutput();
-	D3D11_TEXTURE2D_DESC inputDesc;
-	_effectInput->GetDesc(&inputDesc);
+bool Renderer::Rebuild() {
+	assert(!_renderThread.joinable());
 
-	const RECT& hostWndRect = App::GetInstance().GetHostWndRect();
-	SIZE hostSize = { hostWndRect.right - hostWndRect.left,hostWndRect.bottom - hostWndRect.top };
+	if (!GetWindowRect(App::GetInstance().GetHwndSrc(), &_srcWndRect)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("GetWindowRect 失败"));
+		return false;
+	}
+	_pendingSrcWndRect = _srcWndRect;
+
+	RECT destRect;
+	if (!_BuildEffects(destRect)) {
+		SPDLOG_LOGGER_ERROR(logger, "_BuildEffects 失败");
+		return false;
+	}
+
+	// 尺寸改变后特化的常量可能不同，构建时暂时使用通用的着色器，以免在这里编译
+	_CheckSpecialized();
+
+	if (App::GetInstance().IsShowFPS()) {
+		_frameRateDrawer.SetDestRect(destRect);
+	}
+
+	if (!_cursorDrawer.SetDestRect(destRect)) {
+		SPDLOG_LOGGER_ERROR(logger, "CursorDrawer::SetDestRect 失败");
+		return false;
+	}
+
+	// 输出区域可能变小，交换链的每个缓冲区都要清除一次旧的画面
+	_backBufferClearCount = _backBufferCount;
+
+	_presentationState.Invalidate();
+	return true;
+}
+
+// scale 属性中视为 0 的范围
+static constexpr float SCALE_DELTA = 1e-5f;
+
+// 根元素的成员为数组时每个成员是一个效果，从前到后质量由高到低，否则整个 json 是一个效果
+static void SplitQualityLadder(const std::string& effectsJson, std::vector<std::string>& ladder) {
+	ladder.clear();
+
+	rapidjson::Document doc;
+	if (doc.Parse(effectsJson.c_str(), effectsJson.size()).HasParseError()
+		|| !doc.IsArray() || doc.Empty() || !doc[0].IsArray()
+	) {
+		// 出错时由 ParseEffectsJson 报告
+		ladder.push_back(effectsJson);
+		return;
+	}
+
+	for (const auto& effects : doc.GetArray()) {
+		rapidjson::StringBuffer buffer;
+		rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+		effects.Accept(writer);
+		ladder.emplace_back(buffer.GetString(), buffer.GetSize());
+	}
+}
 
+// 解析效果的 json 并初始化每个效果，不使用设备上下文，因此可以在后台线程上调用
+static bool ParseEffectsJson(const std::string& effectsJson, std::vector<EffectDrawer>& effects,
+	std::vector<std::optional<std::pair<float, float>>>& effectScales
+) {
 	rapidjson::Document doc;
 	if (doc.Parse(effectsJson.c_str(), effectsJson.size()).HasParseError()) {
 		// 解析 json 失败
@@ -750,12 +965,9 @@ bool Renderer::_ResolveEffectsJson(const std::string& effectsJson, RECT& destRec
 		return false;
 	}
 
-	std::vector<SIZE> texSizes;
-	texSizes.push_back({ (LONG)inputDesc.Width, (LONG)inputDesc.Height });
-
 	const auto& effectsArr = doc.GetArray();
-	_effects.reserve(effectsArr.Size());
-	texSizes.reserve(static_cast<size_t>(effectsArr.Size()) + 1);
+	effects.reserve(effectsArr.Size());
+	effectScales.reserve(effectsArr.Size());
 
 	// 不得为空
 	if (effectsArr.Empty()) {
@@ -769,7 +981,8 @@ bool Renderer::_ResolveEffectsJson(const std::string& effectsJson, RECT& destRec
 			return false;
 		}
 
-		EffectDrawer& effect = _effects.emplace_back();
+		EffectDrawer& effect = effects.emplace_back();
+		std::optional<std::pair<float, float>>& effectScale = effectScales.emplace_back();
 
 		auto effectName = effectJson.FindMember("effect");
 		if (effectName == effectJson.MemberEnd() || !effectName->value.IsString()) {
@@ -805,38 +1018,17 @@ bool Renderer::_ResolveEffectsJson(const std::string& effectsJson, RECT& destRec
 				float scaleX = scale[0].GetFloat();
 				float scaleY = scale[1].GetFloat();
 
-				static float DELTA = 1e-5f;
-
-				SIZE outputSize = texSizes.back();;
-
-				if (scaleX >= DELTA) {
-					if (scaleY < DELTA) {
-						SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：非法的 scale 属性");
-						return false;
-					}
-
-					outputSize = { std::lroundf(outputSize.cx * scaleX), std::lroundf(outputSize.cy * scaleY) };
-				} else if (std::abs(scaleX) < DELTA) {
-					if (std::abs(scaleY) >= DELTA) {
-						SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：非法的 scale 属性");
-						return false;
-					}
-
-					outputSize = hostSize;
-				} else {
-					if (scaleY > -DELTA) {
-						SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：非法的 scale 属性");
-						return false;
-					}
-
-					float fillScale = std::min(float(hostSize.cx) / outputSize.cx, float(hostSize.cy) / outputSize.cy);
-					outputSize = {
-						std::lroundf(outputSize.cx * fillScale * -scaleX),
-						std::lroundf(outputSize.cy * fillScale * -scaleY)
-					};
+				// 两个值的符号必须相同
+				if ((scaleX >= SCALE_DELTA && scaleY < SCALE_DELTA)
+					|| (std::abs(scaleX) < SCALE_DELTA && std::abs(scaleY) >= SCALE_DELTA)
+					|| (scaleX <= -SCALE_DELTA && scaleY > -SCALE_DELTA)
+				) {
+					SPDLOG_LOGGER_ERROR(logger, "解析 json 失败：非法的 scale 属性");
+					return false;
 				}
 
-				effect.SetOutputSize(outputSize);
+				// 输出尺寸取决于输入和主窗口的尺寸，在 _BuildEffects 中计算
+				effectScale.emplace(scaleX, scaleY);
 			}
 		}
 
@@ -884,6 +1076,52 @@ bool Renderer::_ResolveEffectsJson(const std::string& effectsJson, RECT& destRec
 				}
 			}
 		}
+	}
+
+	return true;
+}
+
+// 效果链的输入尺寸和主窗口的尺寸，它们只在主线程上重新构建时改变
+static void GetChainSizes(SIZE& inputSize, SIZE& hostSize) {
+	D3D11_TEXTURE2D_DESC inputDesc;
+	App::GetInstance().GetFrameSource().GetOutputAt(0)->GetDesc(&inputDesc);
+	inputSize = { (LONG)inputDesc.Width, (LONG)inputDesc.Height };
+
+	const RECT& hostWndRect = App::GetInstance().GetHostWndRect();
+	hostSize = { hostWndRect.right - hostWndRect.left,hostWndRect.bottom - hostWndRect.top };
+}
+
+// 根据效果链的输入尺寸和主窗口的尺寸计算每个效果的输出尺寸，texSizes 的第一项为输入尺寸
+static bool CalcTexSizes(std::vector<EffectDrawer>& effects,
+	const std::vector<std::optional<std::pair<float, float>>>& effectScales,
+	SIZE inputSize, SIZE hostSize, std::vector<SIZE>& texSizes
+) {
+	texSizes.clear();
+	texSizes.reserve(effects.size() + 1);
+	texSizes.push_back(inputSize);
+
+	for (size_t i = 0; i < effects.size(); ++i) {
+		EffectDrawer& effect = effects[i];
+
+		if (effectScales[i].has_value()) {
+			const auto [scaleX, scaleY] = *effectScales[i];
+
+			SIZE outputSize = texSizes.back();
+
+			if (scaleX >= SCALE_DELTA) {
+				outputSize = { std::lroundf(outputSize.cx * scaleX), std::lroundf(outputSize.cy * scaleY) };
+			} else if (std::abs(scaleX) < SCALE_DELTA) {
+				outputSize = hostSize;
+			} else {
+				float fillScale = std::min(float(hostSize.cx) / outputSize.cx, float(hostSize.cy) / outputSize.cy);
+				outputSize = {
+					std::lroundf(outputSize.cx * fillScale * -scaleX),
+					std::lroundf(outputSize.cy * fillScale * -scaleY)
+				};
+			}
+
+			effect.SetOutputSize(outputSize);
+		}
 
 		SIZE& outputSize = texSizes.emplace_back();
 		if (!effect.CalcOutputSize(texSizes[texSizes.size() - 2], outputSize)) {
@@ -892,13 +1130,96 @@ bool Renderer::_ResolveEffectsJson(const std::string& effectsJson, RECT& destRec
 		}
 	}
 
-	if (_effects.size() == 1) {
+	return true;
+}
+
+// 编译每个效果在当前尺寸下特化的着色器，在加载效果的线程上调用，渲染线程构建时无需编译
+static bool SpecializeEffects(std::vector<EffectDrawer>& effects,
+	const std::vector<std::optional<std::pair<float, float>>>& effectScales,
+	SIZE inputSize, SIZE hostSize
+) {
+	std::vector<SIZE> texSizes;
+	if (!CalcTexSizes(effects, effectScales, inputSize, hostSize, texSizes)) {
+		SPDLOG_LOGGER_ERROR(logger, "CalcTexSizes 失败");
+		return false;
+	}
+
+	for (size_t i = 0; i < effects.size(); ++i) {
+		if (!effects[i].Specialize(texSizes[i])) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("特化第 {} 个效果失败", i + 1));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// 在加载效果的线程上验证半精度变体，渲染线程只需使用选择的 Pass 构建
+static bool ValidateHalfPrecisionEffects(std::vector<EffectDrawer>& effects,
+	const std::vector<std::optional<std::pair<float, float>>>& effectScales,
+	SIZE inputSize, SIZE hostSize
+) {
+	std::vector<SIZE> texSizes;
+	if (!CalcTexSizes(effects, effectScales, inputSize, hostSize, texSizes)) {
+		SPDLOG_LOGGER_ERROR(logger, "CalcTexSizes 失败");
+		return false;
+	}
+
+	for (size_t i = 0; i < effects.size(); ++i) {
+		if (!effects[i].ValidateHalfPrecision(texSizes[i])) {
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("验证第 {} 个效果的半精度变体失败", i + 1));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Renderer::_BuildEffects(RECT& destRect) {
+	FrameSourceBase& frameSource = App::GetInstance().GetFrameSource();
+	// 命令列表引用了旧的效果和纹理
+	_commandLists.clear();
+	_effectInput = frameSource.GetOutputAt(0);
+	_effectInputIndex = 0;
+
+	// 提前创建所有输出纹理的视图，渲染时切换输入不会创建新的视图
+	for (UINT i = 1, count = frameSource.GetOutputCount(); i < count; ++i) {
+		ID3D11ShaderResourceView* srv = nullptr;
+		if (!GetShaderResourceView(frameSource.GetOutputAt(i).Get(), &srv)) {
+			SPDLOG_LOGGER_ERROR(logger, "获取 ShaderResourceView 失败");
+			return false;
+		}
+	}
+
+	SIZE inputSize;
+	SIZE hostSize;
+	GetChainSizes(inputSize, hostSize);
+
+	std::vector<SIZE> texSizes;
+	if (!CalcTexSizes(_effects, _effectScales, inputSize, hostSize, texSizes)) {
+		SPDLOG_LOGGER_ERROR(logger, "CalcTexSizes 失败");
+		return false;
+	}
+
+	// 效果数量为 0 或 1 时也要规划，以释放之前的效果链使用的中间纹理
+	_resourcePool.BeginSchedule();
+	// 失败时原来的效果仍在使用之前的纹理
+	Utils::ScopeExit se([this]() {
+		_resourcePool.CancelSchedule();
+	});
+
+	if (_effects.empty()) {
+		// 效果加载完成前将帧源的输出等比缩放到主窗口
+		SIZE inputSize = texSizes.back();
+		float fillScale = std::min(float(hostSize.cx) / inputSize.cx, float(hostSize.cy) / inputSize.cy);
+		texSizes.push_back({ std::lroundf(inputSize.cx * fillScale), std::lroundf(inputSize.cy * fillScale) });
+	} else if (_effects.size() == 1) {
 		if (!_effects.back().Build(_effectInput, _backBuffer)) {
 			SPDLOG_LOGGER_ERROR(logger, "构建效果失败");
 			return false;
 		}
 	} else {
-		// 创建效果间的中间纹理
+		// 效果间的中间纹理只在相邻的两个效果中使用，尺寸相同时隔一个效果即可复用
 		ComPtr<ID3D11Texture2D> curTex = _effectInput;
 
 		D3D11_TEXTURE2D_DESC desc{};
@@ -910,16 +1231,21 @@ bool Renderer::_ResolveEffectsJson(const std::string& effectsJson, RECT& destRec
 		desc.SampleDesc.Quality = 0;
 		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
 
+		// 帧源没有新帧时从第一个有动态常量的效果开始渲染，它的输入在之后的效果渲染时必须保持不变
+		const size_t firstDynamic = std::find_if(_effects.begin(), _effects.end(),
+			[](const EffectDrawer& effect) { return effect.HasDynamicConstants(); }) - _effects.begin();
+
 		assert(texSizes.size() == _effects.size() + 1);
 		for (size_t i = 0, end = _effects.size() - 1; i < end; ++i) {
 			SIZE texSize = texSizes[i + 1];
 			desc.Width = texSize.cx;
 			desc.Height = texSize.cy;
 
-			ComPtr<ID3D11Texture2D> outputTex;
-			HRESULT hr = _d3dDevice->CreateTexture2D(&desc, nullptr, &outputTex);
-			if (FAILED(hr)) {
-				SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateTexture2D 失败", hr));
+			// 由第 i 个效果写入，第 i + 1 个效果读取
+			const UINT lastUse = i + 1 == firstDynamic ? (UINT)end : UINT(i + 1);
+			ComPtr<ID3D11Texture2D> outputTex = _resourcePool.GetTransientTexture(desc, (UINT)i, lastUse);
+			if (!outputTex) {
+				SPDLOG_LOGGER_ERROR(logger, "GetTransientTexture 失败");
 				return false;
 			}
 
@@ -938,87 +1264,361 @@ bool Renderer::_ResolveEffectsJson(const std::string& effectsJson, RECT& destRec
 		}
 	}
 
+	_resourcePool.EndSchedule();
+	_resourcePool.LogFootprint();
+
+	if (_deferredDC) {
+		_commandLists.resize(frameSource.GetOutputCount());
+	}
+
 	SIZE outputSize = texSizes.back();
 	destRect.left = (hostSize.cx - outputSize.cx) / 2;
 	destRect.right = destRect.left + outputSize.cx;
 	destRect.top = (hostSize.cy - outputSize.cy) / 2;
 	destRect.bottom = destRect.top + outputSize.cy;
+	_passthroughRect = destRect;
 
 	return true;
 }
 
-bool Renderer::SetAlphaBlend(bool enable) {
-	if (!enable) {
-		_d3dDC->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+void Renderer::ReloadEffects(const std::string& effectsJson) {
+	SplitQualityLadder(effectsJson, _qualityLadder);
+	if (!_gpuTimer.IsInitialized() && _qualityLadder.size() > 1) {
+		// 未开启自适应质量，只使用质量最高的效果
+		_qualityLadder.resize(1);
+	}
+	_qualityGovernor.Reset((UINT)_qualityLadder.size());
+
+	_StartReload({ _qualityLadder[0] });
+}
+
+void Renderer::CheckEffectFiles() {
+	_CheckReloadResults();
+
+	if (_queuedReload && _reloadThreadDone) {
+		_ReloadRequest request = std::move(*_queuedReload);
+		_queuedReload.reset();
+		_StartReload(std::move(request));
+	}
+
+	if (_respecializeNeeded.exchange(false)) {
+		SPDLOG_LOGGER_INFO(logger, "尺寸已改变，在后台重新特化效果");
+		_StartReload({ _GetCurrentEffectsJson() });
+	}
+
+	if (_effectsChangeNotification != INVALID_HANDLE_VALUE
+		&& WaitForSingleObject(_effectsChangeNotification, 0) == WAIT_OBJECT_0
+	) {
+		// 保存文件时通常连续触发多次通知，等到两次检查间没有新的修改时才重新加载
+		_effectFilesChanged = true;
+
+		if (!FindNextChangeNotification(_effectsChangeNotification)) {
+			SPDLOG_LOGGER_ERROR(logger, MakeWin32ErrorMsg("FindNextChangeNotification 失败"));
+			FindCloseChangeNotification(_effectsChangeNotification);
+			_effectsChangeNotification = INVALID_HANDLE_VALUE;
+		}
+		return;
+	}
+
+	if (_effectFilesChanged) {
+		_effectFilesChanged = false;
+
+		SPDLOG_LOGGER_INFO(logger, "效果文件已修改，重新加载效果");
+		_StartReload({ _GetCurrentEffectsJson(), true });
+	}
+}
+
+const std::string& Renderer::_GetCurrentEffectsJson() const {
+	// 正在切换质量级别时使用切换的目标，否则替换后会撤销切换
+	// 尚未成功加载过效果时使用请求的效果
+	if (_qualityGovernor.IsSwitching() || _effectsJson.empty()) {
+		return _qualityLadder[_qualityGovernor.GetLevel()];
+	}
+	return _effectsJson;
+}
+
+void Renderer::StopReloadThread() {
+	// 编译无法中断，只能等待
+	_queuedReload.reset();
+	if (_reloadThread.joinable()) {
+		_reloadThread.join();
+	}
+}
+
+bool Renderer::_MergeReloadRequest(_ReloadRequest& request, const _ReloadRequest& superseded) {
+	request.filesChanged |= superseded.filesChanged;
+
+	if (!superseded.qualityLevel || request.qualityLevel) {
 		return true;
 	}
-	
-	if (!_alphaBlendState) {
-		D3D11_BLEND_DESC desc{};
-		desc.RenderTarget[0].BlendEnable = TRUE;
-		desc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
-		desc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
-		desc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-		desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
-		desc.RenderTarget[0].BlendOp = desc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-		desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-
-		HRESULT hr = _d3dDevice->CreateBlendState(&desc, &_alphaBlendState);
-		if (FAILED(hr)) {
-			SPDLOG_LOGGER_CRITICAL(logger, MakeComErrorMsg("CreateBlendState 失败", hr));
-			return false;
+
+	if (request.effectsJson == superseded.effectsJson) {
+		// 加载的是同样的效果，由新的请求完成切换
+		request.qualityLevel = superseded.qualityLevel;
+		return true;
+	}
+
+	return false;
+}
+
+void Renderer::_StartReload(_ReloadRequest request) {
+	if (!_reloadThreadDone) {
+		if (_queuedReload && !_MergeReloadRequest(request, *_queuedReload)) {
+			_AddReloadResult(*_queuedReload, false);
 		}
+		_queuedReload = std::move(request);
+		return;
 	}
-	
-	_d3dDC->OMSetBlendState(_alphaBlendState.Get(), nullptr, 0xffffffff);
-	return true;
+
+	if (_reloadThread.joinable()) {
+		_reloadThread.join();
+	}
+
+	SIZE inputSize;
+	SIZE hostSize;
+	GetChainSizes(inputSize, hostSize);
+
+	_reloadThreadDone = false;
+	_reloadThread = std::thread([this, app = App::GetCurrent(), request = std::move(request), inputSize, hostSize]() mutable {
+		App::ThreadScope scope(app);
+		_ReloadThreadProc(std::move(request), inputSize, hostSize);
+	});
 }
 
-bool Renderer::GetSampler(EffectSamplerFilterType filterType, EffectSamplerAddressType addressType, ID3D11SamplerState** result) {
-	ID3D11SamplerState** sampler;
-	D3D11_TEXTURE_ADDRESS_MODE addressMode;
-	D3D11_FILTER filter;
+void Renderer::_ReloadThreadProc(_ReloadRequest request, SIZE inputSize, SIZE hostSize) {
+	std::unique_ptr<_ReloadedEffects> reloaded = std::make_unique<_ReloadedEffects>();
 
-	if (filterType == EffectSamplerFilterType::Linear) {
-		filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-		if (addressType == EffectSamplerAddressType::Clamp) {
-			sampler = _linearClampSampler.GetAddressOf();
-			addressMode = D3D11_TEXTURE_ADDRESS_CLAMP;
-		} else {
-			sampler = _linearWrapSampler.GetAddressOf();
-			addressMode = D3D11_TEXTURE_ADDRESS_WRAP;
+	// 编译的结果已在缓存中时很快
+	bool success = false;
+	int duration = Utils::Measure([&]() {
+		success = ParseEffectsJson(request.effectsJson, reloaded->effects, reloaded->effectScales);
+		if (success && App::GetInstance().IsSpecializeEffectConstants()) {
+			success = SpecializeEffects(reloaded->effects, reloaded->effectScales, inputSize, hostSize);
+		}
+		if (success && App::GetInstance().IsHalfPrecisionEffects()) {
+			success = ValidateHalfPrecisionEffects(reloaded->effects, reloaded->effectScales, inputSize, hostSize);
+		}
+	});
+
+	if (success) {
+		SPDLOG_LOGGER_INFO(logger, fmt::format("后台加载效果用时 {} 毫秒", duration / 1000.0f));
+
+		reloaded->request = std::move(request);
+
+		AcquireSRWLockExclusive(&_reloadLock);
+		// 渲染线程尚未取走的结果已过时
+		if (_reloadedEffects && !_MergeReloadRequest(reloaded->request, _reloadedEffects->request)) {
+			_reloadResults.push_back({ std::move(_reloadedEffects->request), false });
 		}
+		_reloadedEffects = std::move(reloaded);
+		ReleaseSRWLockExclusive(&_reloadLock);
+
+		Wake();
 	} else {
-		filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
-		if (addressType == EffectSamplerAddressType::Clamp) {
-			sampler = _pointClampSampler.GetAddressOf();
-			addressMode = D3D11_TEXTURE_ADDRESS_CLAMP;
+		_AddReloadResult(request, false);
+
+		if (_effectsLoaded) {
+			SPDLOG_LOGGER_ERROR(logger, "加载效果失败，继续使用原来的效果");
 		} else {
-			sampler = _pointWrapSampler.GetAddressOf();
-			addressMode = D3D11_TEXTURE_ADDRESS_WRAP;
+			SPDLOG_LOGGER_CRITICAL(logger, "加载效果失败");
+			_effectsLoadFailed = true;
 		}
 	}
-	
-	if (*sampler) {
-		*result = *sampler;
-		return true;
+
+	_reloadThreadDone = true;
+}
+
+void Renderer::_ApplyReloadedEffects() {
+	AcquireSRWLockExclusive(&_reloadLock);
+	std::unique_ptr<_ReloadedEffects> reloaded = std::move(_reloadedEffects);
+	ReleaseSRWLockExclusive(&_reloadLock);
+
+	if (!reloaded) {
+		return;
+	}
+
+	if (!reloaded->request.filesChanged && _UpdateEffectConstants(reloaded->effects, reloaded->effectScales)) {
+		SPDLOG_LOGGER_INFO(logger, "只有常量改变，已更新常量缓冲区");
+		_OnEffectsReplaced(reloaded->request);
+		_redrawAll = true;
+		_presentationState.Invalidate();
+		return;
 	}
 
-	D3D11_SAMPLER_DESC desc{};
-	desc.Filter = filter;
-	desc.AddressU = addressMode;
-	desc.AddressV = addressMode;
-	desc.AddressW = addressMode;
-	desc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-	desc.MinLOD = 0;
-	desc.MaxLOD = 0;
-	HRESULT hr = _d3dDevice->CreateSamplerState(&desc, sampler);
+	// 交换 vector 不会移动元素，Pass 中保存的指针仍然有效
+	ComPtr<ID3D11Texture2D> oldEffectInput = _effectInput;
+	const UINT oldEffectInputIndex = _effectInputIndex;
+	_effects.swap(reloaded->effects);
+	_effectScales.swap(reloaded->effectScales);
 
-	if (FAILED(hr)) {
-		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("创建 ID3D11SamplerState 出错", hr));
+	RECT destRect;
+	if (!_BuildEffects(destRect)) {
+		for (EffectDrawer& effect : _effects) {
+			effect.ReleaseViews();
+		}
+
+		_effects.swap(reloaded->effects);
+		_effectScales.swap(reloaded->effectScales);
+		_effectInput = std::move(oldEffectInput);
+		_effectInputIndex = oldEffectInputIndex;
+		if (_deferredDC) {
+			_commandLists.resize(App::GetInstance().GetFrameSource().GetOutputCount());
+		}
+
+		if (_effectsLoaded) {
+			SPDLOG_LOGGER_ERROR(logger, "构建新的效果失败，继续使用原来的效果");
+		} else {
+			SPDLOG_LOGGER_CRITICAL(logger, "构建效果失败");
+			_effectsLoadFailed = true;
+		}
+
+		_AddReloadResult(reloaded->request, false);
+		return;
+	}
+
+	_effectsLoaded = true;
+	_OnEffectsReplaced(reloaded->request);
+	// 后台加载期间重新构建过时，特化使用的尺寸已过时
+	_CheckSpecialized();
+
+	// 原来的效果随 reloaded 一起销毁
+	for (EffectDrawer& effect : reloaded->effects) {
+		effect.ReleaseViews();
+	}
+
+	if (App::GetInstance().IsShowFPS()) {
+		_frameRateDrawer.SetDestRect(destRect);
+	}
+
+	if (!_cursorDrawer.SetDestRect(destRect)) {
+		SPDLOG_LOGGER_ERROR(logger, "CursorDrawer::SetDestRect 失败");
+	}
+
+	SPDLOG_LOGGER_INFO(logger, "已替换为新的效果");
+
+	// 输出区域可能变小
+	_backBufferClearCount = _backBufferCount;
+	_redrawAll = true;
+	_presentationState.Invalidate();
+}
+
+void Renderer::_CheckSpecialized() {
+	if (App::GetInstance().IsSpecializeEffectConstants() && std::any_of(_effects.begin(), _effects.end(),
+		[](const EffectDrawer& effect) { return !effect.IsSpecialized(); })
+	) {
+		_respecializeNeeded = true;
+	}
+}
+
+void Renderer::_OnEffectsReplaced(const _ReloadRequest& request) {
+	// 之前测量的是原来的效果
+	AcquireSRWLockExclusive(&_gpuTimeLock);
+	_gpuTimeSum = 0;
+	_gpuTimeCount = 0;
+	_expectedFrameCount = 0;
+	_droppedFrameCount = 0;
+	ReleaseSRWLockExclusive(&_gpuTimeLock);
+
+	_AddReloadResult(request, true);
+}
+
+void Renderer::_AddReloadResult(const _ReloadRequest& request, bool succeeded) {
+	AcquireSRWLockExclusive(&_reloadLock);
+	_reloadResults.push_back({ request, succeeded });
+	ReleaseSRWLockExclusive(&_reloadLock);
+}
+
+void Renderer::_CheckReloadResults() {
+	AcquireSRWLockExclusive(&_reloadLock);
+	std::vector<_ReloadResult> results = std::move(_reloadResults);
+	_reloadResults.clear();
+	ReleaseSRWLockExclusive(&_reloadLock);
+
+	for (_ReloadResult& result : results) {
+		const std::optional<UINT> qualityLevel = result.request.qualityLevel;
+
+		if (result.succeeded) {
+			_effectsJson = std::move(result.request.effectsJson);
+
+			if (qualityLevel) {
+				_qualityGovernor.OnSwitched();
+			} else {
+				// 之前测量的是原来的效果
+				_qualityGovernor.DiscardSamples();
+			}
+		} else if (qualityLevel) {
+			// 立即回到原来的级别，不必等到超时
+			SPDLOG_LOGGER_ERROR(logger, fmt::format("切换到质量级别 {} 失败", *qualityLevel));
+			_qualityGovernor.OnSwitchFailed();
+		}
+	}
+}
+
+void Renderer::CheckQualityLevel() {
+	if (_qualityLadder.size() < 2) {
+		return;
+	}
+
+	AcquireSRWLockExclusive(&_gpuTimeLock);
+	const float gpuTimeSum = _gpuTimeSum;
+	const UINT gpuTimeCount = _gpuTimeCount;
+	const UINT expectedFrameCount = _expectedFrameCount;
+	const UINT droppedFrameCount = _droppedFrameCount;
+	_gpuTimeSum = 0;
+	_gpuTimeCount = 0;
+	_expectedFrameCount = 0;
+	_droppedFrameCount = 0;
+	ReleaseSRWLockExclusive(&_gpuTimeLock);
+
+	// 没有渲染时没有样本
+	if (gpuTimeCount == 0) {
+		return;
+	}
+
+	const float gpuTime = gpuTimeSum / gpuTimeCount;
+	// 不是垂直同步或无法获取统计时没有丢帧的数据
+	const float droppedRatio = expectedFrameCount == 0 ? 0.0f : (float)droppedFrameCount / expectedFrameCount;
+	std::optional<UINT> level = _qualityGovernor.Update(gpuTime, _frameBudget, droppedRatio);
+	if (level) {
+		SPDLOG_LOGGER_INFO(logger, fmt::format("效果的 GPU 用时为 {:.2f} 毫秒，丢帧比例为 {:.1f}%，切换到质量级别 {}",
+			gpuTime, droppedRatio * 100, *level));
+		_StartReload({ _qualityLadder[*level], false, *level });
+	}
+}
+
+bool Renderer::_UpdateEffectConstants(const std::vector<EffectDrawer>& effects,
+	const std::vector<std::optional<std::pair<float, float>>>& effectScales
+) {
+	// 特化时常量已编译进着色器
+	if (App::GetInstance().IsSpecializeEffectConstants() || effects.size() != _effects.size()) {
 		return false;
 	}
 
-	*result = *sampler;
+	for (size_t i = 0; i < effects.size(); ++i) {
+		if (effectScales[i] != _effectScales[i] || !_effects[i].CanCopyConstants(effects[i])) {
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < effects.size(); ++i) {
+		_effects[i].CopyConstants(effects[i]);
+	}
+
+	return true;
+}
+
+bool Renderer::SetAlphaBlend(bool enable) {
+	if (!enable) {
+		_curStateContext->OMSetBlendState(nullptr);
+		return true;
+	}
+	
+	ID3D11BlendState* alphaBlendState;
+	if (!_deviceResources->GetAlphaBlendState(&alphaBlendState)) {
+		SPDLOG_LOGGER_ERROR(logger, "GetAlphaBlendState 失败");
+		return false;
+	}
+	
+	_curStateContext->OMSetBlendState(alphaBlendState);
 	return true;
 }
@@ -6,17 +6,81 @@
 #include <CommonStates.h>
 #include "StepTimer.h"
 #include "Utils.h"
+#include "ResourcePool.h"
+#include "DeviceResources.h"
+#include "PresentationState.h"
+#include "StateTrackingContext.h"
+#include "QualityGovernor.h"
+#include "GpuTimer.h"
+#include <thread>
+#include <atomic>
 
 
 class Renderer {
 public:
+	~Renderer();
+
 	bool Initialize();
 
+	// 效果在后台加载，完成前直接缩放帧源的输出
 	bool InitializeEffectsAndCursor(const std::string& effectsJson);
 
+	// 返回 true 表示一直没能加载效果，应退出全屏。可以在任意线程调用
+	bool IsEffectsLoadFailed() const {
+		return _effectsLoadFailed;
+	}
+
+	// 在独立的渲染线程上循环调用 Render，直到 StopRenderThread
+	bool StartRenderThread();
+
+	// 通知渲染线程退出并等待其结束，未启动时什么也不做
+	void StopRenderThread();
+
+	// 渲染一帧，只能在渲染线程上调用
 	void Render();
 
-	bool GetSampler(EffectSamplerFilterType filterType, EffectSamplerAddressType addressType, ID3D11SamplerState** result);
+	// 检查源窗口的状态，返回 false 表示应退出全屏。在主线程上定期调用
+	bool CheckSrcState();
+
+	// 源窗口的位置或大小改变并已稳定时返回 true。在主线程上定期调用
+	bool IsSrcWndRectChanged();
+
+	// 源窗口的位置或大小改变后重新构建效果，保留设备、着色器和已加载的纹理
+	// 只能在渲染线程停止时调用，调用前帧源应已重新创建
+	bool Rebuild();
+
+	// 全屏期间更换效果。在后台线程上解析和编译，完成后渲染线程在两帧之间替换，失败时继续使用原来的效果
+	// effectsJson 可以是由高到低的多个效果组成的质量阶梯，开启自适应质量时根据 GPU 用时在其中切换
+	// 只能在主线程上调用
+	void ReloadEffects(const std::string& effectsJson);
+
+	// 检查 effects 文件夹中的文件是否被修改，是则重新加载当前的效果。在主线程上定期调用
+	void CheckEffectFiles();
+
+	// 等待后台的加载结束，并丢弃尚未开始的加载
+	void StopReloadThread();
+
+	// 根据这段时间效果的 GPU 用时选择质量阶梯的级别，需要时切换效果。在主线程上定期调用
+	void CheckQualityLevel();
+
+	// 已呈现的帧数，可以在任意线程调用
+	UINT GetPresentedFrameCount() const {
+		return _presentedFrameCount;
+	}
+
+	// 唤醒等待中的渲染线程，可以在任意线程调用
+	void Wake() {
+		SetEvent(_wakeEvent.get());
+	}
+
+	// 设备、着色器对象和从文件加载的纹理由所有会话共享
+	DeviceResources& GetDeviceResources() {
+		return *_deviceResources;
+	}
+
+	bool GetSampler(EffectSamplerFilterType filterType, EffectSamplerAddressType addressType, ID3D11SamplerState** result) {
+		return _deviceResources->GetSampler(filterType, addressType, result);
+	}
 
 	ComPtr<ID3D11Device1> GetD3DDevice() const{
 		return _d3dDevice;
@@ -26,22 +90,33 @@ public:
 		return _d3dDC;
 	}
 
+	// 设置渲染状态应使用此对象而不是直接通过 GetD3DDC，它会省略没有改变状态的调用
+	StateTrackingContext& GetStateContext() {
+		return *_curStateContext;
+	}
+
 	ComPtr<IDXGIDevice1> GetDXGIDevice() const {
-		return _dxgiDevice;
+		return _deviceResources->GetDXGIDevice();
 	}
 
 	ComPtr<IDXGIFactory2> GetDXGIFactory() const {
-		return _dxgiFactory;
+		return _deviceResources->GetDXGIFactory();
 	}
 
 	ComPtr<IDXGIAdapter1> GetGraphicsAdapter() const {
-		return _graphicsAdapter;
+		return _deviceResources->GetGraphicsAdapter();
 	}
 
+	// 视图的缓存由 _viewLock 保护，加载效果的线程验证半精度变体时也会使用
 	bool GetRenderTargetView(ID3D11Texture2D* texture, ID3D11RenderTargetView** result);
 
 	bool GetShaderResourceView(ID3D11Texture2D* texture, ID3D11ShaderResourceView** result);
 
+	bool GetUnorderedAccessView(ID3D11Texture2D* texture, ID3D11UnorderedAccessView** result);
+
+	// 释放缓存的视图，用于即将销毁的临时纹理
+	void ReleaseViews(ID3D11Texture2D* texture);
+
 	bool SetFillVS();
 
 	bool SetSimpleVS(ID3D11Buffer* simpleVB);
@@ -50,6 +125,10 @@ public:
 
 	bool SetAlphaBlend(bool enable);
 
+	ResourcePool& GetResourcePool() {
+		return _resourcePool;
+	}
+
 	StepTimer& GetTimer() {
 		return _timer;
 	}
@@ -59,56 +138,196 @@ public:
 	}
 
 	D3D_FEATURE_LEVEL GetFeatureLevel() const {
-		return _featureLevel;
+		return _deviceResources->GetFeatureLevel();
 	}
 
-	bool CompileShader(bool isVS, std::string_view hlsl, const char* entryPoint,
-		ID3DBlob** blob, const char* sourceName = nullptr, ID3DInclude* include = nullptr);
+	using ShaderType = DeviceResources::ShaderType;
+
+	bool CompileShader(ShaderType type, std::string_view hlsl, const char* entryPoint,
+		ID3DBlob** blob, const char* sourceName = nullptr, ID3DInclude* include = nullptr) {
+		return _deviceResources->CompileShader(type, hlsl, entryPoint, blob, sourceName, include);
+	}
 
 	// 测试 D3D 调试层是否可用
-	static bool IsDebugLayersAvailable();
+	static bool IsDebugLayersAvailable() {
+		return DeviceResources::IsDebugLayersAvailable();
+	}
 
 private:
 	bool _InitD3D();
 
 	bool _CreateSwapChain();
 
-	bool _CheckSrcState();
+	void _RenderThreadProc();
+
+	// 等待下一次渲染的时机：帧延迟等待对象、帧源或光标的唤醒、帧率限制的时间点
+	void _WaitForWakeUp();
+
+	// 加载请求，qualityLevel 不为空表示由 QualityGovernor 发起的切换
+	struct _ReloadRequest {
+		std::string effectsJson;
+		bool filesChanged = false;
+		std::optional<UINT> qualityLevel;
+	};
+
+	// 在主线程上启动后台加载，上一次加载尚未结束时排队
+	void _StartReload(_ReloadRequest request);
+
+	// 特化常量时在这里编译特化的着色器，inputSize 和 hostSize 为启动时效果链的输入和主窗口的尺寸
+	void _ReloadThreadProc(_ReloadRequest request, SIZE inputSize, SIZE hostSize);
+
+	// 新的请求取代了尚未完成的请求，返回 false 表示被取代的质量级别切换失败
+	static bool _MergeReloadRequest(_ReloadRequest& request, const _ReloadRequest& superseded);
+
+	// 在主线程上处理加载请求的结果
+	void _CheckReloadResults();
+
+	// 重新加载当前的效果时使用
+	const std::string& _GetCurrentEffectsJson() const;
+
+	// 在渲染线程上替换为后台加载完成的效果
+	void _ApplyReloadedEffects();
+
+	// 特化常量时检查构建后的效果是否都使用特化的着色器，否则请求在后台重新特化
+	void _CheckSpecialized();
 
-	bool _ResolveEffectsJson(const std::string& effectsJson, RECT& destRect);
+	// 效果被替换或常量被更新后调用
+	void _OnEffectsReplaced(const _ReloadRequest& request);
+
+	// 加载请求成功或失败后调用，可以在任意线程调用
+	void _AddReloadResult(const _ReloadRequest& request, bool succeeded);
+
+	// 新的效果和原来的只有常量不同时直接更新常量，返回 false 表示需要重新构建
+	bool _UpdateEffectConstants(const std::vector<EffectDrawer>& effects,
+		const std::vector<std::optional<std::pair<float, float>>>& effectScales);
+
+	// 根据帧源和主窗口的尺寸计算每个效果的输出尺寸，然后构建所有效果
+	// 没有效果时只计算直接缩放帧源输出的区域
+	bool _BuildEffects(RECT& destRect);
 
 	void _Render();
 
-	RECT _srcWndRect{};
+	// 效果加载完成前使用双线性插值将帧源的输出缩放到后缓冲
+	void _DrawPassthrough();
 
-	D3D_FEATURE_LEVEL _featureLevel = D3D_FEATURE_LEVEL_10_0;
+	// 绘制所有效果，启用了命令列表时录制或执行命令列表
+	void _DrawAllEffects();
 
-	ComPtr<IDXGIFactory2> _dxgiFactory;
-	ComPtr<IDXGIDevice1> _dxgiDevice;
-	ComPtr<IDXGISwapChain2> _dxgiSwapChain;
-	ComPtr<IDXGIAdapter1> _graphicsAdapter;
+	void _UpdateDroppedFrames();
+
+	RECT _srcWndRect{};
+	// 上次检查时源窗口的位置和大小
+	RECT _pendingSrcWndRect{};
+
+	std::shared_ptr<DeviceResources> _deviceResources;
+	// 以下两个取自 _deviceResources
 	ComPtr<ID3D11Device1> _d3dDevice;
 	ComPtr<ID3D11DeviceContext1> _d3dDC;
+	ComPtr<IDXGISwapChain2> _dxgiSwapChain;
+	StateTrackingContext _stateContext;
+	// 录制命令列表时 GetStateContext 返回延迟上下文
+	StateTrackingContext* _curStateContext = &_stateContext;
+
+	// 为空表示不使用命令列表
+	ComPtr<ID3D11DeviceContext1> _deferredDC;
+	StateTrackingContext _deferredStateContext;
+	// 按 _effectInputIndex 索引，重新构建效果时清空
+	std::vector<ComPtr<ID3D11CommandList>> _commandLists;
 
 	Utils::ScopedHandle _frameLatencyWaitableObject = NULL;
 	bool _waitingForNextFrame = false;
-
-	ComPtr<ID3D11SamplerState> _linearClampSampler;
-	ComPtr<ID3D11SamplerState> _pointClampSampler;
-	ComPtr<ID3D11SamplerState> _linearWrapSampler;
-	ComPtr<ID3D11SamplerState> _pointWrapSampler;
-	ComPtr<ID3D11BlendState> _alphaBlendState;
+	// 上次 Present 后是否已等待过 _frameLatencyWaitableObject
+	bool _frameLatencyWaited = false;
+
+	PresentationState _presentationState;
+	UINT _backBufferCount = 0;
+	// 重新构建后还需清除的后缓冲数
+	UINT _backBufferClearCount = 0;
+	// 上一帧内容无变化，没有呈现
+	bool _idle = false;
+	Utils::ScopedHandle _wakeEvent = NULL;
+	// 空闲或等待第一帧时渲染线程由新帧（FrameSourceBase::IsFrameArrivalSignaled）、光标的 WinEvent 和窗口消息唤醒
+	// GDI 和 DwmSharedSurface 没有内容改变的通知，也无法比较内容，它们每帧都报告新帧，从不进入空闲状态
+	// 因此目前只有会唤醒渲染线程的帧源会空闲，超时只是防止遗漏唤醒的保险
+	static constexpr DWORD _IDLE_TIMEOUT = 100;
+	// 不会唤醒渲染线程的帧源空闲时的轮询间隔（毫秒），约为 60Hz 一帧的一半，延迟不超过一帧
+	static constexpr DWORD _IDLE_POLL_INTERVAL = 8;
+
+	std::thread _renderThread;
+	std::atomic<bool> _stopRenderThread = false;
+	std::atomic<UINT> _presentedFrameCount = 0;
+
+	// 后台加载完成的效果，由渲染线程取走
+	struct _ReloadedEffects {
+		std::vector<EffectDrawer> effects;
+		std::vector<std::optional<std::pair<float, float>>> effectScales;
+		// 文件被修改（filesChanged）时即使只有常量不同也要重新构建
+		_ReloadRequest request;
+	};
+
+	// 加载请求的结果，由主线程取走
+	struct _ReloadResult {
+		_ReloadRequest request;
+		bool succeeded = false;
+	};
+
+	std::thread _reloadThread;
+	std::atomic<bool> _reloadThreadDone = true;
+	// 上一次加载尚未结束时排队的加载，只保留最新的一个
+	std::optional<_ReloadRequest> _queuedReload;
+	// 以下两个成员由 _reloadLock 保护
+	std::unique_ptr<_ReloadedEffects> _reloadedEffects;
+	std::vector<_ReloadResult> _reloadResults;
+	SRWLOCK _reloadLock = SRWLOCK_INIT;
+	// 构建后有效果没有使用特化的着色器，即特化时的尺寸已过时，由主线程在后台重新特化
+	std::atomic<bool> _respecializeNeeded = false;
+	// 重新加载后需要渲染所有效果，只在渲染线程上使用
+	bool _redrawAll = false;
+	// 至少成功加载过一次效果，此后加载失败时继续使用原来的效果
+	std::atomic<bool> _effectsLoaded = false;
+	std::atomic<bool> _effectsLoadFailed = false;
+	// 效果加载完成前的输出区域
+	RECT _passthroughRect{};
+
+	// 以下用于自适应质量
+	// 由高到低的效果，只在主线程上使用。未开启自适应质量时只有一个
+	std::vector<std::string> _qualityLadder;
+	QualityGovernor _qualityGovernor;
+	// 每帧的预算（毫秒）
+	float _frameBudget = 0;
+	// 只在渲染线程上使用
+	GpuTimer _gpuTimer;
+	// 渲染线程累计的效果的 GPU 用时和丢帧，由主线程定期取走
+	float _gpuTimeSum = 0;
+	UINT _gpuTimeCount = 0;
+	UINT _expectedFrameCount = 0;
+	UINT _droppedFrameCount = 0;
+	SRWLOCK _gpuTimeLock = SRWLOCK_INIT;
+	// 上次 Present 后的帧统计，只在渲染线程上使用。没有连续呈现时无效
+	DXGI_FRAME_STATISTICS _lastFrameStats{};
+	bool _frameStatsValid = false;
+
+	// 当前使用的效果，替换成功后才更新，只在主线程上使用
+	std::string _effectsJson;
+	// 监视 effects 文件夹
+	HANDLE _effectsChangeNotification = INVALID_HANDLE_VALUE;
+	// 检测到修改后等到不再修改时才重新加载
+	bool _effectFilesChanged = false;
 
 	ComPtr<ID3D11Texture2D> _effectInput;
+	// _effectInput 在帧源输出纹理中的索引
+	UINT _effectInputIndex = 0;
 	ComPtr<ID3D11Texture2D> _backBuffer;
 	std::unordered_map<ID3D11Texture2D*, ComPtr<ID3D11RenderTargetView>> _rtvMap;
 	std::unordered_map<ID3D11Texture2D*, ComPtr<ID3D11ShaderResourceView>> _srvMap;
+	std::unordered_map<ID3D11Texture2D*, ComPtr<ID3D11UnorderedAccessView>> _uavMap;
+	SRWLOCK _viewLock = SRWLOCK_INIT;
+
+	ResourcePool _resourcePool;
 
-	ComPtr<ID3D11VertexShader> _fillVS;
-	ComPtr<ID3D11VertexShader> _simpleVS;
-	ComPtr<ID3D11InputLayout> _simpleIL;
-	ComPtr<ID3D11PixelShader> _copyPS;
 	std::vector<EffectDrawer> _effects;
+	// 和 _effects 一一对应，为效果的 scale 属性，未指定时为空
+	std::vector<std::optional<std::pair<float, float>>> _effectScales;
 
 	CursorDrawer _cursorDrawer;
 	FrameRateDrawer _frameRateDrawer;
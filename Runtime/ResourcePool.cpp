@@ -0,0 +1,178 @@
+#include "pch.h"
+#include "ResourcePool.h"
+#include "App.h"
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+
+void ResourcePool::BeginSchedule() {
+	assert(!_scheduling);
+	_scheduling = true;
+
+	for (auto& [key, textures] : _transientTextures) {
+		for (_TransientTexture& tex : textures) {
+			tex.used = false;
+		}
+	}
+}
+
+void ResourcePool::EndSchedule() {
+	assert(_scheduling);
+	_scheduling = false;
+
+	_ReleaseTextures([](const _TransientTexture& tex) { return !tex.used; });
+
+	for (auto& [key, textures] : _transientTextures) {
+		for (_TransientTexture& tex : textures) {
+			tex.created = false;
+		}
+	}
+}
+
+void ResourcePool::CancelSchedule() {
+	if (!_scheduling) {
+		return;
+	}
+	_scheduling = false;
+
+	_ReleaseTextures([](const _TransientTexture& tex) { return tex.created; });
+
+	// 规划前的所有纹理都在使用中，见 EndSchedule
+	for (auto& [key, textures] : _transientTextures) {
+		for (_TransientTexture& tex : textures) {
+			tex.used = true;
+		}
+	}
+}
+
+template <typename Pred>
+void ResourcePool::_ReleaseTextures(Pred pred) {
+	Renderer& renderer = App::GetInstance().GetRenderer();
+
+	for (auto it = _transientTextures.begin(); it != _transientTextures.end();) {
+		std::vector<_TransientTexture>& textures = it->second;
+		for (const _TransientTexture& tex : textures) {
+			if (pred(tex)) {
+				renderer.ReleaseViews(tex.texture.Get());
+			}
+		}
+		std::erase_if(textures, pred);
+
+		if (textures.empty()) {
+			it = _transientTextures.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+ComPtr<ID3D11Texture2D> ResourcePool::GetTransientTexture(const D3D11_TEXTURE2D_DESC& desc, UINT firstUse, UINT lastUse) {
+	assert(_scheduling && firstUse <= lastUse);
+
+	std::vector<_TransientTexture>& textures = _transientTextures[{ desc.Width, desc.Height, desc.Format, desc.BindFlags }];
+
+	// 复用已不再使用的纹理
+	for (_TransientTexture& tex : textures) {
+		if (!tex.used || tex.lastUse < firstUse) {
+			tex.used = true;
+			tex.lastUse = lastUse;
+			return tex.texture;
+		}
+	}
+
+	ComPtr<ID3D11Texture2D> texture;
+	HRESULT hr = App::GetInstance().GetRenderer().GetD3DDevice()->CreateTexture2D(&desc, nullptr, &texture);
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("CreateTexture2D 失败", hr));
+		return nullptr;
+	}
+
+	textures.push_back({ texture, lastUse, true, true });
+	return texture;
+}
+
+static UINT GetBitsPerPixel(DXGI_FORMAT format) {
+	switch (format) {
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 128;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+		return 64;
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM:
+	case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SNORM:
+	case DXGI_FORMAT_R16_SINT:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+	case DXGI_FORMAT_B5G5R5A1_UNORM:
+		return 16;
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM:
+	case DXGI_FORMAT_R8_SINT:
+	case DXGI_FORMAT_A8_UNORM:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_UNORM:
+		return 8;
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+	default:
+		return 32;
+	}
+}
+
+size_t ResourcePool::GetTextureSize(ID3D11Texture2D* texture) {
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+
+	const UINT bpp = GetBitsPerPixel(desc.Format);
+	size_t size = 0;
+	for (UINT i = 0; i < desc.MipLevels; ++i) {
+		const size_t width = std::max(desc.Width >> i, 1u);
+		const size_t height = std::max(desc.Height >> i, 1u);
+		size += width * height * bpp / 8;
+	}
+
+	return size * desc.ArraySize;
+}
+
+ResourcePool::Footprint ResourcePool::GetFootprint() const {
+	Footprint result;
+
+	for (const auto& [key, textures] : _transientTextures) {
+		for (const _TransientTexture& tex : textures) {
+			++result.transientCount;
+			result.transientSize += GetTextureSize(tex.texture.Get());
+		}
+	}
+
+	App::GetInstance().GetRenderer().GetDeviceResources().GetAssetFootprint(result.assetCount, result.assetSize);
+
+	return result;
+}
+
+void ResourcePool::LogFootprint() const {
+	Footprint footprint = GetFootprint();
+	SPDLOG_LOGGER_INFO(logger, fmt::format("资源池：{} 个临时纹理共 {} KB，{} 个已加载的纹理共 {} KB",
+		footprint.transientCount, footprint.transientSize / 1024, footprint.assetCount, footprint.assetSize / 1024));
+}
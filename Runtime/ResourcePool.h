@@ -0,0 +1,77 @@
+#pragma once
+#include "pch.h"
+
+
+// 渲染器范围内共享的临时纹理：按尺寸、格式和绑定标志复用，使用区间不重叠的请求可以得到同一个纹理
+// 从文件加载的纹理由所有会话共享，见 DeviceResources::GetAsset
+class ResourcePool {
+public:
+	// 开始规划新的效果链，之前分配的临时纹理都可以被复用
+	void BeginSchedule();
+
+	// 释放本次规划中没有用到的临时纹理
+	void EndSchedule();
+
+	// 构建失败时放弃本次规划：释放本次新建的临时纹理，其他纹理仍由原来的效果使用
+	// 已调用 EndSchedule 时什么也不做
+	void CancelSchedule();
+
+	// 获取在第 firstUse 到 lastUse 步（包含）之间使用的纹理
+	// 同一次规划中 firstUse 必须递增
+	ComPtr<ID3D11Texture2D> GetTransientTexture(const D3D11_TEXTURE2D_DESC& desc, UINT firstUse, UINT lastUse);
+
+	struct Footprint {
+		UINT transientCount = 0;
+		size_t transientSize = 0;
+		// 包括其他会话加载的纹理
+		UINT assetCount = 0;
+		size_t assetSize = 0;
+	};
+
+	Footprint GetFootprint() const;
+
+	void LogFootprint() const;
+
+	// 估计的占用字节数
+	static size_t GetTextureSize(ID3D11Texture2D* texture);
+
+private:
+	struct _TransientKey {
+		UINT width;
+		UINT height;
+		DXGI_FORMAT format;
+		UINT bindFlags;
+
+		bool operator==(const _TransientKey& other) const {
+			return width == other.width && height == other.height
+				&& format == other.format && bindFlags == other.bindFlags;
+		}
+	};
+
+	struct _TransientKeyHash {
+		size_t operator()(const _TransientKey& key) const {
+			size_t result = key.width;
+			result = result * 31 + key.height;
+			result = result * 31 + key.format;
+			result = result * 31 + key.bindFlags;
+			return result;
+		}
+	};
+
+	struct _TransientTexture {
+		ComPtr<ID3D11Texture2D> texture;
+		// 本次规划中最后使用的步，used 为 false 时无意义
+		UINT lastUse = 0;
+		bool used = false;
+		// 在本次规划中创建
+		bool created = false;
+	};
+
+	// 释放 pred 为真的临时纹理
+	template <typename Pred>
+	void _ReleaseTextures(Pred pred);
+
+	bool _scheduling = false;
+
+	std::unordered_map<_TransientKey, std::vector<_TransientTexture>, _TransientKeyHash> _transientTextures;
+};
@@ -0,0 +1,263 @@
+#include "pch.h"
+#include "StateTrackingContext.h"
+
+
+extern std::shared_ptr<spdlog::logger> logger;
+
+
+template <typename T, size_t N>
+void StateTrackingContext::_UpdateSlots(_Slots<T, N>& slots, UINT startSlot, UINT numSlots, T* const* values, UINT& start, UINT& count) {
+	assert(startSlot + numSlots <= N);
+
+	// 只重新设置第一个和最后一个改变的槽之间的部分
+	UINT first = numSlots;
+	UINT last = 0;
+	for (UINT i = 0; i < numSlots; ++i) {
+		T* value = values ? values[i] : nullptr;
+		if (slots[startSlot + i].Get() != value) {
+			slots[startSlot + i] = value;
+			first = std::min(first, i);
+			last = i;
+		}
+	}
+
+	if (first == numSlots) {
+		start = startSlot;
+		count = 0;
+		++_stats.elided;
+	} else {
+		start = startSlot + first;
+		count = last - first + 1;
+		++_stats.issued;
+	}
+}
+
+void StateTrackingContext::ClearState() {
+	_d3dDC->ClearState();
+	++_stats.issued;
+
+	_ResetState();
+}
+
+bool StateTrackingContext::FinishCommandList(ComPtr<ID3D11CommandList>& commandList) {
+	HRESULT hr = _d3dDC->FinishCommandList(FALSE, commandList.ReleaseAndGetAddressOf());
+	_ResetState();
+
+	if (FAILED(hr)) {
+		SPDLOG_LOGGER_ERROR(logger, MakeComErrorMsg("FinishCommandList 失败", hr));
+		return false;
+	}
+
+	return true;
+}
+
+void StateTrackingContext::ExecuteCommandList(ID3D11CommandList* commandList) {
+	_d3dDC->ExecuteCommandList(commandList, FALSE);
+	++_stats.issued;
+
+	_ResetState();
+}
+
+void StateTrackingContext::_ResetState() {
+	_topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	_inputLayout = nullptr;
+	_vertexBuffer = nullptr;
+	_vertexStride = 0;
+	_vertexOffset = 0;
+
+	_vertexShader = nullptr;
+	_pixelShader = nullptr;
+	_computeShader = nullptr;
+
+	_psShaderResources = {};
+	_csShaderResources = {};
+	_psSamplers = {};
+	_csSamplers = {};
+	_psConstantBuffers = {};
+	_csConstantBuffers = {};
+	_csUavs = {};
+	_renderTargets = {};
+
+	_blendState = nullptr;
+	_hasViewport = false;
+}
+
+void StateTrackingContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) {
+	if (_topology == topology) {
+		++_stats.elided;
+		return;
+	}
+
+	_topology = topology;
+	_d3dDC->IASetPrimitiveTopology(topology);
+	++_stats.issued;
+}
+
+void StateTrackingContext::IASetInputLayout(ID3D11InputLayout* inputLayout) {
+	if (_inputLayout.Get() == inputLayout) {
+		++_stats.elided;
+		return;
+	}
+
+	_inputLayout = inputLayout;
+	_d3dDC->IASetInputLayout(inputLayout);
+	++_stats.issued;
+}
+
+void StateTrackingContext::IASetVertexBuffer(ID3D11Buffer* buffer, UINT stride, UINT offset) {
+	if (!buffer) {
+		stride = 0;
+		offset = 0;
+	}
+
+	if (_vertexBuffer.Get() == buffer && _vertexStride == stride && _vertexOffset == offset) {
+		++_stats.elided;
+		return;
+	}
+
+	_vertexBuffer = buffer;
+	_vertexStride = stride;
+	_vertexOffset = offset;
+	_d3dDC->IASetVertexBuffers(0, 1, &buffer, &stride, &offset);
+	++_stats.issued;
+}
+
+void StateTrackingContext::VSSetShader(ID3D11VertexShader* shader) {
+	if (_vertexShader.Get() == shader) {
+		++_stats.elided;
+		return;
+	}
+
+	_vertexShader = shader;
+	_d3dDC->VSSetShader(shader, nullptr, 0);
+	++_stats.issued;
+}
+
+void StateTrackingContext::PSSetShader(ID3D11PixelShader* shader) {
+	if (_pixelShader.Get() == shader) {
+		++_stats.elided;
+		return;
+	}
+
+	_pixelShader = shader;
+	_d3dDC->PSSetShader(shader, nullptr, 0);
+	++_stats.issued;
+}
+
+void StateTrackingContext::CSSetShader(ID3D11ComputeShader* shader) {
+	if (_computeShader.Get() == shader) {
+		++_stats.elided;
+		return;
+	}
+
+	_computeShader = shader;
+	_d3dDC->CSSetShader(shader, nullptr, 0);
+	++_stats.issued;
+}
+
+// ComPtr 只包含一个指针，因此记录的状态可以直接作为数组传给 D3D
+void StateTrackingContext::PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView* const* views) {
+	UINT start, count;
+	_UpdateSlots(_psShaderResources, startSlot, numViews, views, start, count);
+	if (count > 0) {
+		_d3dDC->PSSetShaderResources(start, count, _psShaderResources[start].GetAddressOf());
+	}
+}
+
+void StateTrackingContext::CSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView* const* views) {
+	UINT start, count;
+	_UpdateSlots(_csShaderResources, startSlot, numViews, views, start, count);
+	if (count > 0) {
+		_d3dDC->CSSetShaderResources(start, count, _csShaderResources[start].GetAddressOf());
+	}
+}
+
+void StateTrackingContext::PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState* const* samplers) {
+	UINT start, count;
+	_UpdateSlots(_psSamplers, startSlot, numSamplers, samplers, start, count);
+	if (count > 0) {
+		_d3dDC->PSSetSamplers(start, count, _psSamplers[start].GetAddressOf());
+	}
+}
+
+void StateTrackingContext::CSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState* const* samplers) {
+	UINT start, count;
+	_UpdateSlots(_csSamplers, startSlot, numSamplers, samplers, start, count);
+	if (count > 0) {
+		_d3dDC->CSSetSamplers(start, count, _csSamplers[start].GetAddressOf());
+	}
+}
+
+void StateTrackingContext::PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer* const* buffers) {
+	UINT start, count;
+	_UpdateSlots(_psConstantBuffers, startSlot, numBuffers, buffers, start, count);
+	if (count > 0) {
+		_d3dDC->PSSetConstantBuffers(start, count, _psConstantBuffers[start].GetAddressOf());
+	}
+}
+
+void StateTrackingContext::CSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer* const* buffers) {
+	UINT start, count;
+	_UpdateSlots(_csConstantBuffers, startSlot, numBuffers, buffers, start, count);
+	if (count > 0) {
+		_d3dDC->CSSetConstantBuffers(start, count, _csConstantBuffers[start].GetAddressOf());
+	}
+}
+
+void StateTrackingContext::CSSetUnorderedAccessViews(UINT startSlot, UINT numUAVs, ID3D11UnorderedAccessView* const* uavs) {
+	UINT start, count;
+	_UpdateSlots(_csUavs, startSlot, numUAVs, uavs, start, count);
+	if (count > 0) {
+		_d3dDC->CSSetUnorderedAccessViews(start, count, _csUavs[start].GetAddressOf(), nullptr);
+	}
+}
+
+void StateTrackingContext::OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView* const* rtvs) {
+	assert(numViews <= _renderTargets.size());
+
+	bool changed = false;
+	for (UINT i = 0; i < (UINT)_renderTargets.size(); ++i) {
+		ID3D11RenderTargetView* rtv = i < numViews ? rtvs[i] : nullptr;
+		if (_renderTargets[i].Get() != rtv) {
+			_renderTargets[i] = rtv;
+			changed = true;
+		}
+	}
+
+	if (!changed) {
+		++_stats.elided;
+		return;
+	}
+
+	_d3dDC->OMSetRenderTargets(numViews, numViews > 0 ? _renderTargets[0].GetAddressOf() : nullptr, nullptr);
+	++_stats.issued;
+}
+
+void StateTrackingContext::OMSetBlendState(ID3D11BlendState* blendState) {
+	if (_blendState.Get() == blendState) {
+		++_stats.elided;
+		return;
+	}
+
+	_blendState = blendState;
+	_d3dDC->OMSetBlendState(blendState, nullptr, 0xffffffff);
+	++_stats.issued;
+}
+
+void StateTrackingContext::RSSetViewport(const D3D11_VIEWPORT& viewport) {
+	if (_hasViewport && std::memcmp(&_viewport, &viewport, sizeof(viewport)) == 0) {
+		++_stats.elided;
+		return;
+	}
+
+	_hasViewport = true;
+	_viewport = viewport;
+	_d3dDC->RSSetViewports(1, &viewport);
+	++_stats.issued;
+}
+
+void StateTrackingContext::LogStats() const {
+	const UINT64 total = _stats.issued + _stats.elided;
+	SPDLOG_LOGGER_INFO(logger, fmt::format("设备上下文状态：发出 {} 次调用，省略 {} 次（{:.1f}%）",
+		_stats.issued, _stats.elided, total == 0 ? 0.0 : _stats.elided * 100.0 / total));
+}
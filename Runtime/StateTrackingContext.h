@@ -0,0 +1,119 @@
+#pragma once
+#include "pch.h"
+#include <array>
+
+
+// 包装 ID3D11DeviceContext，记录当前绑定的状态，只发出确实改变了状态的调用
+// 渲染器的所有状态设置都应通过此类，否则记录的状态和实际不符
+// 不模拟运行时对读写冲突的处理：将纹理绑定为输出前，调用者必须先解绑作为输入的视图，反之亦然
+class StateTrackingContext {
+public:
+	void Initialize(ComPtr<ID3D11DeviceContext1> d3dDC) {
+		_d3dDC = d3dDC;
+	}
+
+	// 清空设备上下文的状态，外部代码（如 SpriteBatch）直接修改过状态后也应调用
+	void ClearState();
+
+	// 只用于延迟上下文，录制结束后状态被清空
+	bool FinishCommandList(ComPtr<ID3D11CommandList>& commandList);
+
+	// 只用于立即上下文，执行后状态被清空
+	void ExecuteCommandList(ID3D11CommandList* commandList);
+
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+
+	void IASetInputLayout(ID3D11InputLayout* inputLayout);
+
+	// 只使用槽 0，buffer 为 NULL 时解绑
+	void IASetVertexBuffer(ID3D11Buffer* buffer, UINT stride, UINT offset);
+
+	void VSSetShader(ID3D11VertexShader* shader);
+
+	void PSSetShader(ID3D11PixelShader* shader);
+
+	void CSSetShader(ID3D11ComputeShader* shader);
+
+	void PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView* const* views);
+
+	void CSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView* const* views);
+
+	void PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState* const* samplers);
+
+	void CSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState* const* samplers);
+
+	void PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer* const* buffers);
+
+	void CSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer* const* buffers);
+
+	void CSSetUnorderedAccessViews(UINT startSlot, UINT numUAVs, ID3D11UnorderedAccessView* const* uavs);
+
+	// 和 D3D 相同，numViews 之后的槽被解绑。不使用深度模板缓冲区
+	void OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView* const* rtvs);
+
+	void OMSetBlendState(ID3D11BlendState* blendState);
+
+	// 只使用一个视口
+	void RSSetViewport(const D3D11_VIEWPORT& viewport);
+
+	void Draw(UINT vertexCount, UINT startVertexLocation) {
+		_d3dDC->Draw(vertexCount, startVertexLocation);
+	}
+
+	void Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ) {
+		_d3dDC->Dispatch(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+	}
+
+	struct Stats {
+		// 实际发出的调用
+		UINT64 issued = 0;
+		// 因状态没有改变而省略的调用
+		UINT64 elided = 0;
+	};
+
+	const Stats& GetStats() const {
+		return _stats;
+	}
+
+	void LogStats() const;
+
+private:
+	// 记录的状态恢复为默认值
+	void _ResetState();
+
+	template <typename T, size_t N>
+	using _Slots = std::array<ComPtr<T>, N>;
+
+	// 更新记录的状态，返回需要重新设置的区间，count 为 0 表示没有改变
+	template <typename T, size_t N>
+	void _UpdateSlots(_Slots<T, N>& slots, UINT startSlot, UINT numSlots, T* const* values, UINT& start, UINT& count);
+
+	ComPtr<ID3D11DeviceContext1> _d3dDC;
+
+	D3D11_PRIMITIVE_TOPOLOGY _topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	ComPtr<ID3D11InputLayout> _inputLayout;
+	ComPtr<ID3D11Buffer> _vertexBuffer;
+	UINT _vertexStride = 0;
+	UINT _vertexOffset = 0;
+
+	ComPtr<ID3D11VertexShader> _vertexShader;
+	ComPtr<ID3D11PixelShader> _pixelShader;
+	ComPtr<ID3D11ComputeShader> _computeShader;
+
+	_Slots<ID3D11ShaderResourceView, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT> _psShaderResources;
+	_Slots<ID3D11ShaderResourceView, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT> _csShaderResources;
+	_Slots<ID3D11SamplerState, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT> _psSamplers;
+	_Slots<ID3D11SamplerState, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT> _csSamplers;
+	_Slots<ID3D11Buffer, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT> _psConstantBuffers;
+	_Slots<ID3D11Buffer, D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT> _csConstantBuffers;
+	_Slots<ID3D11UnorderedAccessView, D3D11_1_UAV_SLOT_COUNT> _csUavs;
+	_Slots<ID3D11RenderTargetView, D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT> _renderTargets;
+
+	ComPtr<ID3D11BlendState> _blendState;
+
+	// ClearState 后没有视口
+	bool _hasViewport = false;
+	D3D11_VIEWPORT _viewport{};
+
+	Stats _stats;
+};
@@ -92,3 +92,23 @@ void StepTimer::Tick(std::function<void()> render) {
 		m_qpcSecondCounter %= static_cast<uint64_t>(m_qpcFrequency.QuadPart);
 	}
 }
+
+DWORD StepTimer::GetMillisecondsUntilNextFrame() const noexcept {
+	if (!m_isFixedTimeStep) {
+		return 0;
+	}
+
+	LARGE_INTEGER currentTime;
+	QueryPerformanceCounter(&currentTime);
+
+	uint64_t timeDelta = std::min(static_cast<uint64_t>(currentTime.QuadPart - m_qpcLastTime.QuadPart), m_qpcMaxDelta);
+	timeDelta = timeDelta * TicksPerSecond / static_cast<uint64_t>(m_qpcFrequency.QuadPart);
+
+	const uint64_t elapsed = m_leftOverTicks + timeDelta;
+	if (elapsed >= m_targetElapsedTicks) {
+		return 0;
+	}
+
+	// 向下取整，剩余不足 1 毫秒时由 Tick 处理
+	return DWORD((m_targetElapsedTicks - elapsed) * 1000 / TicksPerSecond);
+}
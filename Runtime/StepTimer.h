@@ -26,6 +26,9 @@ public:
 	// Get the current framerate.
 	uint32_t GetFramesPerSecond() const noexcept { return m_framesPerSecond; }
 
+	// 固定帧率时距离下一帧的毫秒数，否则为 0
+	DWORD GetMillisecondsUntilNextFrame() const noexcept;
+
 	// Set whether to use fixed or variable timestep mode.
 	void SetFixedTimeStep(bool isFixedTimestep) noexcept { m_isFixedTimeStep = isFixedTimestep; }
 
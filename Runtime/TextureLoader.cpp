@@ -7,7 +7,7 @@ extern std::shared_ptr<spdlog::logger> logger;
 
 
 ComPtr<ID3D11Texture2D> LoadImg(const wchar_t* fileName) {
-	ComPtr<IWICImagingFactory2> factory = App::GetInstance().GetWICImageFactory();
+	ComPtr<IWICImagingFactory2> factory = App::GetWICImageFactory();
 	if (!factory) {
 		SPDLOG_LOGGER_ERROR(logger, "GetWICImageFactory 失败");
 		return nullptr;
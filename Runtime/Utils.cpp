@@ -80,9 +80,13 @@ bool Utils::WriteFile(const wchar_t* fileName, const void* buffer, size_t buffer
 	}
 
 	size_t writed = fwrite(buffer, 1, bufferSize, hFile);
-	assert(writed == bufferSize);
-
 	fclose(hFile);
+
+	if (writed != bufferSize) {
+		SPDLOG_LOGGER_ERROR(logger, fmt::format("写入文件{}失败", StrUtils::UTF16ToUTF8(fileName)));
+		return false;
+	}
+
 	return true;
 }
 
@@ -187,6 +191,12 @@ bool Utils::Hasher::Initialize() {
 bool Utils::Hasher::Hash(void* data, size_t len, std::vector<BYTE>& result) {
 	result.resize(_hashLen);
 
+	// 所有调用共享同一个可重用的 hash 对象
+	AcquireSRWLockExclusive(&_lock);
+	Utils::ScopeExit se([this]() {
+		ReleaseSRWLockExclusive(&_lock);
+	});
+
 	NTSTATUS status = BCryptHashData(_hHash, (PUCHAR)data, (ULONG)len, 0);
 	if (!NT_SUCCESS(status)) {
 		SPDLOG_LOGGER_ERROR(logger, fmt::format("BCryptCreateHash 失败\n\tNTSTATUS={}", status));
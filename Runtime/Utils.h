@@ -104,6 +104,8 @@ struct Utils {
 		void* _hashObj = nullptr;	// 存储 hash 对象
 		DWORD _hashLen = 0;			// 哈希结果的大小
 		BCRYPT_HASH_HANDLE _hHash = NULL;
+		// Hash 可能在多个线程上调用
+		SRWLOCK _lock = SRWLOCK_INIT;
 	};
 
 	template<typename T>
@@ -39,6 +39,7 @@
 #include <magnification.h>
 #include <d3d11.h>
 #include <d3d11_1.h>
+#include <d3d11_4.h>
 #include <d3dcompiler.h>
 #include <dxgi1_5.h>
 #include <dxgi1_6.h>
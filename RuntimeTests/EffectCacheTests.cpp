@@ -0,0 +1,92 @@
+#include "pch.h"
+#include "Test.h"
+#include "EffectCache.h"
+#include "Utils.h"
+#include "StrUtils.h"
+#include <thread>
+
+
+// 测试使用的源文件名，不需要真实存在
+static constexpr const wchar_t* FILE_NAME = L"effects\\RuntimeTestsCache.hlsl";
+
+// 形如 EffectCompiler::Compile 生成的键：源文件hash_功能级别
+static std::string MakeHash(char sourceHash, D3D_FEATURE_LEVEL featureLevel) {
+	return std::string(Utils::Hasher::GetInstance().GetHashLength() * 2, sourceHash)
+		+ fmt::format("_{:04x}", (UINT)featureLevel);
+}
+
+static std::wstring GetCacheFilePath(std::string_view hash) {
+	return fmt::format(L".\\cache\\RuntimeTestsCache_hlsl_{}.cmfx", StrUtils::UTF8ToUTF16(hash));
+}
+
+TEST(EffectCache_FeatureLevelsAreSeparate) {
+	EffectCache& cache = EffectCache::GetInstance();
+
+	const std::string hash11 = MakeHash('a', D3D_FEATURE_LEVEL_11_0);
+	const std::string hash10 = MakeHash('a', D3D_FEATURE_LEVEL_10_0);
+
+	auto desc11 = std::make_shared<EffectDesc>();
+	auto desc10 = std::make_shared<EffectDesc>();
+
+	cache.Save(FILE_NAME, hash11, desc11);
+	cache.Save(FILE_NAME, hash10, desc10);
+
+	// 内存缓存按功能级别区分
+	CHECK(cache.Load(FILE_NAME, hash11) == desc11);
+	CHECK(cache.Load(FILE_NAME, hash10) == desc10);
+
+	// 同一源文件在两个功能级别下的缓存文件互不覆盖
+	cache.Flush();
+	CHECK(Utils::FileExists(GetCacheFilePath(hash11).c_str()));
+	CHECK(Utils::FileExists(GetCacheFilePath(hash10).c_str()));
+
+	// 源文件改变后两者都被删除
+	const std::string newHash = MakeHash('b', D3D_FEATURE_LEVEL_11_0);
+	cache.Save(FILE_NAME, newHash, std::make_shared<EffectDesc>());
+	cache.Flush();
+	CHECK(!Utils::FileExists(GetCacheFilePath(hash11).c_str()));
+	CHECK(!Utils::FileExists(GetCacheFilePath(hash10).c_str()));
+	CHECK(Utils::FileExists(GetCacheFilePath(newHash).c_str()));
+
+	DeleteFile(GetCacheFilePath(newHash).c_str());
+}
+
+// 多个会话同时结束时 Flush 和其他会话的 Save 并发
+TEST(EffectCache_ConcurrentSaveAndFlush) {
+	static constexpr UINT THREAD_COUNT = 4;
+	static constexpr UINT ITERATIONS = 20;
+
+	EffectCache& cache = EffectCache::GetInstance();
+
+	// 每个线程使用不同的源文件，不会删除彼此的缓存文件
+	std::vector<std::wstring> fileNames;
+	std::vector<std::string> hashes;
+	for (UINT i = 0; i < THREAD_COUNT; ++i) {
+		fileNames.push_back(fmt::format(L"effects\\RuntimeTestsCache{}.hlsl", i));
+		hashes.push_back(MakeHash(char('a' + i), D3D_FEATURE_LEVEL_11_0));
+	}
+
+	std::vector<std::thread> threads;
+	for (UINT i = 0; i < THREAD_COUNT; ++i) {
+		threads.emplace_back([&, i]() {
+			for (UINT j = 0; j < ITERATIONS; ++j) {
+				cache.Save(fileNames[i].c_str(), hashes[i], std::make_shared<EffectDesc>());
+				if (j % 2 == i % 2) {
+					cache.Flush();
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	// 最后一次 Flush 之后不会有遗留在队列中的项
+	cache.Flush();
+	for (UINT i = 0; i < THREAD_COUNT; ++i) {
+		const std::wstring path = fmt::format(L".\\cache\\RuntimeTestsCache{}_hlsl_{}.cmfx",
+			i, StrUtils::UTF8ToUTF16(hashes[i]));
+		CHECK(Utils::FileExists(path.c_str()));
+		DeleteFile(path.c_str());
+	}
+}
@@ -0,0 +1,370 @@
+#include "pch.h"
+#include "Test.h"
+#include "EffectCompiler.h"
+#include "Utils.h"
+
+
+// 解析内存中的源码，只生成 hlsl 不编译
+static UINT Parse(std::string source, std::shared_ptr<const EffectDesc>& desc, std::vector<std::string>& passSources) {
+	return EffectCompiler::CompileSource(std::move(source), desc,
+		EffectCompiler::COMPILE_FLAG_NO_COMPILE, nullptr, &passSources);
+}
+
+static const char* HEADER = R"(//!MAGPIE EFFECT
+//!VERSION 1
+
+//!TEXTURE
+Texture2D INPUT;
+
+//!SAMPLER
+//!FILTER POINT
+SamplerState sam;
+
+)";
+
+static bool Contains(const std::string& source, std::string_view str) {
+	return source.find(str) != std::string::npos;
+}
+
+TEST(Compute_DirectivesAreParsed) {
+	std::shared_ptr<const EffectDesc> desc;
+	std::vector<std::string> passSources;
+	CHECK(Parse(std::string(HEADER) + R"(
+//!PASS 1
+//!COMPUTE
+//!BLOCK_SIZE 16
+//!NUM_THREADS 64
+void Pass1(uint2 blockStart, uint3 threadId) {
+	OUTPUT[blockStart + threadId.xy] = INPUT.SampleLevel(sam, 0, 0);
+}
+)", desc, passSources) == 0);
+	if (!desc) {
+		return;
+	}
+
+	CHECK(desc->passes.size() == 1);
+	const EffectPassDesc& pass = desc->passes[0];
+	CHECK(pass.isCompute);
+	// 省略高度时为正方形，省略的线程维度为 1
+	CHECK(pass.blockSize == std::make_pair(16u, 16u));
+	CHECK(pass.numThreads[0] == 64 && pass.numThreads[1] == 1 && pass.numThreads[2] == 1);
+}
+
+TEST(Compute_RectangularBlockAnd2DThreads) {
+	std::shared_ptr<const EffectDesc> desc;
+	std::vector<std::string> passSources;
+	CHECK(Parse(std::string(HEADER) + R"(
+//!PASS 1
+//!COMPUTE
+//!BLOCK_SIZE 16, 8
+//!NUM_THREADS 8, 8
+void Pass1(uint2 blockStart, uint3 threadId) {
+	OUTPUT[blockStart + threadId.xy] = 0;
+}
+)", desc, passSources) == 0);
+	if (!desc) {
+		return;
+	}
+
+	const EffectPassDesc& pass = desc->passes[0];
+	CHECK(pass.blockSize == std::make_pair(16u, 8u));
+	CHECK(pass.numThreads[0] == 8 && pass.numThreads[1] == 8 && pass.numThreads[2] == 1);
+}
+
+TEST(Compute_CodegenToOutput) {
+	std::shared_ptr<const EffectDesc> desc;
+	std::vector<std::string> passSources;
+	CHECK(Parse(std::string(HEADER) + R"(
+//!PASS 1
+//!COMPUTE
+//!BIND INPUT
+//!BLOCK_SIZE 16, 8
+//!NUM_THREADS 8, 8
+void Pass1(uint2 blockStart, uint3 threadId) {
+	OUTPUT[blockStart + threadId.xy] = INPUT.SampleLevel(sam, 0, 0);
+}
+)", desc, passSources) == 0);
+	CHECK(passSources.size() == 1);
+	if (passSources.size() != 1) {
+		return;
+	}
+
+	const std::string& hlsl = passSources[0];
+	// 没有 SAVE 时输出到 OUTPUT 的 UAV
+	CHECK(Contains(hlsl, "RWTexture2D<float4> OUTPUT:register(u0);"));
+	CHECK(Contains(hlsl, "Texture2D INPUT:register(t0);"));
+	// 每个线程组处理一个块，参数为块的左上角和组内线程 ID
+	CHECK(Contains(hlsl, "[numthreads(8,8,1)]void __M(uint3 tid:SV_GroupThreadID,uint3 gid:SV_GroupID)"
+		"{Pass1(gid.xy*uint2(16,8),tid);}"));
+	CHECK(!Contains(hlsl, "SV_TARGET"));
+}
+
+TEST(Compute_CodegenToSavedTextures) {
+	std::shared_ptr<const EffectDesc> desc;
+	std::vector<std::string> passSources;
+	CHECK(Parse(std::string(HEADER) + R"(
+//!TEXTURE
+//!WIDTH INPUT_WIDTH
+//!HEIGHT INPUT_HEIGHT
+//!FORMAT R16G16B16A16_FLOAT
+Texture2D tex1;
+
+//!TEXTURE
+//!WIDTH INPUT_WIDTH
+//!HEIGHT INPUT_HEIGHT
+//!FORMAT R16G16B16A16_FLOAT
+Texture2D tex2;
+
+//!PASS 1
+//!COMPUTE
+//!SAVE tex1, tex2
+//!BLOCK_SIZE 8
+//!NUM_THREADS 4, 4, 2
+void Pass1(uint2 blockStart, uint3 threadId) {
+	tex1[blockStart + threadId.xy] = 0;
+	tex2[blockStart + threadId.xy] = 1;
+}
+
+//!PASS 2
+//!BIND tex1, tex2
+float4 Pass2(float2 pos) {
+	return tex1.Sample(sam, pos) + tex2.Sample(sam, pos);
+}
+)", desc, passSources) == 0);
+	CHECK(passSources.size() == 2);
+	if (passSources.size() != 2) {
+		return;
+	}
+
+	const std::string& hlsl = passSources[0];
+	CHECK(Contains(hlsl, "RWTexture2D<float4> tex1:register(u0);"));
+	CHECK(Contains(hlsl, "RWTexture2D<float4> tex2:register(u1);"));
+	CHECK(!Contains(hlsl, "RWTexture2D<float4> OUTPUT"));
+	CHECK(Contains(hlsl, "[numthreads(4,4,2)]"));
+	CHECK(Contains(hlsl, "Pass1(gid.xy*uint2(8,8),tid);"));
+
+	// 像素着色器 Pass 的入口不受影响
+	CHECK(Contains(passSources[1], "float4 __M(float4 p:SV_POSITION,float2 c:TEXCOORD):SV_TARGET{return Pass2(c);}"));
+	CHECK(!Contains(passSources[1], "RWTexture2D"));
+}
+
+TEST(Compute_InvalidDirectivesAreRejected) {
+	const char* invalidPasses[] = {
+		// 缺少 BLOCK_SIZE
+		"//!PASS 1\n//!COMPUTE\n//!NUM_THREADS 64\nvoid Pass1(uint2 b, uint3 t) {}\n",
+		// 缺少 NUM_THREADS
+		"//!PASS 1\n//!COMPUTE\n//!BLOCK_SIZE 16\nvoid Pass1(uint2 b, uint3 t) {}\n",
+		// 像素着色器 Pass 不能有 BLOCK_SIZE 和 NUM_THREADS
+		"//!PASS 1\n//!BLOCK_SIZE 16\nfloat4 Pass1(float2 pos) { return 0; }\n",
+		"//!PASS 1\n//!NUM_THREADS 64\nfloat4 Pass1(float2 pos) { return 0; }\n",
+		// 重复的指令
+		"//!PASS 1\n//!COMPUTE\n//!COMPUTE\n//!BLOCK_SIZE 16\n//!NUM_THREADS 64\nvoid Pass1(uint2 b, uint3 t) {}\n",
+		"//!PASS 1\n//!COMPUTE\n//!BLOCK_SIZE 16\n//!BLOCK_SIZE 8\n//!NUM_THREADS 64\nvoid Pass1(uint2 b, uint3 t) {}\n",
+		// 值不能为 0，维度不能超过限制
+		"//!PASS 1\n//!COMPUTE\n//!BLOCK_SIZE 0\n//!NUM_THREADS 64\nvoid Pass1(uint2 b, uint3 t) {}\n",
+		"//!PASS 1\n//!COMPUTE\n//!BLOCK_SIZE 16, 16, 16\n//!NUM_THREADS 64\nvoid Pass1(uint2 b, uint3 t) {}\n",
+		"//!PASS 1\n//!COMPUTE\n//!BLOCK_SIZE 16\n//!NUM_THREADS 1, 1, 1, 1\nvoid Pass1(uint2 b, uint3 t) {}\n",
+		// cs_5_0 的限制
+		"//!PASS 1\n//!COMPUTE\n//!BLOCK_SIZE 16\n//!NUM_THREADS 2048\nvoid Pass1(uint2 b, uint3 t) {}\n",
+		"//!PASS 1\n//!COMPUTE\n//!BLOCK_SIZE 16\n//!NUM_THREADS 1, 1, 65\nvoid Pass1(uint2 b, uint3 t) {}\n",
+		"//!PASS 1\n//!COMPUTE\n//!BLOCK_SIZE 16\n//!NUM_THREADS 64, 32\nvoid Pass1(uint2 b, uint3 t) {}\n",
+		// 不是数字
+		"//!PASS 1\n//!COMPUTE\n//!BLOCK_SIZE 16a\n//!NUM_THREADS 64\nvoid Pass1(uint2 b, uint3 t) {}\n",
+	};
+
+	for (const char* pass : invalidPasses) {
+		std::shared_ptr<const EffectDesc> desc;
+		std::vector<std::string> passSources;
+		if (Parse(std::string(HEADER) + pass, desc, passSources) == 0) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("应解析失败：\n{}", pass));
+		}
+		CHECK(!desc);
+	}
+}
+
+TEST(Pixel_CodegenEntry) {
+	std::shared_ptr<const EffectDesc> desc;
+	std::vector<std::string> passSources;
+	CHECK(Parse(std::string(HEADER) + R"(
+//!PASS 1
+float4 Pass1(float2 pos) {
+	return INPUT.Sample(sam, pos);
+}
+)", desc, passSources) == 0);
+	CHECK(passSources.size() == 1);
+	if (!desc || passSources.size() != 1) {
+		return;
+	}
+
+	CHECK(!desc->passes[0].isCompute);
+	CHECK(Contains(passSources[0], "SamplerState sam:register(s0);"));
+	CHECK(Contains(passSources[0], "float4 __M(float4 p:SV_POSITION,float2 c:TEXCOORD):SV_TARGET{return Pass1(c);}"));
+}
+
+static const char* CONDITION_HEADER = R"(
+//!CONSTANT
+//!DEFAULT 0
+//!MIN 0
+//!MAX 1
+int enabled;
+
+//!CONSTANT
+//!DEFAULT 0.5
+float strength;
+
+//!TEXTURE
+//!WIDTH INPUT_WIDTH
+//!HEIGHT INPUT_HEIGHT
+//!FORMAT R16G16B16A16_FLOAT
+Texture2D tex1;
+
+)";
+
+TEST(Condition_IsParsed) {
+	std::shared_ptr<const EffectDesc> desc;
+	std::vector<std::string> passSources;
+	CHECK(Parse(std::string(HEADER) + CONDITION_HEADER + R"(
+//!PASS 1
+//!BIND INPUT
+//!SAVE tex1
+//!CONDITION enabled
+float4 Pass1(float2 pos) {
+	return INPUT.Sample(sam, pos) * strength;
+}
+
+//!PASS 2
+//!BIND INPUT, tex1
+float4 Pass2(float2 pos) {
+	return enabled ? tex1.Sample(sam, pos) : INPUT.Sample(sam, pos);
+}
+)", desc, passSources) == 0);
+	if (!desc) {
+		return;
+	}
+
+	// 被跳过的 Pass 的输出绑定为空，不会被内联
+	CHECK(desc->passes.size() == 2);
+	if (desc->passes.size() == 2) {
+		CHECK(desc->passes[0].condition == 0);
+		CHECK(desc->passes[1].condition == -1);
+	}
+}
+
+TEST(Condition_InvalidDirectivesAreRejected) {
+	const char* invalidPasses[] = {
+		// 不存在的常量
+		"//!PASS 1\n//!SAVE tex1\n//!CONDITION missing\nfloat4 Pass1(float2 pos) { return 0; }\n"
+		"//!PASS 2\n//!BIND tex1\nfloat4 Pass2(float2 pos) { return tex1.Sample(sam, pos); }\n",
+		// 只能使用 int 类型的常量
+		"//!PASS 1\n//!SAVE tex1\n//!CONDITION strength\nfloat4 Pass1(float2 pos) { return 0; }\n"
+		"//!PASS 2\n//!BIND tex1\nfloat4 Pass2(float2 pos) { return tex1.Sample(sam, pos); }\n",
+		// 缺少常量名
+		"//!PASS 1\n//!SAVE tex1\n//!CONDITION\nfloat4 Pass1(float2 pos) { return 0; }\n"
+		"//!PASS 2\n//!BIND tex1\nfloat4 Pass2(float2 pos) { return tex1.Sample(sam, pos); }\n",
+		// 重复的指令
+		"//!PASS 1\n//!SAVE tex1\n//!CONDITION enabled\n//!CONDITION enabled\nfloat4 Pass1(float2 pos) { return 0; }\n"
+		"//!PASS 2\n//!BIND tex1\nfloat4 Pass2(float2 pos) { return tex1.Sample(sam, pos); }\n",
+		// 最后一个 Pass 必须执行
+		"//!PASS 1\n//!CONDITION enabled\nfloat4 Pass1(float2 pos) { return 0; }\n",
+	};
+
+	for (const char* pass : invalidPasses) {
+		std::shared_ptr<const EffectDesc> desc;
+		std::vector<std::string> passSources;
+		if (Parse(std::string(HEADER) + CONDITION_HEADER + pass, desc, passSources) == 0) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("应解析失败：\n{}", pass));
+		}
+		CHECK(!desc);
+	}
+}
+
+TEST(Condition_SeparableEffectsSkipByDefault) {
+	// 默认在一个 Pass 中计算，水平方向的 Pass 和它的中间纹理不使用
+	for (const wchar_t* fileName : { L"effects\\Lanczos.hlsl", L"effects\\Bicubic.hlsl", L"effects\\SSimDownscaler.hlsl" }) {
+		std::string source;
+		if (!Utils::ReadTextFile(fileName, source)) {
+			// 从 build 文件夹运行时才能找到
+			continue;
+		}
+
+		std::shared_ptr<const EffectDesc> desc;
+		CHECK(EffectCompiler::CompileSource(source, desc, EffectCompiler::COMPILE_FLAG_NO_COMPILE) == 0);
+		if (!desc) {
+			continue;
+		}
+
+		auto it = std::find_if(desc->constants.begin(), desc->constants.end(),
+			[](const EffectConstantDesc& c) { return c.name == "separable"; });
+		CHECK(it != desc->constants.end());
+		if (it == desc->constants.end()) {
+			continue;
+		}
+
+		CHECK(std::get<int>(it->defaultValue) == 0);
+		CHECK(desc->passes[0].condition == int(it - desc->constants.begin()));
+	}
+}
+
+static const char* COPY_PASS = R"(
+//!PASS 1
+//!BIND INPUT
+float4 Pass1(float2 pos) {
+	return INPUT.Sample(sam, pos);
+}
+)";
+
+// 在 HEADER 的 VERSION 指令之后插入指令
+static std::string InsertHeaderDirectives(std::string_view directives) {
+	static constexpr std::string_view VERSION_LINE = "//!VERSION 1\n";
+
+	std::string source(HEADER);
+	source.insert(source.find(VERSION_LINE) + VERSION_LINE.size(), directives);
+	return source + COPY_PASS;
+}
+
+TEST(Halo_IsParsed) {
+	std::shared_ptr<const EffectDesc> desc;
+	std::vector<std::string> passSources;
+	CHECK(Parse(InsertHeaderDirectives("//!HALO 4\n"), desc, passSources) == 0);
+	CHECK(desc && desc->halo == 4);
+
+	// 未指定时不支持分块
+	CHECK(Parse(InsertHeaderDirectives(""), desc, passSources) == 0);
+	CHECK(desc && desc->halo == -1);
+}
+
+TEST(Halo_InvalidDirectivesAreRejected) {
+	const char* invalidDirectives[] = {
+		// 缺少值
+		"//!HALO\n",
+		// 不能为负数
+		"//!HALO -1\n",
+		// 多余的值
+		"//!HALO 2 3\n",
+		// 重复的指令
+		"//!HALO 2\n//!HALO 2\n",
+	};
+
+	for (const char* directives : invalidDirectives) {
+		std::shared_ptr<const EffectDesc> desc;
+		std::vector<std::string> passSources;
+		if (Parse(InsertHeaderDirectives(directives), desc, passSources) == 0) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("应解析失败：\n{}", directives));
+		}
+		CHECK(!desc);
+	}
+}
+
+TEST(Halo_BuiltinEffectsAreParsed) {
+	for (const wchar_t* fileName : { L"effects\\CAS.hlsl", L"effects\\Lanczos.hlsl", L"effects\\FSRCNNX.hlsl", L"effects\\ACNet.hlsl" }) {
+		std::string source;
+		if (!Utils::ReadTextFile(fileName, source)) {
+			// 从 build 文件夹运行时才能找到
+			continue;
+		}
+
+		std::shared_ptr<const EffectDesc> desc;
+		CHECK(EffectCompiler::CompileSource(source, desc, EffectCompiler::COMPILE_FLAG_NO_COMPILE) == 0);
+		CHECK(desc && desc->halo > 0);
+	}
+}
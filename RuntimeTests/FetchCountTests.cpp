@@ -0,0 +1,216 @@
+#include "pch.h"
+#include "Test.h"
+#include "EffectCompiler.h"
+#include "Utils.h"
+#include "StrUtils.h"
+
+
+// 纹理读取指令的静态计数，从编译后的字节码的反汇编中统计
+// 被统计的 Pass 中的循环都已展开，因此等于每个输出像素的读取次数
+struct FetchCounts {
+	// sample 系列
+	UINT samples = 0;
+	// ld 系列
+	UINT loads = 0;
+	// gather4 系列
+	UINT gathers = 0;
+
+	UINT Total() const {
+		return samples + loads + gathers;
+	}
+};
+
+static bool CountFetches(ID3DBlob* cso, FetchCounts& result) {
+	ComPtr<ID3DBlob> disassembly;
+	HRESULT hr = D3DDisassemble(cso->GetBufferPointer(), cso->GetBufferSize(), 0, nullptr, &disassembly);
+	if (FAILED(hr)) {
+		return false;
+	}
+
+	result = {};
+
+	std::string_view text((const char*)disassembly->GetBufferPointer(), disassembly->GetBufferSize());
+	while (!text.empty()) {
+		const size_t end = text.find('\n');
+		std::string_view line = text.substr(0, end);
+		text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+		const size_t start = line.find_first_not_of(" \t");
+		if (start == std::string_view::npos) {
+			continue;
+		}
+		line.remove_prefix(start);
+
+		// 声明以 dcl_ 开头，注释以 // 开头，都不会被计入
+		if (line.starts_with("sample")) {
+			++result.samples;
+		} else if (line.starts_with("gather4")) {
+			++result.gathers;
+		} else if (line.starts_with("ld ") || line.starts_with("ld_")) {
+			++result.loads;
+		}
+	}
+
+	return true;
+}
+
+// 生成 hlsl 后在这里编译并统计每个 Pass 的读取次数，不需要渲染器
+static bool CompileAndCount(std::string source, std::vector<FetchCounts>& result) {
+	std::shared_ptr<const EffectDesc> desc;
+	std::vector<std::string> passSources;
+	if (EffectCompiler::CompileSource(std::move(source), desc,
+		EffectCompiler::COMPILE_FLAG_NO_COMPILE, nullptr, &passSources) != 0
+	) {
+		return false;
+	}
+
+	result.resize(passSources.size());
+	for (size_t i = 0; i < passSources.size(); ++i) {
+		ComPtr<ID3DBlob> cso;
+		HRESULT hr = D3DCompile(passSources[i].data(), passSources[i].size(), nullptr, nullptr, nullptr,
+			"__M", desc->passes[i].isCompute ? "cs_5_0" : "ps_5_0", D3DCOMPILE_ENABLE_STRICTNESS, 0, &cso, nullptr);
+		if (FAILED(hr) || !CountFetches(cso.Get(), result[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void PrintFetchCounts(std::string_view name, const std::vector<FetchCounts>& counts) {
+	for (size_t i = 0; i < counts.size(); ++i) {
+		fmt::print("  {} Pass{}：sample {}，ld {}，gather4 {}\n",
+			name, i + 1, counts[i].samples, counts[i].loads, counts[i].gathers);
+	}
+}
+
+// 第二个 Pass 读取第一个 Pass 的输出的 (2 * radius + 1)^2 邻域中的亮度
+// useTensor 为 false 时每个点 Sample 一次，即 ACNet 和 FSRCNNX 改用 TENSOR 之前的写法
+// 为 true 时使用 TENSOR 生成的 Gather，每次读取 2x2 个点
+static std::string MakeNeighbourhoodEffect(int radius, bool useTensor) {
+	std::string declaration = useTensor ? R"(//!TENSOR
+//!WIDTH INPUT_WIDTH
+//!HEIGHT INPUT_HEIGHT
+//!CHANNELS 3
+//!FORMAT R8G8B8A8_UNORM
+Texture2D yuvTex;)" : R"(//!TEXTURE
+//!WIDTH INPUT_WIDTH
+//!HEIGHT INPUT_HEIGHT
+//!FORMAT B8G8R8A8_UNORM
+Texture2D yuvTex;)";
+
+	// 权重互不相同，编译器无法合并读取
+	std::string body;
+	int weight = 1;
+	if (useTensor) {
+		const int gatherCount = radius + 1;
+		for (int i = 0; i < gatherCount; ++i) {
+			for (int j = 0; j < gatherCount; ++j) {
+				body += fmt::format("\tresult += float4({}, {}, {}, {}) * yuvTex_Gather(0, pos + float2({} * inputPtX, {} * inputPtY));\n",
+					weight, weight + 1, weight + 2, weight + 3, 2 * i - radius + 0.5, 2 * j - radius + 0.5);
+				weight += 4;
+			}
+		}
+	} else {
+		for (int i = -radius; i <= radius; ++i) {
+			for (int j = -radius; j <= radius; ++j) {
+				body += fmt::format("\tresult += float4({}, {}, {}, {}) * yuvTex.Sample(sam, pos + float2({} * inputPtX, {} * inputPtY)).x;\n",
+					weight, weight + 1, weight + 2, weight + 3, i, j);
+				weight += 4;
+			}
+		}
+	}
+
+	return fmt::format(R"(//!MAGPIE EFFECT
+//!VERSION 1
+
+//!CONSTANT
+//!VALUE INPUT_PT_X
+float inputPtX;
+
+//!CONSTANT
+//!VALUE INPUT_PT_Y
+float inputPtY;
+
+//!TEXTURE
+Texture2D INPUT;
+
+{}
+
+//!SAMPLER
+//!FILTER POINT
+SamplerState sam;
+
+//!PASS 1
+//!BIND INPUT
+//!SAVE yuvTex
+
+float4 Pass1(float2 pos) {{
+	return INPUT.Sample(sam, pos);
+}}
+
+//!PASS 2
+//!BIND yuvTex
+
+float4 Pass2(float2 pos) {{
+	float4 result = 0;
+{}	return result;
+}}
+)", declaration, body);
+}
+
+// 3x3 邻域和 ACNet 的 Pass2 相同，5x5 邻域和 FSRCNNX 原来的 Pass2 相同
+TEST(FetchCount_TensorGatherReducesNeighbourhoodFetches) {
+	static constexpr struct {
+		int radius;
+		UINT samplesBefore;
+		UINT gathersAfter;
+	} CASES[] = {
+		{ 1, 9, 4 },
+		{ 2, 25, 9 }
+	};
+
+	for (const auto& c : CASES) {
+		std::vector<FetchCounts> before;
+		std::vector<FetchCounts> after;
+		CHECK(CompileAndCount(MakeNeighbourhoodEffect(c.radius, false), before));
+		CHECK(CompileAndCount(MakeNeighbourhoodEffect(c.radius, true), after));
+		if (before.size() != 2 || after.size() != 2) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("半径为 {} 时编译失败", c.radius));
+			continue;
+		}
+
+		fmt::print("  {0}x{0} 邻域：Sample {1} 次 -> Gather {2} 次\n",
+			2 * c.radius + 1, before[1].Total(), after[1].Total());
+
+		CHECK(before[1].samples == c.samplesBefore && before[1].gathers == 0);
+		CHECK(after[1].gathers == c.gathersAfter && after[1].samples == 0 && after[1].loads == 0);
+	}
+}
+
+// 内置效果的当前读取次数，用于比较修改前后的效果
+TEST(FetchCount_BuiltinEffects) {
+	for (const wchar_t* fileName : { L"effects\\ACNet.hlsl", L"effects\\FSRCNNX.hlsl", L"effects\\FSRCNNX_LineArt.hlsl" }) {
+		std::string source;
+		if (!Utils::ReadTextFile(fileName, source)) {
+			// 从 build 文件夹运行时才能找到
+			continue;
+		}
+
+		std::vector<FetchCounts> counts;
+		CHECK(CompileAndCount(std::move(source), counts));
+		PrintFetchCounts(StrUtils::UTF16ToUTF8(fileName), counts);
+
+		if (counts.size() < 2) {
+			continue;
+		}
+
+		if (std::wstring_view(fileName) == L"effects\\ACNet.hlsl") {
+			// 3x3 的亮度邻域使用 Gather
+			CHECK(counts[1].gathers == 4 && counts[1].samples == 0);
+		} else {
+			// FSRCNNX 的 5x5 亮度邻域从 yuvTex 中 Gather，将 YUV Pass 合并进来需要 25 次 Sample
+			CHECK(counts[1].gathers == 9 && counts[1].samples == 0);
+		}
+	}
+}
@@ -0,0 +1,355 @@
+#include "pch.h"
+#include "Test.h"
+#include "EffectCompiler.h"
+#include "Utils.h"
+
+
+// 输出和中间纹理的尺寸相同，满足内联的尺寸条件
+static const char* HEADER = R"(//!MAGPIE EFFECT
+//!VERSION 1
+//!OUTPUT_WIDTH INPUT_WIDTH
+//!OUTPUT_HEIGHT INPUT_HEIGHT
+
+//!TEXTURE
+Texture2D INPUT;
+
+//!TEXTURE
+//!WIDTH INPUT_WIDTH
+//!HEIGHT INPUT_HEIGHT
+//!FORMAT R16G16B16A16_FLOAT
+Texture2D tex1;
+
+//!SAMPLER
+//!FILTER POINT
+SamplerState sam;
+
+//!SAMPLER
+//!FILTER LINEAR
+SamplerState linearSam;
+
+)";
+
+static const char* PRODUCER = R"(
+//!PASS 1
+//!BIND INPUT
+//!SAVE tex1
+float4 Pass1(float2 pos) {
+	return INPUT.Sample(sam, pos) * 2;
+}
+)";
+
+struct FuseResult {
+	UINT ret = 1;
+	std::shared_ptr<const EffectDesc> desc;
+	std::vector<std::string> passSources;
+
+	bool Fused() const {
+		return ret == 0 && desc && desc->passes.size() == 1;
+	}
+
+	bool NotFused() const {
+		return ret == 0 && desc && desc->passes.size() == 2;
+	}
+};
+
+static FuseResult Fuse(std::string_view passes, std::string_view commons = {}) {
+	FuseResult result;
+	result.ret = EffectCompiler::CompileSource(std::string(HEADER) + std::string(commons) + std::string(passes),
+		result.desc, EffectCompiler::COMPILE_FLAG_NO_COMPILE, nullptr, &result.passSources);
+	return result;
+}
+
+static bool HasTexture(const EffectDesc& desc, std::string_view name) {
+	return std::any_of(desc.textures.begin(), desc.textures.end(),
+		[name](const EffectIntermediateTextureDesc& d) { return d.name == name; });
+}
+
+TEST(FusePasses_SamplesAtPos) {
+	FuseResult r = Fuse(std::string(PRODUCER) + R"(
+//!PASS 2
+//!BIND tex1
+float4 Pass2(float2 pos) {
+	return tex1.Sample(sam, pos) + 1;
+}
+)");
+	CHECK(r.Fused());
+	if (!r.Fused()) {
+		return;
+	}
+
+	const std::string& hlsl = r.passSources[0];
+	// 生产者的代码和读取函数在消费者之前，读取被替换为函数调用
+	CHECK(hlsl.find("float4 Pass1(float2 pos)") < hlsl.find("float4 Pass2(float2 pos)"));
+	CHECK(hlsl.find("float4 __F1(float2 p){float4 v=Pass1(p);return float4(v);}") != std::string::npos);
+	CHECK(hlsl.find("return __F1(pos) + 1;") != std::string::npos);
+	CHECK(hlsl.find("tex1") == std::string::npos);
+
+	// 消费者继承生产者的输入，中间纹理被删除
+	CHECK(!HasTexture(*r.desc, "tex1"));
+	CHECK(r.desc->passes[0].inputs.size() == 1);
+	CHECK(r.desc->textures[r.desc->passes[0].inputs[0]].name == "INPUT");
+}
+
+TEST(FusePasses_MultipleReadsInPassFunction) {
+	FuseResult r = Fuse(std::string(PRODUCER) + R"(
+//!PASS 2
+//!BIND tex1, INPUT
+float4 Pass2(float2 pos) {
+	float4 a = tex1.Sample(sam, pos);
+	float4 b = tex1 . Sample ( sam , pos );
+	return a + b + INPUT.Sample(sam, pos);
+}
+)");
+	CHECK(r.Fused());
+	if (!r.Fused()) {
+		return;
+	}
+
+	CHECK(r.passSources[0].find("float4 a = __F1(pos);") != std::string::npos);
+	CHECK(r.passSources[0].find("float4 b = __F1(pos);") != std::string::npos);
+	// INPUT 不会重复绑定
+	CHECK(r.desc->passes[0].inputs.size() == 1);
+}
+
+TEST(FusePasses_NarrowFormatIsEmulated) {
+	// 内联后应和写入 R8_UNORM 纹理再读取的结果相同
+	FuseResult r = Fuse(std::string(R"(
+//!TEXTURE
+//!WIDTH INPUT_WIDTH
+//!HEIGHT INPUT_HEIGHT
+//!FORMAT R8_UNORM
+Texture2D tex2;
+
+//!PASS 1
+//!BIND INPUT
+//!SAVE tex2
+float4 Pass1(float2 pos) {
+	return INPUT.Sample(sam, pos);
+}
+
+//!PASS 2
+//!BIND tex2
+float4 Pass2(float2 pos) {
+	return tex2.Sample(sam, pos);
+}
+)"));
+	CHECK(r.Fused());
+	if (r.Fused()) {
+		CHECK(r.passSources[0].find("return float4(saturate(v.x),0,0,1);") != std::string::npos);
+	}
+}
+
+TEST(FusePasses_NegativeCases) {
+	struct Case {
+		const char* name;
+		std::string passes;
+		std::string commons;
+	};
+
+	const Case cases[] = {
+		{ "采样位置不是参数", std::string(PRODUCER) + R"(
+//!PASS 2
+//!BIND tex1
+float4 Pass2(float2 pos) {
+	return tex1.Sample(sam, pos + float2(0.001, 0));
+}
+)" },
+		{ "读取邻域", std::string(PRODUCER) + R"(
+//!PASS 2
+//!BIND tex1
+float4 Pass2(float2 pos) {
+	return tex1.Sample(sam, pos) + tex1.Sample(sam, float2(0, 0));
+}
+)" },
+		{ "线性采样", std::string(PRODUCER) + R"(
+//!PASS 2
+//!BIND tex1
+float4 Pass2(float2 pos) {
+	return tex1.Sample(linearSam, pos);
+}
+)" },
+		{ "不是 Sample", std::string(PRODUCER) + R"(
+//!PASS 2
+//!BIND tex1
+float4 Pass2(float2 pos) {
+	return tex1.Load(int3(0, 0, 0));
+}
+)" },
+		{ "修改了参数", std::string(PRODUCER) + R"(
+//!PASS 2
+//!BIND tex1
+float4 Pass2(float2 pos) {
+	pos.x += 0.001;
+	return tex1.Sample(sam, pos);
+}
+)" },
+		{ "在 Pass 函数外读取", std::string(PRODUCER) + R"(
+//!PASS 2
+//!BIND tex1
+float4 Read(float2 pos) {
+	return tex1.Sample(sam, pos);
+}
+float4 Pass2(float2 pos) {
+	return Read(pos);
+}
+)" },
+		{ "名字冲突", std::string(R"(
+//!PASS 1
+//!BIND INPUT
+//!SAVE tex1
+float4 Scale(float4 c) {
+	return c * 2;
+}
+float4 Pass1(float2 pos) {
+	return Scale(INPUT.Sample(sam, pos));
+}
+)") + R"(
+//!PASS 2
+//!BIND tex1
+float4 Scale(float4 c) {
+	return c * 3;
+}
+float4 Pass2(float2 pos) {
+	return Scale(tex1.Sample(sam, pos));
+}
+)" },
+		{ "生产者有宏", std::string(R"(
+//!PASS 1
+//!BIND INPUT
+//!SAVE tex1
+#define K 2
+float4 Pass1(float2 pos) {
+	return INPUT.Sample(sam, pos) * K;
+}
+)") + R"(
+//!PASS 2
+//!BIND tex1
+float4 Pass2(float2 pos) {
+	return tex1.Sample(sam, pos);
+}
+)" },
+		{ "COMMON 引用了中间纹理", std::string(PRODUCER) + R"(
+//!PASS 2
+//!BIND tex1
+float4 Pass2(float2 pos) {
+	return tex1.Sample(sam, pos);
+}
+)", R"(
+//!COMMON
+float4 ReadTex1(float2 pos) {
+	return tex1.Sample(sam, pos);
+}
+
+)" },
+		{ "计算着色器消费者", std::string(PRODUCER) + R"(
+//!PASS 2
+//!BIND tex1
+//!COMPUTE
+//!BLOCK_SIZE 8
+//!NUM_THREADS 64
+void Pass2(uint2 blockStart, uint3 threadId) {
+	OUTPUT[blockStart] = tex1.SampleLevel(sam, 0, 0);
+}
+)" },
+		{ "按条件执行的生产者", R"(
+//!PASS 1
+//!BIND INPUT
+//!SAVE tex1
+//!CONDITION enabled
+float4 Pass1(float2 pos) {
+	return INPUT.Sample(sam, pos) * 2;
+}
+
+//!PASS 2
+//!BIND tex1
+float4 Pass2(float2 pos) {
+	return tex1.Sample(sam, pos);
+}
+)", R"(
+//!CONSTANT
+//!DEFAULT 0
+//!MIN 0
+//!MAX 1
+int enabled;
+
+)" },
+	};
+
+	for (const Case& c : cases) {
+		FuseResult r = Fuse(c.passes, c.commons);
+		if (!r.NotFused()) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("不应内联：{}", c.name));
+		}
+	}
+}
+
+TEST(FusePasses_TwoReaders) {
+	FuseResult r = Fuse(std::string(R"(
+//!TEXTURE
+//!WIDTH INPUT_WIDTH
+//!HEIGHT INPUT_HEIGHT
+//!FORMAT R16G16B16A16_FLOAT
+Texture2D tex2;
+)") + PRODUCER + R"(
+//!PASS 2
+//!BIND tex1
+//!SAVE tex2
+float4 Pass2(float2 pos) {
+	return tex1.Sample(sam, pos);
+}
+
+//!PASS 3
+//!BIND tex1, tex2
+float4 Pass3(float2 pos) {
+	return tex1.Sample(sam, pos) + tex2.Sample(sam, pos);
+}
+)");
+	// tex1 有两个读取者，不能内联；Pass2 可以内联到 Pass3
+	CHECK(r.ret == 0 && r.desc && r.desc->passes.size() == 2);
+	if (r.desc && r.desc->passes.size() == 2) {
+		CHECK(HasTexture(*r.desc, "tex1"));
+		CHECK(!HasTexture(*r.desc, "tex2"));
+	}
+}
+
+TEST(FusePasses_DifferentSize) {
+	FuseResult r = Fuse(std::string(R"(
+//!TEXTURE
+//!WIDTH INPUT_WIDTH * 2
+//!HEIGHT INPUT_HEIGHT * 2
+//!FORMAT R16G16B16A16_FLOAT
+Texture2D tex2;
+
+//!PASS 1
+//!BIND INPUT
+//!SAVE tex2
+float4 Pass1(float2 pos) {
+	return INPUT.Sample(sam, pos);
+}
+
+//!PASS 2
+//!BIND tex2
+float4 Pass2(float2 pos) {
+	return tex2.Sample(sam, pos);
+}
+)"));
+	CHECK(r.NotFused());
+}
+
+TEST(FusePasses_BuiltinEffects) {
+	// FSRCNNX 在邻域中读取 yuvTex，不满足内联的条件
+	for (const wchar_t* fileName : { L"effects\\FSRCNNX.hlsl", L"effects\\FSRCNNX_LineArt.hlsl" }) {
+		std::string source;
+		if (!Utils::ReadTextFile(fileName, source)) {
+			// 从 build 文件夹运行时才能找到
+			continue;
+		}
+
+		std::shared_ptr<const EffectDesc> desc;
+		CHECK(EffectCompiler::CompileSource(source, desc, EffectCompiler::COMPILE_FLAG_NO_COMPILE) == 0);
+		if (desc) {
+			CHECK(desc->passes.size() == 8);
+			CHECK(HasTexture(*desc, "yuvTex"));
+		}
+	}
+}
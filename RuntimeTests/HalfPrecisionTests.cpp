@@ -0,0 +1,93 @@
+#include "pch.h"
+#include "Test.h"
+#include "EffectDrawer.h"
+#include "GpuEffectChain.h"
+#include "Utils.h"
+#include "StrUtils.h"
+
+
+TEST(HalfPrecision_CalcPSNR) {
+	std::vector<BYTE> a;
+	GenerateReferenceImage(2, 64, 48, a);
+
+	CHECK(std::isinf(CalcPSNR(a, a)));
+
+	// Alpha 通道不参与比较
+	std::vector<BYTE> b = a;
+	for (size_t i = 3; i < b.size(); i += 4) {
+		b[i] = ~b[i];
+	}
+	CHECK(std::isinf(CalcPSNR(a, b)));
+
+	// 每个 RGB 分量都相差 1 时 MSE 为 1，PSNR 为 20 * log10(255)
+	for (size_t i = 0; i < b.size(); ++i) {
+		if (i % 4 != 3) {
+			b[i] = a[i] < 255 ? a[i] + 1 : a[i] - 1;
+		}
+	}
+	CHECK_NEAR(CalcPSNR(a, b), 48.1308, 1e-3);
+}
+
+// 在参考图像上依次执行效果，输出拼接在一起
+static bool RenderReferenceImages(const GpuEffectChain& chain, UINT width, UINT height, std::vector<BYTE>& result) {
+	result.clear();
+
+	std::vector<BYTE> input;
+	std::vector<BYTE> output;
+	for (UINT i = 0; i < REFERENCE_IMAGE_COUNT; ++i) {
+		GenerateReferenceImage(i, width, height, input);
+
+		SIZE outputSize{};
+		if (!chain.Process(input.data(), width, height, width * 4, output, outputSize)) {
+			return false;
+		}
+
+		result.insert(result.end(), output.begin(), output.end());
+	}
+
+	return true;
+}
+
+// 和 EffectDrawer 验证半精度变体的方式相同：在参考图像上比较全精度和半精度的输出
+// WARP 和部分显卡会以全精度执行 min16float，此时 PSNR 为无穷大。找不到效果文件或无法创建设备时跳过
+TEST(HalfPrecision_PassesOnReferenceImages) {
+	if (!DeviceResources::Get(0)) {
+		return;
+	}
+
+	constexpr UINT WIDTH = 128;
+	constexpr UINT HEIGHT = 96;
+
+	for (const char* effectName : { "ACNet", "FSRCNNX" }) {
+		if (!Utils::FileExists((L"effects\\" + StrUtils::UTF8ToUTF16(effectName) + L".hlsl").c_str())) {
+			// 从 build 文件夹运行时才能找到
+			continue;
+		}
+
+		const std::string json = fmt::format(R"([{{"effect":"{}"}}])", effectName);
+
+		GpuEffectChain fullChain;
+		GpuEffectChain halfChain;
+		if (!fullChain.Initialize(json, 0) || !halfChain.Initialize(json, 0, true)) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("初始化 {} 失败", effectName));
+			continue;
+		}
+
+		std::vector<BYTE> fullResult;
+		std::vector<BYTE> halfResult;
+		if (!RenderReferenceImages(fullChain, WIDTH, HEIGHT, fullResult)
+			|| !RenderReferenceImages(halfChain, WIDTH, HEIGHT, halfResult)
+			|| fullResult.size() != halfResult.size()
+		) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("{} 处理参考图像失败", effectName));
+			continue;
+		}
+
+		const double psnr = CalcPSNR(fullResult, halfResult);
+		fmt::print("  {} 半精度变体的 PSNR：{:.2f} dB\n", effectName, psnr);
+
+		if (psnr < EffectDrawer::HALF_PRECISION_MIN_PSNR) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("{} 半精度变体的 PSNR 过低：{:.2f} dB", effectName, psnr));
+		}
+	}
+}
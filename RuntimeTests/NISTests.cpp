@@ -0,0 +1,93 @@
+#include "pch.h"
+#include "Test.h"
+#include "CpuEffectChain.h"
+#include "GpuEffectChain.h"
+#include "Utils.h"
+
+
+// 带有平滑渐变、硬边缘和细线的测试图像，B8G8R8A8
+static std::vector<BYTE> CreateTestImage(UINT width, UINT height) {
+	std::vector<BYTE> result(size_t(width) * height * 4);
+	for (UINT y = 0; y < height; ++y) {
+		for (UINT x = 0; x < width; ++x) {
+			BYTE* pixel = &result[(size_t(y) * width + x) * 4];
+			const bool checker = ((x / 16) + (y / 16)) % 2 == 0;
+			const bool line = (x + y) % 23 == 0;
+			pixel[0] = BYTE(x * 255 / (width - 1));
+			pixel[1] = line ? 255 : (checker ? 200 : 40);
+			pixel[2] = BYTE(y * 255 / (height - 1));
+			pixel[3] = 255;
+		}
+	}
+	return result;
+}
+
+// 相同的 NIS 参数下 CpuNIS 和 NIS.hlsl 的输出只有舍入误差
+// 在第一个显卡上执行，没有显卡时使用 WARP。找不到效果文件时跳过
+TEST(NIS_CpuMatchesGpu) {
+	if (!Utils::FileExists(L"effects\\NIS.hlsl")) {
+		// 从 build 文件夹运行时才能找到
+		Test::ReportSkip("找不到 effects\\NIS.hlsl");
+		return;
+	}
+
+	if (!DeviceResources::Get(0)) {
+		// 总是可以回落到 WARP，无法创建设备是错误
+		Test::ReportFailure(__FILE__, __LINE__, "创建 D3D 设备失败");
+		return;
+	}
+
+	constexpr UINT WIDTH = 160;
+	constexpr UINT HEIGHT = 120;
+	const std::vector<BYTE> input = CreateTestImage(WIDTH, HEIGHT);
+
+	CpuImage cpuInput;
+	CHECK(CpuImageUtils::FromBGRA8(input.data(), WIDTH, HEIGHT, WIDTH * 4, cpuInput));
+
+	for (float scale : { 2.0f, 1.5f, 0.75f }) {
+		const std::string json = fmt::format(R"([{{"effect":"NIS","scale":[{0},{0}],"sharpness":0.5}}])", scale);
+
+		CpuEffectChain cpuChain;
+		GpuEffectChain gpuChain;
+		if (!cpuChain.Initialize(json) || !gpuChain.Initialize(json, 0)) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("{} 倍时初始化效果链失败", scale));
+			continue;
+		}
+
+		CpuImage cpuOutput;
+		CHECK(cpuChain.Process(cpuInput, cpuOutput));
+
+		std::vector<BYTE> gpuOutput;
+		SIZE gpuOutputSize{};
+		CHECK(gpuChain.Process(input.data(), WIDTH, HEIGHT, WIDTH * 4, gpuOutput, gpuOutputSize));
+
+		const UINT outputWidth = cpuOutput.GetWidth();
+		const UINT outputHeight = cpuOutput.GetHeight();
+		CHECK(outputWidth == UINT(WIDTH * scale) && outputHeight == UINT(HEIGHT * scale));
+		if (gpuOutputSize.cx != (LONG)outputWidth || gpuOutputSize.cy != (LONG)outputHeight) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("{} 倍时输出尺寸不同", scale));
+			continue;
+		}
+
+		std::vector<BYTE> cpuPixels(size_t(outputWidth) * outputHeight * 4);
+		CpuImageUtils::ToBGRA8(cpuOutput, cpuPixels.data(), outputWidth * 4);
+
+		// 只比较 RGB。边缘图和系数都和 GPU 一样是半精度，只剩运算顺序和 UNORM 转换的舍入误差，最多相差 1 级
+		int maxDiff = 0;
+		UINT diffCount = 0;
+		for (size_t i = 0; i < cpuPixels.size(); i += 4) {
+			for (size_t c = 0; c < 3; ++c) {
+				const int diff = std::abs((int)cpuPixels[i + c] - (int)gpuOutput[i + c]);
+				maxDiff = std::max(maxDiff, diff);
+				if (diff > 1) {
+					++diffCount;
+				}
+			}
+		}
+
+		if (maxDiff > 1) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("{} 倍时 CPU 和 GPU 的输出相差过大：最大 {}，{} 个分量超过 1",
+				scale, maxDiff, diffCount));
+		}
+	}
+}
@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "Test.h"
+#include "PresentationState.h"
+
+
+static const HCURSOR CURSOR1 = (HCURSOR)(INT_PTR)1;
+static const HCURSOR CURSOR2 = (HCURSOR)(INT_PTR)2;
+
+// 返回已呈现过一次 inputs 的状态
+static PresentationState Presented(const PresentationState::Inputs& inputs) {
+	PresentationState state;
+	state.Update(inputs);
+	return state;
+}
+
+TEST(PresentationState_FirstFrameIsPresented) {
+	PresentationState state;
+	CHECK(state.Update({}));
+	CHECK(!state.Update({}));
+}
+
+TEST(PresentationState_NewFrame) {
+	PresentationState state = Presented({});
+
+	PresentationState::Inputs inputs;
+	inputs.newFrame = true;
+	CHECK(state.Update(inputs));
+	CHECK(state.Update(inputs));
+	CHECK(!state.Update({}));
+}
+
+TEST(PresentationState_DynamicConstants) {
+	PresentationState::Inputs inputs;
+	inputs.hasDynamicConstants = true;
+	PresentationState state = Presented(inputs);
+
+	// 每帧的输出都可能不同
+	CHECK(state.Update(inputs));
+	CHECK(state.Update(inputs));
+}
+
+TEST(PresentationState_Cursor) {
+	PresentationState::Inputs inputs;
+	inputs.cursor = CURSOR1;
+	inputs.cursorPos = { 10, 20 };
+	PresentationState state = Presented(inputs);
+	CHECK(!state.Update(inputs));
+
+	// 移动
+	inputs.cursorPos = { 11, 20 };
+	CHECK(state.Update(inputs));
+	CHECK(!state.Update(inputs));
+
+	// 形状改变
+	inputs.cursor = CURSOR2;
+	CHECK(state.Update(inputs));
+	CHECK(!state.Update(inputs));
+
+	// 隐藏
+	inputs.cursor = NULL;
+	CHECK(state.Update(inputs));
+
+	// 不可见时移动无需呈现
+	inputs.cursorPos = { 100, 200 };
+	CHECK(!state.Update(inputs));
+
+	// 在新位置重新显示
+	inputs.cursor = CURSOR2;
+	CHECK(state.Update(inputs));
+	CHECK(!state.Update(inputs));
+}
+
+TEST(PresentationState_OverlayText) {
+	PresentationState::Inputs inputs;
+	inputs.overlayText = "60 FPS";
+	PresentationState state = Presented(inputs);
+	CHECK(!state.Update(inputs));
+
+	inputs.overlayText = "59 FPS";
+	CHECK(state.Update(inputs));
+	CHECK(!state.Update(inputs));
+
+	// 关闭叠加层
+	inputs.overlayText.clear();
+	CHECK(state.Update(inputs));
+}
+
+TEST(PresentationState_Invalidate) {
+	PresentationState state = Presented({});
+
+	state.Invalidate();
+	CHECK(state.Update({}));
+	CHECK(!state.Update({}));
+
+	// 多次失效只强制呈现一次
+	state.Invalidate();
+	state.Invalidate();
+	CHECK(state.Update({}));
+	CHECK(!state.Update({}));
+}
+
+TEST(PresentationState_UnchangedInputsAfterChange) {
+	PresentationState::Inputs inputs;
+	inputs.cursor = CURSOR1;
+	PresentationState state = Presented(inputs);
+
+	// 记录的是最后一次呈现的状态，回到原来的位置也要呈现
+	PresentationState::Inputs moved = inputs;
+	moved.cursorPos = { 5, 5 };
+	CHECK(state.Update(moved));
+	CHECK(state.Update(inputs));
+	CHECK(!state.Update(inputs));
+}
+
+// 帧源没有新帧（NoUpdate）时只有光标等改变才呈现
+TEST(PresentationState_NoNewFrame) {
+	PresentationState::Inputs inputs;
+	inputs.newFrame = true;
+	inputs.cursor = CURSOR1;
+	PresentationState state = Presented(inputs);
+
+	// 窗口内容静止
+	inputs.newFrame = false;
+	CHECK(!state.Update(inputs));
+	CHECK(!state.Update(inputs));
+
+	// 只有光标移动
+	inputs.cursorPos = { 1, 2 };
+	CHECK(state.Update(inputs));
+	CHECK(!state.Update(inputs));
+
+	// 只有光标形状改变
+	inputs.cursor = CURSOR2;
+	CHECK(state.Update(inputs));
+	CHECK(!state.Update(inputs));
+}
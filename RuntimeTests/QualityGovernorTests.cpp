@@ -0,0 +1,253 @@
+#include "pch.h"
+#include "Test.h"
+#include "QualityGovernor.h"
+
+
+// 使用默认选项：窗口 10 个样本，切换后丢弃 5 个样本，升级前等待 8 个窗口
+static constexpr float BUDGET = 16;
+static constexpr UINT SETTLE = 5;
+static constexpr UINT WINDOW = 10;
+static constexpr UINT UP_WINDOWS = 8;
+
+struct Switch {
+	UINT level;
+	// 发起切换的样本的序号，从 1 开始
+	UINT sample;
+};
+
+// 模拟一段 GPU 用时的轨迹，遇到切换时停止，返回切换的级别
+template <typename F>
+static std::optional<Switch> Feed(QualityGovernor& governor, UINT count, F&& trace) {
+	for (UINT i = 1; i <= count; ++i) {
+		const auto [gpuTime, dropped] = trace(i);
+		std::optional<UINT> level = governor.Update(gpuTime, BUDGET, dropped);
+		if (level) {
+			return Switch{ *level, i };
+		}
+	}
+	return std::nullopt;
+}
+
+static std::optional<Switch> FeedConstant(QualityGovernor& governor, UINT count, float gpuTime, float dropped = 0) {
+	return Feed(governor, count, [&](UINT) { return std::make_pair(gpuTime, dropped); });
+}
+
+// 超出预算时每次降一级，切换完成前不再发起切换
+TEST(QualityGovernor_StepsDownWhenOverBudget) {
+	QualityGovernor governor;
+	governor.Reset(3);
+
+	std::optional<Switch> s = FeedConstant(governor, 1000, 15);
+	CHECK(s && s->level == 1 && s->sample == SETTLE + WINDOW);
+	CHECK(governor.GetLevel() == 1);
+
+	// 切换尚未完成
+	CHECK(!FeedConstant(governor, 100, 15));
+
+	governor.OnSwitched();
+	s = FeedConstant(governor, 1000, 15);
+	CHECK(s && s->level == 2 && s->sample == SETTLE + WINDOW);
+
+	// 已是最低的级别
+	governor.OnSwitched();
+	CHECK(!FeedConstant(governor, 1000, 15));
+	CHECK(governor.GetLevel() == 2);
+}
+
+TEST(QualityGovernor_UsesWindowAverage) {
+	QualityGovernor governor;
+	governor.Reset(2);
+
+	// 尖峰被平均掉
+	std::optional<Switch> s = Feed(governor, 1000, [](UINT i) {
+		return std::make_pair(i % WINDOW == 0 ? 40.0f : 8.0f, 0.0f);
+	});
+	CHECK(!s);
+
+	// 交替的 20 和 6 平均为 13，超过预算的 80%
+	governor.Reset(2);
+	s = Feed(governor, 1000, [](UINT i) {
+		return std::make_pair(i % 2 ? 20.0f : 6.0f, 0.0f);
+	});
+	CHECK(s && s->level == 1);
+}
+
+TEST(QualityGovernor_DiscardsSamplesAfterSwitch) {
+	QualityGovernor governor;
+	governor.Reset(2);
+
+	// 新效果预热时的样本被丢弃
+	std::optional<Switch> s = Feed(governor, SETTLE + WINDOW, [](UINT i) {
+		return std::make_pair(i <= SETTLE ? 100.0f : 8.0f, 0.0f);
+	});
+	CHECK(!s);
+	CHECK(governor.GetLevel() == 0);
+}
+
+// 在升级和降级的阈值之间不切换
+TEST(QualityGovernor_Hysteresis) {
+	QualityGovernor governor;
+	governor.Reset(3);
+	CHECK(FeedConstant(governor, 1000, 15));
+	governor.OnSwitched();
+
+	CHECK(!FeedConstant(governor, 10000, BUDGET * 0.6f));
+	CHECK(governor.GetLevel() == 1);
+}
+
+TEST(QualityGovernor_StepsUpWithHeadroom) {
+	QualityGovernor governor;
+	governor.Reset(3);
+	CHECK(FeedConstant(governor, 1000, 15));
+	governor.OnSwitched();
+
+	std::optional<Switch> s = FeedConstant(governor, 1000, BUDGET * 0.2f);
+	CHECK(s && s->level == 0 && s->sample == SETTLE + WINDOW * UP_WINDOWS);
+
+	// 有余量的窗口必须连续
+	governor.Reset(3);
+	CHECK(FeedConstant(governor, 1000, 15));
+	governor.OnSwitched();
+	s = Feed(governor, 1000, [](UINT i) {
+		// 第 4 个窗口没有余量
+		const bool busy = i > SETTLE + WINDOW * 3 && i <= SETTLE + WINDOW * 4;
+		return std::make_pair(busy ? BUDGET * 0.6f : BUDGET * 0.2f, 0.0f);
+	});
+	CHECK(s && s->level == 0 && s->sample == SETTLE + WINDOW * (4 + UP_WINDOWS));
+}
+
+// 升级后很快又超出预算时，下次等待的时间加倍
+TEST(QualityGovernor_FailedProbeDoublesWait) {
+	QualityGovernor governor;
+	governor.Reset(2);
+	CHECK(FeedConstant(governor, 1000, 15));
+	governor.OnSwitched();
+
+	UINT upWindows = UP_WINDOWS;
+	for (int i = 0; i < 3; ++i) {
+		std::optional<Switch> s = FeedConstant(governor, 10000, BUDGET * 0.2f);
+		CHECK(s && s->level == 0 && s->sample == SETTLE + WINDOW * upWindows);
+		governor.OnSwitched();
+
+		s = FeedConstant(governor, 1000, 15);
+		CHECK(s && s->level == 1 && s->sample == SETTLE + WINDOW);
+		governor.OnSwitched();
+
+		upWindows *= 2;
+	}
+}
+
+// 升级后保持了足够久，恢复默认的等待时间
+TEST(QualityGovernor_StableProbeResetsWait) {
+	QualityGovernor governor;
+	governor.Reset(2);
+	CHECK(FeedConstant(governor, 1000, 15));
+	governor.OnSwitched();
+
+	// 失败一次，等待时间加倍
+	CHECK(FeedConstant(governor, 10000, BUDGET * 0.2f));
+	governor.OnSwitched();
+	CHECK(FeedConstant(governor, 1000, 15));
+	governor.OnSwitched();
+
+	std::optional<Switch> s = FeedConstant(governor, 10000, BUDGET * 0.2f);
+	CHECK(s && s->sample == SETTLE + WINDOW * UP_WINDOWS * 2);
+	governor.OnSwitched();
+
+	// 这次升级保持了 16 个窗口
+	CHECK(!FeedConstant(governor, SETTLE + WINDOW * UP_WINDOWS * 2, BUDGET * 0.6f));
+	s = FeedConstant(governor, 1000, 15);
+	CHECK(s && s->level == 1 && s->sample == WINDOW);
+	governor.OnSwitched();
+
+	s = FeedConstant(governor, 10000, BUDGET * 0.2f);
+	CHECK(s && s->level == 0 && s->sample == SETTLE + WINDOW * UP_WINDOWS);
+}
+
+// 新的效果迟迟没有加载完成时回到原来的级别
+TEST(QualityGovernor_SwitchTimeout) {
+	QualityGovernor::Options options;
+	QualityGovernor governor(options);
+	governor.Reset(2);
+
+	CHECK(FeedConstant(governor, 1000, 15));
+	CHECK(governor.GetLevel() == 1);
+
+	CHECK(!FeedConstant(governor, options.switchTimeoutSamples - 1, 15));
+	CHECK(governor.GetLevel() == 1);
+	CHECK(!FeedConstant(governor, 1, 15));
+	CHECK(governor.GetLevel() == 0);
+
+	// 之后重新开始统计
+	std::optional<Switch> s = FeedConstant(governor, 1000, 15);
+	CHECK(s && s->level == 1 && s->sample == SETTLE + WINDOW);
+}
+
+TEST(QualityGovernor_NoLadder) {
+	QualityGovernor governor;
+	governor.Reset(1);
+	CHECK(!FeedConstant(governor, 10000, 100));
+
+	// 没有预算时不切换
+	governor.Reset(3);
+	for (UINT i = 0; i < 1000; ++i) {
+		CHECK(!governor.Update(100, 0));
+	}
+	CHECK(governor.GetLevel() == 0);
+}
+
+TEST(QualityGovernor_DroppedFrames) {
+	QualityGovernor governor;
+	governor.Reset(3);
+
+	// GPU 用时在预算内，但负载不低时丢帧
+	std::optional<Switch> s = FeedConstant(governor, 1000, BUDGET * 0.5f, 0.1f);
+	CHECK(s && s->level == 1 && s->sample == SETTLE + WINDOW);
+	governor.OnSwitched();
+
+	// 偶尔丢帧不降级
+	CHECK(!FeedConstant(governor, SETTLE + WINDOW * 100, BUDGET * 0.5f, 0.02f));
+
+	// GPU 用时很低时丢帧不是效果造成的，不降级，也不升级
+	CHECK(!FeedConstant(governor, WINDOW * 1000, BUDGET * 0.1f, 0.5f));
+	CHECK(governor.GetLevel() == 1);
+
+	// 不再丢帧后才升级
+	s = FeedConstant(governor, 10000, BUDGET * 0.1f);
+	CHECK(s && s->level == 0 && s->sample == WINDOW * UP_WINDOWS);
+}
+
+// 渲染器报告切换失败时立即回到原来的级别，不必等到超时
+TEST(QualityGovernor_SwitchFailed) {
+	QualityGovernor governor;
+	governor.Reset(3);
+
+	CHECK(FeedConstant(governor, 1000, 15));
+	CHECK(governor.IsSwitching() && governor.GetLevel() == 1);
+
+	// 其他原因的替换不会完成切换
+	governor.DiscardSamples();
+	CHECK(governor.IsSwitching() && governor.GetLevel() == 1);
+
+	governor.OnSwitchFailed();
+	CHECK(!governor.IsSwitching() && governor.GetLevel() == 0);
+
+	// 没有正在进行的切换时什么也不做
+	governor.OnSwitchFailed();
+	CHECK(governor.GetLevel() == 0);
+
+	// 之后重新开始统计
+	std::optional<Switch> s = FeedConstant(governor, 1000, 15);
+	CHECK(s && s->level == 1 && s->sample == SETTLE + WINDOW);
+}
+
+// 不是由 QualityGovernor 发起的替换只丢弃样本
+TEST(QualityGovernor_DiscardSamples) {
+	QualityGovernor governor;
+	governor.Reset(2);
+
+	CHECK(!FeedConstant(governor, SETTLE + WINDOW - 1, 15));
+	governor.DiscardSamples();
+	std::optional<Switch> s = FeedConstant(governor, 1000, 15);
+	CHECK(s && s->level == 1 && s->sample == SETTLE + WINDOW);
+}
@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "Test.h"
+#include "EffectDrawer.h"
+#include "GpuEffectChain.h"
+#include "Utils.h"
+#include "StrUtils.h"
+
+
+// 可分离实现的中间纹理为 R16G16B16A16_FLOAT，和单 Pass 实现相比只有舍入误差
+static constexpr double SEPARABLE_MIN_PSNR = 45.0;
+
+// 在参考图像上比较单 Pass 和可分离实现的输出，MagpieBatch --bench --gpu 测量两者的吞吐量
+// 在第一个显卡上执行，没有显卡时使用 WARP。找不到效果文件或无法创建设备时跳过
+TEST(Separable_MatchesSinglePass) {
+	if (!DeviceResources::Get(0)) {
+		return;
+	}
+
+	static constexpr struct {
+		const char* effect;
+		float scale;
+	} CASES[] = {
+		{ "Lanczos", 2.0f },
+		{ "Lanczos", 1.5f },
+		{ "Bicubic", 2.0f },
+		{ "Bicubic", 1.5f },
+		{ "SSimDownscaler", 0.5f }
+	};
+
+	constexpr UINT WIDTH = 128;
+	constexpr UINT HEIGHT = 96;
+
+	for (const auto& c : CASES) {
+		if (!Utils::FileExists((L"effects\\" + StrUtils::UTF8ToUTF16(c.effect) + L".hlsl").c_str())) {
+			// 从 build 文件夹运行时才能找到
+			continue;
+		}
+
+		GpuEffectChain chains[2];
+		bool success = true;
+		for (int separable = 0; separable < 2; ++separable) {
+			success = success && chains[separable].Initialize(fmt::format(
+				R"([{{"effect":"{0}","scale":[{1},{1}],"separable":{2}}}])", c.effect, c.scale, separable), 0);
+		}
+		if (!success) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("初始化 {} 失败", c.effect));
+			continue;
+		}
+
+		std::vector<BYTE> input;
+		std::vector<BYTE> results[2];
+		std::vector<BYTE> output;
+		for (UINT i = 0; i < REFERENCE_IMAGE_COUNT && success; ++i) {
+			GenerateReferenceImage(i, WIDTH, HEIGHT, input);
+
+			for (int separable = 0; separable < 2; ++separable) {
+				SIZE outputSize{};
+				if (!chains[separable].Process(input.data(), WIDTH, HEIGHT, WIDTH * 4, output, outputSize)
+					|| outputSize.cx != LONG(WIDTH * c.scale) || outputSize.cy != LONG(HEIGHT * c.scale)
+				) {
+					success = false;
+					break;
+				}
+
+				results[separable].insert(results[separable].end(), output.begin(), output.end());
+			}
+		}
+		if (!success) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("{} {} 倍时处理参考图像失败", c.effect, c.scale));
+			continue;
+		}
+
+		const double psnr = CalcPSNR(results[0], results[1]);
+		fmt::print("  {} {} 倍：单 Pass 和可分离实现的 PSNR 为 {:.2f} dB\n", c.effect, c.scale, psnr);
+
+		if (psnr < SEPARABLE_MIN_PSNR) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("{} {} 倍时两种实现的输出相差过大：{:.2f} dB",
+				c.effect, c.scale, psnr));
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "pch.h"
+
+
+// RuntimeTests 使用的最小测试框架
+// TEST 定义并注册一个测试，CHECK 失败时记录位置并继续执行当前测试
+namespace Test {
+
+typedef void (*TestFunc)();
+
+struct TestCase {
+	const char* name;
+	TestFunc func;
+};
+
+std::vector<TestCase>& GetTestCases();
+
+void ReportFailure(const char* file, int line, const std::string& msg);
+
+// 记录当前测试因缺少环境（如效果文件）而跳过，调用后应直接返回
+void ReportSkip(const std::string& reason);
+
+struct Registrar {
+	Registrar(const char* name, TestFunc func) {
+		GetTestCases().push_back({ name, func });
+	}
+};
+
+}
+
+
+#define TEST(name) \
+	static void Test_##name(); \
+	static Test::Registrar TestRegistrar_##name(#name, Test_##name); \
+	static void Test_##name()
+
+#define CHECK(expr) \
+	do { \
+		if (!(expr)) { \
+			Test::ReportFailure(__FILE__, __LINE__, #expr); \
+		} \
+	} while (0)
+
+// 浮点数比较，tolerance 为允许的最大绝对误差
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do { \
+		const double a_ = (double)(actual); \
+		const double e_ = (double)(expected); \
+		if (!(std::abs(a_ - e_) <= (double)(tolerance))) { \
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("{} = {}，期望 {}±{}", #actual, a_, e_, (double)(tolerance))); \
+		} \
+	} while (0)
@@ -0,0 +1,179 @@
+#include "pch.h"
+#include "Test.h"
+#include "CpuTiledProcessor.h"
+
+
+struct PlanCase {
+	SIZE inputSize;
+	// 缩放比例为 alignedOutput / alignment
+	UINT alignment;
+	SIZE alignedOutputSize;
+	UINT halo;
+	UINT tileSize;
+};
+
+static SIZE CalcOutputSize(const PlanCase& c) {
+	// 和效果链相同，输出尺寸四舍五入
+	return {
+		(LONG)std::lround((double)c.inputSize.cx * c.alignedOutputSize.cx / c.alignment),
+		(LONG)std::lround((double)c.inputSize.cy * c.alignedOutputSize.cy / c.alignment)
+	};
+}
+
+static const PlanCase PLAN_CASES[] = {
+	// 尺寸不变，尺寸不是块的整数倍
+	{ { 1000, 700 }, 1, { 1, 1 }, 4, 256 },
+	// 放大 2 倍
+	{ { 1023, 517 }, 1, { 2, 2 }, 5, 256 },
+	// 放大 1.5 倍，需要补齐
+	{ { 999, 333 }, 2, { 3, 3 }, 6, 300 },
+	// 缩小为 0.75 倍
+	{ { 1001, 1003 }, 4, { 3, 3 }, 8, 256 },
+	// 两个方向的比例不同
+	{ { 641, 479 }, 2, { 4, 3 }, 4, 128 },
+	// halo 大于块
+	{ { 600, 600 }, 1, { 2, 2 }, 300, 256 },
+	// 块大于图像
+	{ { 200, 100 }, 1, { 2, 2 }, 4, 2048 },
+};
+
+// 每个输出像素恰好属于一个块，每块保留的输出都不受块边缘影响
+TEST(TilePlan_OutputIsSeamFree) {
+	for (const PlanCase& c : PLAN_CASES) {
+		const SIZE outputSize = CalcOutputSize(c);
+
+		CpuTiledProcessor::Plan plan;
+		CHECK(CpuTiledProcessor::CreatePlan(c.inputSize, outputSize, c.alignedOutputSize, c.halo, c.alignment, c.tileSize, plan));
+		CHECK(plan.tileSize % c.alignment == 0);
+		CHECK(plan.paddedInputSize.cx % c.alignment == 0 && plan.paddedInputSize.cy % c.alignment == 0);
+		CHECK(plan.paddedInputSize.cx - c.inputSize.cx < (LONG)c.alignment);
+		CHECK(plan.paddedInputSize.cy - c.inputSize.cy < (LONG)c.alignment);
+		CHECK(plan.columns * plan.tileSize >= (UINT)plan.paddedInputSize.cx);
+		CHECK(plan.rows * plan.tileSize >= (UINT)plan.paddedInputSize.cy);
+
+		std::vector<BYTE> covered(size_t(outputSize.cx) * outputSize.cy);
+
+		for (UINT row = 0; row < plan.rows; ++row) {
+			for (UINT column = 0; column < plan.columns; ++column) {
+				const CpuTiledProcessor::Tile tile = CpuTiledProcessor::GetTile(plan, column, row);
+				const RECT& in = tile.inputRect;
+				const RECT& out = tile.outputRect;
+
+				CHECK(in.left >= 0 && in.top >= 0);
+				CHECK(in.right <= plan.paddedInputSize.cx && in.bottom <= plan.paddedInputSize.cy);
+				CHECK(out.left < out.right && out.top < out.bottom);
+				CHECK(out.right <= outputSize.cx && out.bottom <= outputSize.cy);
+
+				// 块的输出尺寸是精确的整数，保留的部分在其中
+				const LONG tileOutputWidth = (in.right - in.left) / (LONG)c.alignment * c.alignedOutputSize.cx;
+				const LONG tileOutputHeight = (in.bottom - in.top) / (LONG)c.alignment * c.alignedOutputSize.cy;
+				CHECK(tile.outputOffset.x >= 0 && tile.outputOffset.x + (out.right - out.left) <= tileOutputWidth);
+				CHECK(tile.outputOffset.y >= 0 && tile.outputOffset.y + (out.bottom - out.top) <= tileOutputHeight);
+
+				// 除了图像边缘，保留的部分距离块的边缘至少为 halo 对应的输出像素
+				const LONG haloX = LONG(c.halo / c.alignment * c.alignedOutputSize.cx);
+				const LONG haloY = LONG(c.halo / c.alignment * c.alignedOutputSize.cy);
+				if (in.left > 0) {
+					CHECK(tile.outputOffset.x >= haloX);
+				}
+				if (in.top > 0) {
+					CHECK(tile.outputOffset.y >= haloY);
+				}
+				if (in.right < plan.paddedInputSize.cx) {
+					CHECK(tileOutputWidth - tile.outputOffset.x - (out.right - out.left) >= haloX);
+				}
+				if (in.bottom < plan.paddedInputSize.cy) {
+					CHECK(tileOutputHeight - tile.outputOffset.y - (out.bottom - out.top) >= haloY);
+				}
+
+				// 同一行的块输出的行相同，Run 依赖这一点按行写入
+				const CpuTiledProcessor::Tile firstTile = CpuTiledProcessor::GetTile(plan, 0, row);
+				CHECK(out.top == firstTile.outputRect.top && out.bottom == firstTile.outputRect.bottom);
+
+				for (LONG y = out.top; y < out.bottom; ++y) {
+					for (LONG x = out.left; x < out.right; ++x) {
+						++covered[size_t(y) * outputSize.cx + x];
+					}
+				}
+			}
+		}
+
+		const size_t badPixels = std::count_if(covered.begin(), covered.end(), [](BYTE n) { return n != 1; });
+		if (badPixels != 0) {
+			Test::ReportFailure(__FILE__, __LINE__, fmt::format("{}x{} 的输入有 {} 个输出像素没有被恰好覆盖一次",
+				c.inputSize.cx, c.inputSize.cy, badPixels));
+		}
+	}
+}
+
+// 每一行块读取的输入行号递增，Run 只需保留和下一行重叠的 halo
+TEST(TilePlan_InputRowsAreMonotonic) {
+	for (const PlanCase& c : PLAN_CASES) {
+		CpuTiledProcessor::Plan plan;
+		CHECK(CpuTiledProcessor::CreatePlan(c.inputSize, CalcOutputSize(c), c.alignedOutputSize, c.halo, c.alignment, c.tileSize, plan));
+
+		LONG lastTop = 0;
+		LONG lastBottom = 0;
+		for (UINT row = 0; row < plan.rows; ++row) {
+			const CpuTiledProcessor::Tile tile = CpuTiledProcessor::GetTile(plan, 0, row);
+			CHECK(tile.inputRect.top >= lastTop && tile.inputRect.top <= lastBottom);
+			CHECK(tile.inputRect.bottom >= lastBottom);
+			lastTop = tile.inputRect.top;
+			lastBottom = tile.inputRect.bottom;
+		}
+		CHECK(lastBottom == plan.paddedInputSize.cy);
+	}
+}
+
+TEST(TilePlan_TileLargerThanInput) {
+	CpuTiledProcessor::Plan plan;
+	CHECK(CpuTiledProcessor::CreatePlan({ 200, 100 }, { 400, 200 }, { 2, 2 }, 4, 1, 2048, plan));
+	CHECK(plan.columns == 1 && plan.rows == 1);
+	CHECK(plan.tileSize == 200);
+
+	const CpuTiledProcessor::Tile tile = CpuTiledProcessor::GetTile(plan, 0, 0);
+	CHECK(tile.inputRect.left == 0 && tile.inputRect.top == 0);
+	CHECK(tile.inputRect.right == 200 && tile.inputRect.bottom == 100);
+	CHECK(tile.outputOffset.x == 0 && tile.outputOffset.y == 0);
+	CHECK(tile.outputRect.right == 400 && tile.outputRect.bottom == 200);
+}
+
+TEST(TilePlan_InvalidParamsAreRejected) {
+	CpuTiledProcessor::Plan plan;
+	// 块的边长为 0
+	CHECK(!CpuTiledProcessor::CreatePlan({ 100, 100 }, { 100, 100 }, { 1, 1 }, 2, 1, 0, plan));
+	// halo 没有对齐
+	CHECK(!CpuTiledProcessor::CreatePlan({ 100, 100 }, { 150, 150 }, { 3, 3 }, 3, 2, 64, plan));
+	// 缩放比例为 0
+	CHECK(!CpuTiledProcessor::CreatePlan({ 100, 100 }, { 0, 0 }, { 0, 0 }, 4, 4, 64, plan));
+	CHECK(!CpuTiledProcessor::CreatePlan({ 0, 100 }, { 0, 100 }, { 1, 1 }, 1, 1, 64, plan));
+}
+
+// 根据效果链和内存预算选择块的边长
+TEST(TilePlan_ChainPlanFitsBudget) {
+	CpuEffectChain chain;
+	CHECK(chain.Initialize(R"([{"effect":"CAS"}])"));
+
+	const SIZE inputSize{ 30000, 20000 };
+
+	CpuTiledProcessor::Plan plan;
+	CHECK(CpuTiledProcessor::CreatePlan(chain, inputSize, 0, size_t(16) << 30, plan));
+	CHECK(plan.tileSize == CpuTiledProcessor::DEFAULT_TILE_SIZE);
+	CHECK(plan.outputSize.cx == inputSize.cx && plan.outputSize.cy == inputSize.cy);
+	CHECK(plan.halo >= 1);
+
+	// 预算很小时减小到下限
+	CHECK(CpuTiledProcessor::CreatePlan(chain, inputSize, 0, 1, plan));
+	CHECK(plan.tileSize == CpuTiledProcessor::MIN_TILE_SIZE);
+
+	// 预算足够时块和缓冲区占用的内存不超过预算
+	const size_t budget = size_t(512) << 20;
+	CHECK(CpuTiledProcessor::CreatePlan(chain, inputSize, 0, budget, plan));
+	CHECK(plan.tileSize > CpuTiledProcessor::MIN_TILE_SIZE);
+	CHECK(CpuTiledProcessor::EstimateBufferMemoryUsage(plan) + CpuTiledProcessor::EstimateTileMemoryUsage(chain, plan) <= budget);
+
+	// 指定边长时不考虑预算
+	CHECK(CpuTiledProcessor::CreatePlan(chain, inputSize, 1000, 1, plan));
+	CHECK(plan.tileSize == 1000);
+	CHECK(plan.columns == 30 && plan.rows == 20);
+}
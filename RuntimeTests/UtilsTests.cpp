@@ -0,0 +1,50 @@
+#include "pch.h"
+#include "Test.h"
+#include "Utils.h"
+#include <thread>
+
+
+static std::vector<BYTE> MakeBuffer(size_t size, BYTE seed) {
+	std::vector<BYTE> buffer(size);
+	for (size_t i = 0; i < size; ++i) {
+		buffer[i] = BYTE(seed + i * 31);
+	}
+	return buffer;
+}
+
+// 缓存写入线程和编译线程同时计算 hash
+TEST(Hasher_ConcurrentHashesMatchSerialHashes) {
+	static constexpr size_t BUFFER_COUNT = 8;
+	static constexpr size_t THREAD_COUNT = 8;
+	static constexpr UINT ITERATIONS = 200;
+
+	std::vector<std::vector<BYTE>> buffers;
+	std::vector<std::vector<BYTE>> expected(BUFFER_COUNT);
+	for (size_t i = 0; i < BUFFER_COUNT; ++i) {
+		// 大小不同，使每次 Hash 都需要多次处理数据块
+		buffers.push_back(MakeBuffer(1000 + i * 4096, BYTE(i)));
+		CHECK(Utils::Hasher::GetInstance().Hash(buffers[i].data(), buffers[i].size(), expected[i]));
+	}
+
+	// ReportFailure 不是线程安全的，只在工作线程中记录不一致的次数
+	std::atomic<UINT> mismatches = 0;
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < THREAD_COUNT; ++t) {
+		threads.emplace_back([&, t]() {
+			std::vector<BYTE> hash;
+			for (UINT i = 0; i < ITERATIONS; ++i) {
+				const size_t idx = (t + i) % BUFFER_COUNT;
+				if (!Utils::Hasher::GetInstance().Hash(buffers[idx].data(), buffers[idx].size(), hash)
+					|| hash != expected[idx]
+				) {
+					++mismatches;
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	CHECK(mismatches == 0);
+}
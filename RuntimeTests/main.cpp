@@ -0,0 +1,86 @@
+// Copyright (c) 2021 - present, Liu Xu
+//
+//  This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// MagpieRT 的单元测试，直接编译 Runtime 的源文件，不需要源窗口
+// 用法：RuntimeTests [名字过滤]，只运行名字包含过滤字符串的测试
+// 有测试失败时返回 1
+
+#include "pch.h"
+#include "Test.h"
+#include "Utils.h"
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+
+std::shared_ptr<spdlog::logger> logger = nullptr;
+
+static int failures = 0;
+static int skips = 0;
+
+std::vector<Test::TestCase>& Test::GetTestCases() {
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+void Test::ReportFailure(const char* file, int line, const std::string& msg) {
+	++failures;
+	fmt::print(stderr, "  {}({}): 失败：{}\n", file, line, msg);
+}
+
+void Test::ReportSkip(const std::string& reason) {
+	++skips;
+	fmt::print("  跳过：{}\n", reason);
+}
+
+int main(int argc, char* argv[]) {
+	SetConsoleOutputCP(CP_UTF8);
+
+	// 被测代码的日志只输出警告和错误
+	logger = spdlog::stderr_color_mt("RuntimeTests");
+	logger->set_level(spdlog::level::warn);
+	logger->set_pattern("  [%l] %v");
+
+	if (!Utils::Hasher::GetInstance().Initialize()) {
+		fmt::print(stderr, "初始化 Hasher 失败\n");
+		return 1;
+	}
+
+	const std::string_view filter = argc > 1 ? argv[1] : "";
+
+	UINT run = 0;
+	UINT failed = 0;
+	UINT skipped = 0;
+	for (const Test::TestCase& testCase : Test::GetTestCases()) {
+		if (!filter.empty() && std::string_view(testCase.name).find(filter) == std::string_view::npos) {
+			continue;
+		}
+
+		fmt::print("{}\n", testCase.name);
+
+		const int before = failures;
+		const int skipsBefore = skips;
+		testCase.func();
+		++run;
+
+		if (failures != before) {
+			++failed;
+		} else if (skips != skipsBefore) {
+			++skipped;
+		}
+	}
+
+	fmt::print("\n运行了 {} 个测试，{} 个失败，{} 个跳过\n", run, failed, skipped);
+	return failed == 0 ? 0 : 1;
+}